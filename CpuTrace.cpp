@@ -0,0 +1,192 @@
+//--------------------------------------------------------------------------------------
+// File: CpuTrace.cpp
+//
+// Scoped CPU timing markers and their Chrome trace export
+//--------------------------------------------------------------------------------------
+
+#include "CpuTrace.h"
+
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+
+std::atomic<bool> CpuTrace::s_enabled( false );
+
+namespace
+{
+    struct TraceEvent
+    {
+        const char*     name;
+        uint64_t        startNs;
+        uint64_t        endNs;
+    };
+
+    //? Written only by its thread; 'count' publishes the events before it
+    struct ThreadBuffer
+    {
+        uint32_t                        tid = 0;
+        std::string                     name;           // guarded by the registry mutex
+        const char*                     namePointer = nullptr;
+        std::unique_ptr<TraceEvent[]>   events;
+        std::atomic<size_t>             count{ 0 };
+        std::atomic<uint64_t>           dropped{ 0 };
+    };
+
+    //? Buffers live until exit, so threads may end before the export
+    struct Registry
+    {
+        std::mutex                                  mutex;
+        std::vector<std::unique_ptr<ThreadBuffer>>  buffers;
+    };
+
+    Registry& GetRegistry()
+    {
+        static Registry registry;
+        return registry;
+    }
+
+    thread_local ThreadBuffer* t_buffer = nullptr;
+
+    //? Null if the buffer could not be set up: out of memory, or the registry lock threw.
+    //? The thread's events are dropped then, since a marker must never throw.
+    ThreadBuffer* ThisThreadBuffer() noexcept
+    {
+        if( t_buffer )
+            return t_buffer;
+
+        try
+        {
+            std::unique_ptr<ThreadBuffer> buffer( new ThreadBuffer );
+            buffer->events.reset( new TraceEvent[CpuTrace::kEventsPerThread] );
+
+            Registry& registry = GetRegistry();
+            std::lock_guard<std::mutex> lock( registry.mutex );
+            buffer->tid = uint32_t( registry.buffers.size() + 1 );
+            registry.buffers.push_back( std::move( buffer ) );
+            t_buffer = registry.buffers.back().get();
+        }
+        catch( ... )
+        {
+            return nullptr;
+        }
+        return t_buffer;
+    }
+
+    void AppendEscaped( std::string& out, const char* text )
+    {
+        for( ; *text; ++text )
+        {
+            if( *text == '"' || *text == '\\' )
+                out += '\\';
+            if( static_cast<unsigned char>( *text ) >= 0x20 )
+                out += *text;
+        }
+    }
+}
+
+//--------------------------------------------------------------------------------------
+void CpuTrace::SetThreadName( const char* name )
+{
+    if( !Enabled() )
+        return;
+    ThreadBuffer* buffer = ThisThreadBuffer();
+    if( !buffer || buffer->namePointer == name )
+        return;
+
+    std::lock_guard<std::mutex> lock( GetRegistry().mutex );
+    buffer->name = name;
+    buffer->namePointer = name;
+}
+
+void CpuTrace::Record( const char* name, uint64_t startNs, uint64_t endNs ) noexcept
+{
+    ThreadBuffer* buffer = ThisThreadBuffer();
+    if( !buffer )
+        return;
+
+    const size_t count = buffer->count.load( std::memory_order_relaxed );
+    if( count == kEventsPerThread )
+    {
+        buffer->dropped.fetch_add( 1, std::memory_order_relaxed );
+        return;
+    }
+    buffer->events[count] = TraceEvent{ name, startNs, endNs };
+    buffer->count.store( count + 1, std::memory_order_release );
+}
+
+std::string CpuTrace::ExportChromeJSON()
+{
+    Registry& registry = GetRegistry();
+    std::lock_guard<std::mutex> lock( registry.mutex );
+
+    //? Timestamps are microseconds from the first event, so the timeline starts at 0
+    uint64_t origin = UINT64_MAX;
+    for( const std::unique_ptr<ThreadBuffer>& buffer : registry.buffers )
+    {
+        const size_t count = buffer->count.load( std::memory_order_acquire );
+        for( size_t i = 0; i < count; ++i )
+            origin = buffer->events[i].startNs < origin ? buffer->events[i].startNs : origin;
+    }
+
+    std::string out = "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+    bool first = true;
+    char text[160];
+    for( const std::unique_ptr<ThreadBuffer>& buffer : registry.buffers )
+    {
+        if( !buffer->name.empty() )
+        {
+            snprintf( text, sizeof( text ), "%s\n{\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"name\":\"thread_name\",\"args\":{\"name\":\"",
+                      first ? "" : ",", buffer->tid );
+            out += text;
+            AppendEscaped( out, buffer->name.c_str() );
+            out += "\"}}";
+            first = false;
+        }
+
+        const size_t count = buffer->count.load( std::memory_order_acquire );
+        for( size_t i = 0; i < count; ++i )
+        {
+            const TraceEvent& event = buffer->events[i];
+            out += first ? "\n{\"ph\":\"X\",\"pid\":1,\"name\":\"" : ",\n{\"ph\":\"X\",\"pid\":1,\"name\":\"";
+            AppendEscaped( out, event.name );
+            snprintf( text, sizeof( text ), "\",\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f}", buffer->tid,
+                      double( event.startNs - origin ) / 1000.0, double( event.endNs - event.startNs ) / 1000.0 );
+            out += text;
+            first = false;
+        }
+    }
+    out += "\n]}\n";
+    return out;
+}
+
+bool CpuTrace::WriteChromeJSON( const char* path )
+{
+    const std::string json = ExportChromeJSON();
+    FILE* file = fopen( path, "wb" );
+    if( !file )
+        return false;
+    const bool ok = fwrite( json.data(), 1, json.size(), file ) == json.size();
+    return fclose( file ) == 0 && ok;
+}
+
+uint64_t CpuTrace::EventCount()
+{
+    Registry& registry = GetRegistry();
+    std::lock_guard<std::mutex> lock( registry.mutex );
+    uint64_t events = 0;
+    for( const std::unique_ptr<ThreadBuffer>& buffer : registry.buffers )
+        events += buffer->count.load( std::memory_order_acquire );
+    return events;
+}
+
+uint64_t CpuTrace::DroppedCount()
+{
+    Registry& registry = GetRegistry();
+    std::lock_guard<std::mutex> lock( registry.mutex );
+    uint64_t dropped = 0;
+    for( const std::unique_ptr<ThreadBuffer>& buffer : registry.buffers )
+        dropped += buffer->dropped.load( std::memory_order_relaxed );
+    return dropped;
+}
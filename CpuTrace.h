@@ -0,0 +1,83 @@
+//--------------------------------------------------------------------------------------
+// File: CpuTrace.h
+//
+// Scoped CPU timing markers, exported in the Chrome trace event format (chrome://tracing,
+// ui.perfetto.dev). Every thread records into a buffer of its own, so a marker costs a
+// clock read at each end and a store, with no locks or atomics shared between threads;
+// the exporter reads each buffer up to its published count. A full buffer drops further
+// events instead of wrapping.
+//
+// While tracing is disabled a marker is one relaxed load and a branch. Marker names must
+// be string literals, or otherwise outlive the export.
+//--------------------------------------------------------------------------------------
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+
+class CpuTrace
+{
+public:
+    static const size_t kEventsPerThread = 1 << 16;
+
+    static void Enable( bool enable ) noexcept { s_enabled.store( enable, std::memory_order_relaxed ); }
+    static bool Enabled() noexcept { return s_enabled.load( std::memory_order_relaxed ); }
+
+    // Shown as the thread's name in the trace; cheap to call again with the same pointer.
+    // Ignored while tracing is disabled, so untraced threads allocate no buffer.
+    static void SetThreadName( const char* name );
+
+    static uint64_t Now() noexcept
+    {
+        return uint64_t( std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch() ).count() );
+    }
+
+    // Adds a complete event to the calling thread's buffer
+    static void Record( const char* name, uint64_t startNs, uint64_t endNs ) noexcept;
+
+    // Everything recorded so far, as a Chrome trace JSON object
+    static std::string ExportChromeJSON();
+    static bool WriteChromeJSON( const char* path );
+
+    static uint64_t EventCount();
+    static uint64_t DroppedCount();
+
+private:
+    static std::atomic<bool>    s_enabled;
+};
+
+//? Times the enclosing scope while tracing is enabled
+class CpuTraceScope
+{
+public:
+    explicit CpuTraceScope( const char* name ) noexcept
+    {
+        if( CpuTrace::Enabled() )
+        {
+            m_name = name;
+            m_start = CpuTrace::Now();
+        }
+    }
+    ~CpuTraceScope()
+    {
+        if( m_name )
+            CpuTrace::Record( m_name, m_start, CpuTrace::Now() );
+    }
+
+    CpuTraceScope( const CpuTraceScope& ) = delete;
+    CpuTraceScope& operator=( const CpuTraceScope& ) = delete;
+
+private:
+    const char*     m_name = nullptr;
+    uint64_t        m_start = 0;
+};
+
+#define CPU_TRACE_CONCAT_( a, b ) a##b
+#define CPU_TRACE_CONCAT( a, b ) CPU_TRACE_CONCAT_( a, b )
+#define CPU_TRACE_SCOPE( name ) CpuTraceScope CPU_TRACE_CONCAT( cpuTraceScope, __LINE__ )( name )
@@ -0,0 +1,187 @@
+//--------------------------------------------------------------------------------------
+// File: D3D11CommandRecorder.cpp
+//
+// Deferred-context command recording for a D3D11 window
+//--------------------------------------------------------------------------------------
+
+#include "D3D11CommandRecorder.h"
+
+#include <cstring>
+
+
+namespace
+{
+    //? Per context; 1024 quads before the ring wraps
+    const UINT kRecorderRingBytes = 256 * 1024;
+    const UINT kRecorderRingAlignment = 16 * 16;
+
+    template<typename T>
+    void SafeRelease( T*& p )
+    {
+        if( p )
+        {
+            p->Release();
+            p = nullptr;
+        }
+    }
+}
+
+//--------------------------------------------------------------------------------------
+D3D11CommandRecorder::D3D11CommandRecorder( D3D11RenderDevice& device, D3D11RenderWindow& window, size_t deferredContexts ) :
+    m_device( device ),
+    m_window( window ),
+    m_deferredContexts( deferredContexts )
+{
+}
+
+D3D11CommandRecorder::~D3D11CommandRecorder()
+{
+    for( ID3D11CommandList*& list : m_commandLists )
+        SafeRelease( list );
+    for( RecordingContext& rc : m_contexts )
+    {
+        SafeRelease( rc.constants );
+        SafeRelease( rc.context1 );
+        SafeRelease( rc.context );
+    }
+}
+
+HRESULT D3D11CommandRecorder::Init()
+{
+    ID3D11Device* device = m_device.Device();
+    const bool useRing = m_device.HasConstantRing();
+
+    m_contexts.resize( m_deferredContexts ? m_deferredContexts : 1 );
+    for( RecordingContext& rc : m_contexts )
+    {
+        HRESULT hr = S_OK;
+        if( m_deferredContexts )
+        {
+            hr = device->CreateDeferredContext( 0, &rc.context );
+            if( FAILED( hr ) )
+                return hr;
+        }
+        else
+        {
+            rc.context = m_device.Context();
+            rc.context->AddRef();
+        }
+
+        if( useRing )
+        {
+            hr = rc.context->QueryInterface( __uuidof( ID3D11DeviceContext1 ), reinterpret_cast<void**>( &rc.context1 ) );
+            if( FAILED( hr ) )
+                return hr;
+        }
+
+        D3D11_BUFFER_DESC bd = {};
+        bd.Usage = D3D11_USAGE_DYNAMIC;
+        bd.ByteWidth = useRing ? kRecorderRingBytes : UINT( sizeof( FrameConstants ) );
+        bd.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
+        bd.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+        hr = device->CreateBuffer( &bd, nullptr, &rc.constants );
+        if( FAILED( hr ) )
+            return hr;
+        m_device.Resources().Track( rc.constants, "scene recorder" );
+
+        //? A deferred context's first map of a buffer in each command list has to DISCARD,
+        //? so the ring starts over per recording and never waits on fences
+        if( useRing )
+            rc.ring.reset( new UploadRing( kRecorderRingBytes, kRecorderRingAlignment, UploadRing::WRAP_DISCARD ) );
+    }
+    return S_OK;
+}
+
+bool D3D11CommandRecorder::BeginSubmission( size_t chunkCount )
+{
+    for( ID3D11CommandList*& list : m_commandLists )
+        SafeRelease( list );
+    m_commandLists.assign( Deferred() ? chunkCount : 0, nullptr );
+    return true;
+}
+
+bool D3D11CommandRecorder::UploadQuadConstants( RecordingContext& rc, const FrameConstants& constants )
+{
+    ID3D11DeviceContext* context = rc.context;
+    D3D11_MAPPED_SUBRESOURCE mapped = {};
+
+    if( !rc.ring )
+    {
+        if( FAILED( context->Map( rc.constants, 0, D3D11_MAP_WRITE_DISCARD, 0, &mapped ) ) )
+            return false;
+        memcpy( mapped.pData, &constants, sizeof( constants ) );
+        context->Unmap( rc.constants, 0 );
+        return true;
+    }
+
+    const UploadRing::Allocation allocation = rc.ring->Allocate( sizeof( constants ) );
+    if( !allocation.valid ||
+        FAILED( context->Map( rc.constants, 0, allocation.discard ? D3D11_MAP_WRITE_DISCARD : D3D11_MAP_WRITE_NO_OVERWRITE, 0, &mapped ) ) )
+        return false;
+    memcpy( static_cast<uint8_t*>( mapped.pData ) + allocation.offset, &constants, sizeof( constants ) );
+    context->Unmap( rc.constants, 0 );
+
+    // Same buffer at a new offset: unbind first, as D3D11StateCache does
+    const UINT firstConstant = UINT( allocation.offset / 16 );
+    const UINT numConstants = UINT( allocation.size / 16 );
+    ID3D11Buffer* nullBuffer = nullptr;
+    context->VSSetConstantBuffers( 2, 1, &nullBuffer );
+    context->PSSetConstantBuffers( 2, 1, &nullBuffer );
+    rc.context1->VSSetConstantBuffers1( 2, 1, &rc.constants, &firstConstant, &numConstants );
+    rc.context1->PSSetConstantBuffers1( 2, 1, &rc.constants, &firstConstant, &numConstants );
+    return true;
+}
+
+bool D3D11CommandRecorder::RecordChunk( size_t context, size_t chunk, const FrameConstants* quads, size_t count )
+{
+    if( context >= m_contexts.size() || ( Deferred() && chunk >= m_commandLists.size() ) )
+        return false;
+
+    RecordingContext& rc = m_contexts[context];
+
+    // Deferred contexts start every command list from default state, and the first map
+    // of a dynamic buffer in each list has to discard
+    m_window.BindQuadPipeline( rc.context );
+    if( rc.ring )
+    {
+        rc.ring->Reset();
+    }
+    else
+    {
+        rc.context->VSSetConstantBuffers( 2, 1, &rc.constants );
+        rc.context->PSSetConstantBuffers( 2, 1, &rc.constants );
+    }
+
+    bool ok = true;
+    const UINT indexCount = m_device.QuadIndexCount();
+    for( size_t i = 0; i < count && ok; ++i )
+    {
+        ok = UploadQuadConstants( rc, quads[i] );
+        if( ok )
+            rc.context->DrawIndexed( indexCount, 0, 0 );
+    }
+
+    if( Deferred() )
+    {
+        // Finish even after a failure so the context is ready for its next chunk
+        if( FAILED( rc.context->FinishCommandList( FALSE, &m_commandLists[chunk] ) ) )
+            ok = false;
+    }
+    return ok;
+}
+
+void D3D11CommandRecorder::ExecuteChunks()
+{
+    ID3D11DeviceContext* immediate = m_device.Context();
+    for( ID3D11CommandList*& list : m_commandLists )
+    {
+        if( list )
+            immediate->ExecuteCommandList( list, FALSE );
+        SafeRelease( list );
+    }
+    m_commandLists.clear();
+
+    // Executing a list resets the immediate context's state, and immediate recording
+    // bound everything on the raw context
+    m_device.StateCache().InvalidateAll();
+}
@@ -0,0 +1,58 @@
+//--------------------------------------------------------------------------------------
+// File: D3D11CommandRecorder.h
+//
+// CommandRecorder for one D3D11 window. Chunks are recorded into deferred contexts,
+// each finishing into an ID3D11CommandList, and executed on the immediate context in
+// chunk order. With no deferred contexts the chunks are drawn straight on the
+// immediate context instead, which is the serial baseline.
+//
+// Every context uploads its per-quad constants through its own constant ring when the
+// device supports constant buffer offsets, and through one DISCARD-mapped buffer
+// otherwise.
+//--------------------------------------------------------------------------------------
+
+#pragma once
+
+#include <memory>
+#include <vector>
+
+#include "RenderDeviceD3D11.h"
+#include "SceneRecording.h"
+#include "UploadRing.h"
+
+
+class D3D11CommandRecorder : public CommandRecorder
+{
+public:
+    D3D11CommandRecorder( D3D11RenderDevice& device, D3D11RenderWindow& window, size_t deferredContexts );
+    ~D3D11CommandRecorder() override;
+
+    D3D11CommandRecorder( const D3D11CommandRecorder& ) = delete;
+    D3D11CommandRecorder& operator=( const D3D11CommandRecorder& ) = delete;
+
+    HRESULT Init();
+
+    bool Deferred() const noexcept { return m_deferredContexts > 0; }
+
+    size_t ContextCount() const noexcept override { return m_contexts.size(); }
+    bool BeginSubmission( size_t chunkCount ) override;
+    bool RecordChunk( size_t context, size_t chunk, const FrameConstants* quads, size_t count ) override;
+    void ExecuteChunks() override;
+
+private:
+    struct RecordingContext
+    {
+        ID3D11DeviceContext*        context = nullptr;
+        ID3D11DeviceContext1*       context1 = nullptr;     // only with a constant ring
+        ID3D11Buffer*               constants = nullptr;
+        std::unique_ptr<UploadRing> ring;
+    };
+
+    bool UploadQuadConstants( RecordingContext& rc, const FrameConstants& constants );
+
+    D3D11RenderDevice&              m_device;
+    D3D11RenderWindow&              m_window;
+    const size_t                    m_deferredContexts;
+    std::vector<RecordingContext>   m_contexts;
+    std::vector<ID3D11CommandList*> m_commandLists;     // one per chunk
+};
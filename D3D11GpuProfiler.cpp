@@ -0,0 +1,108 @@
+//--------------------------------------------------------------------------------------
+// File: D3D11GpuProfiler.cpp
+//
+// D3D11 queries behind a GpuProfiler
+//--------------------------------------------------------------------------------------
+
+#include "D3D11GpuProfiler.h"
+
+
+namespace
+{
+    template<typename T>
+    void SafeRelease( T*& p )
+    {
+        if( p )
+        {
+            p->Release();
+            p = nullptr;
+        }
+    }
+
+    ITimestampBackend::QueryResult ToQueryResult( HRESULT hr )
+    {
+        if( hr == S_FALSE )
+            return ITimestampBackend::QUERY_BUSY;
+        return SUCCEEDED( hr ) ? ITimestampBackend::QUERY_OK : ITimestampBackend::QUERY_FAILED;
+    }
+}
+
+//--------------------------------------------------------------------------------------
+HRESULT D3D11TimestampBackend::Init( ID3D11Device* device, ID3D11DeviceContext* context, size_t slotCount, size_t timestampsPerSlot )
+{
+    Release();
+
+    D3D11_QUERY_DESC desc = {};
+    desc.Query = D3D11_QUERY_TIMESTAMP_DISJOINT;
+    m_disjoint.assign( slotCount, nullptr );
+    for( ID3D11Query*& query : m_disjoint )
+    {
+        HRESULT hr = device->CreateQuery( &desc, &query );
+        if( FAILED( hr ) )
+            return hr;
+    }
+
+    desc.Query = D3D11_QUERY_TIMESTAMP;
+    m_timestamps.assign( slotCount * timestampsPerSlot, nullptr );
+    for( ID3D11Query*& query : m_timestamps )
+    {
+        HRESULT hr = device->CreateQuery( &desc, &query );
+        if( FAILED( hr ) )
+            return hr;
+    }
+
+    m_context = context;
+    m_timestampsPerSlot = timestampsPerSlot;
+    return S_OK;
+}
+
+void D3D11TimestampBackend::Release()
+{
+    for( ID3D11Query*& query : m_timestamps )
+        SafeRelease( query );
+    for( ID3D11Query*& query : m_disjoint )
+        SafeRelease( query );
+    m_timestamps.clear();
+    m_disjoint.clear();
+}
+
+void D3D11TimestampBackend::BeginDisjoint( size_t slot )
+{
+    m_context->Begin( m_disjoint[slot] );
+}
+
+void D3D11TimestampBackend::EndDisjoint( size_t slot )
+{
+    m_context->End( m_disjoint[slot] );
+}
+
+void D3D11TimestampBackend::WriteTimestamp( size_t slot, size_t query )
+{
+    if( query < m_timestampsPerSlot )
+        m_context->End( m_timestamps[slot * m_timestampsPerSlot + query] );
+}
+
+ITimestampBackend::QueryResult D3D11TimestampBackend::GetDisjoint( size_t slot, uint64_t* frequency, bool* disjoint )
+{
+    D3D11_QUERY_DATA_TIMESTAMP_DISJOINT data = {};
+    const QueryResult result = ToQueryResult( m_context->GetData( m_disjoint[slot], &data, sizeof( data ), D3D11_ASYNC_GETDATA_DONOTFLUSH ) );
+    if( result == QUERY_OK )
+    {
+        *frequency = data.Frequency;
+        *disjoint = data.Disjoint != FALSE;
+    }
+    return result;
+}
+
+ITimestampBackend::QueryResult D3D11TimestampBackend::GetTimestamp( size_t slot, size_t query, uint64_t* ticks )
+{
+    if( query >= m_timestampsPerSlot )
+        return QUERY_FAILED;
+
+    UINT64 data = 0;
+    const QueryResult result = ToQueryResult( m_context->GetData( m_timestamps[slot * m_timestampsPerSlot + query], &data, sizeof( data ),
+                                                                  D3D11_ASYNC_GETDATA_DONOTFLUSH ) );
+    if( result == QUERY_OK )
+        *ticks = data;
+    return result;
+}
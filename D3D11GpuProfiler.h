@@ -0,0 +1,40 @@
+//--------------------------------------------------------------------------------------
+// File: D3D11GpuProfiler.h
+//
+// D3D11 queries behind a GpuProfiler: one TIMESTAMP_DISJOINT query and a block of
+// TIMESTAMP queries per ring slot. Results are fetched with DONOTFLUSH, so reading them
+// never stalls or flushes the context.
+//--------------------------------------------------------------------------------------
+
+#pragma once
+
+#include <windows.h>
+#include <d3d11_1.h>
+
+#include <vector>
+
+#include "GpuProfiler.h"
+
+
+class D3D11TimestampBackend : public ITimestampBackend
+{
+public:
+    ~D3D11TimestampBackend() override { Release(); }
+
+    // timestampsPerSlot is 2 * ( maxScopes + 1 ) for the profiler it serves
+    HRESULT Init( ID3D11Device* device, ID3D11DeviceContext* context, size_t slotCount, size_t timestampsPerSlot );
+    void Release();
+
+    void BeginDisjoint( size_t slot ) override;
+    void EndDisjoint( size_t slot ) override;
+    void WriteTimestamp( size_t slot, size_t query ) override;
+
+    QueryResult GetDisjoint( size_t slot, uint64_t* frequency, bool* disjoint ) override;
+    QueryResult GetTimestamp( size_t slot, size_t query, uint64_t* ticks ) override;
+
+private:
+    ID3D11DeviceContext*        m_context = nullptr;
+    size_t                      m_timestampsPerSlot = 0;
+    std::vector<ID3D11Query*>   m_disjoint;
+    std::vector<ID3D11Query*>   m_timestamps;       // slot-major
+};
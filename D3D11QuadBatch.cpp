@@ -0,0 +1,162 @@
+//--------------------------------------------------------------------------------------
+// File: D3D11QuadBatch.cpp
+//
+// Instanced drawing of batched quads on D3D11
+//--------------------------------------------------------------------------------------
+
+#include "D3D11QuadBatch.h"
+
+#include <cstring>
+
+
+namespace
+{
+    template<typename T>
+    void SafeRelease( T*& p )
+    {
+        if( p )
+        {
+            p->Release();
+            p = nullptr;
+        }
+    }
+}
+
+//--------------------------------------------------------------------------------------
+D3D11QuadBatchRenderer::D3D11QuadBatchRenderer( D3D11RenderDevice& device, size_t program ) :
+    m_device( device ),
+    m_programIndex( program )
+{
+}
+
+D3D11QuadBatchRenderer::~D3D11QuadBatchRenderer()
+{
+    for( ID3D11ShaderResourceView*& material : m_materials )
+        SafeRelease( material );
+    SafeRelease( m_instanceBuffer );
+}
+
+HRESULT D3D11QuadBatchRenderer::Init()
+{
+    return m_device.GetProgram( m_programIndex, &m_program );
+}
+
+uint32_t D3D11QuadBatchRenderer::AddMaterial( ID3D11ShaderResourceView* textureArray )
+{
+    if( textureArray )
+        textureArray->AddRef();
+    m_materials.push_back( textureArray );
+    return uint32_t( m_materials.size() - 1 );
+}
+
+HRESULT D3D11QuadBatchRenderer::ReserveInstances( size_t count )
+{
+    if( count <= m_instanceCapacity )
+        return S_OK;
+
+    size_t capacity = m_instanceCapacity ? m_instanceCapacity : 1024;
+    while( capacity < count )
+        capacity *= 2;
+
+    SafeRelease( m_instanceBuffer );
+    m_instanceCapacity = 0;
+
+    D3D11_BUFFER_DESC bd = {};
+    bd.Usage = D3D11_USAGE_DYNAMIC;
+    bd.ByteWidth = UINT( capacity * sizeof( QuadInstance ) );
+    bd.BindFlags = D3D11_BIND_VERTEX_BUFFER;
+    bd.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+    HRESULT hr = m_device.Device()->CreateBuffer( &bd, nullptr, &m_instanceBuffer );
+    if( FAILED( hr ) )
+        return hr;
+    m_device.Resources().Track( m_instanceBuffer, "quad batch" );
+
+    m_instanceCapacity = capacity;
+    return S_OK;
+}
+
+HRESULT D3D11QuadBatchRenderer::Draw( const QuadBatcher& batcher )
+{
+    m_lastDraws = 0;
+    const std::vector<QuadInstance>& instances = batcher.Instances();
+    if( instances.empty() || !m_program )
+        return S_OK;
+
+    HRESULT hr = ReserveInstances( instances.size() );
+    if( FAILED( hr ) )
+        return hr;
+
+    //? Upload every instance of the frame at once
+    ID3D11DeviceContext* context = m_device.Context();
+    D3D11_MAPPED_SUBRESOURCE mapped = {};
+    hr = context->Map( m_instanceBuffer, 0, D3D11_MAP_WRITE_DISCARD, 0, &mapped );
+    if( FAILED( hr ) )
+        return hr;
+    memcpy( mapped.pData, instances.data(), instances.size() * sizeof( QuadInstance ) );
+    context->Unmap( m_instanceBuffer, 0 );
+
+    D3D11StateCache& state = m_device.StateCache();
+    ID3D11Buffer* vertexBuffers[] = { m_device.QuadVertexBuffer(), m_instanceBuffer };
+    UINT strides[] = { sizeof( QuadVertex ), sizeof( QuadInstance ) };
+    UINT offsets[] = { 0, 0 };
+    ID3D11SamplerState* sampler = m_device.LinearSampler();
+    state.IASetInputLayout( m_program->inputLayout );
+    state.IASetVertexBuffers( 0, 2, vertexBuffers, strides, offsets );
+    state.IASetIndexBuffer( m_device.QuadIndexBuffer(), DXGI_FORMAT_R16_UINT, 0 );
+    state.IASetPrimitiveTopology( D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST );
+    state.VSSetShader( m_program->vertexShader );
+    state.PSSetShader( m_program->pixelShader );
+    state.PSSetSamplers( 0, 1, &sampler );
+
+    //? Batches come sorted by material, so each texture array is bound once
+    for( const QuadBatch& batch : batcher.Batches() )
+    {
+        if( batch.material >= m_materials.size() )
+            continue;
+        state.PSSetShaderResources( 0, 1, &m_materials[batch.material] );
+        context->DrawIndexedInstanced( m_device.QuadIndexCount(), batch.instanceCount, 0, 0, batch.firstInstance );
+        ++m_lastDraws;
+    }
+    return S_OK;
+}
+
+//--------------------------------------------------------------------------------------
+HRESULT CreateTextureArray( ID3D11Device* device, ID3D11DeviceContext* context, ID3D11Texture2D* const* slices, UINT sliceCount,
+                            ID3D11ShaderResourceView** textureArray )
+{
+    if( !sliceCount || !slices[0] )
+        return E_INVALIDARG;
+
+    D3D11_TEXTURE2D_DESC desc;
+    slices[0]->GetDesc( &desc );
+    desc.ArraySize = sliceCount;
+    desc.Usage = D3D11_USAGE_DEFAULT;
+    desc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+    desc.CPUAccessFlags = 0;
+    desc.MiscFlags = 0;
+
+    ID3D11Texture2D* texture = nullptr;
+    HRESULT hr = device->CreateTexture2D( &desc, nullptr, &texture );
+    if( FAILED( hr ) )
+        return hr;
+
+    for( UINT slice = 0; slice < sliceCount; ++slice )
+    {
+        for( UINT mip = 0; mip < desc.MipLevels; ++mip )
+        {
+            context->CopySubresourceRegion( texture, D3D11CalcSubresource( mip, slice, desc.MipLevels ), 0, 0, 0,
+                                            slices[slice], D3D11CalcSubresource( mip, 0, desc.MipLevels ), nullptr );
+        }
+    }
+
+    D3D11_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
+    srvDesc.Format = desc.Format;
+    srvDesc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE2DARRAY;
+    srvDesc.Texture2DArray.MostDetailedMip = 0;
+    srvDesc.Texture2DArray.MipLevels = desc.MipLevels;
+    srvDesc.Texture2DArray.FirstArraySlice = 0;
+    srvDesc.Texture2DArray.ArraySize = sliceCount;
+    hr = device->CreateShaderResourceView( texture, &srvDesc, textureArray );
+    texture->Release();
+    return hr;
+}
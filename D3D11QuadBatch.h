@@ -0,0 +1,54 @@
+//--------------------------------------------------------------------------------------
+// File: D3D11QuadBatch.h
+//
+// Draws QuadBatcher output on a D3D11 window: the instances go into one dynamic vertex
+// buffer per frame, and each batch is a single DrawIndexedInstanced of the shared quad
+// with its material's texture array bound.
+//--------------------------------------------------------------------------------------
+
+#pragma once
+
+#include <vector>
+
+#include "QuadBatch.h"
+#include "RenderDeviceD3D11.h"
+
+
+class D3D11QuadBatchRenderer
+{
+public:
+    // 'program' must have been registered with VERTEX_LAYOUT_QUAD_INSTANCED
+    D3D11QuadBatchRenderer( D3D11RenderDevice& device, size_t program );
+    ~D3D11QuadBatchRenderer();
+
+    D3D11QuadBatchRenderer( const D3D11QuadBatchRenderer& ) = delete;
+    D3D11QuadBatchRenderer& operator=( const D3D11QuadBatchRenderer& ) = delete;
+
+    HRESULT Init();
+
+    // Materials are texture arrays, indexed in the order they are added; the renderer
+    // keeps its own reference
+    uint32_t AddMaterial( ID3D11ShaderResourceView* textureArray );
+    uint32_t MaterialCount() const noexcept { return uint32_t( m_materials.size() ); }
+
+    // Draws into whatever the window bound in BeginFrame
+    HRESULT Draw( const QuadBatcher& batcher );
+
+    UINT LastDrawCount() const noexcept { return m_lastDraws; }
+
+private:
+    HRESULT ReserveInstances( size_t count );
+
+    D3D11RenderDevice&                      m_device;
+    const size_t                            m_programIndex;
+    const D3D11ShaderProgram*               m_program = nullptr;
+    ID3D11Buffer*                           m_instanceBuffer = nullptr;
+    size_t                                  m_instanceCapacity = 0;
+    std::vector<ID3D11ShaderResourceView*>  m_materials;
+    UINT                                    m_lastDraws = 0;
+};
+
+// Builds a texture array with one slice per source texture, copying every mip. The
+// sources must share size, format and mip count.
+HRESULT CreateTextureArray( ID3D11Device* device, ID3D11DeviceContext* context, ID3D11Texture2D* const* slices, UINT sliceCount,
+                            ID3D11ShaderResourceView** textureArray );
@@ -0,0 +1,212 @@
+//--------------------------------------------------------------------------------------
+// File: D3D11StateCache.cpp
+//
+// Redundant state-change filtering for a D3D11 device context
+//--------------------------------------------------------------------------------------
+
+#include "D3D11StateCache.h"
+
+
+namespace
+{
+    //? Per-slot arguments as the filter compares them; none of these have padding
+    struct VertexBufferBinding
+    {
+        ID3D11Buffer*   buffer;
+        UINT            stride;
+        UINT            offset;
+    };
+
+    struct IndexBufferBinding
+    {
+        ID3D11Buffer*   buffer;
+        DXGI_FORMAT     format;
+        UINT            offset;
+    };
+
+    struct ConstantBufferBinding
+    {
+        ID3D11Buffer*   buffer;
+        UINT            firstConstant;      // 0 and 0 for a whole-buffer bind
+        UINT            numConstants;
+    };
+
+    struct RenderTargetBinding
+    {
+        ID3D11RenderTargetView* views[D3D11_SIMULTANEOUS_RENDER_TARGET_COUNT];
+        ID3D11DepthStencilView* depthStencil;
+        UINT                    count;
+        UINT                    unused;
+    };
+}
+
+//--------------------------------------------------------------------------------------
+void D3D11StateCache::Attach( ID3D11DeviceContext* context, ID3D11DeviceContext1* context1 )
+{
+    m_context = context;
+    m_context1 = context1;
+    m_filter.InvalidateAll();
+}
+
+void D3D11StateCache::IASetInputLayout( ID3D11InputLayout* layout )
+{
+    if( m_filter.Update( STATE_IA_INPUT_LAYOUT, 0, 1, &layout, sizeof( layout ) ) )
+        m_context->IASetInputLayout( layout );
+}
+
+void D3D11StateCache::IASetVertexBuffers( UINT startSlot, UINT count, ID3D11Buffer* const* buffers, const UINT* strides, const UINT* offsets )
+{
+    VertexBufferBinding bindings[D3D11_IA_VERTEX_INPUT_RESOURCE_SLOT_COUNT];
+    for( UINT i = 0; i < count; ++i )
+        bindings[i] = { buffers[i], strides[i], offsets[i] };
+
+    UINT first = 0;
+    UINT issued = 0;
+    if( m_filter.Update( STATE_IA_VERTEX_BUFFERS, startSlot, count, bindings, sizeof( VertexBufferBinding ), &first, &issued ) )
+    {
+        const UINT skip = first - startSlot;
+        m_context->IASetVertexBuffers( first, issued, buffers + skip, strides + skip, offsets + skip );
+    }
+}
+
+void D3D11StateCache::IASetIndexBuffer( ID3D11Buffer* buffer, DXGI_FORMAT format, UINT offset )
+{
+    const IndexBufferBinding binding = { buffer, format, offset };
+    if( m_filter.Update( STATE_IA_INDEX_BUFFER, 0, 1, &binding, sizeof( binding ) ) )
+        m_context->IASetIndexBuffer( buffer, format, offset );
+}
+
+void D3D11StateCache::IASetPrimitiveTopology( D3D11_PRIMITIVE_TOPOLOGY topology )
+{
+    if( m_filter.Update( STATE_IA_TOPOLOGY, 0, 1, &topology, sizeof( topology ) ) )
+        m_context->IASetPrimitiveTopology( topology );
+}
+
+void D3D11StateCache::VSSetShader( ID3D11VertexShader* shader )
+{
+    if( m_filter.Update( STATE_VS_SHADER, 0, 1, &shader, sizeof( shader ) ) )
+        m_context->VSSetShader( shader, nullptr, 0 );
+}
+
+void D3D11StateCache::VSSetConstantBuffers( UINT startSlot, UINT count, ID3D11Buffer* const* buffers )
+{
+    SetConstantBuffers( STAGE_VS, startSlot, count, buffers, nullptr, nullptr );
+}
+
+void D3D11StateCache::VSSetConstantBuffers1( UINT startSlot, UINT count, ID3D11Buffer* const* buffers, const UINT* firstConstant, const UINT* numConstants )
+{
+    SetConstantBuffers( STAGE_VS, startSlot, count, buffers, firstConstant, numConstants );
+}
+
+void D3D11StateCache::PSSetShader( ID3D11PixelShader* shader )
+{
+    if( m_filter.Update( STATE_PS_SHADER, 0, 1, &shader, sizeof( shader ) ) )
+        m_context->PSSetShader( shader, nullptr, 0 );
+}
+
+void D3D11StateCache::PSSetConstantBuffers( UINT startSlot, UINT count, ID3D11Buffer* const* buffers )
+{
+    SetConstantBuffers( STAGE_PS, startSlot, count, buffers, nullptr, nullptr );
+}
+
+void D3D11StateCache::PSSetConstantBuffers1( UINT startSlot, UINT count, ID3D11Buffer* const* buffers, const UINT* firstConstant, const UINT* numConstants )
+{
+    SetConstantBuffers( STAGE_PS, startSlot, count, buffers, firstConstant, numConstants );
+}
+
+void D3D11StateCache::PSSetShaderResources( UINT startSlot, UINT count, ID3D11ShaderResourceView* const* views )
+{
+    UINT first = 0;
+    UINT issued = 0;
+    if( m_filter.Update( STATE_PS_SHADER_RESOURCES, startSlot, count, views, sizeof( *views ), &first, &issued ) )
+        m_context->PSSetShaderResources( first, issued, views + ( first - startSlot ) );
+}
+
+void D3D11StateCache::PSSetSamplers( UINT startSlot, UINT count, ID3D11SamplerState* const* samplers )
+{
+    UINT first = 0;
+    UINT issued = 0;
+    if( m_filter.Update( STATE_PS_SAMPLERS, startSlot, count, samplers, sizeof( *samplers ), &first, &issued ) )
+        m_context->PSSetSamplers( first, issued, samplers + ( first - startSlot ) );
+}
+
+void D3D11StateCache::RSSetState( ID3D11RasterizerState* state )
+{
+    if( m_filter.Update( STATE_RS_STATE, 0, 1, &state, sizeof( state ) ) )
+        m_context->RSSetState( state );
+}
+
+//? Viewports and scissor rects replace the whole array, so they are compared as one slot
+void D3D11StateCache::RSSetViewports( UINT count, const D3D11_VIEWPORT* viewports )
+{
+    if( m_filter.Update( STATE_RS_VIEWPORTS, 0, 1, viewports, count * sizeof( D3D11_VIEWPORT ) ) )
+        m_context->RSSetViewports( count, viewports );
+}
+
+void D3D11StateCache::RSSetScissorRects( UINT count, const D3D11_RECT* rects )
+{
+    if( m_filter.Update( STATE_RS_SCISSOR_RECTS, 0, 1, rects, count * sizeof( D3D11_RECT ) ) )
+        m_context->RSSetScissorRects( count, rects );
+}
+
+void D3D11StateCache::OMSetRenderTargets( UINT count, ID3D11RenderTargetView* const* views, ID3D11DepthStencilView* depthStencil )
+{
+    RenderTargetBinding binding = {};
+    for( UINT i = 0; i < count; ++i )
+        binding.views[i] = views[i];
+    binding.depthStencil = depthStencil;
+    binding.count = count;
+
+    if( m_filter.Update( STATE_OM_RENDER_TARGETS, 0, 1, &binding, sizeof( binding ) ) )
+        m_context->OMSetRenderTargets( count, views, depthStencil );
+}
+
+void D3D11StateCache::SetConstantBuffers( Stage stage, UINT startSlot, UINT count, ID3D11Buffer* const* buffers,
+                                          const UINT* firstConstant, const UINT* numConstants )
+{
+    const StateCall call = stage == STAGE_VS ? STATE_VS_CONSTANT_BUFFERS : STATE_PS_CONSTANT_BUFFERS;
+
+    ConstantBufferBinding bindings[D3D11_COMMONSHADER_CONSTANT_BUFFER_API_SLOT_COUNT];
+    bool moved = false;
+    for( UINT i = 0; i < count; ++i )
+    {
+        bindings[i] = { buffers[i], firstConstant ? firstConstant[i] : 0, numConstants ? numConstants[i] : 0 };
+
+        // Same buffer, different range: the case some runtimes don't pick up
+        const ConstantBufferBinding* last = static_cast<const ConstantBufferBinding*>(
+            m_filter.Last( call, startSlot + i, sizeof( ConstantBufferBinding ) ) );
+        if( last && last->buffer == bindings[i].buffer &&
+            ( last->firstConstant != bindings[i].firstConstant || last->numConstants != bindings[i].numConstants ) )
+            moved = true;
+    }
+
+    UINT first = 0;
+    UINT issued = 0;
+    if( !m_filter.Update( call, startSlot, count, bindings, sizeof( ConstantBufferBinding ), &first, &issued ) )
+        return;
+
+    const UINT skip = first - startSlot;
+    if( moved )
+    {
+        ID3D11Buffer* nullBuffers[D3D11_COMMONSHADER_CONSTANT_BUFFER_API_SLOT_COUNT] = {};
+        if( stage == STAGE_VS )
+            m_context->VSSetConstantBuffers( first, issued, nullBuffers );
+        else
+            m_context->PSSetConstantBuffers( first, issued, nullBuffers );
+    }
+
+    if( firstConstant && m_context1 )
+    {
+        if( stage == STAGE_VS )
+            m_context1->VSSetConstantBuffers1( first, issued, buffers + skip, firstConstant + skip, numConstants + skip );
+        else
+            m_context1->PSSetConstantBuffers1( first, issued, buffers + skip, firstConstant + skip, numConstants + skip );
+    }
+    else
+    {
+        if( stage == STAGE_VS )
+            m_context->VSSetConstantBuffers( first, issued, buffers + skip );
+        else
+            m_context->PSSetConstantBuffers( first, issued, buffers + skip );
+    }
+}
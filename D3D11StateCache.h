@@ -0,0 +1,68 @@
+//--------------------------------------------------------------------------------------
+// File: D3D11StateCache.h
+//
+// Wraps a device context and drops state-setting calls that would not change anything,
+// using StateFilter for the bookkeeping. Covers the calls the render loop makes every
+// frame; anything else still goes to the context directly.
+//
+// Binding the same constant buffer again at a new offset through *SetConstantBuffers1
+// is ignored by some runtimes, so those calls unbind the slot first when only the
+// offset changed.
+//--------------------------------------------------------------------------------------
+
+#pragma once
+
+#include <windows.h>
+#include <d3d11_1.h>
+
+#include "StateFilter.h"
+
+
+class D3D11StateCache
+{
+public:
+    D3D11StateCache() = default;
+
+    void Attach( ID3D11DeviceContext* context, ID3D11DeviceContext1* context1 );
+
+    ID3D11DeviceContext* Context() const noexcept { return m_context; }
+
+    void IASetInputLayout( ID3D11InputLayout* layout );
+    void IASetVertexBuffers( UINT startSlot, UINT count, ID3D11Buffer* const* buffers, const UINT* strides, const UINT* offsets );
+    void IASetIndexBuffer( ID3D11Buffer* buffer, DXGI_FORMAT format, UINT offset );
+    void IASetPrimitiveTopology( D3D11_PRIMITIVE_TOPOLOGY topology );
+
+    void VSSetShader( ID3D11VertexShader* shader );
+    void VSSetConstantBuffers( UINT startSlot, UINT count, ID3D11Buffer* const* buffers );
+    void VSSetConstantBuffers1( UINT startSlot, UINT count, ID3D11Buffer* const* buffers, const UINT* firstConstant, const UINT* numConstants );
+
+    void PSSetShader( ID3D11PixelShader* shader );
+    void PSSetConstantBuffers( UINT startSlot, UINT count, ID3D11Buffer* const* buffers );
+    void PSSetConstantBuffers1( UINT startSlot, UINT count, ID3D11Buffer* const* buffers, const UINT* firstConstant, const UINT* numConstants );
+    void PSSetShaderResources( UINT startSlot, UINT count, ID3D11ShaderResourceView* const* views );
+    void PSSetSamplers( UINT startSlot, UINT count, ID3D11SamplerState* const* samplers );
+
+    void RSSetState( ID3D11RasterizerState* state );
+    void RSSetViewports( UINT count, const D3D11_VIEWPORT* viewports );
+    void RSSetScissorRects( UINT count, const D3D11_RECT* rects );
+
+    void OMSetRenderTargets( UINT count, ID3D11RenderTargetView* const* views, ID3D11DepthStencilView* depthStencil );
+
+    // Flip-model Present unbinds the back buffer from the output merger
+    void InvalidateRenderTargets() noexcept { m_filter.Invalidate( STATE_OM_RENDER_TARGETS ); }
+
+    // After ClearState, ExecuteCommandList or any binding made on the raw context
+    void InvalidateAll() noexcept { m_filter.InvalidateAll(); }
+
+    const StateFilter::Counters& GetCounters() const noexcept { return m_filter.GetCounters(); }
+
+private:
+    enum Stage { STAGE_VS, STAGE_PS };
+
+    void SetConstantBuffers( Stage stage, UINT startSlot, UINT count, ID3D11Buffer* const* buffers,
+                             const UINT* firstConstant, const UINT* numConstants );
+
+    ID3D11DeviceContext*    m_context = nullptr;
+    ID3D11DeviceContext1*   m_context1 = nullptr;
+    StateFilter             m_filter;
+};
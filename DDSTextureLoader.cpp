@@ -16,6 +16,7 @@
 //--------------------------------------------------------------------------------------
 
 #include "DDSTextureLoader.h"
+#include "CpuTrace.h"
 
 #include <assert.h>
 #include <algorithm>
@@ -208,6 +209,8 @@ namespace
         const uint8_t** bitData,
         size_t* bitSize) noexcept
     {
+        CPU_TRACE_SCOPE("LoadTextureDataFromFile");
+
         if (!header || !bitData || !bitSize)
         {
             return E_POINTER;
@@ -465,157 +468,161 @@ namespace
             return 0;
         }
     }
+} // anonymous namespace
 
 
-    //--------------------------------------------------------------------------------------
-    // Get surface information for a particular format
-    //--------------------------------------------------------------------------------------
-    HRESULT GetSurfaceInfo(
-        _In_ size_t width,
-        _In_ size_t height,
-        _In_ DXGI_FORMAT fmt,
-        size_t* outNumBytes,
-        _Out_opt_ size_t* outRowBytes,
-        _Out_opt_ size_t* outNumRows) noexcept
+//--------------------------------------------------------------------------------------
+// Get surface information for a particular format
+//--------------------------------------------------------------------------------------
+_Use_decl_annotations_
+HRESULT DirectX::GetSurfaceInfo(
+    size_t width,
+    size_t height,
+    DXGI_FORMAT fmt,
+    size_t* outNumBytes,
+    size_t* outRowBytes,
+    size_t* outNumRows) noexcept
+{
+    uint64_t numBytes = 0;
+    uint64_t rowBytes = 0;
+    uint64_t numRows = 0;
+
+    bool bc = false;
+    bool packed = false;
+    bool planar = false;
+    size_t bpe = 0;
+    switch (fmt)
     {
-        uint64_t numBytes = 0;
-        uint64_t rowBytes = 0;
-        uint64_t numRows = 0;
-
-        bool bc = false;
-        bool packed = false;
-        bool planar = false;
-        size_t bpe = 0;
-        switch (fmt)
-        {
-        case DXGI_FORMAT_BC1_TYPELESS:
-        case DXGI_FORMAT_BC1_UNORM:
-        case DXGI_FORMAT_BC1_UNORM_SRGB:
-        case DXGI_FORMAT_BC4_TYPELESS:
-        case DXGI_FORMAT_BC4_UNORM:
-        case DXGI_FORMAT_BC4_SNORM:
-            bc = true;
-            bpe = 8;
-            break;
+    case DXGI_FORMAT_BC1_TYPELESS:
+    case DXGI_FORMAT_BC1_UNORM:
+    case DXGI_FORMAT_BC1_UNORM_SRGB:
+    case DXGI_FORMAT_BC4_TYPELESS:
+    case DXGI_FORMAT_BC4_UNORM:
+    case DXGI_FORMAT_BC4_SNORM:
+        bc = true;
+        bpe = 8;
+        break;
 
-        case DXGI_FORMAT_BC2_TYPELESS:
-        case DXGI_FORMAT_BC2_UNORM:
-        case DXGI_FORMAT_BC2_UNORM_SRGB:
-        case DXGI_FORMAT_BC3_TYPELESS:
-        case DXGI_FORMAT_BC3_UNORM:
-        case DXGI_FORMAT_BC3_UNORM_SRGB:
-        case DXGI_FORMAT_BC5_TYPELESS:
-        case DXGI_FORMAT_BC5_UNORM:
-        case DXGI_FORMAT_BC5_SNORM:
-        case DXGI_FORMAT_BC6H_TYPELESS:
-        case DXGI_FORMAT_BC6H_UF16:
-        case DXGI_FORMAT_BC6H_SF16:
-        case DXGI_FORMAT_BC7_TYPELESS:
-        case DXGI_FORMAT_BC7_UNORM:
-        case DXGI_FORMAT_BC7_UNORM_SRGB:
-            bc = true;
-            bpe = 16;
-            break;
+    case DXGI_FORMAT_BC2_TYPELESS:
+    case DXGI_FORMAT_BC2_UNORM:
+    case DXGI_FORMAT_BC2_UNORM_SRGB:
+    case DXGI_FORMAT_BC3_TYPELESS:
+    case DXGI_FORMAT_BC3_UNORM:
+    case DXGI_FORMAT_BC3_UNORM_SRGB:
+    case DXGI_FORMAT_BC5_TYPELESS:
+    case DXGI_FORMAT_BC5_UNORM:
+    case DXGI_FORMAT_BC5_SNORM:
+    case DXGI_FORMAT_BC6H_TYPELESS:
+    case DXGI_FORMAT_BC6H_UF16:
+    case DXGI_FORMAT_BC6H_SF16:
+    case DXGI_FORMAT_BC7_TYPELESS:
+    case DXGI_FORMAT_BC7_UNORM:
+    case DXGI_FORMAT_BC7_UNORM_SRGB:
+        bc = true;
+        bpe = 16;
+        break;
 
-        case DXGI_FORMAT_R8G8_B8G8_UNORM:
-        case DXGI_FORMAT_G8R8_G8B8_UNORM:
-        case DXGI_FORMAT_YUY2:
-            packed = true;
-            bpe = 4;
-            break;
+    case DXGI_FORMAT_R8G8_B8G8_UNORM:
+    case DXGI_FORMAT_G8R8_G8B8_UNORM:
+    case DXGI_FORMAT_YUY2:
+        packed = true;
+        bpe = 4;
+        break;
 
-        case DXGI_FORMAT_Y210:
-        case DXGI_FORMAT_Y216:
-            packed = true;
-            bpe = 8;
-            break;
+    case DXGI_FORMAT_Y210:
+    case DXGI_FORMAT_Y216:
+        packed = true;
+        bpe = 8;
+        break;
 
-        case DXGI_FORMAT_NV12:
-        case DXGI_FORMAT_420_OPAQUE:
-            planar = true;
-            bpe = 2;
-            break;
+    case DXGI_FORMAT_NV12:
+    case DXGI_FORMAT_420_OPAQUE:
+        planar = true;
+        bpe = 2;
+        break;
 
-        case DXGI_FORMAT_P010:
-        case DXGI_FORMAT_P016:
-            planar = true;
-            bpe = 4;
-            break;
+    case DXGI_FORMAT_P010:
+    case DXGI_FORMAT_P016:
+        planar = true;
+        bpe = 4;
+        break;
 
-        default:
-            break;
-        }
+    default:
+        break;
+    }
 
-        if (bc)
-        {
-            uint64_t numBlocksWide = 0;
-            if (width > 0)
-            {
-                numBlocksWide = std::max<uint64_t>(1u, (uint64_t(width) + 3u) / 4u);
-            }
-            uint64_t numBlocksHigh = 0;
-            if (height > 0)
-            {
-                numBlocksHigh = std::max<uint64_t>(1u, (uint64_t(height) + 3u) / 4u);
-            }
-            rowBytes = numBlocksWide * bpe;
-            numRows = numBlocksHigh;
-            numBytes = rowBytes * numBlocksHigh;
-        }
-        else if (packed)
-        {
-            rowBytes = ((uint64_t(width) + 1u) >> 1) * bpe;
-            numRows = uint64_t(height);
-            numBytes = rowBytes * height;
-        }
-        else if (fmt == DXGI_FORMAT_NV11)
+    if (bc)
+    {
+        uint64_t numBlocksWide = 0;
+        if (width > 0)
         {
-            rowBytes = ((uint64_t(width) + 3u) >> 2) * 4u;
-            numRows = uint64_t(height) * 2u; // Direct3D makes this simplifying assumption, although it is larger than the 4:1:1 data
-            numBytes = rowBytes * numRows;
+            numBlocksWide = std::max<uint64_t>(1u, (uint64_t(width) + 3u) / 4u);
         }
-        else if (planar)
+        uint64_t numBlocksHigh = 0;
+        if (height > 0)
         {
-            rowBytes = ((uint64_t(width) + 1u) >> 1) * bpe;
-            numBytes = (rowBytes * uint64_t(height)) + ((rowBytes * uint64_t(height) + 1u) >> 1);
-            numRows = height + ((uint64_t(height) + 1u) >> 1);
+            numBlocksHigh = std::max<uint64_t>(1u, (uint64_t(height) + 3u) / 4u);
         }
-        else
-        {
-            size_t bpp = BitsPerPixel(fmt);
-            if (!bpp)
-                return E_INVALIDARG;
+        rowBytes = numBlocksWide * bpe;
+        numRows = numBlocksHigh;
+        numBytes = rowBytes * numBlocksHigh;
+    }
+    else if (packed)
+    {
+        rowBytes = ((uint64_t(width) + 1u) >> 1) * bpe;
+        numRows = uint64_t(height);
+        numBytes = rowBytes * height;
+    }
+    else if (fmt == DXGI_FORMAT_NV11)
+    {
+        rowBytes = ((uint64_t(width) + 3u) >> 2) * 4u;
+        numRows = uint64_t(height) * 2u; // Direct3D makes this simplifying assumption, although it is larger than the 4:1:1 data
+        numBytes = rowBytes * numRows;
+    }
+    else if (planar)
+    {
+        rowBytes = ((uint64_t(width) + 1u) >> 1) * bpe;
+        numBytes = (rowBytes * uint64_t(height)) + ((rowBytes * uint64_t(height) + 1u) >> 1);
+        numRows = height + ((uint64_t(height) + 1u) >> 1);
+    }
+    else
+    {
+        size_t bpp = BitsPerPixel(fmt);
+        if (!bpp)
+            return E_INVALIDARG;
 
-            rowBytes = (uint64_t(width) * bpp + 7u) / 8u; // round up to nearest byte
-            numRows = uint64_t(height);
-            numBytes = rowBytes * height;
-        }
+        rowBytes = (uint64_t(width) * bpp + 7u) / 8u; // round up to nearest byte
+        numRows = uint64_t(height);
+        numBytes = rowBytes * height;
+    }
 
 #if defined(_M_IX86) || defined(_M_ARM) || defined(_M_HYBRID_X86_ARM64)
-        static_assert(sizeof(size_t) == 4, "Not a 32-bit platform!");
-        if (numBytes > UINT32_MAX || rowBytes > UINT32_MAX || numRows > UINT32_MAX)
-            return HRESULT_FROM_WIN32(ERROR_ARITHMETIC_OVERFLOW);
+    static_assert(sizeof(size_t) == 4, "Not a 32-bit platform!");
+    if (numBytes > UINT32_MAX || rowBytes > UINT32_MAX || numRows > UINT32_MAX)
+        return HRESULT_FROM_WIN32(ERROR_ARITHMETIC_OVERFLOW);
 #else
-        static_assert(sizeof(size_t) == 8, "Not a 64-bit platform!");
+    static_assert(sizeof(size_t) == 8, "Not a 64-bit platform!");
 #endif
 
-        if (outNumBytes)
-        {
-            *outNumBytes = static_cast<size_t>(numBytes);
-        }
-        if (outRowBytes)
-        {
-            *outRowBytes = static_cast<size_t>(rowBytes);
-        }
-        if (outNumRows)
-        {
-            *outNumRows = static_cast<size_t>(numRows);
-        }
-
-        return S_OK;
+    if (outNumBytes)
+    {
+        *outNumBytes = static_cast<size_t>(numBytes);
+    }
+    if (outRowBytes)
+    {
+        *outRowBytes = static_cast<size_t>(rowBytes);
+    }
+    if (outNumRows)
+    {
+        *outNumRows = static_cast<size_t>(numRows);
     }
 
+    return S_OK;
+}
+
 
+namespace
+{
     //--------------------------------------------------------------------------------------
     #define ISBITMASK( r,g,b,a ) ( ddpf.RBitMask == r && ddpf.GBitMask == g && ddpf.BBitMask == b && ddpf.ABitMask == a )
 
@@ -914,6 +921,8 @@ namespace
         _Out_ size_t& skipMip,
         _Out_writes_(mipCount*arraySize) D3D11_SUBRESOURCE_DATA* initData) noexcept
     {
+        CPU_TRACE_SCOPE("FillInitData");
+
         if (!bitData || !initData)
         {
             return E_POINTER;
@@ -1245,6 +1254,8 @@ namespace
         _Outptr_opt_ ID3D11Resource** texture,
         _Outptr_opt_ ID3D11ShaderResourceView** textureView) noexcept
     {
+        CPU_TRACE_SCOPE("CreateTextureFromDDS");
+
         HRESULT hr = S_OK;
 
         UINT width = header->width;
@@ -0,0 +1,131 @@
+//--------------------------------------------------------------------------------------
+// File: DamageTracker.cpp
+//
+// Change tracking for damage-driven rendering
+//--------------------------------------------------------------------------------------
+
+#include "DamageTracker.h"
+
+#include <cstdio>
+#include <cstring>
+
+
+//--------------------------------------------------------------------------------------
+size_t DamageTracker::AddInput( const char* name )
+{
+    m_inputs.emplace_back();
+    m_inputs.back().name = name;
+    return m_inputs.size() - 1;
+}
+
+bool DamageTracker::UpdateBytes( size_t input, const void* data, size_t size )
+{
+    Input& in = m_inputs[input];
+    const uint8_t* bytes = static_cast<const uint8_t*>( data );
+    if( in.seen && in.value.size() == size && memcmp( in.value.data(), bytes, size ) == 0 )
+        return false;
+
+    in.value.assign( bytes, bytes + size );
+    if( in.seen )
+        Bump( in );
+    in.seen = true;
+    return true;
+}
+
+bool DamageTracker::UpdateGeneration( size_t input, uint64_t generation )
+{
+    Input& in = m_inputs[input];
+    if( in.seen && in.source == generation )
+        return false;
+
+    in.source = generation;
+    if( in.seen )
+        Bump( in );
+    in.seen = true;
+    return true;
+}
+
+void DamageTracker::Invalidate( size_t input )
+{
+    Bump( m_inputs[input] );
+}
+
+void DamageTracker::InvalidateAll()
+{
+    for( Input& in : m_inputs )
+        Bump( in );
+}
+
+bool DamageTracker::Dirty() const noexcept
+{
+    for( const Input& in : m_inputs )
+    {
+        if( in.generation != in.rendered )
+            return true;
+    }
+    return false;
+}
+
+void DamageTracker::MarkRendered() noexcept
+{
+    for( Input& in : m_inputs )
+        in.rendered = in.generation;
+    ++m_stats.rendered;
+}
+
+void DamageTracker::Bump( Input& input ) noexcept
+{
+    ++input.generation;
+    ++input.changes;
+}
+
+std::string DamageTracker::Format() const
+{
+    const uint64_t frames = m_stats.rendered + m_stats.skipped;
+    char line[128];
+    snprintf( line, sizeof( line ), "Damage: %llu frames rendered, %llu skipped (%.1f%%)",
+              static_cast<unsigned long long>( m_stats.rendered ), static_cast<unsigned long long>( m_stats.skipped ),
+              frames ? 100.0 * double( m_stats.skipped ) / double( frames ) : 0.0 );
+
+    std::string text = line;
+    for( size_t i = 0; i < m_inputs.size(); ++i )
+    {
+        snprintf( line, sizeof( line ), "%s %s changed %llu times", i ? "," : ";", m_inputs[i].name.c_str(),
+                  static_cast<unsigned long long>( m_inputs[i].changes ) );
+        text += line;
+    }
+    text += "\n";
+    return text;
+}
+
+//--------------------------------------------------------------------------------------
+void ChangeSignal::Notify()
+{
+    {
+        std::lock_guard<std::mutex> lock( m_mutex );
+        m_generation.fetch_add( 1, std::memory_order_release );
+    }
+    m_changed.notify_all();
+}
+
+bool ChangeSignal::WaitForChange( uint64_t seen )
+{
+    std::unique_lock<std::mutex> lock( m_mutex );
+    m_changed.wait( lock, [this, seen] { return m_closed || m_generation.load( std::memory_order_relaxed ) != seen; } );
+    return !m_closed;
+}
+
+void ChangeSignal::Close()
+{
+    {
+        std::lock_guard<std::mutex> lock( m_mutex );
+        m_closed = true;
+    }
+    m_changed.notify_all();
+}
+
+void ChangeSignal::Reopen()
+{
+    std::lock_guard<std::mutex> lock( m_mutex );
+    m_closed = false;
+}
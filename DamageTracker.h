@@ -0,0 +1,116 @@
+//--------------------------------------------------------------------------------------
+// File: DamageTracker.h
+//
+// Change tracking for damage-driven rendering. A window registers the inputs its frame
+// is made of (constants, textures, the size of its targets, ...). Every input carries a
+// generation that moves whenever its value changes, and the window only renders and
+// presents when some generation moved since the frame it last rendered.
+//
+// ChangeSignal is the cross-thread half: a generation other threads bump when something
+// a render thread cannot poll changed (a key press, an exposed window), which the
+// render thread can sleep on while its tracker is clean.
+//
+// Only the standard library is used.
+//--------------------------------------------------------------------------------------
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+
+class DamageTracker
+{
+public:
+    struct Stats
+    {
+        uint64_t    rendered = 0;
+        uint64_t    skipped = 0;        // frames nothing changed for
+    };
+
+    // Registers an input and returns its index. Every input starts out changed, so the
+    // first frame always renders.
+    size_t AddInput( const char* name );
+
+    // Compares 'size' bytes with the input's previous value and moves its generation
+    // when they differ. Returns whether they did.
+    bool UpdateBytes( size_t input, const void* data, size_t size );
+
+    // Follows a counter kept elsewhere (a resize count, a surface's generation): the
+    // input changes whenever the counter does
+    bool UpdateGeneration( size_t input, uint64_t generation );
+
+    // Moves the generation whatever the value
+    void Invalidate( size_t input );
+    void InvalidateAll();
+
+    // Whether any input changed since the last MarkRendered()
+    bool Dirty() const noexcept;
+    bool Changed( size_t input ) const { return m_inputs[input].generation != m_inputs[input].rendered; }
+
+    // The frame was rendered with the current inputs
+    void MarkRendered() noexcept;
+
+    // The frame was skipped since nothing changed
+    void MarkSkipped() noexcept { ++m_stats.skipped; }
+
+    size_t InputCount() const noexcept { return m_inputs.size(); }
+    uint64_t Generation( size_t input ) const { return m_inputs[input].generation; }
+
+    const Stats& GetStats() const noexcept { return m_stats; }
+
+    // Rendered and skipped frames, and how often each input changed
+    std::string Format() const;
+
+private:
+    struct Input
+    {
+        std::string             name;
+        std::vector<uint8_t>    value;              // UpdateBytes()
+        uint64_t                source = 0;         // UpdateGeneration()
+        bool                    seen = false;       // value or source holds something
+        uint64_t                generation = 1;
+        uint64_t                rendered = 0;       // generation of the last rendered frame
+        uint64_t                changes = 0;
+    };
+
+    void Bump( Input& input ) noexcept;
+
+    std::vector<Input>  m_inputs;
+    Stats               m_stats;
+};
+
+//? --------------------------------------------------------------------------------------
+//? A generation bumped by any thread; waiters sleep until it moves. Close() wakes every
+//? waiter for shutdown.
+//? --------------------------------------------------------------------------------------
+class ChangeSignal
+{
+public:
+    ChangeSignal() noexcept : m_generation( 0 ), m_closed( false ) {}
+
+    ChangeSignal( const ChangeSignal& ) = delete;
+    ChangeSignal& operator=( const ChangeSignal& ) = delete;
+
+    // Moves the generation and wakes every waiter
+    void Notify();
+
+    uint64_t Generation() const noexcept { return m_generation.load( std::memory_order_acquire ); }
+
+    // Blocks until the generation differs from 'seen'. False once closed.
+    bool WaitForChange( uint64_t seen );
+
+    void Close();
+    void Reopen();
+
+private:
+    std::atomic<uint64_t>       m_generation;
+    bool                        m_closed;
+    std::mutex                  m_mutex;
+    std::condition_variable     m_changed;
+};
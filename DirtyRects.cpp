@@ -0,0 +1,147 @@
+//--------------------------------------------------------------------------------------
+// File: DirtyRects.cpp
+//
+// Dirty-rectangle tracking for shared surfaces
+//--------------------------------------------------------------------------------------
+
+#include "DirtyRects.h"
+
+#include <algorithm>
+
+
+namespace
+{
+    bool Clip( DirtyRect& rc, uint32_t width, uint32_t height ) noexcept
+    {
+        rc.right = std::min( rc.right, width );
+        rc.bottom = std::min( rc.bottom, height );
+        return rc.left < rc.right && rc.top < rc.bottom;
+    }
+
+    bool Contains( const DirtyRect& outer, const DirtyRect& inner ) noexcept
+    {
+        return outer.left <= inner.left && outer.top <= inner.top &&
+               outer.right >= inner.right && outer.bottom >= inner.bottom;
+    }
+
+    // Pixels saved (positive) or wasted (negative) by replacing a and b with their union.
+    int64_t MergeGain( const DirtyRect& a, const DirtyRect& b, uint64_t perCopyOverhead ) noexcept
+    {
+        const int64_t separate = int64_t( DirtyRectArea( a ) + DirtyRectArea( b ) + 2 * perCopyOverhead );
+        const int64_t merged = int64_t( DirtyRectArea( DirtyRectUnion( a, b ) ) + perCopyOverhead );
+        return separate - merged;
+    }
+}
+
+
+//--------------------------------------------------------------------------------------
+void DirtyRegion::Reset( uint32_t width, uint32_t height )
+{
+    m_width = width;
+    m_height = height;
+    m_rects.clear();
+}
+
+void DirtyRegion::Add( const DirtyRect& rect )
+{
+    DirtyRect rc = rect;
+    if( !Clip( rc, m_width, m_height ) )
+        return;
+
+    for( const DirtyRect& existing : m_rects )
+    {
+        if( Contains( existing, rc ) )
+            return;
+    }
+
+    if( m_rects.size() >= kMaxPendingRects )
+    {
+        DirtyRect bounds = rc;
+        for( const DirtyRect& existing : m_rects )
+            bounds = DirtyRectUnion( bounds, existing );
+        m_rects.clear();
+        m_rects.push_back( bounds );
+        return;
+    }
+
+    m_rects.push_back( rc );
+}
+
+void DirtyRegion::AddAll()
+{
+    m_rects.clear();
+    if( m_width && m_height )
+        m_rects.push_back( DirtyRect{ 0, 0, m_width, m_height } );
+}
+
+void DirtyRegion::Merge( const DirtyRegion& other )
+{
+    for( const DirtyRect& rc : other.m_rects )
+        Add( rc );
+}
+
+//--------------------------------------------------------------------------------------
+// Greedy pairwise merge: repeatedly take the pair with the best gain under the cost
+// model. Once no pair is worth merging, keep merging the cheapest pairs until the
+// count limit holds. The input is capped at kMaxPendingRects so O(n^3) is fine here.
+//--------------------------------------------------------------------------------------
+void DirtyRegion::Coalesce( const DirtyRectCost& cost )
+{
+    const size_t maxRects = std::max<size_t>( cost.maxRects, 1 );
+
+    while( m_rects.size() > 1 )
+    {
+        size_t bestI = 0;
+        size_t bestJ = 1;
+        int64_t bestGain = INT64_MIN;
+        for( size_t i = 0; i < m_rects.size(); ++i )
+        {
+            for( size_t j = i + 1; j < m_rects.size(); ++j )
+            {
+                const int64_t gain = MergeGain( m_rects[i], m_rects[j], cost.perCopyOverhead );
+                if( gain > bestGain )
+                {
+                    bestGain = gain;
+                    bestI = i;
+                    bestJ = j;
+                }
+            }
+        }
+
+        if( bestGain < 0 && m_rects.size() <= maxRects )
+            break;
+
+        m_rects[bestI] = DirtyRectUnion( m_rects[bestI], m_rects[bestJ] );
+        m_rects.erase( m_rects.begin() + ptrdiff_t( bestJ ) );
+
+        // The grown rectangle may now swallow others outright
+        const DirtyRect merged = m_rects[bestI];
+        for( size_t k = m_rects.size(); k-- > 0; )
+        {
+            if( k != bestI && Contains( merged, m_rects[k] ) )
+            {
+                m_rects.erase( m_rects.begin() + ptrdiff_t( k ) );
+                if( k < bestI )
+                    --bestI;
+            }
+        }
+    }
+}
+
+uint64_t DirtyRegion::Pixels() const noexcept
+{
+    uint64_t pixels = 0;
+    for( const DirtyRect& rc : m_rects )
+        pixels += DirtyRectArea( rc );
+    return pixels;
+}
+
+//--------------------------------------------------------------------------------------
+void DirtyCopyStats::Record( const DirtyRegion& region, uint32_t bytesPerPixel ) noexcept
+{
+    lastFrameBytes = region.Pixels() * bytesPerPixel;
+    lastFrameRects = region.Rects().size();
+    bytesCopied += lastFrameBytes;
+    bytesFullCopy += uint64_t( region.Width() ) * region.Height() * bytesPerPixel;
+    ++frames;
+}
@@ -0,0 +1,118 @@
+//--------------------------------------------------------------------------------------
+// File: DirtyRects.h
+//
+// Dirty-rectangle tracking for shared surfaces. The producer adds the regions it touched
+// in a frame, Coalesce() merges them with a simple copy-cost model and the consumer
+// copies only the resulting boxes instead of the whole surface.
+//
+// Rectangles are half-open ([left, right) x [top, bottom)), matching D3D11_BOX.
+//--------------------------------------------------------------------------------------
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+
+struct DirtyRect
+{
+    uint32_t    left;
+    uint32_t    top;
+    uint32_t    right;
+    uint32_t    bottom;
+};
+
+inline uint64_t DirtyRectArea( const DirtyRect& rc ) noexcept
+{
+    if( rc.right <= rc.left || rc.bottom <= rc.top )
+        return 0;
+    return uint64_t( rc.right - rc.left ) * uint64_t( rc.bottom - rc.top );
+}
+
+inline DirtyRect DirtyRectUnion( const DirtyRect& a, const DirtyRect& b ) noexcept
+{
+    DirtyRect rc;
+    rc.left   = a.left < b.left ? a.left : b.left;
+    rc.top    = a.top < b.top ? a.top : b.top;
+    rc.right  = a.right > b.right ? a.right : b.right;
+    rc.bottom = a.bottom > b.bottom ? a.bottom : b.bottom;
+    return rc;
+}
+
+//? Tuning for Coalesce(). Costs are expressed in pixels so the model does not depend
+//? on the surface format.
+struct DirtyRectCost
+{
+    // Fixed cost of issuing one more copy (API call, driver validation, GPU setup),
+    // expressed as the number of pixels that could have been copied instead.
+    uint64_t    perCopyOverhead = 64 * 64;
+
+    // Hard upper bound on the number of boxes handed to the consumer.
+    size_t      maxRects = 8;
+};
+
+class DirtyRegion
+{
+public:
+    // Input rectangles beyond this count collapse into their bounding box right away,
+    // which keeps Coalesce() cheap no matter how chatty the producer is.
+    static const size_t kMaxPendingRects = 64;
+
+    DirtyRegion() noexcept : m_width( 0 ), m_height( 0 ) {}
+
+    // Clears the region and sets the surface size used for clipping.
+    void Reset( uint32_t width, uint32_t height );
+
+    // Clears the region, keeping the surface size.
+    void Clear() noexcept { m_rects.clear(); }
+
+    // Adds a rectangle; it is clipped to the surface and dropped when empty.
+    void Add( const DirtyRect& rc );
+
+    // Marks the whole surface dirty.
+    void AddAll();
+
+    // Adds every rectangle of another region (e.g. when a consumer skipped a frame).
+    void Merge( const DirtyRegion& other );
+
+    // Merges rectangles whenever one bigger copy is cheaper than two smaller ones and
+    // enforces DirtyRectCost::maxRects.
+    void Coalesce( const DirtyRectCost& cost );
+
+    const std::vector<DirtyRect>& Rects() const noexcept { return m_rects; }
+    bool Empty() const noexcept { return m_rects.empty(); }
+    uint32_t Width() const noexcept { return m_width; }
+    uint32_t Height() const noexcept { return m_height; }
+
+    // Number of pixels the consumer will copy (overlaps are counted twice, as copied).
+    uint64_t Pixels() const noexcept;
+
+private:
+    uint32_t                m_width;
+    uint32_t                m_height;
+    std::vector<DirtyRect>  m_rects;
+};
+
+//? Bytes-copied-per-frame accounting for the consumer side.
+struct DirtyCopyStats
+{
+    uint64_t    frames = 0;
+    uint64_t    bytesCopied = 0;        // total over all frames
+    uint64_t    bytesFullCopy = 0;      // what whole-surface copies would have cost
+    uint64_t    lastFrameBytes = 0;
+    uint64_t    lastFrameRects = 0;
+
+    void Record( const DirtyRegion& region, uint32_t bytesPerPixel ) noexcept;
+
+    double BytesPerFrame() const noexcept
+    {
+        return frames ? double( bytesCopied ) / double( frames ) : 0.0;
+    }
+
+    // Fraction of the full-copy bandwidth that was actually used (1.0 = no savings).
+    double CopyRatio() const noexcept
+    {
+        return bytesFullCopy ? double( bytesCopied ) / double( bytesFullCopy ) : 1.0;
+    }
+};
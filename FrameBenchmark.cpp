@@ -0,0 +1,230 @@
+//--------------------------------------------------------------------------------------
+// File: FrameBenchmark.cpp
+//
+// CPU timing of a fixed run of frames
+//--------------------------------------------------------------------------------------
+
+#include "FrameBenchmark.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+
+#include "FrameLoop.h"
+#include "QuadBatch.h"
+
+
+namespace
+{
+    double MillisecondsBetween( FrameBenchmark::Clock::time_point start, FrameBenchmark::Clock::time_point end )
+    {
+        return std::chrono::duration<double, std::milli>( end - start ).count();
+    }
+
+    //? Sorted samples; rank ceil( p * n ), 1-based
+    double NearestRank( const std::vector<double>& sorted, double fraction )
+    {
+        const size_t rank = size_t( ceil( fraction * double( sorted.size() ) ) );
+        return sorted[rank ? rank - 1 : 0];
+    }
+
+    void AppendSummaryJSON( std::string& out, const TimingSummary& summary )
+    {
+        char text[256];
+        snprintf( text, sizeof( text ),
+                  "{ \"count\": %llu, \"mean_ms\": %.4f, \"p50_ms\": %.4f, \"p95_ms\": %.4f, \"p99_ms\": %.4f, \"max_ms\": %.4f }",
+                  (unsigned long long)summary.count, summary.meanMs, summary.p50Ms, summary.p95Ms, summary.p99Ms, summary.maxMs );
+        out += text;
+    }
+
+    void AppendSummaryCSV( std::string& out, const std::string& name, const TimingSummary& summary )
+    {
+        char text[256];
+        snprintf( text, sizeof( text ), "%s,%llu,%.4f,%.4f,%.4f,%.4f,%.4f\n", name.c_str(),
+                  (unsigned long long)summary.count, summary.meanMs, summary.p50Ms, summary.p95Ms, summary.p99Ms, summary.maxMs );
+        out += text;
+    }
+
+    //? The batched instance as the window's per-draw constants: HLSL rows of the world
+    //? matrix are the instance rows, with z passed through
+    FrameConstants InstanceConstants( const QuadInstance& instance )
+    {
+        FrameConstants constants = {};
+        constants.world[0] = instance.row0[0];
+        constants.world[1] = instance.row0[1];
+        constants.world[3] = instance.row0[2];
+        constants.world[4] = instance.row1[0];
+        constants.world[5] = instance.row1[1];
+        constants.world[7] = instance.row1[2];
+        constants.world[10] = 1.0f;
+        constants.world[15] = 1.0f;
+        for( float& channel : constants.meshColor )
+            channel = 1.0f;
+        return constants;
+    }
+}
+
+//--------------------------------------------------------------------------------------
+TimingSummary SummarizeTimings( std::vector<double> samplesMs )
+{
+    TimingSummary summary;
+    if( samplesMs.empty() )
+        return summary;
+
+    std::sort( samplesMs.begin(), samplesMs.end() );
+    double total = 0.0;
+    for( double sample : samplesMs )
+        total += sample;
+
+    summary.count = samplesMs.size();
+    summary.meanMs = total / double( samplesMs.size() );
+    summary.p50Ms = NearestRank( samplesMs, 0.50 );
+    summary.p95Ms = NearestRank( samplesMs, 0.95 );
+    summary.p99Ms = NearestRank( samplesMs, 0.99 );
+    summary.maxMs = samplesMs.back();
+    return summary;
+}
+
+//--------------------------------------------------------------------------------------
+size_t FrameBenchmark::AddPhase( const std::string& name )
+{
+    for( size_t i = 0; i < m_phases.size(); ++i )
+    {
+        if( m_phases[i].name == name )
+            return i;
+    }
+    m_phases.emplace_back();
+    m_phases.back().name = name;
+    return m_phases.size() - 1;
+}
+
+void FrameBenchmark::BeginFrame()
+{
+    for( Phase& phase : m_phases )
+        phase.frameMs = 0.0;
+    m_inFrame = true;
+    m_frameStart = Clock::now();
+}
+
+void FrameBenchmark::EndFrame()
+{
+    if( !m_inFrame )
+        return;
+    m_inFrame = false;
+
+    const double frameMs = MillisecondsBetween( m_frameStart, Clock::now() );
+    if( m_framesSeen++ < m_warmupFrames )
+        return;
+
+    m_frameMs.push_back( frameMs );
+    for( Phase& phase : m_phases )
+        phase.samplesMs.push_back( phase.frameMs );
+}
+
+void FrameBenchmark::AddPhaseTime( size_t phase, double ms )
+{
+    if( phase < m_phases.size() )
+        m_phases[phase].frameMs += ms;
+}
+
+FrameBenchmark::ScopedPhase::~ScopedPhase()
+{
+    if( m_benchmark )
+        m_benchmark->AddPhaseTime( m_phase, MillisecondsBetween( m_start, Clock::now() ) );
+}
+
+std::string FrameBenchmark::FormatJSON( const BenchmarkConfig& config, const char* backend ) const
+{
+    char text[512];
+    snprintf( text, sizeof( text ),
+              "{\n  \"backend\": \"%s\",\n"
+              "  \"config\": { \"frames\": %llu, \"warmup_frames\": %llu, \"frame_seconds\": %.6f, \"width\": %u, \"height\": %u, "
+              "\"quads\": %llu, \"textures\": %u, \"windows\": %u },\n  \"frame\": ",
+              backend, (unsigned long long)config.frames, (unsigned long long)config.warmupFrames, config.frameSeconds,
+              config.width, config.height, (unsigned long long)config.quads, config.textures, config.windows );
+
+    std::string out = text;
+    AppendSummaryJSON( out, FrameSummary() );
+    out += ",\n  \"phases\": {";
+    for( size_t i = 0; i < m_phases.size(); ++i )
+    {
+        out += i ? ",\n    \"" : "\n    \"";
+        out += m_phases[i].name;
+        out += "\": ";
+        AppendSummaryJSON( out, PhaseSummary( i ) );
+    }
+    out += m_phases.empty() ? "}\n}\n" : "\n  }\n}\n";
+    return out;
+}
+
+std::string FrameBenchmark::FormatCSV() const
+{
+    std::string out = "name,count,mean_ms,p50_ms,p95_ms,p99_ms,max_ms\n";
+    AppendSummaryCSV( out, "frame", FrameSummary() );
+    for( size_t i = 0; i < m_phases.size(); ++i )
+        AppendSummaryCSV( out, m_phases[i].name, PhaseSummary( i ) );
+    return out;
+}
+
+//--------------------------------------------------------------------------------------
+bool RunFrameBenchmark( RenderDevice& device, size_t program, const BenchmarkConfig& config, FrameBenchmark& benchmark )
+{
+    std::vector<RenderWindow*> windows;
+    for( uint32_t i = 0; i < std::max( config.windows, 1u ); ++i )
+    {
+        RenderWindowDesc desc;
+        desc.name = "Benchmark" + std::to_string( i + 1 );
+        desc.program = program;
+        desc.width = config.width;
+        desc.height = config.height;
+        desc.offscreen = true;
+        RenderWindow* window = device.CreateRenderWindow( desc );
+        if( !window )
+            return false;
+        windows.push_back( window );
+    }
+
+    //? The grid of BuildSceneBatchA: quad i spins at t + 0.01 i; materials alternate along it
+    const uint32_t materials = std::max( config.textures, 1u );
+    const size_t side = size_t( ceilf( sqrtf( float( std::max<size_t>( config.quads, 1 ) ) ) ) );
+    const float cell = 2.0f / float( side );
+    QuadList quads;
+    QuadBatcher batcher;
+    quads.Reserve( config.quads );
+    const size_t scenePhase = benchmark.AddPhase( "scene" );
+
+    FrameLoopDesc loopDesc;
+    loopDesc.frameCount = config.frames;
+    loopDesc.frameSeconds = config.frameSeconds;
+    loopDesc.readbackLatency = 0;
+    FrameLoop loop( *windows[0], loopDesc );
+    for( size_t i = 1; i < windows.size(); ++i )
+        loop.AddWindow( *windows[i] );
+    loop.SetBenchmark( &benchmark );
+
+    uint64_t builtFrame = 0;
+    loop.SetDraw( [&]( RenderWindow& window, uint64_t frameId, double seconds )
+    {
+        if( builtFrame != frameId )
+        {
+            FrameBenchmark::ScopedPhase phase( &benchmark, scenePhase );
+            const float t = float( seconds );
+            quads.Clear();
+            for( size_t i = 0; i < config.quads; ++i )
+            {
+                quads.Add( -1.0f + cell * ( float( i % side ) + 0.5f ), 1.0f - cell * ( float( i / side ) + 0.5f ),
+                           0.45f * cell * cosf( t + 0.01f * float( i ) ), 0.45f * cell, 0.0f, uint32_t( i % materials ), 0 );
+            }
+            batcher.Build( quads, materials );
+            builtFrame = frameId;
+        }
+
+        for( const QuadInstance& instance : batcher.Instances() )
+        {
+            window.UpdateFrameConstants( InstanceConstants( instance ) );
+            window.DrawQuad();
+        }
+    } );
+
+    return loop.Run();
+}
@@ -0,0 +1,113 @@
+//--------------------------------------------------------------------------------------
+// File: FrameBenchmark.h
+//
+// CPU timing of a fixed run of frames. Each frame is split into named phases; a phase
+// may be entered several times per frame (once per window, say) and its time is summed.
+// The first warm-up frames are not recorded. Results are summarized as mean, p50, p95,
+// p99 and max per phase and for whole frames, and written as JSON or CSV so runs can be
+// compared over time.
+//
+// RunFrameBenchmark drives a scene of batched quads through FrameLoop on any backend,
+// so the same numbers come out of the null backend as out of D3D11.
+//--------------------------------------------------------------------------------------
+
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "RenderDevice.h"
+
+
+struct BenchmarkConfig
+{
+    uint64_t    frames = 300;
+    uint64_t    warmupFrames = 10;
+    double      frameSeconds = 1.0 / 60.0;      // animation time per frame
+    uint32_t    width = 1280;
+    uint32_t    height = 720;
+    size_t      quads = 1;
+    uint32_t    textures = 1;                   // materials the quads are spread over
+    uint32_t    windows = 1;
+};
+
+struct TimingSummary
+{
+    uint64_t    count = 0;
+    double      meanMs = 0.0;
+    double      p50Ms = 0.0;
+    double      p95Ms = 0.0;
+    double      p99Ms = 0.0;
+    double      maxMs = 0.0;
+};
+
+// Nearest-rank percentiles of the samples
+TimingSummary SummarizeTimings( std::vector<double> samplesMs );
+
+class FrameBenchmark
+{
+public:
+    using Clock = std::chrono::steady_clock;
+
+    explicit FrameBenchmark( uint64_t warmupFrames = 0 ) : m_warmupFrames( warmupFrames ) {}
+
+    // Phases keep the order they are added in; adding a name twice returns the first index
+    size_t AddPhase( const std::string& name );
+    size_t PhaseCount() const noexcept { return m_phases.size(); }
+    const std::string& PhaseName( size_t phase ) const { return m_phases[phase].name; }
+
+    void BeginFrame();
+    void EndFrame();
+    void AddPhaseTime( size_t phase, double ms );
+
+    //? Times one phase for the lifetime of the scope; does nothing without a benchmark
+    class ScopedPhase
+    {
+    public:
+        ScopedPhase( FrameBenchmark* benchmark, size_t phase ) :
+            m_benchmark( benchmark ), m_phase( phase ), m_start( benchmark ? Clock::now() : Clock::time_point() ) {}
+        ~ScopedPhase();
+
+        ScopedPhase( const ScopedPhase& ) = delete;
+        ScopedPhase& operator=( const ScopedPhase& ) = delete;
+
+    private:
+        FrameBenchmark*     m_benchmark;
+        size_t              m_phase;
+        Clock::time_point   m_start;
+    };
+
+    uint64_t FramesRecorded() const noexcept { return m_frameMs.size(); }
+    TimingSummary FrameSummary() const { return SummarizeTimings( m_frameMs ); }
+    TimingSummary PhaseSummary( size_t phase ) const { return SummarizeTimings( m_phases[phase].samplesMs ); }
+
+    // One object with the configuration, the frame summary and one summary per phase
+    std::string FormatJSON( const BenchmarkConfig& config, const char* backend ) const;
+
+    // One row per summary: name,count,mean_ms,p50_ms,p95_ms,p99_ms,max_ms; "frame" first
+    std::string FormatCSV() const;
+
+private:
+    struct Phase
+    {
+        std::string             name;
+        double                  frameMs = 0.0;      // summed over the current frame
+        std::vector<double>     samplesMs;
+    };
+
+    const uint64_t          m_warmupFrames;
+    uint64_t                m_framesSeen = 0;
+    bool                    m_inFrame = false;
+    Clock::time_point       m_frameStart;
+    std::vector<Phase>      m_phases;
+    std::vector<double>     m_frameMs;
+};
+
+// Creates config.windows offscreen windows of 'program' on 'device' and runs the quad
+// grid for config.frames frames, rebuilding the batches every frame. Phases are FrameLoop's
+// plus "scene", the batch build, which is also counted in "draw". The windows stay on
+// the device. False if a window could not be created.
+bool RunFrameBenchmark( RenderDevice& device, size_t program, const BenchmarkConfig& config, FrameBenchmark& benchmark );
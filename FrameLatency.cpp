@@ -0,0 +1,142 @@
+//--------------------------------------------------------------------------------------
+// File: FrameLatency.cpp
+//
+// End-to-end producer->consumer latency instrumentation
+//--------------------------------------------------------------------------------------
+
+#include "FrameLatency.h"
+
+#include <algorithm>
+#include <cstdio>
+
+
+namespace
+{
+    double ToMs( uint64_t from, uint64_t to ) noexcept
+    {
+        return to > from ? double( to - from ) * 1e-6 : 0.0;
+    }
+
+    LatencyPercentiles Percentiles( std::vector<double>& values )
+    {
+        LatencyPercentiles result;
+        if( values.empty() )
+            return result;
+
+        auto pick = [&values]( double q ) -> double
+        {
+            const size_t n = size_t( q * double( values.size() - 1 ) + 0.5 );
+            std::nth_element( values.begin(), values.begin() + ptrdiff_t( n ), values.end() );
+            return values[n];
+        };
+
+        result.p50 = pick( 0.50 );
+        result.p95 = pick( 0.95 );
+        result.p99 = pick( 0.99 );
+        result.max = *std::max_element( values.begin(), values.end() );
+        return result;
+    }
+}
+
+
+//--------------------------------------------------------------------------------------
+FrameLatencyTracker::FrameLatencyTracker() noexcept :
+    m_presented( 0 ),
+    m_dropped( 0 ),
+    m_lost( 0 ),
+    m_lastFrameId( 0 ),
+    m_windowNext( 0 ),
+    m_dumpIntervalNs( 5000ull * 1000000ull ),
+    m_lastDump( 0 )
+{
+}
+
+void FrameLatencyTracker::RecordPresented( const FrameStamp& stamp ) noexcept
+{
+    if( stamp.frameId <= m_lastFrameId )
+        return;
+
+    if( m_lastFrameId != 0 && stamp.frameId > m_lastFrameId + 1 )
+        m_dropped.fetch_add( stamp.frameId - m_lastFrameId - 1, std::memory_order_relaxed );
+    m_lastFrameId = stamp.frameId;
+
+    m_presented.fetch_add( 1, std::memory_order_relaxed );
+    if( !m_ring.TryPush( stamp ) )
+        m_lost.fetch_add( 1, std::memory_order_relaxed );
+}
+
+void FrameLatencyTracker::Drain()
+{
+    FrameStamp stamp;
+    while( m_ring.TryPop( stamp ) )
+    {
+        if( m_window.size() < kWindowSize )
+        {
+            m_window.push_back( stamp );
+        }
+        else
+        {
+            m_window[m_windowNext] = stamp;
+            m_windowNext = ( m_windowNext + 1 ) % kWindowSize;
+        }
+    }
+}
+
+LatencyReport FrameLatencyTracker::Report()
+{
+    Drain();
+
+    LatencyReport report;
+    report.samples = m_window.size();
+    report.framesPresented = m_presented.load( std::memory_order_relaxed );
+    report.framesDropped = m_dropped.load( std::memory_order_relaxed );
+    report.samplesLost = m_lost.load( std::memory_order_relaxed );
+
+    std::vector<double> values;
+    values.reserve( m_window.size() );
+
+    auto segment = [&]( uint64_t FrameStamp::* from, uint64_t FrameStamp::* to )
+    {
+        values.clear();
+        for( const FrameStamp& s : m_window )
+            values.push_back( ToMs( s.*from, s.*to ) );
+        return Percentiles( values );
+    };
+
+    report.endToEnd = segment( &FrameStamp::renderStart, &FrameStamp::present );
+    report.producer = segment( &FrameStamp::renderStart, &FrameStamp::submit );
+    report.handoff = segment( &FrameStamp::submit, &FrameStamp::acquire );
+    report.consumer = segment( &FrameStamp::acquire, &FrameStamp::present );
+    return report;
+}
+
+bool FrameLatencyTracker::DumpIfDue( uint64_t nowNs, std::string& text )
+{
+    if( m_lastDump == 0 )
+    {
+        m_lastDump = nowNs;
+        return false;
+    }
+    if( nowNs - m_lastDump < m_dumpIntervalNs )
+        return false;
+
+    m_lastDump = nowNs;
+    text = Format( Report() );
+    return true;
+}
+
+std::string FrameLatencyTracker::Format( const LatencyReport& report )
+{
+    char buffer[512];
+    snprintf( buffer, sizeof( buffer ),
+        "Frame latency (%zu samples): end-to-end p50 %.2f p95 %.2f p99 %.2f max %.2f ms | "
+        "producer p50 %.2f, handoff p50 %.2f, consumer p50 %.2f ms | "
+        "presented %llu, dropped %llu, lost samples %llu\n",
+        report.samples,
+        report.endToEnd.p50, report.endToEnd.p95, report.endToEnd.p99, report.endToEnd.max,
+        report.producer.p50, report.handoff.p50, report.consumer.p50,
+        (unsigned long long)report.framesPresented,
+        (unsigned long long)report.framesDropped,
+        (unsigned long long)report.samplesLost );
+    return buffer;
+}
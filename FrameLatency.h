@@ -0,0 +1,137 @@
+//--------------------------------------------------------------------------------------
+// File: FrameLatency.h
+//
+// End-to-end producer->consumer latency instrumentation. Every frame handed from the
+// producer to the consumer carries a FrameStamp; the producer fills in the render start
+// and submit times, the consumer the acquire and present times. Completed stamps go
+// through a lock-free single-producer/single-consumer ring and are turned into
+// percentiles and dropped-frame counters by FrameLatencyTracker.
+//
+// Nothing in here depends on the platform; timestamps come from std::chrono.
+//--------------------------------------------------------------------------------------
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+
+// High-resolution monotonic timestamp in nanoseconds
+inline uint64_t LatencyNow() noexcept
+{
+    return uint64_t( std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch() ).count() );
+}
+
+struct FrameStamp
+{
+    uint64_t    frameId = 0;
+    uint64_t    renderStart = 0;    // producer begins the frame
+    uint64_t    submit = 0;         // producer has flushed the frame to the shared surface
+    uint64_t    acquire = 0;        // consumer picks the frame up
+    uint64_t    present = 0;        // consumer has presented it
+};
+
+//? --------------------------------------------------------------------------------------
+//? Bounded lock-free ring for exactly one writer thread and one reader thread
+//? --------------------------------------------------------------------------------------
+template <typename T, size_t Capacity>
+class SpscRing
+{
+    static_assert( Capacity >= 2 && ( Capacity & ( Capacity - 1 ) ) == 0, "Capacity must be a power of two" );
+
+public:
+    SpscRing() noexcept : m_head( 0 ), m_tail( 0 ) {}
+
+    // Writer thread only. Returns false when the ring is full.
+    bool TryPush( const T& value ) noexcept
+    {
+        const size_t head = m_head.load( std::memory_order_relaxed );
+        if( head - m_tail.load( std::memory_order_acquire ) == Capacity )
+            return false;
+        m_items[head & ( Capacity - 1 )] = value;
+        m_head.store( head + 1, std::memory_order_release );
+        return true;
+    }
+
+    // Reader thread only. Returns false when the ring is empty.
+    bool TryPop( T& value ) noexcept
+    {
+        const size_t tail = m_tail.load( std::memory_order_relaxed );
+        if( tail == m_head.load( std::memory_order_acquire ) )
+            return false;
+        value = m_items[tail & ( Capacity - 1 )];
+        m_tail.store( tail + 1, std::memory_order_release );
+        return true;
+    }
+
+private:
+    T                       m_items[Capacity];
+    std::atomic<size_t>     m_head;
+    std::atomic<size_t>     m_tail;
+};
+
+//? Percentiles of one latency segment, in milliseconds
+struct LatencyPercentiles
+{
+    double      p50 = 0.0;
+    double      p95 = 0.0;
+    double      p99 = 0.0;
+    double      max = 0.0;
+};
+
+struct LatencyReport
+{
+    size_t              samples = 0;            // samples in the current window
+    uint64_t            framesPresented = 0;    // all time
+    uint64_t            framesDropped = 0;      // producer frames the consumer never showed
+    uint64_t            samplesLost = 0;        // stamps that did not fit into the ring
+    LatencyPercentiles  endToEnd;               // renderStart -> present
+    LatencyPercentiles  producer;               // renderStart -> submit
+    LatencyPercentiles  handoff;                // submit -> acquire
+    LatencyPercentiles  consumer;               // acquire -> present
+};
+
+class FrameLatencyTracker
+{
+public:
+    static const size_t kRingSize = 256;
+    static const size_t kWindowSize = 1024;
+
+    FrameLatencyTracker() noexcept;
+
+    // Consumer thread: records a fully stamped frame. Gaps in frame ids are counted as
+    // dropped frames; a repeated id (the consumer re-presenting a stale frame) is ignored.
+    void RecordPresented( const FrameStamp& stamp ) noexcept;
+
+    // Reader thread: drains the ring into the rolling window and computes the report.
+    LatencyReport Report();
+
+    // Reader thread: returns true and fills text once every dumpIntervalMs.
+    bool DumpIfDue( uint64_t nowNs, std::string& text );
+
+    void SetDumpInterval( uint64_t intervalMs ) noexcept { m_dumpIntervalNs = intervalMs * 1000000ull; }
+
+    static std::string Format( const LatencyReport& report );
+
+private:
+    void Drain();
+
+    SpscRing<FrameStamp, kRingSize>     m_ring;
+
+    // Written by the consumer thread, read by the reporting thread
+    std::atomic<uint64_t>               m_presented;
+    std::atomic<uint64_t>               m_dropped;
+    std::atomic<uint64_t>               m_lost;
+    uint64_t                            m_lastFrameId;      // consumer thread only
+
+    // Reporting thread only
+    std::vector<FrameStamp>             m_window;
+    size_t                              m_windowNext;
+    uint64_t                            m_dumpIntervalNs;
+    uint64_t                            m_lastDump;
+};
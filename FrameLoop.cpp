@@ -0,0 +1,179 @@
+//--------------------------------------------------------------------------------------
+// File: FrameLoop.cpp
+//
+// Fixed-length frame loop for offscreen windows
+//--------------------------------------------------------------------------------------
+
+#include "FrameLoop.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+
+namespace
+{
+    //? Copies still in flight after the last frame get this long to finish
+    const int kDrainAttempts = 1000;
+
+    using Clock = std::chrono::steady_clock;
+
+    void PutLE( uint8_t* p, uint32_t value, int bytes )
+    {
+        for( int i = 0; i < bytes; ++i )
+            p[i] = uint8_t( value >> ( i * 8 ) );
+    }
+}
+
+//--------------------------------------------------------------------------------------
+FrameLoop::FrameLoop( RenderWindow& window, const FrameLoopDesc& desc ) :
+    m_windows( 1, &window ),
+    m_desc( desc )
+{
+    m_draw = []( RenderWindow& target, uint64_t, double seconds )
+    {
+        const float white[4] = { 1.0f, 1.0f, 1.0f, 1.0f };
+        target.UpdateFrameConstants( SpinningQuadConstants( float( seconds ), white ) );
+        target.DrawQuad();
+    };
+}
+
+bool FrameLoop::Run()
+{
+    const Clock::time_point start = Clock::now();
+    m_stats = FrameLoopStats();
+
+    //? Enough slots that every frame can be captured
+    RenderWindow& first = *m_windows[0];
+    std::unique_ptr<IStagingBackend> backend;
+    std::unique_ptr<ReadbackRing> readback;
+    if( m_desc.readbackLatency )
+    {
+        const size_t slots = size_t( m_desc.readbackLatency ) + 1;
+        backend = first.CreateReadback( slots );
+        if( !backend )
+            return false;
+        readback.reset( new ReadbackRing( *backend, slots, m_desc.readbackLatency, first.Width(), first.Height(), 4 ) );
+        readback->SetCallback( m_callback );
+    }
+
+    size_t beginPhase = 0, drawPhase = 0, readbackPhase = 0, presentPhase = 0;
+    if( m_benchmark )
+    {
+        beginPhase = m_benchmark->AddPhase( "begin" );
+        drawPhase = m_benchmark->AddPhase( "draw" );
+        readbackPhase = m_benchmark->AddPhase( "readback" );
+        presentPhase = m_benchmark->AddPhase( "present" );
+    }
+
+    for( uint64_t frameId = 1; frameId <= m_desc.frameCount; ++frameId )
+    {
+        const double seconds = double( frameId - 1 ) * m_desc.frameSeconds;
+        if( m_benchmark )
+            m_benchmark->BeginFrame();
+
+        for( RenderWindow* window : m_windows )
+        {
+            {
+                FrameBenchmark::ScopedPhase phase( m_benchmark, beginPhase );
+                window->BeginFrame();
+            }
+            {
+                FrameBenchmark::ScopedPhase phase( m_benchmark, drawPhase );
+                m_draw( *window, frameId, seconds );
+            }
+            if( readback && window == &first )
+            {
+                FrameBenchmark::ScopedPhase phase( m_benchmark, readbackPhase );
+                readback->Capture( frameId );
+            }
+            {
+                FrameBenchmark::ScopedPhase phase( m_benchmark, presentPhase );
+                window->Present();
+            }
+        }
+
+        if( readback )
+        {
+            FrameBenchmark::ScopedPhase phase( m_benchmark, readbackPhase );
+            readback->Poll( frameId );
+        }
+        if( m_benchmark )
+            m_benchmark->EndFrame();
+        ++m_stats.frames;
+    }
+
+    if( readback )
+    {
+        for( int attempt = 0; readback->InFlight() && attempt < kDrainAttempts; ++attempt )
+        {
+            if( !readback->Drain() )
+                std::this_thread::sleep_for( std::chrono::milliseconds( 1 ) );
+        }
+
+        const ReadbackRing::Stats& stats = readback->GetStats();
+        m_stats.delivered = stats.delivered;
+        m_stats.dropped = stats.droppedNoSlot + ( stats.captured - stats.delivered );
+    }
+
+    m_stats.wallMs = std::chrono::duration<double, std::milli>( Clock::now() - start ).count();
+    return true;
+}
+
+//--------------------------------------------------------------------------------------
+FrameConstants SpinningQuadConstants( float angle, const float meshColor[4] )
+{
+    //? RotationY, stored transposed: rows of the HLSL matrix are the columns here
+    const float c = cosf( angle );
+    const float s = sinf( angle );
+    const float world[16] =
+    {
+           c, 0.0f,    s, 0.0f,
+        0.0f, 1.0f, 0.0f, 0.0f,
+          -s, 0.0f,    c, 0.0f,
+        0.0f, 0.0f, 0.0f, 1.0f,
+    };
+
+    FrameConstants constants;
+    memcpy( constants.world, world, sizeof( world ) );
+    memcpy( constants.meshColor, meshColor, sizeof( constants.meshColor ) );
+    return constants;
+}
+
+bool WriteFrameBitmap( const char* path, const ReadbackFrame& frame )
+{
+    if( !frame.data || frame.bytesPerPixel != 4 )
+        return false;
+
+    const uint32_t imageBytes = frame.width * frame.height * 4;
+    uint8_t header[54] = {};
+    header[0] = 'B';
+    header[1] = 'M';
+    PutLE( header + 2, 54 + imageBytes, 4 );
+    PutLE( header + 10, 54, 4 );
+    PutLE( header + 14, 40, 4 );
+    PutLE( header + 18, frame.width, 4 );
+    PutLE( header + 22, uint32_t( -int32_t( frame.height ) ), 4 );     // negative height: top-down rows
+    PutLE( header + 26, 1, 2 );
+    PutLE( header + 28, 32, 2 );
+    PutLE( header + 34, imageBytes, 4 );
+
+    //? RGBA to BGRA
+    std::vector<uint8_t> pixels( frame.data, frame.data + imageBytes );
+    for( size_t i = 0; i < pixels.size(); i += 4 )
+    {
+        const uint8_t r = pixels[i];
+        pixels[i] = pixels[i + 2];
+        pixels[i + 2] = r;
+    }
+
+    FILE* file = fopen( path, "wb" );
+    if( !file )
+        return false;
+    const bool ok = fwrite( header, 1, sizeof( header ), file ) == sizeof( header ) &&
+                    fwrite( pixels.data(), 1, pixels.size(), file ) == pixels.size();
+    return fclose( file ) == 0 && ok;
+}
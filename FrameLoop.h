@@ -0,0 +1,72 @@
+//--------------------------------------------------------------------------------------
+// File: FrameLoop.h
+//
+// Fixed-length frame loop for offscreen windows: no message pump and no wall clock.
+// Every frame is BeginFrame, the draw callback, a readback capture, Present and a poll
+// of the readback ring; at the end the ring is drained so every captured frame reaches
+// the callback. Animation time advances by a fixed step, so a run renders the same
+// frames on every backend. Extra windows are drawn after the first each frame; only the
+// first is read back. With a FrameBenchmark attached, each of these steps is a phase.
+//--------------------------------------------------------------------------------------
+
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include "FrameBenchmark.h"
+#include "ReadbackRing.h"
+#include "RenderDevice.h"
+
+
+struct FrameLoopDesc
+{
+    uint64_t    frameCount = 60;
+    double      frameSeconds = 1.0 / 60.0;  // animation time per frame
+    uint32_t    readbackLatency = 2;        // frames between a capture and its map; 0: no readback
+};
+
+struct FrameLoopStats
+{
+    uint64_t    frames = 0;
+    uint64_t    delivered = 0;      // frames handed to the readback callback
+    uint64_t    dropped = 0;        // captures that found no free slot, or never mapped
+    double      wallMs = 0.0;
+};
+
+// Called between BeginFrame and Present; 'seconds' is frameId - 1 times the fixed step
+using FrameDrawFn = std::function<void( RenderWindow& window, uint64_t frameId, double seconds )>;
+
+class FrameLoop
+{
+public:
+    FrameLoop( RenderWindow& window, const FrameLoopDesc& desc );
+
+    void AddWindow( RenderWindow& window ) { m_windows.push_back( &window ); }
+    void SetBenchmark( FrameBenchmark* benchmark ) { m_benchmark = benchmark; }
+
+    // The default draw is the window's quad spinning about Y
+    void SetDraw( FrameDrawFn draw ) { m_draw = std::move( draw ); }
+    void SetReadbackCallback( ReadbackCallback callback ) { m_callback = std::move( callback ); }
+
+    // Runs every frame. False if the readback could not be created.
+    bool Run();
+
+    const FrameLoopStats& Stats() const noexcept { return m_stats; }
+
+private:
+    std::vector<RenderWindow*>          m_windows;
+    const FrameLoopDesc                 m_desc;
+    FrameBenchmark*                     m_benchmark = nullptr;
+    FrameDrawFn                         m_draw;
+    ReadbackCallback                    m_callback;
+    FrameLoopStats                      m_stats;
+};
+
+// World matrix (transposed for HLSL) of a rotation by 'angle' radians about Y
+FrameConstants SpinningQuadConstants( float angle, const float meshColor[4] );
+
+// Writes an RGBA8 readback frame as a 32-bit top-down BMP
+bool WriteFrameBitmap( const char* path, const ReadbackFrame& frame );
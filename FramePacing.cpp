@@ -0,0 +1,157 @@
+//--------------------------------------------------------------------------------------
+// File: FramePacing.cpp
+//
+// Frame pacing for presenting windows
+//--------------------------------------------------------------------------------------
+
+#include "FramePacing.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <thread>
+
+
+namespace
+{
+    //? Past this many samples the sleep statistics weigh new sleeps like a moving
+    //? average, so they follow changes in the timer resolution
+    const uint64_t kMaxSleepSamples = 64;
+
+    double Milliseconds( uint64_t ns )
+    {
+        return double( ns ) / 1e6;
+    }
+}
+
+//--------------------------------------------------------------------------------------
+uint64_t SteadyPacingClock::Now()
+{
+    return uint64_t( std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch() ).count() );
+}
+
+void SteadyPacingClock::Sleep( uint64_t ns )
+{
+    std::this_thread::sleep_for( std::chrono::nanoseconds( ns ) );
+}
+
+void SteadyPacingClock::Pause()
+{
+    std::this_thread::yield();
+}
+
+//--------------------------------------------------------------------------------------
+FramePacer::FramePacer( IPacingClock& clock, const FramePacingConfig& config ) :
+    m_clock( clock ),
+    m_config( config ),
+    m_sleepMean( double( config.initialSleepNs ) )
+{
+    SetTargetFps( config.targetFps );
+}
+
+void FramePacer::SetTargetFps( double fps )
+{
+    m_config.targetFps = fps > 0.0 ? fps : 0.0;
+    m_period = fps > 0.0 ? uint64_t( 1e9 / fps + 0.5 ) : 0;
+    m_nextDeadline = 0;
+}
+
+void FramePacer::BeginFrame( IFrameLatencyWaitable* const* waitables, size_t count )
+{
+    //? The swap chains first: their waits end at a vsync, and the throttle then only
+    //? adds what is left of the frame's slot
+    if( count )
+    {
+        const uint64_t start = m_clock.Now();
+        for( size_t i = 0; i < count; ++i )
+        {
+            if( waitables[i] && !waitables[i]->Wait( m_config.latencyTimeoutNs ) )
+                ++m_stats.latencyTimeouts;
+        }
+        m_stats.latencyWaitMs += Milliseconds( m_clock.Now() - start );
+    }
+
+    if( m_period )
+    {
+        const uint64_t now = m_clock.Now();
+        if( m_nextDeadline == 0 )
+        {
+            m_nextDeadline = now;
+        }
+        else if( now > m_nextDeadline + m_period )
+        {
+            //? A frame took long enough to miss its slot and the next: catching up would
+            //? only produce a burst of unthrottled frames
+            ++m_stats.lateFrames;
+            m_nextDeadline = now;
+        }
+        else
+        {
+            WaitUntil( m_nextDeadline );
+        }
+        m_nextDeadline += m_period;
+    }
+
+    const uint64_t begin = m_clock.Now();
+    if( m_stats.frames )
+        m_intervals.Add( Milliseconds( begin - m_lastBegin ) );
+    m_lastBegin = begin;
+    ++m_stats.frames;
+}
+
+void FramePacer::WaitUntil( uint64_t deadline )
+{
+    uint64_t now = m_clock.Now();
+    while( now < deadline && deadline - now > SleepEstimateNs() )
+    {
+        m_clock.Sleep( m_config.sleepQuantumNs );
+        const uint64_t woke = m_clock.Now();
+        AddSleepSample( woke - now );
+        m_stats.sleepMs += Milliseconds( woke - now );
+        now = woke;
+    }
+
+    const uint64_t spinStart = now;
+    while( now < deadline )
+    {
+        m_clock.Pause();
+        now = m_clock.Now();
+    }
+    m_stats.spinMs += Milliseconds( now - spinStart );
+
+    const double overshootMs = Milliseconds( now - deadline );
+    if( overshootMs > m_stats.maxOvershootMs )
+        m_stats.maxOvershootMs = overshootMs;
+}
+
+uint64_t FramePacer::SleepEstimateNs() const noexcept
+{
+    const double variance = m_sleepSamples > 1 ? m_sleepM2 / double( m_sleepSamples - 1 ) : 0.0;
+    return uint64_t( m_sleepMean + std::sqrt( variance ) );
+}
+
+void FramePacer::AddSleepSample( uint64_t ns )
+{
+    //? Welford's update, with the sample count capped
+    if( m_sleepSamples < kMaxSleepSamples )
+        ++m_sleepSamples;
+    else
+        m_sleepM2 *= double( m_sleepSamples - 1 ) / double( m_sleepSamples );
+
+    const double sample = double( ns );
+    const double delta = sample - m_sleepMean;
+    m_sleepMean += delta / double( m_sleepSamples );
+    m_sleepM2 += delta * ( sample - m_sleepMean );
+}
+
+std::string FramePacer::Format() const
+{
+    char line[256];
+    snprintf( line, sizeof( line ), "Frame pacing: %llu frames, %.3f ms mean interval (%.3f min, %.3f max), %llu late, %llu latency timeouts; "
+              "%.1f ms waiting on swap chains, %.1f ms sleeping, %.1f ms spinning, %.3f ms worst overshoot\n",
+              static_cast<unsigned long long>( m_stats.frames ), m_intervals.MeanMs(), m_intervals.MinMs(), m_intervals.MaxMs(),
+              static_cast<unsigned long long>( m_stats.lateFrames ), static_cast<unsigned long long>( m_stats.latencyTimeouts ),
+              m_stats.latencyWaitMs, m_stats.sleepMs, m_stats.spinMs, m_stats.maxOvershootMs );
+    return line;
+}
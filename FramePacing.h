@@ -0,0 +1,120 @@
+//--------------------------------------------------------------------------------------
+// File: FramePacing.h
+//
+// Frame pacing for presenting windows. Before the CPU starts a frame, FramePacer waits
+// until every swap chain it paces can queue another frame (a frame-latency waitable
+// object, so the CPU never runs more than the configured number of frames ahead of the
+// display), then until the frame's slot when a target frame rate is set.
+//
+// Timed waits are a sleep/spin hybrid: the pacer sleeps in short quanta while the time
+// left is longer than what a sleep has been observed to take, and spins the rest. The
+// observed sleep length adapts to the platform's timer resolution.
+//
+// Time, sleeping and the latency waits all go through interfaces, so the pacing runs
+// the same against the real clock and a simulated display.
+//--------------------------------------------------------------------------------------
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include "GpuProfiler.h"
+
+
+class IPacingClock
+{
+public:
+    virtual ~IPacingClock() = default;
+
+    // Monotonic time in nanoseconds
+    virtual uint64_t Now() = 0;
+
+    // Blocks for about 'ns'; may take longer
+    virtual void Sleep( uint64_t ns ) = 0;
+
+    // One step of a busy wait
+    virtual void Pause() = 0;
+};
+
+// std::chrono and std::this_thread
+class SteadyPacingClock : public IPacingClock
+{
+public:
+    uint64_t Now() override;
+    void Sleep( uint64_t ns ) override;
+    void Pause() override;
+};
+
+// A swap chain's frame-latency waitable object, or a stand-in for one
+class IFrameLatencyWaitable
+{
+public:
+    virtual ~IFrameLatencyWaitable() = default;
+
+    // Waits until another frame can be queued. False on timeout.
+    virtual bool Wait( uint64_t timeoutNs ) = 0;
+};
+
+struct FramePacingConfig
+{
+    double      targetFps = 0.0;                    // 0: only the swap chains pace the frames
+    uint64_t    latencyTimeoutNs = 100000000;       // stop waiting on a swap chain after this (e.g. while occluded)
+    uint64_t    sleepQuantumNs = 1000000;           // length of each sleep
+    uint64_t    initialSleepNs = 2000000;           // assumed length of a sleep until some were measured
+};
+
+class FramePacer
+{
+public:
+    struct Stats
+    {
+        uint64_t    frames = 0;
+        uint64_t    latencyTimeouts = 0;    // a swap chain did not free a frame in time
+        uint64_t    lateFrames = 0;         // began more than a frame after their slot; the schedule restarts
+        double      latencyWaitMs = 0.0;    // totals
+        double      sleepMs = 0.0;
+        double      spinMs = 0.0;
+        double      maxOvershootMs = 0.0;   // latest a timed wait returned after its deadline
+    };
+
+    FramePacer( IPacingClock& clock, const FramePacingConfig& config );
+
+    // Changes the target frame rate; the schedule restarts at the next frame
+    void SetTargetFps( double fps );
+    double TargetFps() const noexcept { return m_config.targetFps; }
+
+    // Waits until each of the 'count' swap chains can take another frame, then until the
+    // next frame's slot if a target frame rate is set
+    void BeginFrame( IFrameLatencyWaitable* const* waitables = nullptr, size_t count = 0 );
+
+    // Sleeps and then spins until Now() reaches 'deadline'
+    void WaitUntil( uint64_t deadline );
+
+    // Current estimate of how long one sleep quantum really takes: mean plus one
+    // standard deviation of the recent ones
+    uint64_t SleepEstimateNs() const noexcept;
+
+    const Stats& GetStats() const noexcept { return m_stats; }
+
+    // Time between consecutive BeginFrame() returns
+    const RollingTimer& FrameIntervals() const noexcept { return m_intervals; }
+
+    // Totals and the recent frame intervals
+    std::string Format() const;
+
+private:
+    void AddSleepSample( uint64_t ns );
+
+    IPacingClock&       m_clock;
+    FramePacingConfig   m_config;
+    uint64_t            m_period = 0;           // ns per frame at the target rate
+    uint64_t            m_nextDeadline = 0;     // 0: start a new schedule
+    uint64_t            m_lastBegin = 0;
+    double              m_sleepMean = 0.0;      // running mean and variance of measured sleeps
+    double              m_sleepM2 = 0.0;
+    uint64_t            m_sleepSamples = 0;
+    RollingTimer        m_intervals;
+    Stats               m_stats;
+};
@@ -0,0 +1,377 @@
+//--------------------------------------------------------------------------------------
+// File: GoldenImage.cpp
+//
+// Image diff and golden-image regression checks
+//--------------------------------------------------------------------------------------
+
+#include "GoldenImage.h"
+#include "FrameLoop.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <limits>
+
+#if defined( __SSE2__ ) || defined( _M_X64 ) || ( defined( _M_IX86_FP ) && _M_IX86_FP >= 2 )
+#include <emmintrin.h>
+#define GOLDEN_SSE2 1
+#else
+#define GOLDEN_SSE2 0
+#endif
+
+
+namespace
+{
+    using Clock = std::chrono::steady_clock;
+
+    const uint32_t kDDSHeaderBytes = 4 + 124 + 20;      // magic, header, DX10 header
+    const uint32_t kFormatR8G8B8A8Unorm = 28;
+    const uint32_t kDimensionTexture2D = 3;
+
+    struct DiffTotals
+    {
+        uint64_t    differing = 0;
+        uint64_t    squared = 0;
+        uint32_t    maxError = 0;
+    };
+
+    void DiffPixelsScalar( const uint8_t* a, const uint8_t* b, size_t pixels, uint32_t channels, uint32_t tolerance, DiffTotals& totals )
+    {
+        for( size_t i = 0; i < pixels; ++i, a += 4, b += 4 )
+        {
+            bool differs = false;
+            for( uint32_t c = 0; c < channels; ++c )
+            {
+                const uint32_t error = a[c] > b[c] ? a[c] - b[c] : b[c] - a[c];
+                totals.squared += error * error;
+                totals.maxError = std::max( totals.maxError, error );
+                differs |= error > tolerance;
+            }
+            totals.differing += differs ? 1 : 0;
+        }
+    }
+
+#if GOLDEN_SSE2
+    //? Four pixels per step. Squared errors gather in 32-bit lanes, at most 260100 per
+    //? lane per step, so they move to 64 bits every kStepsPerFlush steps.
+    void DiffPixelsSSE2( const uint8_t* a, const uint8_t* b, size_t pixels, uint32_t channels, uint32_t tolerance, DiffTotals& totals )
+    {
+        const size_t kStepsPerFlush = 4096;
+        static const uint8_t kBitCount[16] = { 0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4 };
+
+        const __m128i zero = _mm_setzero_si128();
+        const __m128i keep = _mm_set1_epi32( channels == 4 ? -1 : 0x00ffffff );
+        const __m128i slack = _mm_set1_epi8( char( std::min( tolerance, 255u ) ) );
+        __m128i maxError = zero;
+
+        size_t steps = pixels / 4;
+        while( steps )
+        {
+            const size_t batch = std::min( steps, kStepsPerFlush );
+            __m128i squared = zero;
+            for( size_t i = 0; i < batch; ++i, a += 16, b += 16 )
+            {
+                const __m128i x = _mm_loadu_si128( reinterpret_cast<const __m128i*>( a ) );
+                const __m128i y = _mm_loadu_si128( reinterpret_cast<const __m128i*>( b ) );
+                const __m128i error = _mm_and_si128( _mm_or_si128( _mm_subs_epu8( x, y ), _mm_subs_epu8( y, x ) ), keep );
+                maxError = _mm_max_epu8( maxError, error );
+
+                const __m128i low = _mm_unpacklo_epi8( error, zero );
+                const __m128i high = _mm_unpackhi_epi8( error, zero );
+                squared = _mm_add_epi32( squared, _mm_add_epi32( _mm_madd_epi16( low, low ), _mm_madd_epi16( high, high ) ) );
+
+                //? A pixel matches when all of its errors are within the tolerance
+                const __m128i same = _mm_cmpeq_epi32( _mm_subs_epu8( error, slack ), zero );
+                totals.differing += 4 - kBitCount[_mm_movemask_ps( _mm_castsi128_ps( same ) )];
+            }
+
+            uint32_t lanes[4];
+            _mm_storeu_si128( reinterpret_cast<__m128i*>( lanes ), squared );
+            totals.squared += uint64_t( lanes[0] ) + lanes[1] + lanes[2] + lanes[3];
+            steps -= batch;
+        }
+
+        uint8_t bytes[16];
+        _mm_storeu_si128( reinterpret_cast<__m128i*>( bytes ), maxError );
+        for( uint8_t value : bytes )
+            totals.maxError = std::max<uint32_t>( totals.maxError, value );
+
+        DiffPixelsScalar( a, b, pixels % 4, channels, tolerance, totals );
+    }
+#endif
+
+    void PutLE32( uint8_t* p, uint32_t value )
+    {
+        p[0] = uint8_t( value );
+        p[1] = uint8_t( value >> 8 );
+        p[2] = uint8_t( value >> 16 );
+        p[3] = uint8_t( value >> 24 );
+    }
+
+    uint32_t GetLE32( const uint8_t* p )
+    {
+        return uint32_t( p[0] ) | ( uint32_t( p[1] ) << 8 ) | ( uint32_t( p[2] ) << 16 ) | ( uint32_t( p[3] ) << 24 );
+    }
+
+    size_t FrameBytes( uint32_t width, uint32_t height )
+    {
+        return size_t( width ) * height * 4;
+    }
+}
+
+//--------------------------------------------------------------------------------------
+ImageDiffResult DiffImages( const ReadbackFrame& image, const ReadbackFrame& reference, const ImageDiffOptions& options )
+{
+    ImageDiffResult result;
+    if( !image.data || !reference.data || image.bytesPerPixel != 4 || reference.bytesPerPixel != 4 ||
+        image.width != reference.width || image.height != reference.height )
+        return result;
+
+    const size_t pixels = size_t( image.width ) * image.height;
+    const uint32_t channels = options.compareAlpha ? 4 : 3;
+    DiffTotals totals;
+#if GOLDEN_SSE2
+    DiffPixelsSSE2( image.data, reference.data, pixels, channels, options.tolerance, totals );
+#else
+    DiffPixelsScalar( image.data, reference.data, pixels, channels, options.tolerance, totals );
+#endif
+
+    result.sizeMatches = true;
+    result.pixels = pixels;
+    result.differing = totals.differing;
+    result.maxError = totals.maxError;
+    result.mse = pixels ? double( totals.squared ) / ( double( pixels ) * channels ) : 0.0;
+    result.psnr = result.mse > 0.0 ? 10.0 * log10( 255.0 * 255.0 / result.mse ) : std::numeric_limits<double>::infinity();
+    return result;
+}
+
+bool WriteFramesDDS( const char* path, const std::vector<ReadbackFrame>& frames )
+{
+    if( frames.empty() )
+        return false;
+    const uint32_t width = frames[0].width;
+    const uint32_t height = frames[0].height;
+    for( const ReadbackFrame& frame : frames )
+    {
+        if( !frame.data || frame.bytesPerPixel != 4 || frame.width != width || frame.height != height )
+            return false;
+    }
+
+    //? DDSD_CAPS | HEIGHT | WIDTH | PITCH | PIXELFORMAT, a 'DX10' pixel format and
+    //? DDSCAPS_TEXTURE; the array size lives in the DX10 header
+    uint8_t header[kDDSHeaderBytes] = {};
+    memcpy( header, "DDS ", 4 );
+    PutLE32( header + 4, 124 );
+    PutLE32( header + 8, 0x1 | 0x2 | 0x4 | 0x8 | 0x1000 );
+    PutLE32( header + 12, height );
+    PutLE32( header + 16, width );
+    PutLE32( header + 20, width * 4 );
+    PutLE32( header + 28, 1 );
+    PutLE32( header + 76, 32 );
+    PutLE32( header + 80, 0x4 );
+    memcpy( header + 84, "DX10", 4 );
+    PutLE32( header + 108, 0x1000 );
+    PutLE32( header + 128, kFormatR8G8B8A8Unorm );
+    PutLE32( header + 132, kDimensionTexture2D );
+    PutLE32( header + 140, uint32_t( frames.size() ) );
+
+    FILE* file = fopen( path, "wb" );
+    if( !file )
+        return false;
+    bool ok = fwrite( header, 1, sizeof( header ), file ) == sizeof( header );
+    for( size_t i = 0; ok && i < frames.size(); ++i )
+        ok = fwrite( frames[i].data, 1, FrameBytes( width, height ), file ) == FrameBytes( width, height );
+    return fclose( file ) == 0 && ok;
+}
+
+bool ReadFramesDDS( const char* path, std::vector<uint8_t>& pixels, uint32_t* width, uint32_t* height, uint32_t* count )
+{
+    FILE* file = fopen( path, "rb" );
+    if( !file )
+        return false;
+
+    uint8_t header[kDDSHeaderBytes];
+    bool ok = fread( header, 1, sizeof( header ), file ) == sizeof( header ) && memcmp( header, "DDS ", 4 ) == 0 &&
+              memcmp( header + 84, "DX10", 4 ) == 0 && GetLE32( header + 128 ) == kFormatR8G8B8A8Unorm &&
+              GetLE32( header + 132 ) == kDimensionTexture2D && GetLE32( header + 28 ) <= 1;
+    if( ok )
+    {
+        *height = GetLE32( header + 12 );
+        *width = GetLE32( header + 16 );
+        *count = GetLE32( header + 140 );
+        ok = *width && *height && *count;
+    }
+    if( ok )
+    {
+        pixels.resize( FrameBytes( *width, *height ) * *count );
+        ok = fread( pixels.data(), 1, pixels.size(), file ) == pixels.size();
+    }
+    fclose( file );
+    return ok;
+}
+
+//--------------------------------------------------------------------------------------
+GoldenSuite::GoldenSuite( const std::string& directory, bool update ) :
+    m_directory( directory ),
+    m_update( update )
+{
+}
+
+bool GoldenSuite::Check( const std::string& name, uint64_t index, const ReadbackFrame& frame )
+{
+    return Record( name, index, frame, nullptr );
+}
+
+bool GoldenSuite::Compare( const std::string& name, uint64_t index, const ReadbackFrame& frame, const ReadbackFrame& reference )
+{
+    return Record( name, index, frame, &reference );
+}
+
+bool GoldenSuite::Record( const std::string& name, uint64_t index, const ReadbackFrame& frame, const ReadbackFrame* reference )
+{
+    CaseResult& result = m_cases[name];
+    if( !result.frames )
+        result.minPsnr = std::numeric_limits<double>::infinity();
+    ++result.frames;
+    ++m_stats.frames;
+
+    ReadbackFrame expected;
+    if( reference )
+    {
+        expected = *reference;
+    }
+    else if( m_update )
+    {
+        //? Frames land at their index; a frame of another size fails
+        Golden& golden = m_goldens[name];
+        if( !golden.width )
+        {
+            golden.width = frame.width;
+            golden.height = frame.height;
+        }
+        const size_t bytes = FrameBytes( golden.width, golden.height );
+        const bool fits = frame.data && frame.bytesPerPixel == 4 && frame.width == golden.width && frame.height == golden.height;
+        if( fits )
+        {
+            golden.count = std::max( golden.count, uint32_t( index + 1 ) );
+            golden.pixels.resize( bytes * golden.count );
+            memcpy( &golden.pixels[bytes * index], frame.data, bytes );
+            return true;
+        }
+    }
+    else
+    {
+        Golden& golden = m_goldens[name];
+        if( !golden.loaded )
+        {
+            golden.loaded = true;
+            if( !ReadFramesDDS( GoldenPath( name ).c_str(), golden.pixels, &golden.width, &golden.height, &golden.count ) )
+                golden.count = 0;
+        }
+        if( index < golden.count )
+        {
+            expected.frameId = index + 1;
+            expected.width = golden.width;
+            expected.height = golden.height;
+            expected.bytesPerPixel = 4;
+            expected.data = &golden.pixels[FrameBytes( golden.width, golden.height ) * index];
+            expected.size = FrameBytes( golden.width, golden.height );
+        }
+        else
+        {
+            result.missing = true;
+        }
+    }
+
+    bool passed = false;
+    if( expected.data )
+    {
+        const Clock::time_point start = Clock::now();
+        const ImageDiffResult diff = DiffImages( frame, expected, m_options );
+        m_stats.diffMs += std::chrono::duration<double, std::milli>( Clock::now() - start ).count();
+        m_stats.pixels += diff.pixels;
+
+        passed = diff.sizeMatches && diff.maxError <= m_thresholds.maxError && diff.psnr >= m_thresholds.minPsnr;
+        if( diff.sizeMatches )
+        {
+            result.maxError = std::max( result.maxError, diff.maxError );
+            result.minPsnr = std::min( result.minPsnr, diff.psnr );
+        }
+    }
+
+    if( !passed )
+    {
+        //? The first failing frame is kept next to the goldens for a look
+        if( result.firstFailed == UINT64_MAX )
+        {
+            result.firstFailed = index;
+            WriteFrameBitmap( ( m_directory + "/" + name + ".fail.bmp" ).c_str(), frame );
+        }
+        ++result.failed;
+        ++m_stats.failed;
+    }
+    return passed;
+}
+
+bool GoldenSuite::Finish()
+{
+    bool ok = m_stats.failed == 0;
+    if( !m_update )
+        return ok;
+
+    for( const std::pair<const std::string, Golden>& entry : m_goldens )
+    {
+        const Golden& golden = entry.second;
+        if( !golden.count )
+            continue;
+
+        std::vector<ReadbackFrame> frames( golden.count );
+        for( uint32_t i = 0; i < golden.count; ++i )
+        {
+            frames[i].frameId = i + 1;
+            frames[i].width = golden.width;
+            frames[i].height = golden.height;
+            frames[i].bytesPerPixel = 4;
+            frames[i].data = &golden.pixels[FrameBytes( golden.width, golden.height ) * i];
+            frames[i].size = FrameBytes( golden.width, golden.height );
+        }
+        ok &= WriteFramesDDS( GoldenPath( entry.first ).c_str(), frames );
+    }
+    return ok;
+}
+
+std::string GoldenSuite::FormatReport() const
+{
+    std::string report;
+    char text[256];
+    for( const std::pair<const std::string, CaseResult>& entry : m_cases )
+    {
+        const CaseResult& result = entry.second;
+        if( m_update && m_goldens.count( entry.first ) )
+        {
+            snprintf( text, sizeof( text ), "Golden %s: %llu frames recorded\n", entry.first.c_str(), (unsigned long long)result.frames );
+        }
+        else
+        {
+            snprintf( text, sizeof( text ), "Golden %s: %llu frames, %llu failed%s, max error %u, min PSNR %.2f dB%s\n",
+                      entry.first.c_str(), (unsigned long long)result.frames, (unsigned long long)result.failed,
+                      result.failed ? ( " (first " + std::to_string( result.firstFailed ) + ")" ).c_str() : "",
+                      result.maxError, result.minPsnr, result.missing ? ", goldens missing" : "" );
+        }
+        report += text;
+    }
+
+    const double seconds = m_stats.diffMs / 1000.0;
+    snprintf( text, sizeof( text ), "Golden diff: %llu frames, %.1f Mpixels in %.2f ms (%.0f Mpixels/s)\n",
+              (unsigned long long)m_stats.frames, m_stats.pixels / 1e6, m_stats.diffMs,
+              seconds > 0.0 ? m_stats.pixels / 1e6 / seconds : 0.0 );
+    report += text;
+    return report;
+}
+
+std::string GoldenSuite::GoldenPath( const std::string& name ) const
+{
+    return m_directory + "/" + name + ".dds";
+}
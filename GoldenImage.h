@@ -0,0 +1,122 @@
+//--------------------------------------------------------------------------------------
+// File: GoldenImage.h
+//
+// Golden-image regression checks for rendered frames. DiffImages compares two RGBA8
+// images 16 bytes at a time with SSE2 and reports the pixels that differ, the largest
+// channel error, the mean squared error and PSNR; it runs at memory speed, so a test
+// can check every frame it renders.
+//
+// A GoldenSuite checks named cases frame by frame. Each case's goldens are one DDS
+// file, <directory>/<name>.dds, holding every frame as a slice of an R8G8B8A8 texture
+// array, so texture viewers open them directly. In update mode the frames checked
+// become the new goldens instead. The first failing frame of a case is written next to
+// its goldens as <name>.fail.bmp.
+//--------------------------------------------------------------------------------------
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "ReadbackRing.h"
+
+
+struct ImageDiffOptions
+{
+    bool        compareAlpha = true;    // false for targets whose alpha is never shown
+    uint32_t    tolerance = 0;          // channel errors up to this don't make a pixel differ
+};
+
+struct ImageDiffResult
+{
+    bool        sizeMatches = false;    // false: nothing else is filled in
+    uint64_t    pixels = 0;
+    uint64_t    differing = 0;          // pixels with a channel error above the tolerance
+    uint32_t    maxError = 0;           // largest channel error, 0..255
+    double      mse = 0.0;              // mean squared channel error
+    double      psnr = 0.0;             // dB; infinite for identical images
+};
+
+// Compares two RGBA8 frames (bytesPerPixel 4, tightly packed) of the same size
+ImageDiffResult DiffImages( const ReadbackFrame& image, const ReadbackFrame& reference, const ImageDiffOptions& options = ImageDiffOptions() );
+
+// Writes RGBA8 frames of one size as the slices of an R8G8B8A8 DDS texture array
+bool WriteFramesDDS( const char* path, const std::vector<ReadbackFrame>& frames );
+
+// Reads a file written by WriteFramesDDS; pixels holds the slices back to back
+bool ReadFramesDDS( const char* path, std::vector<uint8_t>& pixels, uint32_t* width, uint32_t* height, uint32_t* count );
+
+struct GoldenThresholds
+{
+    uint32_t    maxError = 8;           // a frame fails if any channel is further off than this
+    double      minPsnr = 40.0;         // or if its PSNR is below this
+};
+
+class GoldenSuite
+{
+public:
+    struct CaseResult
+    {
+        uint64_t    frames = 0;
+        uint64_t    failed = 0;
+        uint64_t    firstFailed = UINT64_MAX;   // frame index
+        uint32_t    maxError = 0;
+        double      minPsnr = 0.0;              // the worst frame's
+        bool        missing = false;            // no golden for some frame
+    };
+
+    struct Stats
+    {
+        uint64_t    frames = 0;         // checks made, over every case
+        uint64_t    failed = 0;
+        uint64_t    pixels = 0;         // pixels diffed
+        double      diffMs = 0.0;       // time spent in DiffImages
+    };
+
+    // update: record the frames checked and write them as the goldens at Finish()
+    GoldenSuite( const std::string& directory, bool update );
+
+    void SetThresholds( const GoldenThresholds& thresholds ) { m_thresholds = thresholds; }
+    void SetDiffOptions( const ImageDiffOptions& options ) { m_options = options; }
+
+    // Checks frame 'index' of case 'name' against its golden, loading the case's file
+    // on first use. Returns true if it passed or is being recorded.
+    bool Check( const std::string& name, uint64_t index, const ReadbackFrame& frame );
+
+    // Checks a frame against an image in memory, for copies that must match their source
+    bool Compare( const std::string& name, uint64_t index, const ReadbackFrame& frame, const ReadbackFrame& reference );
+
+    // Writes the recorded goldens in update mode. True if every check passed and every
+    // golden could be written.
+    bool Finish();
+
+    const std::map<std::string, CaseResult>& Cases() const noexcept { return m_cases; }
+    const Stats& GetStats() const noexcept { return m_stats; }
+
+    // One line per case and the diff throughput
+    std::string FormatReport() const;
+
+private:
+    struct Golden
+    {
+        bool                    loaded = false;
+        uint32_t                width = 0;
+        uint32_t                height = 0;
+        uint32_t                count = 0;
+        std::vector<uint8_t>    pixels;     // slices back to back; recorded frames in update mode
+    };
+
+    bool Record( const std::string& name, uint64_t index, const ReadbackFrame& frame, const ReadbackFrame* reference );
+    std::string GoldenPath( const std::string& name ) const;
+
+    std::string                         m_directory;
+    bool                                m_update;
+    GoldenThresholds                    m_thresholds;
+    ImageDiffOptions                    m_options;
+    std::map<std::string, Golden>       m_goldens;
+    std::map<std::string, CaseResult>   m_cases;
+    Stats                               m_stats;
+};
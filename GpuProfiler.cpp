@@ -0,0 +1,226 @@
+//--------------------------------------------------------------------------------------
+// File: GpuProfiler.cpp
+//
+// GPU time per named scope from timestamp queries
+//--------------------------------------------------------------------------------------
+
+#include "GpuProfiler.h"
+
+#include <algorithm>
+#include <cstdio>
+
+
+//--------------------------------------------------------------------------------------
+void RollingTimer::Add( double ms )
+{
+    if( m_samples.size() < m_window )
+        m_samples.push_back( ms );
+    else
+        m_samples[m_next] = ms;
+    m_next = ( m_next + 1 ) % m_window;
+    m_lastMs = ms;
+    ++m_count;
+}
+
+double RollingTimer::MeanMs() const
+{
+    if( m_samples.empty() )
+        return 0.0;
+    double total = 0.0;
+    for( double sample : m_samples )
+        total += sample;
+    return total / double( m_samples.size() );
+}
+
+double RollingTimer::MinMs() const
+{
+    return m_samples.empty() ? 0.0 : *std::min_element( m_samples.begin(), m_samples.end() );
+}
+
+double RollingTimer::MaxMs() const
+{
+    return m_samples.empty() ? 0.0 : *std::max_element( m_samples.begin(), m_samples.end() );
+}
+
+//--------------------------------------------------------------------------------------
+GpuProfiler::GpuProfiler( ITimestampBackend& backend, size_t slotCount, size_t maxScopes, uint32_t latencyFrames, size_t window ) :
+    m_backend( backend ),
+    m_maxScopes( maxScopes ),
+    m_latency( latencyFrames ),
+    m_window( window )
+{
+    for( size_t slot = slotCount; slot > 0; --slot )
+        m_free.push_back( slot - 1 );
+    Scope( "frame" );
+}
+
+size_t GpuProfiler::Scope( const std::string& name )
+{
+    for( size_t i = 0; i < m_scopes.size(); ++i )
+    {
+        if( m_scopes[i].name == name )
+            return i;
+    }
+    m_scopes.push_back( ScopeInfo{ name, RollingTimer( m_window ) } );
+    return m_scopes.size() - 1;
+}
+
+bool GpuProfiler::BeginFrame( uint64_t frameId )
+{
+    ++m_stats.framesBegun;
+    if( m_recording )
+        EndFrame();
+    if( m_free.empty() )
+    {
+        ++m_stats.droppedNoSlot;
+        return false;
+    }
+
+    m_current.slot = m_free.back();
+    m_free.pop_back();
+    m_current.frameId = frameId;
+    m_current.intervals.clear();
+    m_nextQuery = 0;
+    m_openScopes = 0;
+    m_recording = true;
+
+    m_backend.BeginDisjoint( m_current.slot );
+    BeginScope( kFrameScope );
+    return true;
+}
+
+void GpuProfiler::EndFrame()
+{
+    if( !m_recording )
+        return;
+
+    EndScope( kFrameScope );
+    m_backend.EndDisjoint( m_current.slot );
+    m_recording = false;
+    m_inFlight.push_back( std::move( m_current ) );
+    m_current = Pending();
+}
+
+void GpuProfiler::BeginScope( size_t scope )
+{
+    if( !m_recording || scope >= m_scopes.size() )
+        return;
+
+    //? Room for this pair and the end of every scope still open, the frame's included
+    if( m_nextQuery + 2 + m_openScopes > 2 * ( m_maxScopes + 1 ) )
+    {
+        ++m_stats.scopesOverflowed;
+        return;
+    }
+
+    m_backend.WriteTimestamp( m_current.slot, m_nextQuery );
+    m_current.intervals.push_back( Interval{ scope, m_nextQuery, SIZE_MAX } );
+    ++m_nextQuery;
+    ++m_openScopes;
+}
+
+void GpuProfiler::EndScope( size_t scope )
+{
+    if( !m_recording )
+        return;
+
+    //? Innermost open interval of this scope; none if BeginScope overflowed
+    for( size_t i = m_current.intervals.size(); i > 0; --i )
+    {
+        Interval& interval = m_current.intervals[i - 1];
+        if( interval.scope == scope && interval.end == SIZE_MAX )
+        {
+            m_backend.WriteTimestamp( m_current.slot, m_nextQuery );
+            interval.end = m_nextQuery;
+            ++m_nextQuery;
+            --m_openScopes;
+            return;
+        }
+    }
+}
+
+size_t GpuProfiler::Resolve( uint64_t currentFrameId )
+{
+    size_t resolved = 0;
+    while( !m_inFlight.empty() && m_inFlight.front().frameId + m_latency <= currentFrameId )
+    {
+        Pending& pending = m_inFlight.front();
+
+        uint64_t frequency = 0;
+        bool disjoint = false;
+        ITimestampBackend::QueryResult result = m_backend.GetDisjoint( pending.slot, &frequency, &disjoint );
+        if( result == ITimestampBackend::QUERY_BUSY )
+        {
+            ++m_stats.queryBusy;
+            break;
+        }
+
+        //? Every timestamp was written before the disjoint query ended, so a busy one here
+        //? is rare; try again next frame rather than wait
+        m_frameTotals.assign( m_scopes.size(), -1.0 );
+        for( size_t i = 0; i < pending.intervals.size() && result == ITimestampBackend::QUERY_OK && !disjoint && frequency; ++i )
+        {
+            const Interval& interval = pending.intervals[i];
+            if( interval.end == SIZE_MAX )
+                continue;
+
+            uint64_t begin = 0, end = 0;
+            result = m_backend.GetTimestamp( pending.slot, interval.begin, &begin );
+            if( result == ITimestampBackend::QUERY_OK )
+                result = m_backend.GetTimestamp( pending.slot, interval.end, &end );
+            if( result == ITimestampBackend::QUERY_OK )
+            {
+                const double ms = end > begin ? double( end - begin ) * 1000.0 / double( frequency ) : 0.0;
+                double& total = m_frameTotals[interval.scope];
+                total = total < 0.0 ? ms : total + ms;
+            }
+        }
+        if( result == ITimestampBackend::QUERY_BUSY )
+        {
+            ++m_stats.queryBusy;
+            break;
+        }
+
+        if( result == ITimestampBackend::QUERY_OK && disjoint )
+        {
+            ++m_stats.droppedDisjoint;
+        }
+        else if( result == ITimestampBackend::QUERY_FAILED || !frequency )
+        {
+            ++m_stats.droppedFailed;
+        }
+        else
+        {
+            for( size_t scope = 0; scope < m_frameTotals.size(); ++scope )
+            {
+                if( m_frameTotals[scope] >= 0.0 )
+                    m_scopes[scope].timer.Add( m_frameTotals[scope] );
+            }
+            ++m_stats.framesResolved;
+            ++resolved;
+        }
+
+        m_free.push_back( pending.slot );
+        m_inFlight.pop_front();
+    }
+    return resolved;
+}
+
+std::string GpuProfiler::Format() const
+{
+    char line[160];
+    snprintf( line, sizeof( line ), "GPU time: %llu frames resolved, %llu disjoint, %llu without a slot\n",
+              static_cast<unsigned long long>( m_stats.framesResolved ), static_cast<unsigned long long>( m_stats.droppedDisjoint ),
+              static_cast<unsigned long long>( m_stats.droppedNoSlot ) );
+    std::string out = line;
+
+    for( const ScopeInfo& scope : m_scopes )
+    {
+        if( !scope.timer.Count() )
+            continue;
+        snprintf( line, sizeof( line ), "  %-16s %8.3f ms mean %8.3f min %8.3f max %8.3f last\n", scope.name.c_str(),
+                  scope.timer.MeanMs(), scope.timer.MinMs(), scope.timer.MaxMs(), scope.timer.LastMs() );
+        out += line;
+    }
+    return out;
+}
@@ -0,0 +1,168 @@
+//--------------------------------------------------------------------------------------
+// File: GpuProfiler.h
+//
+// GPU time per named scope. Each profiled frame gets a disjoint query and a block of
+// timestamp queries: one pair for the whole frame and one pair per scope opened in it.
+// Frames go around a ring of such blocks; results are read back latency frames later
+// without waiting, oldest first, and frames the driver marks disjoint are thrown away.
+// Every scope keeps rolling statistics over its last samples.
+//
+// The profiler only talks to an ITimestampBackend, so the ring and the statistics work
+// the same for D3D11 queries and for synthetic timestamps.
+//--------------------------------------------------------------------------------------
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <vector>
+
+
+class ITimestampBackend
+{
+public:
+    enum QueryResult
+    {
+        QUERY_OK,
+        QUERY_BUSY,     // the GPU has not got this far yet
+        QUERY_FAILED,
+    };
+
+    virtual ~ITimestampBackend() = default;
+
+    // Queries are addressed by ring slot and, for timestamps, by index within the slot
+    virtual void BeginDisjoint( size_t slot ) = 0;
+    virtual void EndDisjoint( size_t slot ) = 0;
+    virtual void WriteTimestamp( size_t slot, size_t query ) = 0;
+
+    // Never block
+    virtual QueryResult GetDisjoint( size_t slot, uint64_t* frequency, bool* disjoint ) = 0;
+    virtual QueryResult GetTimestamp( size_t slot, size_t query, uint64_t* ticks ) = 0;
+};
+
+//? Statistics over the last 'window' samples
+class RollingTimer
+{
+public:
+    explicit RollingTimer( size_t window = 120 ) : m_window( window ? window : 1 ) {}
+
+    void Add( double ms );
+
+    uint64_t Count() const noexcept { return m_count; }     // every sample ever added
+    double LastMs() const noexcept { return m_lastMs; }
+    double MeanMs() const;
+    double MinMs() const;
+    double MaxMs() const;
+
+private:
+    const size_t            m_window;
+    std::vector<double>     m_samples;
+    size_t                  m_next = 0;
+    uint64_t                m_count = 0;
+    double                  m_lastMs = 0.0;
+};
+
+class GpuProfiler
+{
+public:
+    static const size_t kFrameScope = 0;    // the whole frame, always scope 0
+
+    struct Stats
+    {
+        uint64_t    framesBegun = 0;
+        uint64_t    framesResolved = 0;
+        uint64_t    droppedNoSlot = 0;      // BeginFrame() found every slot in flight
+        uint64_t    droppedDisjoint = 0;    // the clock was unreliable in that frame
+        uint64_t    droppedFailed = 0;
+        uint64_t    scopesOverflowed = 0;   // more scopes in a frame than maxScopes
+        uint64_t    queryBusy = 0;          // Resolve() polls that found results pending
+    };
+
+    // latencyFrames is k: frame N is first read back in frame N + k. slotCount should be
+    // at least k + 1 to profile every frame; every slot holds 2 * ( maxScopes + 1 )
+    // timestamps.
+    GpuProfiler( ITimestampBackend& backend, size_t slotCount, size_t maxScopes, uint32_t latencyFrames, size_t window = 120 );
+
+    // Names are registered once; a name registered twice returns the first id
+    size_t Scope( const std::string& name );
+    size_t ScopeCount() const noexcept { return m_scopes.size(); }
+    const std::string& ScopeName( size_t scope ) const { return m_scopes[scope].name; }
+    const RollingTimer& ScopeTimer( size_t scope ) const { return m_scopes[scope].timer; }
+
+    // Returns false if the frame is not profiled (no free slot); scopes then do nothing
+    bool BeginFrame( uint64_t frameId );
+    void EndFrame();
+
+    // Scopes may nest, and a scope may be opened more than once per frame; its times add up
+    void BeginScope( size_t scope );
+    void EndScope( size_t scope );
+
+    // Reads back every finished frame at least k frames old. Returns the frames resolved.
+    size_t Resolve( uint64_t currentFrameId );
+
+    size_t InFlight() const noexcept { return m_inFlight.size(); }
+    const Stats& GetStats() const noexcept { return m_stats; }
+
+    // One line per scope with samples: mean, min, max and last in milliseconds
+    std::string Format() const;
+
+private:
+    struct ScopeInfo
+    {
+        std::string     name;
+        RollingTimer    timer;
+    };
+
+    struct Interval
+    {
+        size_t      scope;
+        size_t      begin;      // timestamp index within the slot
+        size_t      end;        // SIZE_MAX until the scope is closed
+    };
+
+    struct Pending
+    {
+        size_t                  slot;
+        uint64_t                frameId;
+        std::vector<Interval>   intervals;
+    };
+
+    ITimestampBackend&          m_backend;
+    const size_t                m_maxScopes;
+    const uint32_t              m_latency;
+    const size_t                m_window;
+    std::vector<ScopeInfo>      m_scopes;
+    std::vector<size_t>         m_free;
+    std::deque<Pending>         m_inFlight;
+    bool                        m_recording = false;
+    Pending                     m_current;
+    size_t                      m_nextQuery = 0;
+    size_t                      m_openScopes = 0;
+    std::vector<double>         m_frameTotals;      // per scope, while resolving a frame
+    Stats                       m_stats;
+};
+
+//? Brackets a scope for the lifetime of the object; does nothing without a profiler
+class GpuProfileScope
+{
+public:
+    GpuProfileScope( GpuProfiler* profiler, size_t scope ) : m_profiler( profiler ), m_scope( scope )
+    {
+        if( m_profiler )
+            m_profiler->BeginScope( m_scope );
+    }
+    ~GpuProfileScope()
+    {
+        if( m_profiler )
+            m_profiler->EndScope( m_scope );
+    }
+
+    GpuProfileScope( const GpuProfileScope& ) = delete;
+    GpuProfileScope& operator=( const GpuProfileScope& ) = delete;
+
+private:
+    GpuProfiler*    m_profiler;
+    size_t          m_scope;
+};
@@ -0,0 +1,334 @@
+//--------------------------------------------------------------------------------------
+// File: HeadlessDriver.cpp
+//
+// Options and backend-neutral runs of the headless modes
+//--------------------------------------------------------------------------------------
+
+#include "HeadlessDriver.h"
+#include "FrameLoop.h"
+#include "GoldenImage.h"
+#include "RenderDeviceSoftware.h"
+#include "RenderThreads.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+
+namespace
+{
+    const float kClearColorA[4] = { 0.098039225f, 0.098039225f, 0.439215720f, 1.0f };   // Colors::MidnightBlue
+    const float kClearColorB[4] = { 0.372549027f, 0.619607866f, 0.627451003f, 1.0f };   // Colors::CadetBlue
+    const float kMeshColor[4] = { 1.0f, 1.0f, 1.0f, 1.0f };
+
+    const uint32_t kGoldenWidth = 320;
+    const uint32_t kGoldenHeight = 240;
+
+    //? The text right after 'name', or nullptr if the command line does not have it
+    const char* FindOption( const char* commandLine, const char* name )
+    {
+        const char* found = strstr( commandLine, name );
+        return found ? found + strlen( name ) : nullptr;
+    }
+
+    RenderWindowDesc HeadlessWindowDesc( size_t program, const HeadlessOptions& options )
+    {
+        RenderWindowDesc desc;
+        desc.name = "A";
+        desc.program = program;
+        desc.textureFile = L"test.dds";
+        memcpy( desc.clearColor, kClearColorA, sizeof( desc.clearColor ) );
+        desc.width = options.width;
+        desc.height = options.height;
+        desc.offscreen = true;
+        return desc;
+    }
+
+    ReadbackFrame SoftwareFrame( const SoftwareRenderWindow& window, const uint32_t* pixels, uint64_t index )
+    {
+        ReadbackFrame frame;
+        frame.frameId = index + 1;
+        frame.width = window.Width();
+        frame.height = window.Height();
+        frame.bytesPerPixel = 4;
+        frame.data = reinterpret_cast<const uint8_t*>( pixels );
+        frame.size = size_t( frame.width ) * frame.height * 4;
+        return frame;
+    }
+
+    //? Window A, the copy of its frame that stands in for the shared surface, and window B
+    //? drawing that copy, checked every frame. The copy must match A exactly; A and B are
+    //? checked against their goldens.
+    bool RunGoldenSoftware( SoftwareRenderDevice& device, size_t programA, size_t programB, const HeadlessOptions& options,
+                            GoldenSuite& golden, HeadlessLogFn log )
+    {
+        RenderWindowDesc descA = HeadlessWindowDesc( programA, options );
+        RenderWindowDesc descB = descA;
+        descB.name = "B";
+        descB.program = programB;
+        descB.textureFile = nullptr;
+        memcpy( descB.clearColor, kClearColorB, sizeof( descB.clearColor ) );
+
+        SoftwareRenderWindow* windowA = device.CreateRenderWindow( descA );
+        SoftwareRenderWindow* windowB = device.CreateRenderWindow( descB );
+        if( !windowA || !windowB )
+        {
+            log( "Golden: the windows could not be created\n" );
+            return false;
+        }
+
+        const auto start = std::chrono::steady_clock::now();
+        for( uint64_t i = 0; i < options.frames; ++i )
+        {
+            const FrameConstants cb = SpinningQuadConstants( float( double( i ) * options.frameSeconds ), kMeshColor );
+            windowA->BeginFrame();
+            windowA->UpdateFrameConstants( cb );
+            windowA->DrawQuad();
+            windowA->Present();
+            const ReadbackFrame frameA = SoftwareFrame( *windowA, windowA->Raster().Color(), i );
+            golden.Check( "A", i, frameA );
+
+            std::shared_ptr<SoftwareTexture> shared = std::make_shared<SoftwareTexture>();
+            AppendTextureLevel( *shared, windowA->Width(), windowA->Height(), windowA->Raster().Color() );
+            golden.Compare( "shared", i, SoftwareFrame( *windowA, shared->texels.data(), i ), frameA );
+
+            windowB->SetTexture( shared );
+            windowB->BeginFrame();
+            windowB->UpdateFrameConstants( cb );
+            windowB->DrawQuad();
+            windowB->Present();
+            golden.Check( "B", i, SoftwareFrame( *windowB, windowB->Raster().Color(), i ) );
+        }
+
+        char msg[160];
+        snprintf( msg, sizeof( msg ), "Golden run %ux%u: %llu frames in %.1f ms\n", options.width, options.height,
+                  static_cast<unsigned long long>( options.frames ),
+                  std::chrono::duration<double, std::milli>( std::chrono::steady_clock::now() - start ).count() );
+        log( msg );
+        return true;
+    }
+}
+
+//--------------------------------------------------------------------------------------
+void ParseHeadlessOptions( const char* commandLine, HeadlessOptions& options )
+{
+    if( !commandLine )
+        return;
+
+    const char* size = FindOption( commandLine, "-headless=" );
+    if( size )
+    {
+        const char* x = strchr( size, 'x' );
+        if( atoi( size ) > 0 && x && atoi( x + 1 ) > 0 )
+        {
+            options.width = uint32_t( atoi( size ) );
+            options.height = uint32_t( atoi( x + 1 ) );
+        }
+    }
+
+    const char* golden = FindOption( commandLine, "-golden=" );
+    if( golden )
+    {
+        options.goldenDirectory.assign( golden, strcspn( golden, " \t" ) );
+        options.goldenUpdate = strstr( commandLine, "-goldenupdate" ) != nullptr;
+        if( !options.width )
+        {
+            options.width = kGoldenWidth;
+            options.height = kGoldenHeight;
+        }
+    }
+
+    options.software = strstr( commandLine, "-software" ) != nullptr;
+    if( options.software && !options.width )
+    {
+        options.width = 800;
+        options.height = 600;
+    }
+
+    const char* frames = FindOption( commandLine, "-frames=" );
+    const bool framesGiven = frames && atoi( frames ) > 0;
+    if( framesGiven )
+        options.frames = uint64_t( atoi( frames ) );
+
+    const char* benchmark = FindOption( commandLine, "-benchmark=" );
+    if( benchmark )
+    {
+        const BenchmarkConfig defaults;
+        options.benchmarkPath.assign( benchmark, strcspn( benchmark, " \t" ) );
+        if( !options.width )
+        {
+            options.width = defaults.width;
+            options.height = defaults.height;
+        }
+        if( !framesGiven )
+            options.frames = defaults.frames;
+    }
+
+    const char* quads = FindOption( commandLine, "-quads=" );
+    if( quads && atoi( quads ) > 0 )
+        options.quads = size_t( atoi( quads ) );
+    const char* textures = FindOption( commandLine, "-textures=" );
+    if( textures && atoi( textures ) > 1 )
+        options.textures = uint32_t( atoi( textures ) );
+    const char* windows = FindOption( commandLine, "-windows=" );
+    if( windows && atoi( windows ) > 1 )
+        options.windows = uint32_t( atoi( windows ) );
+}
+
+BenchmarkConfig HeadlessBenchmarkConfig( const HeadlessOptions& options )
+{
+    BenchmarkConfig config;
+    config.frames = options.frames;
+    config.frameSeconds = options.frameSeconds;
+    config.width = options.width;
+    config.height = options.height;
+    config.quads = options.quads ? options.quads : 1;
+    config.textures = options.textures;
+    config.windows = options.windows;
+    return config;
+}
+
+//--------------------------------------------------------------------------------------
+int RunHeadlessLoop( RenderDevice& device, size_t program, const HeadlessOptions& options, HeadlessLogFn log,
+                     GoldenSuite* golden )
+{
+    RenderWindow* window = device.CreateRenderWindow( HeadlessWindowDesc( program, options ) );
+    if( !window )
+    {
+        log( "Headless: window A could not be created\n" );
+        return 1;
+    }
+
+    FrameLoopDesc loopDesc;
+    loopDesc.frameCount = options.frames;
+    loopDesc.frameSeconds = options.frameSeconds;
+    loopDesc.readbackLatency = options.readbackLatency;
+    FrameLoop loop( *window, loopDesc );
+
+    std::vector<uint8_t> lastFrame;
+    uint64_t lastFrameId = 0;
+    loop.SetReadbackCallback( [&]( const ReadbackFrame& frame )
+    {
+        lastFrame.assign( frame.data, frame.data + frame.size );
+        lastFrameId = frame.frameId;
+        if( golden )
+            golden->Check( "A", frame.frameId - 1, frame );
+    } );
+    bool ok = loop.Run();
+
+    const FrameLoopStats& stats = loop.Stats();
+    char msg[200];
+    snprintf( msg, sizeof( msg ), "Headless %ux%u on %s: %llu frames in %.1f ms, %llu read back, %llu dropped\n",
+              window->Width(), window->Height(), device.BackendName(), static_cast<unsigned long long>( stats.frames ),
+              stats.wallMs, static_cast<unsigned long long>( stats.delivered ), static_cast<unsigned long long>( stats.dropped ) );
+    log( msg );
+
+    if( ok && !lastFrame.empty() )
+    {
+        ReadbackFrame last;
+        last.frameId = lastFrameId;
+        last.width = window->Width();
+        last.height = window->Height();
+        last.bytesPerPixel = 4;
+        last.data = lastFrame.data();
+        last.size = lastFrame.size();
+        WriteFrameBitmap( options.imagePath, last );
+    }
+    if( ok && golden )
+        ok = stats.dropped == 0 && FinishGoldenSuite( *golden, log );
+    return ok ? 0 : 1;
+}
+
+int RunHeadlessBenchmark( RenderDevice& device, size_t program, const HeadlessOptions& options, HeadlessLogFn log )
+{
+    const BenchmarkConfig config = HeadlessBenchmarkConfig( options );
+    FrameBenchmark benchmark( config.warmupFrames );
+    if( !RunFrameBenchmark( device, program, config, benchmark ) )
+    {
+        log( "Benchmark: the windows could not be created\n" );
+        return 1;
+    }
+    if( !WriteBenchmarkReport( options.benchmarkPath, benchmark, config, device.BackendName(), log ) )
+        return 1;
+
+    const TimingSummary frames = benchmark.FrameSummary();
+    char msg[200];
+    snprintf( msg, sizeof( msg ), "%s %ux%u: %.1f frames per second, %zu quads in %u windows\n", device.BackendName(),
+              config.width, config.height, frames.meanMs > 0.0 ? 1000.0 / frames.meanMs : 0.0, config.quads, config.windows );
+    log( msg );
+    return 0;
+}
+
+bool WriteBenchmarkReport( const std::string& path, const FrameBenchmark& benchmark, const BenchmarkConfig& config,
+                           const char* backend, HeadlessLogFn log )
+{
+    const bool csv = path.size() >= 4 && ( path.compare( path.size() - 4, 4, ".csv" ) == 0 || path.compare( path.size() - 4, 4, ".CSV" ) == 0 );
+    const std::string report = csv ? benchmark.FormatCSV() : benchmark.FormatJSON( config, backend );
+    log( report.c_str() );
+
+    FILE* file = fopen( path.c_str(), "wb" );
+    if( !file )
+    {
+        log( ( "Benchmark: could not write " + path + "\n" ).c_str() );
+        return false;
+    }
+    const bool written = fwrite( report.data(), 1, report.size(), file ) == report.size();
+    return fclose( file ) == 0 && written;
+}
+
+bool FinishGoldenSuite( GoldenSuite& golden, HeadlessLogFn log )
+{
+    const bool ok = golden.Finish();
+    log( golden.FormatReport().c_str() );
+    return ok;
+}
+
+int RunPortableHeadless( const HeadlessOptions& options, HeadlessLogFn log )
+{
+    //? Neither backend compiles HLSL, so the programs need no source
+    SharedRenderAssets assets;
+    const size_t programA = assets.AddProgram( "A", "" );
+    const size_t programB = assets.AddProgram( "B", "" );
+
+    std::unique_ptr<RenderDevice> device;
+    if( options.software )
+    {
+        //? The software shaders doing what m_shader and m_shaderB do
+        std::unique_ptr<SoftwareRenderDevice> software( new SoftwareRenderDevice( assets ) );
+        SoftwareProgram program;
+        program.vertexShader = SOFTWARE_VS_WORLD;
+        program.pixelShader = RASTER_PS_TEXTURE;
+        software->SetProgram( programA, program );
+        program.vertexShader = SOFTWARE_VS_VIEW_WORLD_PROJECTION;
+        program.pixelShader = RASTER_PS_MESH_COLOR_MINUS_TEXTURE;
+        software->SetProgram( programB, program );
+        device = std::move( software );
+    }
+    else
+    {
+        device = CreateNullRenderDevice( assets );
+    }
+    if( !device->Create() )
+        return 1;
+
+    if( options.software )
+    {
+        const WorkerPool* pool = static_cast<SoftwareRenderDevice&>( *device ).Pool();
+        char msg[96];
+        snprintf( msg, sizeof( msg ), "Software rasterizer on %zu threads\n", pool ? pool->ThreadCount() + 1 : size_t( 1 ) );
+        log( msg );
+    }
+    if( !options.benchmarkPath.empty() )
+        return RunHeadlessBenchmark( *device, programA, options, log );
+    if( options.goldenDirectory.empty() )
+        return RunHeadlessLoop( *device, programA, options, log );
+
+    GoldenSuite golden( options.goldenDirectory, options.goldenUpdate );
+    if( !options.software )
+        return RunHeadlessLoop( *device, programA, options, log, &golden );
+    const bool ok = RunGoldenSoftware( static_cast<SoftwareRenderDevice&>( *device ), programA, programB, options, golden, log );
+    return ok && FinishGoldenSuite( golden, log ) ? 0 : 1;
+}
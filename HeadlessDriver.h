@@ -0,0 +1,89 @@
+//--------------------------------------------------------------------------------------
+// File: HeadlessDriver.h
+//
+// The headless modes without D3D: their command-line options and the runs that only
+// need a RenderDevice. wWinMain hands its command line to ParseHeadlessOptions() and
+// runs the D3D11 version of a headless run itself; HeadlessMain.cpp is a portable
+// main() that runs the rest, so they build and run on any platform (CMakeLists.txt).
+//
+// Only the standard library and the backend-neutral modules are used.
+//--------------------------------------------------------------------------------------
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include "FrameBenchmark.h"
+#include "RenderDevice.h"
+
+class GoldenSuite;
+
+struct HeadlessOptions
+{
+    uint32_t    width = 0;                  // 0: not headless, show the windows
+    uint32_t    height = 0;
+    uint64_t    frames = 60;
+    double      frameSeconds = 1.0 / 60.0;  // animation time per frame
+    uint32_t    readbackLatency = 2;        // frames between a capture and its map
+    const char* imagePath = "rendertex_headless.bmp";   // the last frame read back
+    bool        software = false;           // the CPU rasterizer instead of D3D11
+    std::string benchmarkPath;              // empty: no benchmark
+    std::string goldenDirectory;            // empty: no golden checks
+    bool        goldenUpdate = false;       // record the goldens instead of checking them
+
+    // Scene size. The windowed modes use them as well: windows is then the number of
+    // windows on device B.
+    size_t      quads = 0;                  // 0: the single quad
+    uint32_t    textures = 1;
+    uint32_t    windows = 1;
+};
+
+// Reads the headless options from a command line, the way wWinMain reads the others:
+//
+//  -headless=WxH       render window A offscreen at WxH without any windows
+//  -software           run headless on the CPU rasterizer (800x600 unless given otherwise)
+//  -frames=N           for N frames, then write the last one to imagePath
+//  -benchmark=<file>   run headless (1280x720 and 300 frames unless given) and write frame
+//                      and phase timings to <file>, as CSV if it ends in .csv and JSON
+//                      otherwise
+//  -quads=N            draw a grid of N quads on window A
+//  -textures=N         spread N textures over the grid
+//  -windows=N          N windows on device B; a benchmark renders N offscreen windows
+//  -golden=<dir>       run headless (320x240 unless given) and check every frame against
+//                      the goldens in <dir>
+//  -goldenupdate       with -golden=<dir>, record the goldens there instead
+void ParseHeadlessOptions( const char* commandLine, HeadlessOptions& options );
+
+// The benchmark configuration of a headless run
+BenchmarkConfig HeadlessBenchmarkConfig( const HeadlessOptions& options );
+
+// Receives the report lines of a run
+using HeadlessLogFn = void (*)( const char* text );
+
+// Window A, the textured quad of 'program', offscreen on 'device' for options.frames
+// frames through FrameLoop. The last frame read back is written to options.imagePath.
+// With 'golden' every frame read back is checked as its case A, and the run fails if a
+// frame was dropped or a check failed. Returns the process exit code: 0 on success.
+int RunHeadlessLoop( RenderDevice& device, size_t program, const HeadlessOptions& options, HeadlessLogFn log,
+                     GoldenSuite* golden = nullptr );
+
+// RunFrameBenchmark() of 'program' on 'device', reported to options.benchmarkPath.
+// Returns the process exit code.
+int RunHeadlessBenchmark( RenderDevice& device, size_t program, const HeadlessOptions& options, HeadlessLogFn log );
+
+// Writes a benchmark's summary to 'path', CSV if it ends in .csv and JSON otherwise, and
+// logs it. False if the file could not be written.
+bool WriteBenchmarkReport( const std::string& path, const FrameBenchmark& benchmark, const BenchmarkConfig& config,
+                           const char* backend, HeadlessLogFn log );
+
+// Writes the goldens 'golden' recorded and logs every case; false if any check failed
+bool FinishGoldenSuite( GoldenSuite& golden, HeadlessLogFn log );
+
+// A headless run on a portable backend: with options.software the CPU rasterizer, which
+// runs programs A and B as software shaders, and otherwise the null backend, which draws
+// nothing, so only the frame loop, readback and benchmark harness are exercised. A golden
+// run on the CPU rasterizer checks window A, the copy of its frame that stands in for the
+// shared surface, and window B drawing that copy. Returns the process exit code.
+int RunPortableHeadless( const HeadlessOptions& options, HeadlessLogFn log );
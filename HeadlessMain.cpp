@@ -0,0 +1,34 @@
+//--------------------------------------------------------------------------------------
+// File: HeadlessMain.cpp
+//
+// Portable entry point of the headless modes, built by CMakeLists.txt. Takes the same
+// options as the application (see HeadlessDriver.h) and is always headless: without
+// -headless=WxH it renders at 800x600.
+//--------------------------------------------------------------------------------------
+
+#include "HeadlessDriver.h"
+
+#include <cstdio>
+#include <string>
+
+
+int main( int argc, char** argv )
+{
+    //? The options are looked up in one command line, as wWinMain gets it
+    std::string commandLine;
+    for( int i = 1; i < argc; ++i )
+    {
+        commandLine += argv[i];
+        commandLine += ' ';
+    }
+
+    HeadlessOptions options;
+    ParseHeadlessOptions( commandLine.c_str(), options );
+    if( !options.width )
+    {
+        options.width = 800;
+        options.height = 600;
+    }
+
+    return RunPortableHeadless( options, []( const char* text ) { fputs( text, stdout ); } );
+}
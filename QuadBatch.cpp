@@ -0,0 +1,127 @@
+//--------------------------------------------------------------------------------------
+// File: QuadBatch.cpp
+//
+// Batching for scenes of many textured quads
+//--------------------------------------------------------------------------------------
+
+#include "QuadBatch.h"
+
+#include <cmath>
+
+
+namespace
+{
+    //? No aliasing between the arrays, so the loop vectorizes without runtime checks
+    void ScaleRotate( const float* __restrict scaleX, const float* __restrict scaleY,
+                      const float* __restrict cosAngle, const float* __restrict sinAngle,
+                      float* __restrict a, float* __restrict b, float* __restrict c, float* __restrict d, size_t count )
+    {
+        for( size_t i = 0; i < count; ++i )
+        {
+            a[i] = scaleX[i] * cosAngle[i];
+            b[i] = -scaleY[i] * sinAngle[i];
+            c[i] = scaleX[i] * sinAngle[i];
+            d[i] = scaleY[i] * cosAngle[i];
+        }
+    }
+}
+
+//--------------------------------------------------------------------------------------
+void QuadList::Reserve( size_t count )
+{
+    x.reserve( count );
+    y.reserve( count );
+    scaleX.reserve( count );
+    scaleY.reserve( count );
+    cosAngle.reserve( count );
+    sinAngle.reserve( count );
+    material.reserve( count );
+    slice.reserve( count );
+}
+
+void QuadList::Clear()
+{
+    x.clear();
+    y.clear();
+    scaleX.clear();
+    scaleY.clear();
+    cosAngle.clear();
+    sinAngle.clear();
+    material.clear();
+    slice.clear();
+}
+
+size_t QuadList::Add( float centerX, float centerY, float halfWidth, float halfHeight, float angle, uint32_t materialIndex, uint32_t sliceIndex )
+{
+    x.push_back( centerX );
+    y.push_back( centerY );
+    scaleX.push_back( halfWidth );
+    scaleY.push_back( halfHeight );
+    cosAngle.push_back( cosf( angle ) );
+    sinAngle.push_back( sinf( angle ) );
+    material.push_back( materialIndex );
+    slice.push_back( sliceIndex );
+    return x.size() - 1;
+}
+
+//--------------------------------------------------------------------------------------
+size_t QuadBatcher::Build( const QuadList& quads, uint32_t materialCount )
+{
+    const size_t count = quads.Size();
+    m_batches.clear();
+
+    //? Counting sort by material: histogram, prefix sum, then each quad's slot
+    m_counts.assign( size_t( materialCount ) + 1, 0 );
+    const uint32_t* material = quads.material.data();
+    for( size_t i = 0; i < count; ++i )
+        ++m_counts[material[i] < materialCount ? material[i] : materialCount];
+
+    uint32_t packed = 0;
+    for( uint32_t m = 0; m < materialCount; ++m )
+    {
+        const uint32_t used = m_counts[m];
+        if( used )
+        {
+            QuadBatch batch;
+            batch.material = m;
+            batch.firstInstance = packed;
+            batch.instanceCount = used;
+            m_batches.push_back( batch );
+        }
+        m_counts[m] = packed;
+        packed += used;
+    }
+
+    m_destination.resize( count );
+    for( size_t i = 0; i < count; ++i )
+        m_destination[i] = material[i] < materialCount ? m_counts[material[i]]++ : UINT32_MAX;
+
+    //? Rotation and scale for all quads, array at a time
+    m_a.resize( count );
+    m_b.resize( count );
+    m_c.resize( count );
+    m_d.resize( count );
+    ScaleRotate( quads.scaleX.data(), quads.scaleY.data(), quads.cosAngle.data(), quads.sinAngle.data(),
+                 m_a.data(), m_b.data(), m_c.data(), m_d.data(), count );
+
+    //? Scatter into material order
+    m_instances.resize( packed );
+    QuadInstance* instances = m_instances.data();
+    for( size_t i = 0; i < count; ++i )
+    {
+        const uint32_t to = m_destination[i];
+        if( to == UINT32_MAX )
+            continue;
+
+        QuadInstance& instance = instances[to];
+        instance.row0[0] = m_a[i];
+        instance.row0[1] = m_b[i];
+        instance.row0[2] = quads.x[i];
+        instance.row1[0] = m_c[i];
+        instance.row1[1] = m_d[i];
+        instance.row1[2] = quads.y[i];
+        instance.slice = quads.slice[i];
+        instance.unused = 0;
+    }
+    return packed;
+}
@@ -0,0 +1,80 @@
+//--------------------------------------------------------------------------------------
+// File: QuadBatch.h
+//
+// Batching for scenes of many textured quads (thumbnails, video tiles). Quads are
+// described as structure-of-arrays; each has a 2D placement, a material (one texture
+// array) and a slice in that array. QuadBatcher sorts them by material with a counting
+// sort and packs one QuadInstance per quad, so a backend can draw each material with a
+// single instanced draw of the shared unit quad.
+//
+// The transform pass works on whole arrays with no branches or calls so the compiler
+// can vectorize it; only the final scatter into sorted order is per quad.
+//--------------------------------------------------------------------------------------
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+
+//? Per-instance vertex data, read as TEXCOORD1..3 by the batch vertex shader:
+//? clip.x = dot( row0, float3( pos.xy, 1 ) ), clip.y = dot( row1, float3( pos.xy, 1 ) )
+struct QuadInstance
+{
+    float       row0[3];
+    float       row1[3];
+    uint32_t    slice;
+    uint32_t    unused;
+};
+
+static_assert( sizeof( QuadInstance ) == 32, "QuadInstance must match the instanced input layout" );
+
+//? Structure-of-arrays quad list; every array has Size() entries
+class QuadList
+{
+public:
+    void Reserve( size_t count );
+    void Clear();
+    size_t Size() const noexcept { return x.size(); }
+
+    // Centre, half extents and rotation (radians) of the unit quad in clip space
+    size_t Add( float centerX, float centerY, float halfWidth, float halfHeight, float angle, uint32_t material, uint32_t slice );
+
+    std::vector<float>      x;
+    std::vector<float>      y;
+    std::vector<float>      scaleX;
+    std::vector<float>      scaleY;
+    std::vector<float>      cosAngle;       // rotation, kept as cos/sin so Build needs no trig
+    std::vector<float>      sinAngle;
+    std::vector<uint32_t>   material;
+    std::vector<uint32_t>   slice;
+};
+
+//? One instanced draw
+struct QuadBatch
+{
+    uint32_t    material = 0;
+    uint32_t    firstInstance = 0;
+    uint32_t    instanceCount = 0;
+};
+
+class QuadBatcher
+{
+public:
+    // Packs every quad whose material is below materialCount, grouped by material in
+    // ascending order and in list order within a material. Returns the quads packed.
+    size_t Build( const QuadList& quads, uint32_t materialCount );
+
+    const std::vector<QuadInstance>& Instances() const noexcept { return m_instances; }
+    const std::vector<QuadBatch>& Batches() const noexcept { return m_batches; }
+
+private:
+    std::vector<QuadInstance>   m_instances;
+    std::vector<QuadBatch>      m_batches;
+
+    //? Scratch, kept between builds
+    std::vector<float>          m_a, m_b, m_c, m_d;
+    std::vector<uint32_t>       m_counts;
+    std::vector<uint32_t>       m_destination;
+};
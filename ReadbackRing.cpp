@@ -0,0 +1,123 @@
+//--------------------------------------------------------------------------------------
+// File: ReadbackRing.cpp
+//
+// Asynchronous GPU->CPU frame readback
+//--------------------------------------------------------------------------------------
+
+#include "ReadbackRing.h"
+
+#include <cstring>
+
+
+//--------------------------------------------------------------------------------------
+void RepackRows( uint8_t* dst, const uint8_t* src, size_t srcPitch, size_t rowBytes, uint32_t rows ) noexcept
+{
+    if( srcPitch == rowBytes )
+    {
+        memcpy( dst, src, rowBytes * rows );
+        return;
+    }
+
+    for( uint32_t y = 0; y < rows; ++y )
+    {
+        memcpy( dst, src, rowBytes );
+        dst += rowBytes;
+        src += srcPitch;
+    }
+}
+
+//--------------------------------------------------------------------------------------
+ReadbackRing::ReadbackRing( IStagingBackend& backend, size_t slotCount, uint32_t latencyFrames,
+                            uint32_t width, uint32_t height, uint32_t bytesPerPixel ) :
+    m_backend( backend ),
+    m_latency( latencyFrames ),
+    m_width( width ),
+    m_height( height ),
+    m_bytesPerPixel( bytesPerPixel ),
+    m_packed( size_t( width ) * height * bytesPerPixel )
+{
+    // Hand out low slots first
+    for( size_t i = slotCount; i-- > 0; )
+        m_free.push_back( i );
+}
+
+bool ReadbackRing::Capture( uint64_t frameId )
+{
+    if( m_free.empty() )
+    {
+        ++m_stats.droppedNoSlot;
+        return false;
+    }
+
+    const size_t slot = m_free.back();
+    if( !m_backend.IssueCopy( slot ) )
+        return false;
+
+    m_free.pop_back();
+    m_inFlight.push_back( Pending{ slot, frameId } );
+    ++m_stats.captured;
+    return true;
+}
+
+size_t ReadbackRing::Poll( uint64_t currentFrameId )
+{
+    return Deliver( m_latency, currentFrameId );
+}
+
+size_t ReadbackRing::Drain()
+{
+    return Deliver( 0, UINT64_MAX );
+}
+
+size_t ReadbackRing::Deliver( uint64_t minFrameAge, uint64_t currentFrameId )
+{
+    size_t delivered = 0;
+    const size_t rowBytes = size_t( m_width ) * m_bytesPerPixel;
+
+    // Copies complete in submission order, so stop at the first one that is not ready
+    while( !m_inFlight.empty() )
+    {
+        const Pending pending = m_inFlight.front();
+        if( currentFrameId < pending.frameId + minFrameAge )
+            break;
+
+        const uint8_t* data = nullptr;
+        size_t rowPitch = 0;
+        const IStagingBackend::MapResult result = m_backend.TryMap( pending.slot, &data, &rowPitch );
+        if( result == IStagingBackend::MAP_BUSY )
+        {
+            ++m_stats.mapBusy;
+            break;
+        }
+
+        m_inFlight.pop_front();
+        m_free.push_back( pending.slot );
+
+        if( result == IStagingBackend::MAP_FAILED )
+        {
+            ++m_stats.mapFailed;
+            continue;
+        }
+
+        RepackRows( m_packed.data(), data, rowPitch, rowBytes, m_height );
+        m_backend.Unmap( pending.slot );
+        m_stats.bytesRepacked += m_packed.size();
+
+        if( m_callback )
+        {
+            ReadbackFrame frame;
+            frame.frameId = pending.frameId;
+            frame.width = m_width;
+            frame.height = m_height;
+            frame.bytesPerPixel = m_bytesPerPixel;
+            frame.data = m_packed.data();
+            frame.size = m_packed.size();
+            m_callback( frame );
+        }
+
+        ++m_stats.delivered;
+        ++delivered;
+    }
+
+    return delivered;
+}
@@ -0,0 +1,110 @@
+//--------------------------------------------------------------------------------------
+// File: ReadbackRing.h
+//
+// Asynchronous GPU->CPU frame readback. A ring of staging surfaces is filled by copies
+// issued in frame N; frame N+k tries to map them without waiting, repacks the pitched
+// rows into a tightly packed buffer and hands the image to a callback.
+//
+// The ring only talks to an IStagingBackend, so the scheduling and repacking work the
+// same for D3D11 staging textures and for any CPU-side stand-in.
+//--------------------------------------------------------------------------------------
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <utility>
+#include <vector>
+
+
+class IStagingBackend
+{
+public:
+    enum MapResult
+    {
+        MAP_OK,
+        MAP_BUSY,       // the copy has not finished on the GPU yet
+        MAP_FAILED,
+    };
+
+    virtual ~IStagingBackend() = default;
+
+    // Issues the copy of the current source image into staging slot 'slot'
+    virtual bool IssueCopy( size_t slot ) = 0;
+
+    // Maps slot 'slot' without blocking
+    virtual MapResult TryMap( size_t slot, const uint8_t** data, size_t* rowPitch ) = 0;
+
+    virtual void Unmap( size_t slot ) = 0;
+};
+
+struct ReadbackFrame
+{
+    uint64_t        frameId = 0;
+    uint32_t        width = 0;
+    uint32_t        height = 0;
+    uint32_t        bytesPerPixel = 0;
+    const uint8_t*  data = nullptr;     // tightly packed, width * bytesPerPixel per row
+    size_t          size = 0;
+};
+
+using ReadbackCallback = std::function<void( const ReadbackFrame& )>;
+
+// Copies 'rows' rows of 'rowBytes' each from a pitched source into a tightly packed buffer
+void RepackRows( uint8_t* dst, const uint8_t* src, size_t srcPitch, size_t rowBytes, uint32_t rows ) noexcept;
+
+class ReadbackRing
+{
+public:
+    struct Stats
+    {
+        uint64_t    captured = 0;       // copies issued
+        uint64_t    delivered = 0;      // frames handed to the callback
+        uint64_t    droppedNoSlot = 0;  // Capture() found every slot in flight
+        uint64_t    mapBusy = 0;        // TryMap() polls that found the copy unfinished
+        uint64_t    mapFailed = 0;
+        uint64_t    bytesRepacked = 0;
+    };
+
+    // latencyFrames is k: a copy issued in frame N is first mapped in frame N + k.
+    // slotCount should be at least k + 1 to capture every frame.
+    ReadbackRing( IStagingBackend& backend, size_t slotCount, uint32_t latencyFrames,
+                  uint32_t width, uint32_t height, uint32_t bytesPerPixel );
+
+    void SetCallback( ReadbackCallback callback ) { m_callback = std::move( callback ); }
+
+    // Frame N: copies the current image into a free slot. Returns false when none is free.
+    bool Capture( uint64_t frameId );
+
+    // Every frame: delivers finished copies that are at least k frames old, oldest first.
+    // Returns the number of frames delivered.
+    size_t Poll( uint64_t currentFrameId );
+
+    // Delivers whatever can be mapped right now, regardless of age; used at shutdown.
+    size_t Drain();
+
+    size_t InFlight() const noexcept { return m_inFlight.size(); }
+    const Stats& GetStats() const noexcept { return m_stats; }
+
+private:
+    struct Pending
+    {
+        size_t      slot;
+        uint64_t    frameId;
+    };
+
+    size_t Deliver( uint64_t minFrameAge, uint64_t currentFrameId );
+
+    IStagingBackend&        m_backend;
+    const uint32_t          m_latency;
+    const uint32_t          m_width;
+    const uint32_t          m_height;
+    const uint32_t          m_bytesPerPixel;
+    std::vector<size_t>     m_free;
+    std::deque<Pending>     m_inFlight;
+    std::vector<uint8_t>    m_packed;
+    ReadbackCallback        m_callback;
+    Stats                   m_stats;
+};
@@ -0,0 +1,291 @@
+//--------------------------------------------------------------------------------------
+// File: RenderDevice.cpp
+//
+// Shared assets, device/window lifecycle and the null backend
+//--------------------------------------------------------------------------------------
+
+#include "RenderDevice.h"
+#include "RenderThreads.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+
+
+//--------------------------------------------------------------------------------------
+SharedRenderAssets::SharedRenderAssets()
+{
+    // Vertex XYZ and texture map reference
+    m_vertices =
+    {
+        { { -1.0f, -1.0f, 0.0f }, { 1.0f, 1.0f } },
+        { {  1.0f, -1.0f, 0.0f }, { 0.0f, 1.0f } },
+        { {  1.0f,  1.0f, 0.0f }, { 0.0f, 0.0f } },
+        { { -1.0f,  1.0f, 0.0f }, { 1.0f, 0.0f } },
+    };
+
+    m_indices =
+    {
+        3, 1, 0,
+        2, 1, 3,
+    };
+}
+
+size_t SharedRenderAssets::AddProgram( const char* name, const char* source, VertexLayout layout )
+{
+    std::unique_ptr<Program> program( new Program );
+    program->name = name;
+    program->source = source;
+    program->layout = layout;
+
+    std::lock_guard<std::mutex> lock( m_mutex );
+    m_programs.push_back( std::move( program ) );
+    return m_programs.size() - 1;
+}
+
+std::shared_future<bool> SharedRenderAssets::Request( size_t index, ShaderStage stage, const ShaderCompileFn& compile, WorkerPool* pool )
+{
+    Program* program = nullptr;
+    std::shared_ptr<std::promise<bool>> promise;
+    std::shared_future<bool> result;
+    {
+        std::lock_guard<std::mutex> lock( m_mutex );
+        if( index >= m_programs.size() )
+        {
+            std::promise<bool> failed;
+            failed.set_value( false );
+            return failed.get_future().share();
+        }
+
+        program = m_programs[index].get();
+        if( program->result[stage].valid() )
+            return program->result[stage];
+
+        promise = std::make_shared<std::promise<bool>>();
+        program->result[stage] = promise->get_future().share();
+        result = program->result[stage];
+    }
+
+    // The bytecode is written before the promise is fulfilled and never again after
+    auto job = [program, stage, compile, promise]()
+    {
+        const bool ok = compile && compile( program->source, program->entryPoint[stage], program->target[stage],
+                                            program->bytecode[stage] );
+        promise->set_value( ok );
+    };
+
+    if( pool )
+        pool->Submit( program->name + "." + program->entryPoint[stage], job );
+    else
+        job();
+    return result;
+}
+
+void SharedRenderAssets::PrefetchAll( const ShaderCompileFn& compile, WorkerPool& pool )
+{
+    for( size_t i = 0; i < ProgramCount(); ++i )
+    {
+        Request( i, SHADER_STAGE_VERTEX, compile, &pool );
+        Request( i, SHADER_STAGE_PIXEL, compile, &pool );
+    }
+}
+
+const std::vector<uint8_t>* SharedRenderAssets::Bytecode( size_t index, ShaderStage stage, const ShaderCompileFn& compile )
+{
+    std::shared_future<bool> result = Request( index, stage, compile );
+    if( !result.get() )
+        return nullptr;
+
+    std::lock_guard<std::mutex> lock( m_mutex );
+    return &m_programs[index]->bytecode[stage];
+}
+
+uint64_t SharedRenderAssets::Bytes() const
+{
+    std::lock_guard<std::mutex> lock( m_mutex );
+    uint64_t bytes = m_vertices.size() * sizeof( QuadVertex ) + m_indices.size() * sizeof( uint16_t );
+    for( const std::unique_ptr<Program>& program : m_programs )
+    {
+        // Only finished compiles; one still in flight owns its vector
+        for( uint32_t stage = 0; stage < SHADER_STAGE_COUNT; ++stage )
+        {
+            const std::shared_future<bool>& result = program->result[stage];
+            if( result.valid() && result.wait_for( std::chrono::seconds( 0 ) ) == std::future_status::ready )
+                bytes += program->bytecode[stage].size();
+        }
+    }
+    return bytes;
+}
+
+//--------------------------------------------------------------------------------------
+void RenderDevice::DestroyRenderWindow( RenderWindow* window )
+{
+    m_windows.erase( std::remove_if( m_windows.begin(), m_windows.end(),
+                                     [window]( const std::unique_ptr<RenderWindow>& w ) { return w.get() == window; } ),
+                     m_windows.end() );
+}
+
+RenderWindow* RenderDevice::AdoptWindow( std::unique_ptr<RenderWindow> window )
+{
+    m_windows.push_back( std::move( window ) );
+    return m_windows.back().get();
+}
+
+std::string FormatRenderDeviceStats( const RenderDevice& device )
+{
+    const RenderDeviceStats& stats = device.Stats();
+
+    char line[256];
+    snprintf( line, sizeof( line ), "%s device: created in %.2f ms, %llu bytes of shared assets\n",
+              device.BackendName(), stats.createMs, static_cast<unsigned long long>( stats.sharedBytes ) );
+    std::string out = line;
+
+    for( size_t i = 0; i < device.WindowCount(); ++i )
+    {
+        const RenderWindow& window = *device.Window( i );
+        snprintf( line, sizeof( line ), "  window '%s' %ux%u: created in %.2f ms, %llu bytes",
+                  window.Desc().name.c_str(), window.Width(), window.Height(), window.Stats().createMs,
+                  static_cast<unsigned long long>( window.Stats().gpuBytes ) );
+        out += line;
+        if( window.Stats().resizes )
+        {
+            snprintf( line, sizeof( line ), ", resized %llu times (%llu projection updates)",
+                      static_cast<unsigned long long>( window.Stats().resizes ),
+                      static_cast<unsigned long long>( window.Stats().projectionUpdates ) );
+            out += line;
+        }
+        out += "\n";
+    }
+    return out;
+}
+
+//? --------------------------------------------------------------------------------------
+//? Null backend
+//? --------------------------------------------------------------------------------------
+namespace
+{
+    using Clock = std::chrono::steady_clock;
+
+    double MillisecondsSince( Clock::time_point start )
+    {
+        return std::chrono::duration<double, std::milli>( Clock::now() - start ).count();
+    }
+
+    class NullRenderWindow : public RenderWindow
+    {
+    public:
+        explicit NullRenderWindow( const RenderWindowDesc& desc )
+        {
+            const Clock::time_point start = Clock::now();
+
+            m_desc = desc;
+            m_width = std::max( desc.width, 1u );
+            m_height = std::max( desc.height, 1u );
+            m_color.resize( size_t( m_width ) * m_height );
+            m_depth.resize( size_t( m_width ) * m_height );
+
+            m_stats.gpuBytes = ( m_color.size() + m_depth.size() ) * sizeof( uint32_t ) + sizeof( m_constants );
+            m_stats.createMs = MillisecondsSince( start );
+        }
+
+        void BeginFrame() override
+        {
+            uint32_t rgba = 0;
+            for( int c = 0; c < 4; ++c )
+            {
+                const float v = std::min( std::max( m_desc.clearColor[c], 0.0f ), 1.0f );
+                rgba |= uint32_t( v * 255.0f + 0.5f ) << ( c * 8 );
+            }
+            std::fill( m_color.begin(), m_color.end(), rgba );
+            std::fill( m_depth.begin(), m_depth.end(), 0xffffffu );
+        }
+
+        void UpdateFrameConstants( const FrameConstants& constants ) override { m_constants = constants; }
+
+        void DrawQuad() override {}
+
+        void Present() override { ++m_framesPresented; }
+
+        bool Resize( uint32_t width, uint32_t height ) override
+        {
+            if( width == 0 || height == 0 || ( width == m_width && height == m_height ) )
+                return true;
+
+            if( AspectChanges( width, height ) )
+                ++m_stats.projectionUpdates;
+            m_width = width;
+            m_height = height;
+            m_color.assign( size_t( m_width ) * m_height, 0 );
+            m_depth.assign( size_t( m_width ) * m_height, 0 );
+
+            m_stats.gpuBytes = ( m_color.size() + m_depth.size() ) * sizeof( uint32_t ) + sizeof( m_constants );
+            ++m_stats.resizes;
+            return true;
+        }
+
+        std::unique_ptr<IStagingBackend> CreateReadback( size_t slotCount ) override
+        {
+            return std::unique_ptr<IStagingBackend>( new NullStagingBackend( m_color, m_width, slotCount ) );
+        }
+
+    private:
+        //? Copies are immediate, so every map succeeds
+        class NullStagingBackend : public IStagingBackend
+        {
+        public:
+            NullStagingBackend( const std::vector<uint32_t>& color, uint32_t width, size_t slotCount ) :
+                m_color( color ), m_width( width ), m_slots( slotCount ) {}
+
+            bool IssueCopy( size_t slot ) override
+            {
+                m_slots[slot] = m_color;
+                return true;
+            }
+
+            MapResult TryMap( size_t slot, const uint8_t** data, size_t* rowPitch ) override
+            {
+                *data = reinterpret_cast<const uint8_t*>( m_slots[slot].data() );
+                *rowPitch = size_t( m_width ) * sizeof( uint32_t );
+                return MAP_OK;
+            }
+
+            void Unmap( size_t ) override {}
+
+        private:
+            const std::vector<uint32_t>&        m_color;
+            const uint32_t                      m_width;
+            std::vector<std::vector<uint32_t>>  m_slots;
+        };
+
+        std::vector<uint32_t>   m_color;
+        std::vector<uint32_t>   m_depth;
+        FrameConstants          m_constants = {};
+    };
+
+    class NullRenderDevice : public RenderDevice
+    {
+    public:
+        explicit NullRenderDevice( SharedRenderAssets& assets ) : RenderDevice( assets ) {}
+
+        const char* BackendName() const noexcept override { return "Null"; }
+
+        bool Create() override
+        {
+            // Nothing to upload; the assets are only referenced
+            m_stats = RenderDeviceStats();
+            return true;
+        }
+
+        RenderWindow* CreateRenderWindow( const RenderWindowDesc& desc ) override
+        {
+            if( desc.program >= m_assets.ProgramCount() )
+                return nullptr;
+            return AdoptWindow( std::unique_ptr<RenderWindow>( new NullRenderWindow( desc ) ) );
+        }
+    };
+}
+
+std::unique_ptr<RenderDevice> CreateNullRenderDevice( SharedRenderAssets& assets )
+{
+    return std::unique_ptr<RenderDevice>( new NullRenderDevice( assets ) );
+}
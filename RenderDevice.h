@@ -0,0 +1,237 @@
+//--------------------------------------------------------------------------------------
+// File: RenderDevice.h
+//
+// Backend-neutral device/window abstraction. A RenderDevice owns any number of
+// RenderWindows; each window owns its own targets, constant buffers and texture, while
+// everything immutable (shader bytecode, the quad's vertex and index data) lives once in
+// SharedRenderAssets and is shared by every device and window.
+//
+// The D3D11 implementation is in RenderDeviceD3D11.h; this file also provides a null
+// backend that goes through the same lifecycle without a GPU. A window can also be
+// offscreen: it renders into a plain target of a fixed size and is read back instead
+// of presented.
+//--------------------------------------------------------------------------------------
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "ReadbackRing.h"
+
+
+//? --------------------------------------------------------------------------------------
+//? Immutable assets
+//? --------------------------------------------------------------------------------------
+struct QuadVertex
+{
+    float   pos[3];
+    float   tex[2];
+};
+
+enum ShaderStage : uint32_t
+{
+    SHADER_STAGE_VERTEX = 0,
+    SHADER_STAGE_PIXEL = 1,
+    SHADER_STAGE_COUNT
+};
+
+//? Vertex inputs a program's vertex shader expects
+enum VertexLayout : uint32_t
+{
+    VERTEX_LAYOUT_QUAD,             // QuadVertex only
+    VERTEX_LAYOUT_QUAD_INSTANCED,   // QuadVertex in slot 0, QuadInstance (QuadBatch.h) in slot 1
+};
+
+// Compiles one entry point of an HLSL source into bytecode
+using ShaderCompileFn = std::function<bool( const char* source, const char* entryPoint, const char* target,
+                                            std::vector<uint8_t>& bytecode )>;
+
+class WorkerPool;
+
+class SharedRenderAssets
+{
+public:
+    struct Program
+    {
+        std::string             name;
+        const char*             source = nullptr;
+        VertexLayout            layout = VERTEX_LAYOUT_QUAD;
+        const char*             entryPoint[SHADER_STAGE_COUNT] = { "VS", "PS" };
+        const char*             target[SHADER_STAGE_COUNT] = { "vs_4_0", "ps_4_0" };
+        std::vector<uint8_t>    bytecode[SHADER_STAGE_COUNT];   // valid once result[] is ready and true
+        std::shared_future<bool> result[SHADER_STAGE_COUNT];
+    };
+
+    // Sets up the textured unit quad every window draws
+    SharedRenderAssets();
+
+    SharedRenderAssets( const SharedRenderAssets& ) = delete;
+    SharedRenderAssets& operator=( const SharedRenderAssets& ) = delete;
+
+    // Registers a shader program (VS + PS from one source); returns its index
+    size_t AddProgram( const char* name, const char* source, VertexLayout layout = VERTEX_LAYOUT_QUAD );
+
+    size_t ProgramCount() const noexcept { return m_programs.size(); }
+    const Program& GetProgram( size_t index ) const { return *m_programs[index]; }
+
+    // Starts compiling one stage, on 'pool' if given and inline otherwise. Only the first
+    // request for a stage compiles; later ones return the same future.
+    std::shared_future<bool> Request( size_t program, ShaderStage stage, const ShaderCompileFn& compile, WorkerPool* pool = nullptr );
+
+    // Requests every stage of every registered program on the pool
+    void PrefetchAll( const ShaderCompileFn& compile, WorkerPool& pool );
+
+    // Bytecode of one stage, waiting for a compile already in flight. Returns nullptr if
+    // compilation failed. Safe to call from several threads.
+    const std::vector<uint8_t>* Bytecode( size_t program, ShaderStage stage, const ShaderCompileFn& compile );
+
+    const std::vector<QuadVertex>& Vertices() const noexcept { return m_vertices; }
+    const std::vector<uint16_t>& Indices() const noexcept { return m_indices; }
+
+    // CPU memory held by the shared assets
+    uint64_t Bytes() const;
+
+private:
+    std::vector<std::unique_ptr<Program>>   m_programs;
+    std::vector<QuadVertex>                 m_vertices;
+    std::vector<uint16_t>                   m_indices;
+    mutable std::mutex                      m_mutex;
+};
+
+//? --------------------------------------------------------------------------------------
+//? Per-frame data, laid out like cbChangesEveryFrame in the shaders
+//? --------------------------------------------------------------------------------------
+struct FrameConstants
+{
+    float   world[16];      // already transposed for HLSL
+    float   meshColor[4];
+};
+
+//? --------------------------------------------------------------------------------------
+//? Windows
+//? --------------------------------------------------------------------------------------
+struct RenderWindowDesc
+{
+    std::string     name;
+    void*           nativeWindow = nullptr;     // HWND for D3D11
+    uint32_t        width = 0;                  // 0: take the size from the native window
+    uint32_t        height = 0;
+    size_t          program = 0;                // index into SharedRenderAssets
+    const wchar_t*  textureFile = nullptr;      // DDS file sampled by the quad, if any
+    float           clearColor[4] = { 0.0f, 0.0f, 0.0f, 1.0f };
+    bool            shaderReadableBackBuffer = false;
+    bool            offscreen = false;          // no native window or swap chain; width and height are required
+    uint32_t        bufferCount = 0;            // swap chain buffers; 0: as many as the backend allows
+    uint32_t        maxFrameLatency = 0;        // >0: frames the CPU may queue ahead, with a waitable to pace on
+    uint32_t        syncInterval = 0;           // vblanks per present; 0: present immediately
+    bool            transientDepth = false;     // no depth buffer of its own; the device plans one per frame
+};
+
+struct RenderWindowStats
+{
+    double      createMs = 0.0;     // wall time spent in window creation
+    uint64_t    gpuBytes = 0;       // targets, constant buffers and textures owned by the window
+    uint64_t    resizes = 0;        // Resize() calls that changed the size
+    uint64_t    projectionUpdates = 0;  // of those, the ones that changed the aspect ratio
+};
+
+class RenderWindow
+{
+public:
+    virtual ~RenderWindow() = default;
+
+    const RenderWindowDesc& Desc() const noexcept { return m_desc; }
+    const RenderWindowStats& Stats() const noexcept { return m_stats; }
+    uint32_t Width() const noexcept { return m_width; }
+    uint32_t Height() const noexcept { return m_height; }
+    uint64_t FramesPresented() const noexcept { return m_framesPresented; }
+    bool Offscreen() const noexcept { return m_desc.offscreen; }
+
+    // Binds and clears the window's targets
+    virtual void BeginFrame() = 0;
+
+    virtual void UpdateFrameConstants( const FrameConstants& constants ) = 0;
+
+    // Draws the textured quad with the window's program
+    virtual void DrawQuad() = 0;
+
+    // Offscreen windows only count the frame
+    virtual void Present() = 0;
+
+    // Recreates the window's targets at a new size; the projection is only rebuilt when
+    // the aspect ratio changes. A zero size (a minimized window) keeps the current
+    // targets. Readbacks created before must be recreated.
+    virtual bool Resize( uint32_t width, uint32_t height ) = 0;
+
+    // Staging slots for reading the color target back through a ReadbackRing. Images are
+    // RGBA8, Width() x Height(). nullptr on failure.
+    virtual std::unique_ptr<IStagingBackend> CreateReadback( size_t slotCount ) = 0;
+
+protected:
+    RenderWindow() = default;
+
+    // Whether width x height differs in aspect ratio from the current size
+    bool AspectChanges( uint32_t width, uint32_t height ) const noexcept
+    {
+        return uint64_t( width ) * m_height != uint64_t( m_width ) * height;
+    }
+
+    RenderWindowDesc    m_desc;
+    RenderWindowStats   m_stats;
+    uint32_t            m_width = 0;
+    uint32_t            m_height = 0;
+    uint64_t            m_framesPresented = 0;
+};
+
+//? --------------------------------------------------------------------------------------
+//? Devices
+//? --------------------------------------------------------------------------------------
+struct RenderDeviceStats
+{
+    double      createMs = 0.0;     // device creation
+    uint64_t    sharedBytes = 0;    // per-device copies of the shared assets
+};
+
+class RenderDevice
+{
+public:
+    virtual ~RenderDevice() = default;
+
+    virtual const char* BackendName() const noexcept = 0;
+
+    virtual bool Create() = 0;
+
+    // The device owns the window; nullptr on failure
+    virtual RenderWindow* CreateRenderWindow( const RenderWindowDesc& desc ) = 0;
+
+    void DestroyRenderWindow( RenderWindow* window );
+    void DestroyAllWindows() { m_windows.clear(); }
+
+    size_t WindowCount() const noexcept { return m_windows.size(); }
+    RenderWindow* Window( size_t index ) const { return m_windows[index].get(); }
+
+    const RenderDeviceStats& Stats() const noexcept { return m_stats; }
+    SharedRenderAssets& Assets() const noexcept { return m_assets; }
+
+protected:
+    explicit RenderDevice( SharedRenderAssets& assets ) : m_assets( assets ) {}
+
+    RenderWindow* AdoptWindow( std::unique_ptr<RenderWindow> window );
+
+    SharedRenderAssets&                         m_assets;
+    RenderDeviceStats                           m_stats;
+    std::vector<std::unique_ptr<RenderWindow>>  m_windows;
+};
+
+// Null backend: windows are plain CPU buffers, draws are no-ops
+std::unique_ptr<RenderDevice> CreateNullRenderDevice( SharedRenderAssets& assets );
+
+// One line per device and window: creation time and memory
+std::string FormatRenderDeviceStats( const RenderDevice& device );
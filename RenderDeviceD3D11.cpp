@@ -0,0 +1,1245 @@
+//--------------------------------------------------------------------------------------
+// File: RenderDeviceD3D11.cpp
+//
+// D3D11 backend of RenderDevice/RenderWindow
+//--------------------------------------------------------------------------------------
+
+#include "RenderDeviceD3D11.h"
+
+#include <directxmath.h>
+
+#include <chrono>
+#include <cstring>
+
+#include "DDSTextureLoader.h"
+
+using namespace DirectX;
+
+
+namespace
+{
+    struct CBNeverChanges
+    {
+        XMMATRIX mView;
+    };
+
+    struct CBChangeOnResize
+    {
+        XMMATRIX mProjection;
+    };
+
+    static_assert( sizeof( FrameConstants ) == sizeof( XMMATRIX ) + sizeof( XMFLOAT4 ), "FrameConstants must match cbChangesEveryFrame" );
+
+    //? Offsets passed to *SetConstantBuffers1 must be multiples of 16 constants
+    const UINT kConstantRingBytes = 256 * 1024;
+    const UINT kConstantRingAlignment = 16 * 16;
+
+    //? Ring frames that can be in flight; more get folded into the next fence
+    const size_t kConstantRingFences = 8;
+
+    //? Released depth buffers kept for the next resize; a few window-sized D24S8 buffers
+    const uint64_t kTargetPoolBudgetBytes = 64ull * 1024 * 1024;
+
+    using Clock = std::chrono::steady_clock;
+
+    double MillisecondsSince( Clock::time_point start )
+    {
+        return std::chrono::duration<double, std::milli>( Clock::now() - start ).count();
+    }
+
+    template<typename T>
+    void SafeRelease( T*& p )
+    {
+        if( p )
+        {
+            p->Release();
+            p = nullptr;
+        }
+    }
+
+    //? Bits per pixel, or per texel of a 4x4 block for the BC formats
+    UINT FormatBitsPerPixel( DXGI_FORMAT format )
+    {
+        switch( format )
+        {
+        case DXGI_FORMAT_R32G32B32A32_FLOAT:
+        case DXGI_FORMAT_R32G32B32A32_UINT:
+            return 128;
+        case DXGI_FORMAT_R16G16B16A16_FLOAT:
+        case DXGI_FORMAT_R16G16B16A16_UNORM:
+        case DXGI_FORMAT_R32G32_FLOAT:
+            return 64;
+        case DXGI_FORMAT_B5G6R5_UNORM:
+        case DXGI_FORMAT_B5G5R5A1_UNORM:
+        case DXGI_FORMAT_R16_FLOAT:
+        case DXGI_FORMAT_R8G8_UNORM:
+            return 16;
+        case DXGI_FORMAT_R8_UNORM:
+        case DXGI_FORMAT_A8_UNORM:
+        case DXGI_FORMAT_BC2_UNORM:
+        case DXGI_FORMAT_BC2_UNORM_SRGB:
+        case DXGI_FORMAT_BC3_UNORM:
+        case DXGI_FORMAT_BC3_UNORM_SRGB:
+        case DXGI_FORMAT_BC5_UNORM:
+        case DXGI_FORMAT_BC5_SNORM:
+        case DXGI_FORMAT_BC6H_UF16:
+        case DXGI_FORMAT_BC6H_SF16:
+        case DXGI_FORMAT_BC7_UNORM:
+        case DXGI_FORMAT_BC7_UNORM_SRGB:
+            return 8;
+        case DXGI_FORMAT_BC1_UNORM:
+        case DXGI_FORMAT_BC1_UNORM_SRGB:
+        case DXGI_FORMAT_BC4_UNORM:
+        case DXGI_FORMAT_BC4_SNORM:
+            return 4;
+        default:
+            return 32;
+        }
+    }
+}
+
+uint64_t EstimateTextureBytes( const D3D11_TEXTURE2D_DESC& desc )
+{
+    const uint64_t bpp = FormatBitsPerPixel( desc.Format );
+    uint64_t bytes = 0;
+    UINT width = desc.Width;
+    UINT height = desc.Height;
+    const UINT mips = desc.MipLevels ? desc.MipLevels : 1;
+    for( UINT mip = 0; mip < mips; ++mip )
+    {
+        //? GetSurfaceInfo() knows every format a DDS file can hold; typeless depth
+        //? formats and the like fall back to the bits-per-pixel estimate
+        size_t levelBytes = 0;
+        if( SUCCEEDED( GetSurfaceInfo( width, height, desc.Format, &levelBytes, nullptr, nullptr ) ) && levelBytes )
+            bytes += levelBytes;
+        else
+            bytes += ( uint64_t( width ) * height * bpp + 7 ) / 8;
+        width = width > 1 ? width / 2 : 1;
+        height = height > 1 ? height / 2 : 1;
+    }
+    return bytes * desc.ArraySize * desc.SampleDesc.Count;
+}
+
+uint64_t EstimateResourceBytes( ID3D11Resource* resource, ResourceKind* kind )
+{
+    D3D11_RESOURCE_DIMENSION dimension = D3D11_RESOURCE_DIMENSION_UNKNOWN;
+    resource->GetType( &dimension );
+    *kind = dimension == D3D11_RESOURCE_DIMENSION_BUFFER ? RESOURCE_BUFFER : RESOURCE_TEXTURE;
+
+    if( dimension == D3D11_RESOURCE_DIMENSION_BUFFER )
+    {
+        D3D11_BUFFER_DESC desc;
+        static_cast<ID3D11Buffer*>( resource )->GetDesc( &desc );
+        return desc.ByteWidth;
+    }
+    if( dimension == D3D11_RESOURCE_DIMENSION_TEXTURE2D )
+    {
+        D3D11_TEXTURE2D_DESC desc;
+        static_cast<ID3D11Texture2D*>( resource )->GetDesc( &desc );
+        return EstimateTextureBytes( desc );
+    }
+    return 0;
+}
+
+//! --------------------------------------------------------------------------------------
+//!
+//! RESOURCE TRACKING
+//!
+//! --------------------------------------------------------------------------------------
+namespace
+{
+    // {5D2C8E41-7A3F-4B6E-9C15-2F8A0D6B3E97}
+    const GUID kResourceTrackerGuid = { 0x5d2c8e41, 0x7a3f, 0x4b6e, { 0x9c, 0x15, 0x2f, 0x8a, 0x0d, 0x6b, 0x3e, 0x97 } };
+
+    //? Private data of a tracked resource. D3D holds the only reference and drops it when
+    //? the resource is destroyed, which takes the resource off the tracker.
+    class ResourceReleaseHook : public IUnknown
+    {
+    public:
+        ResourceReleaseHook( std::shared_ptr<ResourceTracker> tracker, const void* object ) :
+            m_tracker( std::move( tracker ) ),
+            m_object( object ),
+            m_refs( 1 )
+        {
+        }
+
+        HRESULT STDMETHODCALLTYPE QueryInterface( REFIID riid, void** object ) override
+        {
+            if( !object )
+                return E_POINTER;
+            if( riid != __uuidof( IUnknown ) )
+            {
+                *object = nullptr;
+                return E_NOINTERFACE;
+            }
+            *object = static_cast<IUnknown*>( this );
+            AddRef();
+            return S_OK;
+        }
+
+        ULONG STDMETHODCALLTYPE AddRef() override
+        {
+            return ULONG( InterlockedIncrement( &m_refs ) );
+        }
+
+        ULONG STDMETHODCALLTYPE Release() override
+        {
+            const ULONG refs = ULONG( InterlockedDecrement( &m_refs ) );
+            if( refs == 0 )
+            {
+                m_tracker->Remove( m_object );
+                delete this;
+            }
+            return refs;
+        }
+
+    private:
+        std::shared_ptr<ResourceTracker>    m_tracker;
+        const void*                         m_object;
+        volatile LONG                       m_refs;
+    };
+}
+
+bool D3D11ResourceTracker::Track( ID3D11Resource* resource, const char* owner, uint32_t copies )
+{
+    if( !resource )
+        return false;
+
+    ResourceKind kind = RESOURCE_TEXTURE;
+    const uint64_t bytes = EstimateResourceBytes( resource, &kind ) * copies;
+    if( !m_tracker->Add( resource, kind, owner, bytes ) )
+        return false;
+
+    //? Should the resource refuse the hook, dropping our reference removes the record again
+    ResourceReleaseHook* hook = new ResourceReleaseHook( m_tracker, resource );
+    const HRESULT hr = resource->SetPrivateDataInterface( kResourceTrackerGuid, hook );
+    hook->Release();
+    return SUCCEEDED( hr );
+}
+
+uint32_t D3D11ResourceTracker::RefCount( const void* object )
+{
+    //! Only valid on a live resource: the AddRef() would otherwise revive one that is
+    //! being destroyed
+    ID3D11Resource* resource = static_cast<ID3D11Resource*>( const_cast<void*>( object ) );
+    resource->AddRef();
+    return uint32_t( resource->Release() );
+}
+
+//! --------------------------------------------------------------------------------------
+//!
+//! DEVICE
+//!
+//! --------------------------------------------------------------------------------------
+D3D11RenderDevice::D3D11RenderDevice( SharedRenderAssets& assets, ShaderCompileFn compile ) :
+    RenderDevice( assets ),
+    m_compile( std::move( compile ) )
+{
+}
+
+D3D11RenderDevice::~D3D11RenderDevice()
+{
+    // Windows reference the device objects below
+    DestroyAllWindows();
+    if( m_context ) m_context->ClearState();
+    m_stateCache.InvalidateAll();
+
+    for( std::unique_ptr<D3D11ShaderProgram>& program : m_programs )
+    {
+        if( !program )
+            continue;
+        SafeRelease( program->inputLayout );
+        SafeRelease( program->pixelShader );
+        SafeRelease( program->vertexShader );
+    }
+    ReleaseTransientViews();
+    m_transientTargets.reset();
+    m_targetPool.reset();
+    m_targetAllocator.reset();
+    for( ID3D11Query* query : m_ringQueries )
+        SafeRelease( query );
+    for( RingFence& fence : m_ringFences )
+        SafeRelease( fence.query );
+    SafeRelease( m_constantRing );
+    SafeRelease( m_samplerLinear );
+    SafeRelease( m_indexBuffer );
+    SafeRelease( m_vertexBuffer );
+    SafeRelease( m_factory2 );
+    SafeRelease( m_factory );
+    SafeRelease( m_context1 );
+    SafeRelease( m_context );
+    SafeRelease( m_device1 );
+    SafeRelease( m_device );
+}
+
+bool D3D11RenderDevice::Create()
+{
+    const Clock::time_point start = Clock::now();
+
+    m_lastError = CreateDevice();
+    if( SUCCEEDED( m_lastError ) )
+        m_lastError = CreateSharedObjects();
+
+    m_stats.createMs = MillisecondsSince( start );
+    return SUCCEEDED( m_lastError );
+}
+
+HRESULT D3D11RenderDevice::CreateDevice()
+{
+    HRESULT hr = S_OK;
+
+    UINT createDeviceFlags = 0;
+#ifdef _DEBUG
+    createDeviceFlags |= D3D11_CREATE_DEVICE_DEBUG;
+#endif
+
+    D3D_DRIVER_TYPE driverTypes[] =
+    {
+        D3D_DRIVER_TYPE_WARP,
+        D3D_DRIVER_TYPE_HARDWARE,
+        D3D_DRIVER_TYPE_REFERENCE,
+    };
+    UINT numDriverTypes = ARRAYSIZE( driverTypes );
+
+    D3D_FEATURE_LEVEL featureLevels[] =
+    {
+        D3D_FEATURE_LEVEL_11_1,
+        D3D_FEATURE_LEVEL_11_0,
+        D3D_FEATURE_LEVEL_10_1,
+        D3D_FEATURE_LEVEL_10_0,
+    };
+    UINT numFeatureLevels = ARRAYSIZE( featureLevels );
+
+    for( UINT driverTypeIndex = 0; driverTypeIndex < numDriverTypes; driverTypeIndex++ )
+    {
+        m_driverType = driverTypes[driverTypeIndex];
+        hr = D3D11CreateDevice( nullptr, m_driverType, nullptr, createDeviceFlags, featureLevels, numFeatureLevels,
+                                D3D11_SDK_VERSION, &m_device, &m_featureLevel, &m_context );
+
+        if( hr == E_INVALIDARG )
+        {
+            // DirectX 11.0 platforms will not recognize D3D_FEATURE_LEVEL_11_1 so we need to retry without it
+            hr = D3D11CreateDevice( nullptr, m_driverType, nullptr, createDeviceFlags, &featureLevels[1], numFeatureLevels - 1,
+                                    D3D11_SDK_VERSION, &m_device, &m_featureLevel, &m_context );
+        }
+
+        if( SUCCEEDED( hr ) )
+            break;
+    }
+    if( FAILED( hr ) )
+        return hr;
+
+    //! Obtain DXGI factory from device (since we used nullptr for pAdapter above)
+    {
+        IDXGIDevice* dxgiDevice = nullptr;
+        hr = m_device->QueryInterface( __uuidof( IDXGIDevice ), reinterpret_cast<void**>( &dxgiDevice ) );
+        if( SUCCEEDED( hr ) )
+        {
+            IDXGIAdapter* adapter = nullptr;
+            hr = dxgiDevice->GetAdapter( &adapter );
+            if( SUCCEEDED( hr ) )
+            {
+                hr = adapter->GetParent( __uuidof( IDXGIFactory1 ), reinterpret_cast<void**>( &m_factory ) );
+                adapter->Release();
+            }
+            dxgiDevice->Release();
+        }
+    }
+    if( FAILED( hr ) )
+        return hr;
+
+    //? Swap chains are created with CreateSwapChainForHwnd, which needs DXGI 1.2
+    hr = m_factory->QueryInterface( __uuidof( IDXGIFactory2 ), reinterpret_cast<void**>( &m_factory2 ) );
+    if( FAILED( hr ) )
+        return hr;
+
+    // DirectX 11.1 or later
+    if( SUCCEEDED( m_device->QueryInterface( __uuidof( ID3D11Device1 ), reinterpret_cast<void**>( &m_device1 ) ) ) )
+    {
+        (void) m_context->QueryInterface( __uuidof( ID3D11DeviceContext1 ), reinterpret_cast<void**>( &m_context1 ) );
+    }
+
+    m_stateCache.Attach( m_context, m_context1 );
+    return S_OK;
+}
+
+//? --------------------------------------------------------------------------------------
+//? Uploads the parts of the shared assets every window on this device draws with
+//? --------------------------------------------------------------------------------------
+HRESULT D3D11RenderDevice::CreateSharedObjects()
+{
+    const std::vector<QuadVertex>& vertices = m_assets.Vertices();
+    const std::vector<uint16_t>& indices = m_assets.Indices();
+
+    //? Create vertex buffer
+    D3D11_BUFFER_DESC bd = {};
+    bd.Usage = D3D11_USAGE_IMMUTABLE;
+    bd.ByteWidth = UINT( sizeof( QuadVertex ) * vertices.size() );
+    bd.BindFlags = D3D11_BIND_VERTEX_BUFFER;
+    bd.CPUAccessFlags = 0;
+
+    D3D11_SUBRESOURCE_DATA InitData = {};
+    InitData.pSysMem = vertices.data();
+    HRESULT hr = m_device->CreateBuffer( &bd, &InitData, &m_vertexBuffer );
+    if( FAILED( hr ) )
+        return hr;
+    m_resources.Track( m_vertexBuffer, "quad" );
+    m_stats.sharedBytes += bd.ByteWidth;
+
+    //? Create index buffer
+    bd.ByteWidth = UINT( sizeof( uint16_t ) * indices.size() );
+    bd.BindFlags = D3D11_BIND_INDEX_BUFFER;
+    InitData.pSysMem = indices.data();
+    hr = m_device->CreateBuffer( &bd, &InitData, &m_indexBuffer );
+    if( FAILED( hr ) )
+        return hr;
+    m_resources.Track( m_indexBuffer, "quad" );
+    m_indexCount = UINT( indices.size() );
+    m_stats.sharedBytes += bd.ByteWidth;
+
+    //? Create the sample state
+    D3D11_SAMPLER_DESC sampDesc = {};
+    sampDesc.Filter = D3D11_FILTER_MIN_MAG_MIP_LINEAR;
+    sampDesc.AddressU = D3D11_TEXTURE_ADDRESS_WRAP;
+    sampDesc.AddressV = D3D11_TEXTURE_ADDRESS_WRAP;
+    sampDesc.AddressW = D3D11_TEXTURE_ADDRESS_WRAP;
+    sampDesc.ComparisonFunc = D3D11_COMPARISON_NEVER;
+    sampDesc.MinLOD = 0;
+    sampDesc.MaxLOD = D3D11_FLOAT32_MAX;
+    hr = m_device->CreateSamplerState( &sampDesc, &m_samplerLinear );
+    if( FAILED( hr ) )
+        return hr;
+
+    //? Window depth buffers and other targets that are recreated on resize
+    m_targetAllocator.reset( new D3D11TargetAllocator( m_device, &m_resources ) );
+    m_targetPool.reset( new RenderTargetPool( *m_targetAllocator, kTargetPoolBudgetBytes ) );
+    m_transientTargets.reset( new TransientTargetSet( *m_targetPool ) );
+
+    //? Constant ring; optional, windows fall back to their own buffers without it
+    if( m_context1 )
+    {
+        D3D11_FEATURE_DATA_D3D11_OPTIONS options = {};
+        if( SUCCEEDED( m_device->CheckFeatureSupport( D3D11_FEATURE_D3D11_OPTIONS, &options, sizeof( options ) ) ) &&
+            options.ConstantBufferOffsetting && options.MapNoOverwriteOnDynamicConstantBuffer )
+        {
+            //? Without its queries the ring could never retire anything
+            D3D11_QUERY_DESC queryDesc = {};
+            queryDesc.Query = D3D11_QUERY_EVENT;
+            m_ringQueries.assign( kConstantRingFences, nullptr );
+            bool queries = true;
+            for( ID3D11Query*& query : m_ringQueries )
+                queries = queries && SUCCEEDED( m_device->CreateQuery( &queryDesc, &query ) );
+
+            bd.Usage = D3D11_USAGE_DYNAMIC;
+            bd.ByteWidth = kConstantRingBytes;
+            bd.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
+            bd.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+            if( queries && SUCCEEDED( m_device->CreateBuffer( &bd, nullptr, &m_constantRing ) ) )
+            {
+                m_resources.Track( m_constantRing, "constant ring" );
+                m_uploadRing.reset( new UploadRing( kConstantRingBytes, kConstantRingAlignment, UploadRing::WRAP_FENCED ) );
+                m_stats.sharedBytes += bd.ByteWidth;
+            }
+        }
+    }
+    return S_OK;
+}
+
+HRESULT D3D11RenderDevice::UploadConstants( const void* data, UINT size, D3D11ConstantSlice* slice )
+{
+    if( !m_uploadRing )
+        return E_NOTIMPL;
+
+    //? Appends with NO_OVERWRITE, and wraps only onto retired frames, so nothing the GPU
+    //? may still read is written; only the first map discards
+    UploadRing::Allocation allocation = m_uploadRing->Allocate( size );
+    if( !allocation.valid )
+    {
+        RetireConstantRing();
+        allocation = m_uploadRing->Allocate( size );
+        if( !allocation.valid )
+            return E_OUTOFMEMORY;
+    }
+
+    D3D11_MAPPED_SUBRESOURCE mapped = {};
+    HRESULT hr = m_context->Map( m_constantRing, 0, allocation.discard ? D3D11_MAP_WRITE_DISCARD : D3D11_MAP_WRITE_NO_OVERWRITE,
+                                 0, &mapped );
+    if( FAILED( hr ) )
+        return hr;
+    memcpy( static_cast<uint8_t*>( mapped.pData ) + allocation.offset, data, size );
+    m_context->Unmap( m_constantRing, 0 );
+
+    slice->buffer = m_constantRing;
+    slice->firstConstant = UINT( allocation.offset / 16 );
+    slice->numConstants = UINT( allocation.size / 16 );
+    return S_OK;
+}
+
+void D3D11RenderDevice::FenceConstantRing()
+{
+    if( !m_uploadRing )
+        return;
+
+    RetireConstantRing();
+    if( m_ringQueries.empty() )
+        return;
+
+    //? The ring skips frames that uploaded nothing; those need no query either
+    const size_t inFlight = m_uploadRing->FramesInFlight();
+    m_uploadRing->EndFrame( ++m_ringFrame );
+    if( m_uploadRing->FramesInFlight() == inFlight )
+        return;
+
+    RingFence fence;
+    fence.query = m_ringQueries.back();
+    fence.frameId = m_ringFrame;
+    m_ringQueries.pop_back();
+    m_context->End( fence.query );
+    m_ringFences.push_back( fence );
+}
+
+void D3D11RenderDevice::RetireConstantRing()
+{
+    while( !m_ringFences.empty() &&
+           m_context->GetData( m_ringFences.front().query, nullptr, 0, D3D11_ASYNC_GETDATA_DONOTFLUSH ) == S_OK )
+    {
+        m_uploadRing->Retire( m_ringFences.front().frameId );
+        m_ringQueries.push_back( m_ringFences.front().query );
+        m_ringFences.pop_front();
+    }
+}
+
+//? --------------------------------------------------------------------------------------
+//? One pass per window, writing its depth buffer. The plan only changes when windows are
+//? resized or stop drawing, and the targets and their views are kept until it does.
+//? --------------------------------------------------------------------------------------
+HRESULT D3D11RenderDevice::PlanTransientDepth( D3D11RenderWindow* const* windows, size_t count )
+{
+    m_transientFrame.Clear();
+    for( size_t i = 0; i < count; ++i )
+    {
+        TransientTextureDesc desc;
+        desc.name = windows[i]->Desc().name;
+        desc.key = windows[i]->DepthKey();
+        desc.texelBytes = 4;
+        desc.mayBeLarger = true;
+        const size_t depth = m_transientFrame.AddTexture( desc );
+        m_transientFrame.Write( m_transientFrame.AddPass( desc.name.c_str() ), depth );
+    }
+    PlanTransientAliasing( m_transientFrame, m_transientPlan );
+    HRESULT hr = m_transientTargets->Realize( m_transientPlan ) ? S_OK : E_OUTOFMEMORY;
+
+    //? A target the pool replaced needs a new view. The old view still references the
+    //? old texture, so a new texture can never turn up at the same address.
+    for( size_t i = m_transientPlan.targets.size(); i < m_transientViews.size(); ++i )
+        SafeRelease( m_transientViews[i].view );
+    m_transientViews.resize( m_transientPlan.targets.size() );
+    for( size_t i = 0; i < m_transientViews.size(); ++i )
+    {
+        const size_t entry = m_transientTargets->TargetEntry( i );
+        ID3D11Texture2D* texture = entry != RenderTargetPool::kInvalidEntry ? PooledTexture( entry ) : nullptr;
+        TransientView& view = m_transientViews[i];
+        if( view.texture == texture )
+            continue;
+
+        SafeRelease( view.view );
+        view.texture = nullptr;
+        m_stateCache.InvalidateRenderTargets();
+        if( !texture )
+            continue;
+
+        D3D11_DEPTH_STENCIL_VIEW_DESC descDSV = {};
+        descDSV.Format = DXGI_FORMAT_D24_UNORM_S8_UINT;
+        descDSV.ViewDimension = D3D11_DSV_DIMENSION_TEXTURE2D;
+        descDSV.Texture2D.MipSlice = 0;
+        const HRESULT viewHr = m_device->CreateDepthStencilView( texture, &descDSV, &view.view );
+        if( FAILED( viewHr ) )
+        {
+            hr = viewHr;
+            continue;
+        }
+        view.texture = texture;
+    }
+
+    for( size_t i = 0; i < count; ++i )
+        windows[i]->SetDepthStencilView( m_transientViews[m_transientPlan.targetOf[i]].view );
+    return hr;
+}
+
+void D3D11RenderDevice::ReleaseTransientViews()
+{
+    for( TransientView& view : m_transientViews )
+        SafeRelease( view.view );
+    m_transientViews.clear();
+}
+
+HRESULT D3D11RenderDevice::GetProgram( size_t index, const D3D11ShaderProgram** program )
+{
+    if( index >= m_assets.ProgramCount() )
+        return E_INVALIDARG;
+
+    if( m_programs.size() <= index )
+        m_programs.resize( index + 1 );
+    if( m_programs[index] )
+    {
+        *program = m_programs[index].get();
+        return S_OK;
+    }
+
+    //? Bytecode is compiled once and shared with every other device
+    const std::vector<uint8_t>* vs = m_assets.Bytecode( index, SHADER_STAGE_VERTEX, m_compile );
+    if( !vs )
+    {
+        MessageBox( nullptr,
+                    L"Vertex shader compilation failed.", L"Error", MB_OK );
+        return E_FAIL;
+    }
+
+    const std::vector<uint8_t>* ps = m_assets.Bytecode( index, SHADER_STAGE_PIXEL, m_compile );
+    if( !ps )
+    {
+        MessageBox( nullptr,
+                    L"Pixel shader compilation failed.", L"Error", MB_OK );
+        return E_FAIL;
+    }
+
+    std::unique_ptr<D3D11ShaderProgram> created( new D3D11ShaderProgram );
+
+    //? Create the vertex shader
+    HRESULT hr = m_device->CreateVertexShader( vs->data(), vs->size(), nullptr, &created->vertexShader );
+    if( FAILED( hr ) )
+        return hr;
+
+    //? Define the input layout; instanced programs read QuadInstance from slot 1
+    D3D11_INPUT_ELEMENT_DESC layout[] =
+    {
+        { "POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 0, D3D11_INPUT_PER_VERTEX_DATA, 0 },
+        { "TEXCOORD", 0, DXGI_FORMAT_R32G32_FLOAT, 0, 12, D3D11_INPUT_PER_VERTEX_DATA, 0 },
+        { "TEXCOORD", 1, DXGI_FORMAT_R32G32B32_FLOAT, 1, 0, D3D11_INPUT_PER_INSTANCE_DATA, 1 },
+        { "TEXCOORD", 2, DXGI_FORMAT_R32G32B32_FLOAT, 1, 12, D3D11_INPUT_PER_INSTANCE_DATA, 1 },
+        { "TEXCOORD", 3, DXGI_FORMAT_R32_UINT, 1, 24, D3D11_INPUT_PER_INSTANCE_DATA, 1 },
+    };
+    UINT numElements = m_assets.GetProgram( index ).layout == VERTEX_LAYOUT_QUAD_INSTANCED ? ARRAYSIZE( layout ) : 2;
+
+    //? Create the input layout
+    hr = m_device->CreateInputLayout( layout, numElements, vs->data(), vs->size(), &created->inputLayout );
+    if( FAILED( hr ) )
+    {
+        SafeRelease( created->vertexShader );
+        return hr;
+    }
+
+    //? Create the pixel shader
+    hr = m_device->CreatePixelShader( ps->data(), ps->size(), nullptr, &created->pixelShader );
+    if( FAILED( hr ) )
+    {
+        SafeRelease( created->inputLayout );
+        SafeRelease( created->vertexShader );
+        return hr;
+    }
+
+    m_stats.sharedBytes += vs->size() + ps->size();
+    m_programs[index] = std::move( created );
+    *program = m_programs[index].get();
+    return S_OK;
+}
+
+D3D11RenderWindow* D3D11RenderDevice::CreateRenderWindow( const RenderWindowDesc& desc )
+{
+    std::unique_ptr<D3D11RenderWindow> window( new D3D11RenderWindow( *this ) );
+    m_lastError = window->Init( desc );
+    if( FAILED( m_lastError ) )
+        return nullptr;
+
+    return static_cast<D3D11RenderWindow*>( AdoptWindow( std::move( window ) ) );
+}
+
+//! --------------------------------------------------------------------------------------
+//!
+//! WINDOW
+//!
+//! --------------------------------------------------------------------------------------
+D3D11RenderWindow::~D3D11RenderWindow()
+{
+    SafeRelease( m_texture );
+    SafeRelease( m_cbChangesEveryFrame );
+    SafeRelease( m_cbChangeOnResize );
+    SafeRelease( m_cbNeverChanges );
+    ReleaseTargets();
+
+    //! A swap chain has to be windowed when it is released
+    if( m_swapChain )
+        m_swapChain->SetFullscreenState( FALSE, nullptr );
+    SafeRelease( m_swapChain );
+    SafeRelease( m_swapChain1 );
+}
+
+HRESULT D3D11RenderWindow::Init( const RenderWindowDesc& desc )
+{
+    const Clock::time_point start = Clock::now();
+
+    m_desc = desc;
+    m_hwnd = static_cast<HWND>( desc.nativeWindow );
+
+    m_width = desc.width;
+    m_height = desc.height;
+    if( desc.offscreen && ( m_width == 0 || m_height == 0 ) )
+        return E_INVALIDARG;
+    if( m_width == 0 || m_height == 0 )
+    {
+        RECT rc;
+        GetClientRect( m_hwnd, &rc );
+        m_width = rc.right - rc.left;
+        m_height = rc.bottom - rc.top;
+    }
+
+    ID3D11Device* device = m_device.Device();
+    ID3D11DeviceContext* context = m_device.Context();
+
+    HRESULT hr = m_device.GetProgram( desc.program, &m_program );
+    if( FAILED( hr ) )
+        return hr;
+
+    //? Create swap chain; offscreen windows only get a plain target
+    if( !desc.offscreen )
+    {
+        hr = CreateSwapChain( desc.shaderReadableBackBuffer );
+        if( FAILED( hr ) )
+            return hr;
+    }
+
+    hr = CreateTargets();
+    if( FAILED( hr ) )
+        return hr;
+
+    //? Create the constant buffers
+    D3D11_BUFFER_DESC bd = {};
+    bd.Usage = D3D11_USAGE_DEFAULT;
+    bd.ByteWidth = sizeof( CBNeverChanges );
+    bd.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
+    bd.CPUAccessFlags = 0;
+    hr = device->CreateBuffer( &bd, nullptr, &m_cbNeverChanges );
+    if( FAILED( hr ) )
+        return hr;
+
+    bd.ByteWidth = sizeof( CBChangeOnResize );
+    hr = device->CreateBuffer( &bd, nullptr, &m_cbChangeOnResize );
+    if( FAILED( hr ) )
+        return hr;
+
+    bd.ByteWidth = sizeof( FrameConstants );
+    hr = device->CreateBuffer( &bd, nullptr, &m_cbChangesEveryFrame );
+    if( FAILED( hr ) )
+        return hr;
+
+    const std::string constantsOwner = desc.name + " constants";
+    m_device.Resources().Track( m_cbNeverChanges, constantsOwner.c_str() );
+    m_device.Resources().Track( m_cbChangeOnResize, constantsOwner.c_str() );
+    m_device.Resources().Track( m_cbChangesEveryFrame, constantsOwner.c_str() );
+
+    //? Load the texture, if the window has one of its own
+    if( desc.textureFile )
+    {
+        ID3D11Resource* texture = nullptr;
+        hr = CreateDDSTextureFromFile( device, desc.textureFile, &texture, &m_texture );
+        if( FAILED( hr ) )
+            return hr;
+        m_device.Resources().Track( texture, ( desc.name + " texture" ).c_str() );
+        texture->Release();
+    }
+
+    //? Initialize the view matrix
+    XMVECTOR Eye = XMVectorSet( 0.0f, 0.0f, -5.0f, 0.0f );    // cam rotation (Y-axis Rot, X-axis Rot, Z-axis?)
+    XMVECTOR At = XMVectorSet( 0.0f, 0.0f, 0.0f, 0.0f );
+    XMVECTOR Up = XMVectorSet( 0.0f, 1.0f, 0.0f, 0.0f );      // ? but cannot be empty/zero
+
+    CBNeverChanges cbNeverChanges;
+    cbNeverChanges.mView = XMMatrixTranspose( XMMatrixLookAtLH( Eye, At, Up ) );
+    context->UpdateSubresource( m_cbNeverChanges, 0, nullptr, &cbNeverChanges, 0, 0 );
+
+    //? Initialize the projection matrix
+    UpdateProjection();
+
+    //? Memory owned by this window
+    UpdateGpuBytes();
+
+    m_stats.createMs = MillisecondsSince( start );
+    return S_OK;
+}
+
+HRESULT D3D11RenderWindow::CreateSwapChain( bool shaderReadable )
+{
+    DXGI_SWAP_CHAIN_DESC1 sd = {};
+    sd.Width = m_width;
+    sd.Height = m_height;
+    sd.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
+    sd.SampleDesc.Count = 1;
+    sd.SampleDesc.Quality = 0;
+    sd.BufferUsage = DXGI_USAGE_RENDER_TARGET_OUTPUT | ( shaderReadable ? DXGI_USAGE_SHADER_INPUT : 0 );
+    sd.BufferCount = m_desc.bufferCount ? m_desc.bufferCount : DXGI_MAX_SWAP_CHAIN_BUFFERS;
+    sd.BufferCount = sd.BufferCount < 2 ? 2 : sd.BufferCount > DXGI_MAX_SWAP_CHAIN_BUFFERS ? DXGI_MAX_SWAP_CHAIN_BUFFERS : sd.BufferCount;    // the flip model needs two
+    sd.SwapEffect = DXGI_SWAP_EFFECT_FLIP_SEQUENTIAL;
+    sd.Flags = m_desc.maxFrameLatency ? DXGI_SWAP_CHAIN_FLAG_FRAME_LATENCY_WAITABLE_OBJECT : 0;
+
+    HRESULT hr = m_device.Factory2()->CreateSwapChainForHwnd( m_device.Device(), m_hwnd, &sd, nullptr, nullptr, &m_swapChain1 );
+    if( FAILED( hr ) && sd.Flags )
+    {
+        //! DXGI before 1.3 has no waitable swap chains; the latency limit then goes on the
+        //! device and Present() blocks instead
+        sd.Flags = 0;
+        hr = m_device.Factory2()->CreateSwapChainForHwnd( m_device.Device(), m_hwnd, &sd, nullptr, nullptr, &m_swapChain1 );
+    }
+    if( SUCCEEDED( hr ) )
+    {
+        hr = m_swapChain1->QueryInterface( __uuidof( IDXGISwapChain ), reinterpret_cast<void**>( &m_swapChain ) );
+    }
+    if( FAILED( hr ) )
+        return hr;
+
+    if( m_desc.maxFrameLatency )
+    {
+        IDXGISwapChain2* swapChain2 = nullptr;
+        IDXGIDevice1* dxgiDevice = nullptr;
+        if( sd.Flags && SUCCEEDED( m_swapChain1->QueryInterface( __uuidof( IDXGISwapChain2 ), reinterpret_cast<void**>( &swapChain2 ) ) ) )
+        {
+            swapChain2->SetMaximumFrameLatency( m_desc.maxFrameLatency );
+            m_latencyWaitable.Attach( swapChain2->GetFrameLatencyWaitableObject() );
+            swapChain2->Release();
+        }
+        else if( SUCCEEDED( m_device.Device()->QueryInterface( __uuidof( IDXGIDevice1 ), reinterpret_cast<void**>( &dxgiDevice ) ) ) )
+        {
+            dxgiDevice->SetMaximumFrameLatency( m_desc.maxFrameLatency );
+            dxgiDevice->Release();
+        }
+    }
+
+    //! ALT+ENTER is left to DXGI: it switches the swap chain in and out of fullscreen and
+    //! the window then gets a WM_SIZE, which ends up in Resize()
+    m_bufferCount = sd.BufferCount;
+    return S_OK;
+}
+
+//? --------------------------------------------------------------------------------------
+//? Everything that depends on the window size: the back buffer (or offscreen target), its
+//? view, the depth buffer and the viewport
+//? --------------------------------------------------------------------------------------
+HRESULT D3D11RenderWindow::CreateTargets()
+{
+    ID3D11Device* device = m_device.Device();
+
+    HRESULT hr = S_OK;
+    if( m_swapChain )
+    {
+        //! With the flip model buffer 0 always refers to the current back buffer, so it is
+        //! kept for the render target view and for copies out of the window
+        hr = m_swapChain->GetBuffer( 0, __uuidof( ID3D11Texture2D ), reinterpret_cast<void**>( &m_backBuffer ) );
+    }
+    else
+    {
+        D3D11_TEXTURE2D_DESC descTarget = {};
+        descTarget.Width = m_width;
+        descTarget.Height = m_height;
+        descTarget.MipLevels = 1;
+        descTarget.ArraySize = 1;
+        descTarget.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
+        descTarget.SampleDesc.Count = 1;
+        descTarget.SampleDesc.Quality = 0;
+        descTarget.Usage = D3D11_USAGE_DEFAULT;
+        descTarget.BindFlags = D3D11_BIND_RENDER_TARGET | ( m_desc.shaderReadableBackBuffer ? D3D11_BIND_SHADER_RESOURCE : 0 );
+        hr = device->CreateTexture2D( &descTarget, nullptr, &m_backBuffer );
+    }
+    if( FAILED( hr ) )
+        return hr;
+
+    //? A swap chain's buffers are all alike; buffer 0 is recorded for every one of them
+    m_device.Resources().Track( m_backBuffer, ( m_desc.name + " back buffer" ).c_str(), m_swapChain ? m_bufferCount : 1 );
+
+    hr = device->CreateRenderTargetView( m_backBuffer, nullptr, &m_renderTargetView );
+    if( FAILED( hr ) )
+        return hr;
+
+    //? Depth stencil texture from the device's pool. It is bucketed, so it may be larger
+    //? than the window; only the viewport's corner of it is ever used. Transient depth
+    //? buffers come from the device each frame instead.
+    if( !m_desc.transientDepth )
+    {
+        m_depthEntry = m_device.TargetPool().Acquire( DepthKey(), true );
+        if( m_depthEntry == RenderTargetPool::kInvalidEntry )
+            return E_OUTOFMEMORY;
+
+        //? Create the depth stencil view
+        D3D11_DEPTH_STENCIL_VIEW_DESC descDSV = {};
+        descDSV.Format = DXGI_FORMAT_D24_UNORM_S8_UINT;
+        descDSV.ViewDimension = D3D11_DSV_DIMENSION_TEXTURE2D;
+        descDSV.Texture2D.MipSlice = 0;
+        hr = device->CreateDepthStencilView( m_device.PooledTexture( m_depthEntry ), &descDSV, &m_depthStencilView );
+        if( FAILED( hr ) )
+            return hr;
+    }
+
+    //? Setup the viewport
+    m_viewport.Width = (FLOAT)m_width;
+    m_viewport.Height = (FLOAT)m_height;
+    m_viewport.MinDepth = 0.0f;
+    m_viewport.MaxDepth = 1.0f;
+    m_viewport.TopLeftX = 0;
+    m_viewport.TopLeftY = 0;
+    return S_OK;
+}
+
+void D3D11RenderWindow::ReleaseTargets()
+{
+    SafeRelease( m_depthStencilView );
+    if( m_depthEntry != RenderTargetPool::kInvalidEntry )
+    {
+        m_device.TargetPool().Release( m_depthEntry );
+        m_depthEntry = RenderTargetPool::kInvalidEntry;
+    }
+    SafeRelease( m_renderTargetView );
+    SafeRelease( m_backBuffer );
+}
+
+void D3D11RenderWindow::UpdateProjection()
+{
+    CBChangeOnResize cbChangesOnResize;
+    cbChangesOnResize.mProjection = XMMatrixTranspose( XMMatrixPerspectiveFovLH( XM_PIDIV4, m_width / (FLOAT)m_height, 0.01f, 100.0f ) );
+    m_device.Context()->UpdateSubresource( m_cbChangeOnResize, 0, nullptr, &cbChangesOnResize, 0, 0 );
+}
+
+void D3D11RenderWindow::UpdateGpuBytes()
+{
+    D3D11_TEXTURE2D_DESC backDesc;
+    m_backBuffer->GetDesc( &backDesc );
+    m_stats.gpuBytes = EstimateTextureBytes( backDesc ) * m_bufferCount
+                     + sizeof( CBNeverChanges ) + sizeof( CBChangeOnResize ) + sizeof( FrameConstants );
+    if( m_depthEntry != RenderTargetPool::kInvalidEntry )
+    {
+        D3D11_TEXTURE2D_DESC depthDesc;
+        m_device.PooledTexture( m_depthEntry )->GetDesc( &depthDesc );
+        m_stats.gpuBytes += EstimateTextureBytes( depthDesc );
+    }
+    if( m_texture )
+    {
+        ID3D11Resource* resource = nullptr;
+        m_texture->GetResource( &resource );
+        ID3D11Texture2D* texture = nullptr;
+        if( SUCCEEDED( resource->QueryInterface( __uuidof( ID3D11Texture2D ), reinterpret_cast<void**>( &texture ) ) ) )
+        {
+            D3D11_TEXTURE2D_DESC texDesc;
+            texture->GetDesc( &texDesc );
+            m_stats.gpuBytes += EstimateTextureBytes( texDesc );
+            texture->Release();
+        }
+        resource->Release();
+    }
+}
+
+//? --------------------------------------------------------------------------------------
+//? Resizes in place: the swap chain keeps its buffer count and format, the depth buffer
+//? goes back to the pool and the new one usually comes straight out of it again. The
+//? projection only changes with the aspect ratio.
+//? --------------------------------------------------------------------------------------
+bool D3D11RenderWindow::Resize( uint32_t width, uint32_t height )
+{
+    if( width == 0 || height == 0 || ( width == m_width && height == m_height ) )
+        return true;
+
+    //! ResizeBuffers fails while anything still references the back buffer, including a
+    //! view bound on the context or one whose destruction is still deferred
+    ID3D11DeviceContext* context = m_device.Context();
+    context->OMSetRenderTargets( 0, nullptr, nullptr );
+    m_device.StateCache().InvalidateRenderTargets();
+    ReleaseTargets();
+    context->Flush();
+
+    const bool aspectChanges = AspectChanges( width, height );
+    m_width = width;
+    m_height = height;
+
+    m_lastError = S_OK;
+    if( m_swapChain1 )
+    {
+        DXGI_SWAP_CHAIN_DESC1 sd;
+        m_lastError = m_swapChain1->GetDesc1( &sd );
+        if( SUCCEEDED( m_lastError ) )
+            m_lastError = m_swapChain1->ResizeBuffers( 0, m_width, m_height, DXGI_FORMAT_UNKNOWN, sd.Flags );
+    }
+    if( SUCCEEDED( m_lastError ) )
+        m_lastError = CreateTargets();
+    if( FAILED( m_lastError ) )
+        return false;
+
+    if( aspectChanges )
+    {
+        UpdateProjection();
+        ++m_stats.projectionUpdates;
+    }
+    UpdateGpuBytes();
+    ++m_stats.resizes;
+    return true;
+}
+
+void D3D11RenderWindow::SetTexture( ID3D11ShaderResourceView* srv )
+{
+    if( srv ) srv->AddRef();
+    SafeRelease( m_texture );
+    m_texture = srv;
+}
+
+RenderTargetKey D3D11RenderWindow::DepthKey() const
+{
+    RenderTargetKey key;
+    key.width = m_width;
+    key.height = m_height;
+    key.format = DXGI_FORMAT_D24_UNORM_S8_UINT;
+    key.bindFlags = D3D11_BIND_DEPTH_STENCIL;
+    return key;
+}
+
+void D3D11RenderWindow::SetDepthStencilView( ID3D11DepthStencilView* view )
+{
+    if( view ) view->AddRef();
+    SafeRelease( m_depthStencilView );
+    m_depthStencilView = view;
+}
+
+//? --------------------------------------------------------------------------------------
+//? Per-frame work. Every window binds all of its state through the device's state cache,
+//? so only what differs from the previous window or pass reaches the context.
+//? --------------------------------------------------------------------------------------
+void D3D11RenderWindow::BeginFrame()
+{
+    D3D11StateCache& state = m_device.StateCache();
+
+    state.OMSetRenderTargets( 1, &m_renderTargetView, m_depthStencilView );
+    state.RSSetViewports( 1, &m_viewport );
+    state.RSSetState( nullptr );
+
+    ID3D11DeviceContext* context = m_device.Context();
+
+    //
+    // Clear the back buffer
+    //
+    context->ClearRenderTargetView( m_renderTargetView, m_desc.clearColor );
+
+    //
+    // Clear the depth buffer to 1.0 (max depth); a transient one may be missing if the
+    // device could not plan it
+    //
+    if( m_depthStencilView )
+        context->ClearDepthStencilView( m_depthStencilView, D3D11_CLEAR_DEPTH, 1.0f, 0 );
+}
+
+void D3D11RenderWindow::UpdateFrameConstants( const FrameConstants& constants )
+{
+    if( m_device.HasConstantRing() && SUCCEEDED( m_device.UploadConstants( &constants, sizeof( constants ), &m_frameConstants ) ) )
+        return;
+
+    m_frameConstants = D3D11ConstantSlice();
+    m_device.Context()->UpdateSubresource( m_cbChangesEveryFrame, 0, nullptr, &constants, 0, 0 );
+}
+
+void D3D11RenderWindow::DrawQuad()
+{
+    D3D11StateCache& state = m_device.StateCache();
+
+    ID3D11Buffer* vertexBuffer = m_device.QuadVertexBuffer();
+    UINT stride = sizeof( QuadVertex );
+    UINT offset = 0;
+    state.IASetInputLayout( m_program->inputLayout );
+    state.IASetVertexBuffers( 0, 1, &vertexBuffer, &stride, &offset );
+    state.IASetIndexBuffer( m_device.QuadIndexBuffer(), DXGI_FORMAT_R16_UINT, 0 );
+    state.IASetPrimitiveTopology( D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST );
+
+    ID3D11Buffer* constantBuffers[] = { m_cbNeverChanges, m_cbChangeOnResize, m_cbChangesEveryFrame };
+    ID3D11SamplerState* sampler = m_device.LinearSampler();
+    state.VSSetShader( m_program->vertexShader );
+    state.PSSetShader( m_program->pixelShader );
+    if( m_frameConstants.buffer )
+    {
+        //? Every window on the device binds the same ring, each at its own offset
+        state.VSSetConstantBuffers( 0, 2, constantBuffers );
+        state.VSSetConstantBuffers1( 2, 1, &m_frameConstants.buffer, &m_frameConstants.firstConstant, &m_frameConstants.numConstants );
+        state.PSSetConstantBuffers1( 2, 1, &m_frameConstants.buffer, &m_frameConstants.firstConstant, &m_frameConstants.numConstants );
+    }
+    else
+    {
+        state.VSSetConstantBuffers( 0, 3, constantBuffers );
+        state.PSSetConstantBuffers( 2, 1, &m_cbChangesEveryFrame );
+    }
+    state.PSSetShaderResources( 0, 1, &m_texture );
+    state.PSSetSamplers( 0, 1, &sampler );
+    m_device.Context()->DrawIndexed( m_device.QuadIndexCount(), 0, 0 );
+}
+
+void D3D11RenderWindow::BindQuadPipeline( ID3D11DeviceContext* context ) const
+{
+    context->OMSetRenderTargets( 1, &m_renderTargetView, m_depthStencilView );
+    context->RSSetViewports( 1, &m_viewport );
+
+    ID3D11Buffer* vertexBuffer = m_device.QuadVertexBuffer();
+    UINT stride = sizeof( QuadVertex );
+    UINT offset = 0;
+    context->IASetInputLayout( m_program->inputLayout );
+    context->IASetVertexBuffers( 0, 1, &vertexBuffer, &stride, &offset );
+    context->IASetIndexBuffer( m_device.QuadIndexBuffer(), DXGI_FORMAT_R16_UINT, 0 );
+    context->IASetPrimitiveTopology( D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST );
+
+    ID3D11Buffer* constantBuffers[] = { m_cbNeverChanges, m_cbChangeOnResize };
+    ID3D11SamplerState* sampler = m_device.LinearSampler();
+    context->VSSetShader( m_program->vertexShader, nullptr, 0 );
+    context->VSSetConstantBuffers( 0, 2, constantBuffers );
+    context->PSSetShader( m_program->pixelShader, nullptr, 0 );
+    context->PSSetShaderResources( 0, 1, &m_texture );
+    context->PSSetSamplers( 0, 1, &sampler );
+}
+
+void D3D11RenderWindow::Present()
+{
+    m_device.FenceConstantRing();
+
+    //? Offscreen there is no present to submit the frame, and its readback copies would
+    //? otherwise wait in the command buffer
+    if( m_swapChain )
+    {
+        m_swapChain->Present( m_desc.syncInterval, 0 );
+        m_device.StateCache().InvalidateRenderTargets();
+    }
+    else
+    {
+        m_device.Context()->Flush();
+    }
+    ++m_framesPresented;
+}
+
+std::unique_ptr<IStagingBackend> D3D11RenderWindow::CreateReadback( size_t slotCount )
+{
+    std::unique_ptr<D3D11StagingBackend> backend( new D3D11StagingBackend );
+    if( FAILED( backend->Init( m_device.Device(), m_device.Context(), m_backBuffer, slotCount, &m_device.Resources() ) ) )
+        return nullptr;
+    return std::move( backend );
+}
+
+//! --------------------------------------------------------------------------------------
+//!
+//! FRAME LATENCY
+//!
+//! --------------------------------------------------------------------------------------
+void D3D11LatencyWaitable::Close()
+{
+    if( m_handle )
+    {
+        CloseHandle( m_handle );
+        m_handle = nullptr;
+    }
+}
+
+bool D3D11LatencyWaitable::Wait( uint64_t timeoutNs )
+{
+    const DWORD timeoutMs = DWORD( ( timeoutNs + 999999 ) / 1000000 );
+    return WaitForSingleObjectEx( m_handle, timeoutMs, TRUE ) == WAIT_OBJECT_0;
+}
+
+//! --------------------------------------------------------------------------------------
+//!
+//! TARGET POOL
+//!
+//! --------------------------------------------------------------------------------------
+D3D11TargetAllocator::~D3D11TargetAllocator()
+{
+    for( ID3D11Texture2D*& texture : m_textures )
+        SafeRelease( texture );
+}
+
+bool D3D11TargetAllocator::CreateTarget( size_t entry, const RenderTargetKey& key, uint64_t* bytes )
+{
+    if( entry >= m_textures.size() )
+        m_textures.resize( entry + 1, nullptr );
+
+    D3D11_TEXTURE2D_DESC desc = {};
+    desc.Width = key.width;
+    desc.Height = key.height;
+    desc.MipLevels = 1;
+    desc.ArraySize = 1;
+    desc.Format = static_cast<DXGI_FORMAT>( key.format );
+    desc.SampleDesc.Count = 1;
+    desc.SampleDesc.Quality = 0;
+    desc.Usage = D3D11_USAGE_DEFAULT;
+    desc.BindFlags = key.bindFlags;
+    if( FAILED( m_device->CreateTexture2D( &desc, nullptr, &m_textures[entry] ) ) )
+        return false;
+    if( m_resources )
+        m_resources->Track( m_textures[entry], "target pool" );
+
+    *bytes = EstimateTextureBytes( desc );
+    return true;
+}
+
+void D3D11TargetAllocator::DestroyTarget( size_t entry )
+{
+    if( entry < m_textures.size() )
+        SafeRelease( m_textures[entry] );
+}
+
+//! --------------------------------------------------------------------------------------
+//!
+//! READBACK
+//!
+//! --------------------------------------------------------------------------------------
+HRESULT D3D11StagingBackend::Init( ID3D11Device* device, ID3D11DeviceContext* context, ID3D11Texture2D* source, size_t slotCount,
+                                   D3D11ResourceTracker* resources )
+{
+    D3D11_TEXTURE2D_DESC desc;
+    source->GetDesc( &desc );
+    desc.MipLevels = 1;
+    desc.ArraySize = 1;
+    desc.Usage = D3D11_USAGE_STAGING;
+    desc.BindFlags = 0;
+    desc.CPUAccessFlags = D3D11_CPU_ACCESS_READ;
+    desc.MiscFlags = 0;
+
+    m_staging.assign( slotCount, nullptr );
+    for( ID3D11Texture2D*& staging : m_staging )
+    {
+        HRESULT hr = device->CreateTexture2D( &desc, nullptr, &staging );
+        if( FAILED( hr ) )
+            return hr;
+        if( resources )
+            resources->Track( staging, "readback" );
+    }
+    m_context = context;
+    m_source = source;
+    return S_OK;
+}
+
+void D3D11StagingBackend::Release()
+{
+    for( ID3D11Texture2D*& staging : m_staging )
+        SafeRelease( staging );
+    m_staging.clear();
+}
+
+bool D3D11StagingBackend::IssueCopy( size_t slot )
+{
+    m_context->CopySubresourceRegion( m_staging[slot], 0, 0, 0, 0, m_source, 0, nullptr );
+    return true;
+}
+
+IStagingBackend::MapResult D3D11StagingBackend::TryMap( size_t slot, const uint8_t** data, size_t* rowPitch )
+{
+    D3D11_MAPPED_SUBRESOURCE mapped = {};
+    HRESULT hr = m_context->Map( m_staging[slot], 0, D3D11_MAP_READ, D3D11_MAP_FLAG_DO_NOT_WAIT, &mapped );
+    if( hr == DXGI_ERROR_WAS_STILL_DRAWING )
+        return MAP_BUSY;
+    if( FAILED( hr ) )
+        return MAP_FAILED;
+
+    *data = static_cast<const uint8_t*>( mapped.pData );
+    *rowPitch = mapped.RowPitch;
+    return MAP_OK;
+}
+
+void D3D11StagingBackend::Unmap( size_t slot )
+{
+    m_context->Unmap( m_staging[slot], 0 );
+}
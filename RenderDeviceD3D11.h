@@ -0,0 +1,333 @@
+//--------------------------------------------------------------------------------------
+// File: RenderDeviceD3D11.h
+//
+// D3D11 backend of RenderDevice/RenderWindow. Each device uploads the shared assets
+// once (quad buffers, sampler, one VS/PS/input layout per program used) and every
+// window on it references them; windows own their swap chain, constant buffers and
+// texture. Offscreen windows own a plain render-target texture instead of a swap chain.
+// Depth buffers come from the device's RenderTargetPool, so resizing a window reuses
+// them where it can. Windows created with transientDepth get theirs per frame instead,
+// planned by the device so that windows drawing one after the other share one. Every
+// texture and buffer is recorded in the device's resource tracker with its owner and
+// size.
+//--------------------------------------------------------------------------------------
+
+#pragma once
+
+#include <windows.h>
+#include <d3d11_1.h>
+#include <d3d11_2.h>
+
+#include <deque>
+#include <memory>
+#include <vector>
+
+#include "D3D11StateCache.h"
+#include "FramePacing.h"
+#include "RenderDevice.h"
+#include "RenderTargetPool.h"
+#include "ResourceTracker.h"
+#include "TransientTargets.h"
+#include "UploadRing.h"
+
+
+class D3D11RenderDevice;
+
+//? Records a device's textures and buffers in a ResourceTracker. Each recorded resource
+//? carries a small COM object as private data, which D3D releases when the resource is
+//? destroyed; that removes the record, so nothing is ever untracked by hand.
+class D3D11ResourceTracker : public IResourceRefCounts
+{
+public:
+    D3D11ResourceTracker() : m_tracker( std::make_shared<ResourceTracker>( this ) ) {}
+    ~D3D11ResourceTracker() override { m_tracker->SetRefCounts( nullptr ); }
+
+    D3D11ResourceTracker( const D3D11ResourceTracker& ) = delete;
+    D3D11ResourceTracker& operator=( const D3D11ResourceTracker& ) = delete;
+
+    // Records 'resource' under 'owner', sized from its description. copies: how many
+    // resources of the same size it stands for (a swap chain's buffers). A resource
+    // recorded before keeps its first owner.
+    bool Track( ID3D11Resource* resource, const char* owner, uint32_t copies = 1 );
+
+    uint32_t RefCount( const void* object ) override;
+
+    ResourceTracker& Tracker() noexcept { return *m_tracker; }
+
+    // The records outlive the device for as long as any of its resources do, which is
+    // what a leak report after the device is gone needs
+    std::shared_ptr<ResourceTracker> SharedTracker() const noexcept { return m_tracker; }
+
+private:
+    std::shared_ptr<ResourceTracker>    m_tracker;
+};
+
+//? Device objects for one of the shared programs
+struct D3D11ShaderProgram
+{
+    ID3D11VertexShader*     vertexShader = nullptr;
+    ID3D11PixelShader*      pixelShader = nullptr;
+    ID3D11InputLayout*      inputLayout = nullptr;
+};
+
+//? A range of the device's constant ring, bound with *SetConstantBuffers1
+struct D3D11ConstantSlice
+{
+    ID3D11Buffer*   buffer = nullptr;
+    UINT            firstConstant = 0;      // in 16-byte constants, a multiple of 16
+    UINT            numConstants = 0;
+};
+
+//? D3D11 staging textures behind a ReadbackRing. Copies come from one fixed source
+//? texture; maps never wait for the GPU.
+class D3D11StagingBackend : public IStagingBackend
+{
+public:
+    ~D3D11StagingBackend() override { Release(); }
+
+    HRESULT Init( ID3D11Device* device, ID3D11DeviceContext* context, ID3D11Texture2D* source, size_t slotCount,
+                  D3D11ResourceTracker* resources = nullptr );
+    void Release();
+
+    bool IssueCopy( size_t slot ) override;
+    MapResult TryMap( size_t slot, const uint8_t** data, size_t* rowPitch ) override;
+    void Unmap( size_t slot ) override;
+
+private:
+    ID3D11DeviceContext*            m_context = nullptr;
+    ID3D11Texture2D*                m_source = nullptr;
+    std::vector<ID3D11Texture2D*>   m_staging;
+};
+
+//? D3D11 textures behind a RenderTargetPool, one per pool entry. The key's format is a
+//? DXGI_FORMAT and its bind flags are D3D11_BIND_* flags.
+class D3D11TargetAllocator : public IRenderTargetAllocator
+{
+public:
+    D3D11TargetAllocator( ID3D11Device* device, D3D11ResourceTracker* resources ) : m_device( device ), m_resources( resources ) {}
+    ~D3D11TargetAllocator() override;
+
+    bool CreateTarget( size_t entry, const RenderTargetKey& key, uint64_t* bytes ) override;
+    void DestroyTarget( size_t entry ) override;
+
+    ID3D11Texture2D* Texture( size_t entry ) const { return entry < m_textures.size() ? m_textures[entry] : nullptr; }
+
+private:
+    ID3D11Device*                   m_device;
+    D3D11ResourceTracker*           m_resources;
+    std::vector<ID3D11Texture2D*>   m_textures;
+};
+
+//? A swap chain's frame-latency waitable object
+class D3D11LatencyWaitable : public IFrameLatencyWaitable
+{
+public:
+    ~D3D11LatencyWaitable() override { Close(); }
+
+    void Attach( HANDLE handle ) { Close(); m_handle = handle; }
+    void Close();
+    HANDLE Handle() const noexcept { return m_handle; }
+
+    bool Wait( uint64_t timeoutNs ) override;
+
+private:
+    HANDLE  m_handle = nullptr;
+};
+
+class D3D11RenderWindow : public RenderWindow
+{
+public:
+    ~D3D11RenderWindow() override;
+
+    void BeginFrame() override;
+    void UpdateFrameConstants( const FrameConstants& constants ) override;
+    void DrawQuad() override;
+    void Present() override;
+    std::unique_ptr<IStagingBackend> CreateReadback( size_t slotCount ) override;
+
+    // Resizes the swap chain buffers (or the offscreen target) and recreates the views.
+    // Anything else holding the back buffer has to let go of it first.
+    bool Resize( uint32_t width, uint32_t height ) override;
+
+    // Failure from the last Resize()
+    HRESULT LastError() const noexcept { return m_lastError; }
+
+    // Replaces the texture the quad samples; the window keeps its own reference
+    void SetTexture( ID3D11ShaderResourceView* srv );
+
+    // Size, format and usage of the depth buffer the window needs at its current size
+    RenderTargetKey DepthKey() const;
+
+    // Binds everything DrawQuad uses except the per-frame constants in slot 2, directly
+    // on 'context'. For recording draws on deferred contexts.
+    void BindQuadPipeline( ID3D11DeviceContext* context ) const;
+
+    HWND Hwnd() const noexcept { return m_hwnd; }
+    IDXGISwapChain* SwapChain() const noexcept { return m_swapChain; }     // nullptr when offscreen
+
+    // What a FramePacer waits on before starting a frame for this window; nullptr
+    // without a maxFrameLatency or where the swap chain has no waitable object
+    IFrameLatencyWaitable* LatencyWaitable() noexcept { return m_latencyWaitable.Handle() ? &m_latencyWaitable : nullptr; }
+
+    ID3D11Texture2D* BackBuffer() const noexcept { return m_backBuffer; }
+    ID3D11RenderTargetView* RenderTargetView() const noexcept { return m_renderTargetView; }
+    ID3D11DepthStencilView* DepthStencilView() const noexcept { return m_depthStencilView; }
+    ID3D11ShaderResourceView* Texture() const noexcept { return m_texture; }
+    const D3D11_VIEWPORT& Viewport() const noexcept { return m_viewport; }
+
+private:
+    friend class D3D11RenderDevice;
+
+    explicit D3D11RenderWindow( D3D11RenderDevice& device ) : m_device( device ) {}
+
+    HRESULT Init( const RenderWindowDesc& desc );
+    HRESULT CreateSwapChain( bool shaderReadable );
+    HRESULT CreateTargets();
+    void ReleaseTargets();
+    void UpdateProjection();
+    void UpdateGpuBytes();
+    void SetDepthStencilView( ID3D11DepthStencilView* view );
+
+    D3D11RenderDevice&          m_device;
+    HWND                        m_hwnd = nullptr;
+    IDXGISwapChain1*            m_swapChain1 = nullptr;
+    IDXGISwapChain*             m_swapChain = nullptr;
+    D3D11LatencyWaitable        m_latencyWaitable;
+    ID3D11Texture2D*            m_backBuffer = nullptr;     // buffer 0 is always the current back buffer with flip; the target itself when offscreen
+    ID3D11RenderTargetView*     m_renderTargetView = nullptr;
+    UINT                        m_bufferCount = 1;
+    size_t                      m_depthEntry = RenderTargetPool::kInvalidEntry;     // in the device's target pool; none with transientDepth
+    ID3D11DepthStencilView*     m_depthStencilView = nullptr;                       // with transientDepth: this frame's, from the device
+    ID3D11Buffer*               m_cbNeverChanges = nullptr;
+    ID3D11Buffer*               m_cbChangeOnResize = nullptr;
+    ID3D11Buffer*               m_cbChangesEveryFrame = nullptr;   // only used without the constant ring
+    D3D11ConstantSlice          m_frameConstants;                   // this frame's slice of the ring, if any
+    ID3D11ShaderResourceView*   m_texture = nullptr;
+    const D3D11ShaderProgram*   m_program = nullptr;
+    D3D11_VIEWPORT              m_viewport = {};
+    HRESULT                     m_lastError = S_OK;
+};
+
+class D3D11RenderDevice : public RenderDevice
+{
+public:
+    D3D11RenderDevice( SharedRenderAssets& assets, ShaderCompileFn compile );
+    ~D3D11RenderDevice() override;
+
+    const char* BackendName() const noexcept override { return "D3D11"; }
+
+    bool Create() override;
+    D3D11RenderWindow* CreateRenderWindow( const RenderWindowDesc& desc ) override;
+
+    D3D11RenderWindow* Window( size_t index ) const { return static_cast<D3D11RenderWindow*>( RenderDevice::Window( index ) ); }
+
+    // Last failure from Create() or CreateRenderWindow()
+    HRESULT LastError() const noexcept { return m_lastError; }
+
+    ID3D11Device* Device() const noexcept { return m_device; }
+    ID3D11Device1* Device1() const noexcept { return m_device1; }
+    ID3D11DeviceContext* Context() const noexcept { return m_context; }
+    ID3D11DeviceContext1* Context1() const noexcept { return m_context1; }
+    IDXGIFactory1* Factory() const noexcept { return m_factory; }
+    IDXGIFactory2* Factory2() const noexcept { return m_factory2; }
+    D3D_DRIVER_TYPE DriverType() const noexcept { return m_driverType; }
+    D3D_FEATURE_LEVEL FeatureLevel() const noexcept { return m_featureLevel; }
+
+    // Filters redundant state changes on the immediate context; the windows bind
+    // through it, and so should any pass that shares the context with them
+    D3D11StateCache& StateCache() noexcept { return m_stateCache; }
+
+    // Window depth buffers and any other size-dependent textures; an entry's texture is
+    // PooledTexture( entry )
+    RenderTargetPool& TargetPool() noexcept { return *m_targetPool; }
+    ID3D11Texture2D* PooledTexture( size_t entry ) const { return m_targetAllocator->Texture( entry ); }
+
+    // Every texture and buffer created on this device, by owner
+    D3D11ResourceTracker& Resources() noexcept { return m_resources; }
+
+    // Gives 'windows', all created with transientDepth and drawing this frame in this
+    // order, each a depth buffer for the frame. The buffers are planned as transient
+    // targets, so windows drawing one after the other share one. Call before their
+    // BeginFrame(); windows that do not draw need not be passed.
+    HRESULT PlanTransientDepth( D3D11RenderWindow* const* windows, size_t count );
+    const TransientPlan& TransientDepthPlan() const noexcept { return m_transientPlan; }
+    const TransientTargetSet* TransientTargets() const noexcept { return m_transientTargets.get(); }
+
+    // Created on first use and shared by every window on this device
+    HRESULT GetProgram( size_t index, const D3D11ShaderProgram** program );
+
+    ID3D11Buffer* QuadVertexBuffer() const noexcept { return m_vertexBuffer; }
+    ID3D11Buffer* QuadIndexBuffer() const noexcept { return m_indexBuffer; }
+    UINT QuadIndexCount() const noexcept { return m_indexCount; }
+    ID3D11SamplerState* LinearSampler() const noexcept { return m_samplerLinear; }
+
+    // Per-draw constants are written into one dynamic buffer with NO_OVERWRITE maps and
+    // bound at an offset. Needs a D3D11.1 context and driver support for offsets and
+    // NO_OVERWRITE on constant buffers; without them windows use UpdateSubresource.
+    // The ring is fenced: it only wraps onto constants whose frame an event query has
+    // shown the GPU to be done with, and while it is full uploads fail, so windows use
+    // UpdateSubresource for that frame.
+    bool HasConstantRing() const noexcept { return m_constantRing != nullptr; }
+    HRESULT UploadConstants( const void* data, UINT size, D3D11ConstantSlice* slice );
+
+    // Ends a frame of the constant ring with an event query; every window's Present()
+    // calls it, before the frame is submitted
+    void FenceConstantRing();
+    const UploadRing::Stats* ConstantRingStats() const noexcept { return m_uploadRing ? &m_uploadRing->GetStats() : nullptr; }
+
+private:
+    HRESULT CreateDevice();
+    HRESULT CreateSharedObjects();
+    void ReleaseTransientViews();
+    void RetireConstantRing();
+
+    //? The event query ending one frame of the constant ring
+    struct RingFence
+    {
+        ID3D11Query*    query = nullptr;
+        uint64_t        frameId = 0;
+    };
+
+    //? A view of one transient target, kept while the target stays the same
+    struct TransientView
+    {
+        ID3D11Texture2D*        texture = nullptr;      // not referenced; the view holds it
+        ID3D11DepthStencilView* view = nullptr;
+    };
+
+    ShaderCompileFn             m_compile;
+    HRESULT                     m_lastError = S_OK;
+    D3D_DRIVER_TYPE             m_driverType = D3D_DRIVER_TYPE_NULL;
+    D3D_FEATURE_LEVEL           m_featureLevel = D3D_FEATURE_LEVEL_11_0;
+    ID3D11Device*               m_device = nullptr;
+    ID3D11Device1*              m_device1 = nullptr;
+    ID3D11DeviceContext*        m_context = nullptr;
+    ID3D11DeviceContext1*       m_context1 = nullptr;
+    D3D11StateCache             m_stateCache;
+    D3D11ResourceTracker        m_resources;
+    IDXGIFactory1*              m_factory = nullptr;
+    IDXGIFactory2*              m_factory2 = nullptr;
+    ID3D11Buffer*               m_vertexBuffer = nullptr;
+    ID3D11Buffer*               m_indexBuffer = nullptr;
+    UINT                        m_indexCount = 0;
+    ID3D11SamplerState*         m_samplerLinear = nullptr;
+    ID3D11Buffer*               m_constantRing = nullptr;
+    std::unique_ptr<UploadRing> m_uploadRing;
+    std::vector<ID3D11Query*>   m_ringQueries;          // event queries not in flight
+    std::deque<RingFence>       m_ringFences;           // in flight, oldest first
+    uint64_t                    m_ringFrame = 0;
+    std::unique_ptr<D3D11TargetAllocator> m_targetAllocator;
+    std::unique_ptr<RenderTargetPool> m_targetPool;
+    std::unique_ptr<TransientTargetSet> m_transientTargets;
+    TransientFrame              m_transientFrame;
+    TransientPlan               m_transientPlan;
+    std::vector<TransientView>  m_transientViews;       // per target of m_transientPlan
+    std::vector<std::unique_ptr<D3D11ShaderProgram>> m_programs;
+};
+
+// Bytes a texture occupies, including its mip chain and array slices. Each level is
+// sized by GetSurfaceInfo(), so block-compressed and packed formats come out exact.
+uint64_t EstimateTextureBytes( const D3D11_TEXTURE2D_DESC& desc );
+
+// Bytes a 2D texture or a buffer occupies; 0 for other resources
+uint64_t EstimateResourceBytes( ID3D11Resource* resource, ResourceKind* kind );
@@ -0,0 +1,234 @@
+//--------------------------------------------------------------------------------------
+// File: RenderDeviceSoftware.cpp
+//
+// CPU backend of RenderDevice/RenderWindow
+//--------------------------------------------------------------------------------------
+
+#include "RenderDeviceSoftware.h"
+#include "RenderThreads.h"
+
+#include <chrono>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+
+namespace
+{
+    using Clock = std::chrono::steady_clock;
+
+    double MillisecondsSince( Clock::time_point start )
+    {
+        return std::chrono::duration<double, std::milli>( Clock::now() - start ).count();
+    }
+
+    //? Copies are made when issued, after resolving the window, so every map succeeds
+    class SoftwareStagingBackend : public IStagingBackend
+    {
+    public:
+        SoftwareStagingBackend( SoftwareRenderWindow& window, size_t slotCount ) :
+            m_window( window ), m_slots( slotCount ) {}
+
+        bool IssueCopy( size_t slot ) override
+        {
+            m_window.Resolve();
+            const uint32_t* color = m_window.Raster().Color();
+            m_slots[slot].assign( color, color + size_t( m_window.Width() ) * m_window.Height() );
+            return true;
+        }
+
+        MapResult TryMap( size_t slot, const uint8_t** data, size_t* rowPitch ) override
+        {
+            *data = reinterpret_cast<const uint8_t*>( m_slots[slot].data() );
+            *rowPitch = size_t( m_window.Width() ) * sizeof( uint32_t );
+            return MAP_OK;
+        }
+
+        void Unmap( size_t ) override {}
+
+    private:
+        SoftwareRenderWindow&               m_window;
+        std::vector<std::vector<uint32_t>>  m_slots;
+    };
+
+    //? DDS paths are plain ASCII here; anything else is not found
+    bool NarrowPath( const wchar_t* path, std::string& narrow )
+    {
+        narrow.clear();
+        for( ; *path; ++path )
+        {
+            if( *path > 0x7f )
+                return false;
+            narrow += char( *path );
+        }
+        return true;
+    }
+
+    uint64_t TextureBytes( const SoftwareTexture* texture )
+    {
+        return texture ? uint64_t( texture->texels.size() ) * sizeof( uint32_t ) : 0;
+    }
+}
+
+//--------------------------------------------------------------------------------------
+SoftwareRenderWindow::SoftwareRenderWindow( SoftwareRenderDevice& device, const RenderWindowDesc& desc, const SoftwareProgram& program ) :
+    m_device( device ),
+    m_program( program ),
+    m_raster( desc.width, desc.height )
+{
+    m_desc = desc;
+    m_desc.offscreen = true;
+    m_width = m_raster.Width();
+    m_height = m_raster.Height();
+
+    //? The camera and projection of the D3D11 windows
+    const float eye[3] = { 0.0f, 0.0f, -5.0f };
+    const float at[3] = { 0.0f, 0.0f, 0.0f };
+    const float up[3] = { 0.0f, 1.0f, 0.0f };
+    m_view = RasterLookAtLH( eye, at, up );
+    m_projection = RasterPerspectiveFovLH( 3.14159265f / 4.0f, m_width / float( m_height ), 0.01f, 100.0f );
+}
+
+void SoftwareRenderWindow::BeginFrame()
+{
+    m_raster.Clear( m_desc.clearColor );
+}
+
+void SoftwareRenderWindow::UpdateFrameConstants( const FrameConstants& constants )
+{
+    m_constants = constants;
+}
+
+void SoftwareRenderWindow::DrawQuad()
+{
+    RasterMatrix transform = RasterTranspose( m_constants.world );
+    if( m_program.vertexShader == SOFTWARE_VS_VIEW_WORLD_PROJECTION )
+        transform = RasterMultiply( RasterMultiply( m_view, transform ), m_projection );
+
+    const std::vector<QuadVertex>& quad = m_device.Assets().Vertices();
+    const std::vector<uint16_t>& indices = m_device.Assets().Indices();
+    RasterVertex vertices[4];
+    for( size_t i = 0; i < quad.size() && i < 4; ++i )
+    {
+        const float position[4] = { quad[i].pos[0], quad[i].pos[1], quad[i].pos[2], 1.0f };
+        RasterTransform( position, transform, vertices[i].clip );
+        vertices[i].tex[0] = quad[i].tex[0];
+        vertices[i].tex[1] = quad[i].tex[1];
+    }
+
+    RasterDrawState state;
+    state.shader = m_program.pixelShader;
+    state.texture = m_texture.get();
+    memcpy( state.meshColor, m_constants.meshColor, sizeof( state.meshColor ) );
+    m_raster.DrawTriangles( vertices, indices.data(), indices.size(), state );
+}
+
+void SoftwareRenderWindow::Present()
+{
+    Resolve();
+    ++m_framesPresented;
+}
+
+bool SoftwareRenderWindow::Resize( uint32_t width, uint32_t height )
+{
+    if( width == 0 || height == 0 || ( width == m_width && height == m_height ) )
+        return true;
+
+    //? Draws binned for the old size are finished rather than dropped
+    if( m_raster.Pending() )
+        Resolve();
+
+    const bool aspectChanges = AspectChanges( width, height );
+    m_stats.gpuBytes -= uint64_t( m_width ) * m_height * ( sizeof( uint32_t ) + sizeof( float ) );
+    m_raster = TileRasterizer( width, height );
+    m_width = m_raster.Width();
+    m_height = m_raster.Height();
+    m_stats.gpuBytes += uint64_t( m_width ) * m_height * ( sizeof( uint32_t ) + sizeof( float ) );
+
+    if( aspectChanges )
+    {
+        m_projection = RasterPerspectiveFovLH( 3.14159265f / 4.0f, m_width / float( m_height ), 0.01f, 100.0f );
+        ++m_stats.projectionUpdates;
+    }
+    ++m_stats.resizes;
+    return true;
+}
+
+std::unique_ptr<IStagingBackend> SoftwareRenderWindow::CreateReadback( size_t slotCount )
+{
+    return std::unique_ptr<IStagingBackend>( new SoftwareStagingBackend( *this, slotCount ) );
+}
+
+void SoftwareRenderWindow::SetTexture( std::shared_ptr<const SoftwareTexture> texture )
+{
+    //? Binned draws point at the old texture
+    if( m_raster.Pending() )
+        Resolve();
+
+    m_stats.gpuBytes -= TextureBytes( m_texture.get() );
+    m_texture = std::move( texture );
+    m_stats.gpuBytes += TextureBytes( m_texture.get() );
+}
+
+void SoftwareRenderWindow::Resolve()
+{
+    m_raster.Flush( m_device.Pool() );
+}
+
+//--------------------------------------------------------------------------------------
+SoftwareRenderDevice::SoftwareRenderDevice( SharedRenderAssets& assets, size_t threadCount ) :
+    RenderDevice( assets ),
+    m_threadCount( threadCount )
+{
+}
+
+SoftwareRenderDevice::~SoftwareRenderDevice()
+{
+    //? Windows resolve on the pool, so they go first
+    DestroyAllWindows();
+    m_pool.reset();
+}
+
+bool SoftwareRenderDevice::Create()
+{
+    const Clock::time_point start = Clock::now();
+    m_stats = RenderDeviceStats();
+
+    size_t helpers = m_threadCount;
+    if( helpers == SIZE_MAX )
+    {
+        const unsigned cores = std::thread::hardware_concurrency();
+        helpers = cores > 1 ? cores - 1 : 0;
+    }
+    m_pool.reset( helpers ? new WorkerPool( helpers ) : nullptr );
+
+    m_stats.createMs = MillisecondsSince( start );
+    return true;
+}
+
+SoftwareRenderWindow* SoftwareRenderDevice::CreateRenderWindow( const RenderWindowDesc& desc )
+{
+    const Clock::time_point start = Clock::now();
+
+    std::map<size_t, SoftwareProgram>::const_iterator program = m_programs.find( desc.program );
+    if( program == m_programs.end() || desc.program >= m_assets.ProgramCount() || !desc.width || !desc.height )
+        return nullptr;
+
+    std::shared_ptr<SoftwareTexture> texture;
+    if( desc.textureFile )
+    {
+        std::string path;
+        texture = std::make_shared<SoftwareTexture>();
+        if( !NarrowPath( desc.textureFile, path ) || !LoadSoftwareTextureDDS( path.c_str(), *texture ) )
+            return nullptr;
+    }
+
+    std::unique_ptr<SoftwareRenderWindow> window( new SoftwareRenderWindow( *this, desc, program->second ) );
+    window->m_stats.gpuBytes = uint64_t( window->Width() ) * window->Height() * ( sizeof( uint32_t ) + sizeof( float ) ) +
+                               sizeof( FrameConstants );
+    window->SetTexture( texture );
+    window->m_stats.createMs = MillisecondsSince( start );
+
+    return static_cast<SoftwareRenderWindow*>( AdoptWindow( std::move( window ) ) );
+}
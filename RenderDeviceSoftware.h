@@ -0,0 +1,92 @@
+//--------------------------------------------------------------------------------------
+// File: RenderDeviceSoftware.h
+//
+// CPU backend of RenderDevice/RenderWindow on TileRasterizer, for machines without a
+// GPU (headless servers, CI). It cannot run the HLSL programs, so each program a window
+// uses is mapped to the software shaders that do the same thing with SetProgram().
+// Windows are always offscreen: draws are binned as they come and rasterized on the
+// device's worker threads at Present() or when a readback copy is issued.
+//--------------------------------------------------------------------------------------
+
+#pragma once
+
+#include <map>
+#include <memory>
+
+#include "RenderDevice.h"
+#include "SoftwareRaster.h"
+
+
+class SoftwareRenderDevice;
+
+//? Software stand-ins for the stages of one HLSL program
+enum SoftwareVertexShader : uint32_t
+{
+    SOFTWARE_VS_WORLD,                      // mul( pos, World )
+    SOFTWARE_VS_VIEW_WORLD_PROJECTION,      // mul( mul( mul( pos, View ), World ), Projection )
+};
+
+struct SoftwareProgram
+{
+    SoftwareVertexShader    vertexShader = SOFTWARE_VS_WORLD;
+    RasterPixelShader       pixelShader = RASTER_PS_TEXTURE;
+};
+
+class SoftwareRenderWindow : public RenderWindow
+{
+public:
+    void BeginFrame() override;
+    void UpdateFrameConstants( const FrameConstants& constants ) override;
+    void DrawQuad() override;
+    void Present() override;
+    bool Resize( uint32_t width, uint32_t height ) override;
+    std::unique_ptr<IStagingBackend> CreateReadback( size_t slotCount ) override;
+
+    // Replaces the texture the quad samples; draws already made keep the old one
+    void SetTexture( std::shared_ptr<const SoftwareTexture> texture );
+    const std::shared_ptr<const SoftwareTexture>& Texture() const noexcept { return m_texture; }
+
+    // Rasterizes every draw made so far; Raster().Color() is then the current image
+    void Resolve();
+    const TileRasterizer& Raster() const noexcept { return m_raster; }
+
+private:
+    friend class SoftwareRenderDevice;
+
+    SoftwareRenderWindow( SoftwareRenderDevice& device, const RenderWindowDesc& desc, const SoftwareProgram& program );
+
+    SoftwareRenderDevice&                   m_device;
+    SoftwareProgram                         m_program;
+    TileRasterizer                          m_raster;
+    RasterMatrix                            m_view;
+    RasterMatrix                            m_projection;
+    FrameConstants                          m_constants = {};
+    std::shared_ptr<const SoftwareTexture>  m_texture;
+};
+
+class SoftwareRenderDevice : public RenderDevice
+{
+public:
+    // threadCount: rasterizer threads besides the caller's; SIZE_MAX for one per core
+    explicit SoftwareRenderDevice( SharedRenderAssets& assets, size_t threadCount = SIZE_MAX );
+    ~SoftwareRenderDevice() override;
+
+    const char* BackendName() const noexcept override { return "Software"; }
+
+    bool Create() override;
+
+    // nullptr if the program has no software shaders, the size is missing or the
+    // texture could not be read (32-bit uncompressed and BC1-BC3 DDS files can)
+    SoftwareRenderWindow* CreateRenderWindow( const RenderWindowDesc& desc ) override;
+
+    SoftwareRenderWindow* Window( size_t index ) const { return static_cast<SoftwareRenderWindow*>( RenderDevice::Window( index ) ); }
+
+    void SetProgram( size_t program, const SoftwareProgram& shaders ) { m_programs[program] = shaders; }
+
+    WorkerPool* Pool() const noexcept { return m_pool.get(); }
+
+private:
+    size_t                              m_threadCount;
+    std::unique_ptr<WorkerPool>         m_pool;
+    std::map<size_t, SoftwareProgram>   m_programs;
+};
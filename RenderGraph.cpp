@@ -0,0 +1,353 @@
+//--------------------------------------------------------------------------------------
+// File: RenderGraph.cpp
+//
+// Render graph compilation: culling, ordering and cross-device synchronization
+//--------------------------------------------------------------------------------------
+
+#include "RenderGraph.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <functional>
+#include <queue>
+
+
+namespace
+{
+    const size_t kNone = SIZE_MAX;
+
+    enum EdgeKind : uint8_t
+    {
+        EDGE_READ_AFTER_WRITE,
+        EDGE_WRITE_AFTER_WRITE,
+        EDGE_WRITE_AFTER_READ,
+    };
+
+    struct Edge
+    {
+        size_t      from;
+        size_t      to;
+        EdgeKind    kind;
+    };
+
+    //? Dependencies from the declaration order: a read depends on the latest write, a
+    //? write on the reads since that write and on the write itself
+    void BuildEdges( const RenderGraph& graph, std::vector<Edge>& edges )
+    {
+        struct Version
+        {
+            size_t              writer = kNone;
+            std::vector<size_t> readers;
+        };
+        std::vector<Version> versions( graph.ResourceCount() );
+
+        for( size_t pass = 0; pass < graph.PassCount(); ++pass )
+        {
+            const RenderGraph::Pass& p = graph.GetPass( pass );
+
+            //? A pass reading what it writes reads the earlier version
+            for( const RenderGraph::Access& access : p.accesses )
+            {
+                if( access.write )
+                    continue;
+                Version& version = versions[access.resource];
+                if( version.writer != kNone && version.writer != pass )
+                    edges.push_back( Edge{ version.writer, pass, EDGE_READ_AFTER_WRITE } );
+                if( version.readers.empty() || version.readers.back() != pass )
+                    version.readers.push_back( pass );
+            }
+            for( const RenderGraph::Access& access : p.accesses )
+            {
+                if( !access.write )
+                    continue;
+                Version& version = versions[access.resource];
+                if( version.writer == pass )
+                    continue;
+                for( size_t reader : version.readers )
+                {
+                    if( reader != pass )
+                        edges.push_back( Edge{ reader, pass, EDGE_WRITE_AFTER_READ } );
+                }
+
+                //? Even with readers in between: they may be culled, and the writes still
+                //? have to land in order
+                if( version.writer != kNone )
+                    edges.push_back( Edge{ version.writer, pass, EDGE_WRITE_AFTER_WRITE } );
+                version.writer = pass;
+                version.readers.clear();
+            }
+        }
+
+        std::sort( edges.begin(), edges.end(), []( const Edge& a, const Edge& b )
+        {
+            return a.from != b.from ? a.from < b.from : a.to != b.to ? a.to < b.to : a.kind < b.kind;
+        } );
+        edges.erase( std::unique( edges.begin(), edges.end(), []( const Edge& a, const Edge& b )
+        {
+            return a.from == b.from && a.to == b.to;
+        } ), edges.end() );
+    }
+
+    const char* StepName( RenderStepKind kind )
+    {
+        switch( kind )
+        {
+        case RENDER_STEP_WAIT:      return "wait";
+        case RENDER_STEP_SIGNAL:    return "signal";
+        case RENDER_STEP_FLUSH:     return "flush";
+        default:                    return "pass";
+        }
+    }
+}
+
+//--------------------------------------------------------------------------------------
+void RenderGraph::Clear()
+{
+    m_passes.clear();
+    m_resources.clear();
+}
+
+size_t RenderGraph::AddResource( const char* name, uint32_t flags )
+{
+    m_resources.emplace_back();
+    m_resources.back().name = name;
+    m_resources.back().flags = flags;
+    return m_resources.size() - 1;
+}
+
+size_t RenderGraph::AddPass( const char* name, uint32_t device, bool sideEffects )
+{
+    m_passes.emplace_back();
+    m_passes.back().name = name;
+    m_passes.back().device = device;
+    m_passes.back().sideEffects = sideEffects;
+    return m_passes.size() - 1;
+}
+
+//--------------------------------------------------------------------------------------
+bool CompileRenderGraph( const RenderGraph& graph, RenderSchedule& schedule, const RenderGraphOptions& options )
+{
+    const auto start = std::chrono::steady_clock::now();
+    const size_t passCount = graph.PassCount();
+
+    schedule.order.clear();
+    schedule.steps.clear();
+    schedule.errors.clear();
+    schedule.culled.assign( passCount, 0 );
+    schedule.stats = RenderSchedule::Stats();
+    schedule.stats.passes = passCount;
+
+    //? Resources used on several devices have to be shared
+    std::vector<uint32_t> deviceOf( graph.ResourceCount(), UINT32_MAX );
+    std::vector<uint8_t> reported( graph.ResourceCount(), 0 );
+    for( size_t pass = 0; pass < passCount; ++pass )
+    {
+        const RenderGraph::Pass& p = graph.GetPass( pass );
+        for( const RenderGraph::Access& access : p.accesses )
+        {
+            const RenderGraph::Resource& resource = graph.GetResource( access.resource );
+            uint32_t& device = deviceOf[access.resource];
+            if( device == UINT32_MAX )
+                device = p.device;
+            else if( device != p.device && !( resource.flags & GRAPH_RESOURCE_SHARED ) && !reported[access.resource] )
+            {
+                schedule.errors.push_back( "'" + resource.name + "' is used on several devices but not shared" );
+                reported[access.resource] = 1;
+            }
+        }
+    }
+
+    std::vector<Edge> edges;
+    BuildEdges( graph, edges );
+
+    //? Culling. Edges only lead to later passes, so one backward sweep sees every pass
+    //? after all the passes that depend on it.
+    std::vector<uint8_t> kept( passCount, 0 );
+    for( size_t pass = 0; pass < passCount; ++pass )
+    {
+        const RenderGraph::Pass& p = graph.GetPass( pass );
+        kept[pass] = p.sideEffects;
+        for( const RenderGraph::Access& access : p.accesses )
+        {
+            if( access.write && ( graph.GetResource( access.resource ).flags & GRAPH_RESOURCE_OUTPUT ) )
+                kept[pass] = 1;
+        }
+    }
+    for( size_t i = edges.size(); i-- > 0; )
+    {
+        //? A kept pass needs whatever it reads, and what an earlier write left that a
+        //? partial write does not cover; a reader that came first does not matter to it
+        const Edge& edge = edges[i];
+        if( edge.kind != EDGE_WRITE_AFTER_READ && kept[edge.to] )
+            kept[edge.from] = 1;
+    }
+
+    std::vector<std::vector<size_t>> successors( passCount );
+    std::vector<size_t> pending( passCount, 0 );
+    for( const Edge& edge : edges )
+    {
+        if( !kept[edge.from] || !kept[edge.to] )
+            continue;
+        successors[edge.from].push_back( edge.to );
+        ++pending[edge.to];
+        ++schedule.stats.edges;
+        if( graph.GetPass( edge.from ).device != graph.GetPass( edge.to ).device )
+            ++schedule.stats.crossDeviceEdges;
+    }
+
+    //? Ordering: of the passes that are ready, the earliest declared on the device that
+    //? ran last, else the earliest declared on any device
+    uint32_t deviceCount = 0;
+    for( size_t pass = 0; pass < passCount; ++pass )
+        deviceCount = std::max( deviceCount, graph.GetPass( pass ).device + 1 );
+
+    typedef std::priority_queue<size_t, std::vector<size_t>, std::greater<size_t>> ReadyQueue;
+    std::vector<ReadyQueue> ready( deviceCount );
+    for( size_t pass = 0; pass < passCount; ++pass )
+    {
+        if( !kept[pass] )
+        {
+            schedule.culled[pass] = 1;
+            ++schedule.stats.culled;
+        }
+        else if( pending[pass] == 0 )
+        {
+            ready[graph.GetPass( pass ).device].push( pass );
+        }
+    }
+
+    uint32_t current = 0;
+    schedule.order.reserve( passCount - schedule.stats.culled );
+    for( ;; )
+    {
+        if( ready[current].empty() )
+        {
+            size_t earliest = kNone;
+            for( uint32_t device = 0; device < deviceCount; ++device )
+            {
+                if( !ready[device].empty() && ( earliest == kNone || ready[device].top() < earliest ) )
+                {
+                    earliest = ready[device].top();
+                    current = device;
+                }
+            }
+            if( earliest == kNone )
+                break;
+        }
+
+        const size_t pass = ready[current].top();
+        ready[current].pop();
+        schedule.order.push_back( pass );
+        for( size_t next : successors[pass] )
+        {
+            if( --pending[next] == 0 )
+                ready[graph.GetPass( next ).device].push( next );
+        }
+    }
+
+    //? Shared resources: every run of passes using one on the same device waits before
+    //? its first pass and signals after its last
+    std::vector<std::vector<size_t>> waitsBefore( passCount );
+    std::vector<std::vector<size_t>> signalsAfter( passCount );
+    std::vector<size_t> runLast( graph.ResourceCount(), kNone );
+    for( size_t pass : schedule.order )
+    {
+        const RenderGraph::Pass& p = graph.GetPass( pass );
+        for( const RenderGraph::Access& access : p.accesses )
+        {
+            if( !( graph.GetResource( access.resource ).flags & GRAPH_RESOURCE_SHARED ) )
+                continue;
+            size_t& last = runLast[access.resource];
+            if( last == pass )
+                continue;
+            if( last != kNone && graph.GetPass( last ).device == p.device )
+            {
+                last = pass;
+                continue;
+            }
+            if( last != kNone )
+                signalsAfter[last].push_back( access.resource );
+            waitsBefore[pass].push_back( access.resource );
+            last = pass;
+        }
+    }
+    for( size_t resource = 0; resource < runLast.size(); ++resource )
+    {
+        if( runLast[resource] != kNone )
+            signalsAfter[runLast[resource]].push_back( resource );
+    }
+
+    std::vector<uint8_t> unflushed( deviceCount, 0 );
+    for( size_t pass : schedule.order )
+    {
+        const uint32_t device = graph.GetPass( pass ).device;
+        for( size_t resource : waitsBefore[pass] )
+        {
+            schedule.steps.push_back( RenderStep{ RENDER_STEP_WAIT, device, resource } );
+            ++schedule.stats.waits;
+        }
+
+        schedule.steps.push_back( RenderStep{ RENDER_STEP_PASS, device, pass } );
+        unflushed[device] = 1;
+
+        if( signalsAfter[pass].empty() )
+            continue;
+        if( !options.signalFlushes && unflushed[device] )
+        {
+            schedule.steps.push_back( RenderStep{ RENDER_STEP_FLUSH, device, 0 } );
+            ++schedule.stats.flushes;
+        }
+        unflushed[device] = 0;
+        for( size_t resource : signalsAfter[pass] )
+        {
+            schedule.steps.push_back( RenderStep{ RENDER_STEP_SIGNAL, device, resource } );
+            ++schedule.stats.signals;
+        }
+    }
+
+    schedule.stats.compileMs = std::chrono::duration<double, std::milli>( std::chrono::steady_clock::now() - start ).count();
+    return schedule.Ok();
+}
+
+std::string RenderSchedule::Format( const RenderGraph& graph ) const
+{
+    std::string text;
+    for( const RenderStep& step : steps )
+    {
+        text += std::to_string( step.device ) + ": " + StepName( step.kind );
+        if( step.kind == RENDER_STEP_PASS )
+            text += " " + graph.GetPass( step.index ).name;
+        else if( step.kind != RENDER_STEP_FLUSH )
+            text += " " + graph.GetResource( step.index ).name;
+        text += "\n";
+    }
+    for( const std::string& error : errors )
+        text += "error: " + error + "\n";
+    return text;
+}
+
+std::string RenderSchedule::FormatStats() const
+{
+    char line[224];
+    snprintf( line, sizeof( line ), "Render graph: %zu passes, %zu culled, %zu dependencies (%zu across devices), %zu waits, %zu signals, %zu flushes, compiled in %.3f ms\n",
+              stats.passes, stats.culled, stats.edges, stats.crossDeviceEdges, stats.waits, stats.signals, stats.flushes, stats.compileMs );
+    return line;
+}
+
+//--------------------------------------------------------------------------------------
+void ExecuteRenderSchedule( const RenderSchedule& schedule, uint32_t device, IRenderGraphBackend& backend )
+{
+    for( const RenderStep& step : schedule.steps )
+    {
+        if( step.device != device )
+            continue;
+        switch( step.kind )
+        {
+        case RENDER_STEP_PASS:      backend.RunPass( step.index ); break;
+        case RENDER_STEP_WAIT:      backend.Wait( step.index ); break;
+        case RENDER_STEP_SIGNAL:    backend.Signal( step.index ); break;
+        case RENDER_STEP_FLUSH:     backend.Flush(); break;
+        }
+    }
+}
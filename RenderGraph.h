@@ -0,0 +1,150 @@
+//--------------------------------------------------------------------------------------
+// File: RenderGraph.h
+//
+// Declarative frame description. Passes run on a device and declare which resources
+// they read and write; CompileRenderGraph() turns that into a schedule:
+//
+//  - passes whose results nobody uses are culled: a pass is kept if it has side effects
+//    (presents), writes an output resource (one read after the frame) or writes
+//    something a kept pass reads;
+//  - the kept passes are ordered by their dependencies, staying on one device for as
+//    long as its dependencies allow so that devices hand over resources as rarely as
+//    possible;
+//  - a shared resource (a surface opened on several devices) is taken with a wait
+//    before each run of passes using it on one device and handed back with a signal
+//    right after the run. A device flushes before signalling only if the signal does
+//    not submit its work by itself and it submitted work since its last flush.
+//
+// Within a device the API orders everything else itself, so no other barriers are
+// emitted. ExecuteRenderSchedule() walks one device's steps and hands them to an
+// IRenderGraphBackend, so each device can be driven from its own thread.
+//
+// Only the standard library is used.
+//--------------------------------------------------------------------------------------
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+
+enum RenderGraphResourceFlags : uint32_t
+{
+    GRAPH_RESOURCE_SHARED = 1,      // opened on several devices; handed over with a wait and a signal
+    GRAPH_RESOURCE_OUTPUT = 2,      // used after the frame (read back, shown), so its writers are kept
+};
+
+class RenderGraph
+{
+public:
+    struct Resource
+    {
+        std::string name;
+        uint32_t    flags = 0;
+    };
+
+    struct Access
+    {
+        size_t      resource;
+        bool        write;
+    };
+
+    struct Pass
+    {
+        std::string         name;
+        uint32_t            device = 0;
+        bool                sideEffects = false;
+        std::vector<Access> accesses;
+    };
+
+    void Clear();
+
+    size_t AddResource( const char* name, uint32_t flags = 0 );
+
+    // Passes are declared in the order they would run; a read sees the latest write
+    // declared before it
+    size_t AddPass( const char* name, uint32_t device, bool sideEffects = false );
+
+    void Read( size_t pass, size_t resource ) { m_passes[pass].accesses.push_back( Access{ resource, false } ); }
+    void Write( size_t pass, size_t resource ) { m_passes[pass].accesses.push_back( Access{ resource, true } ); }
+
+    size_t PassCount() const noexcept { return m_passes.size(); }
+    size_t ResourceCount() const noexcept { return m_resources.size(); }
+    const Pass& GetPass( size_t pass ) const { return m_passes[pass]; }
+    const Resource& GetResource( size_t resource ) const { return m_resources[resource]; }
+
+private:
+    std::vector<Pass>       m_passes;
+    std::vector<Resource>   m_resources;
+};
+
+enum RenderStepKind : uint8_t
+{
+    RENDER_STEP_PASS,
+    RENDER_STEP_WAIT,       // the device takes a shared resource
+    RENDER_STEP_SIGNAL,     // the device hands a shared resource back
+    RENDER_STEP_FLUSH,      // the device submits what it recorded so far
+};
+
+struct RenderStep
+{
+    RenderStepKind  kind = RENDER_STEP_PASS;
+    uint32_t        device = 0;
+    size_t          index = 0;          // the pass, or the resource of a wait or signal
+};
+
+struct RenderGraphOptions
+{
+    // Signalling a shared resource submits the device's work (keyed mutexes do), so no
+    // flush has to precede it
+    bool    signalFlushes = false;
+};
+
+struct RenderSchedule
+{
+    struct Stats
+    {
+        size_t      passes = 0;
+        size_t      culled = 0;
+        size_t      edges = 0;              // dependencies between kept passes
+        size_t      crossDeviceEdges = 0;
+        size_t      waits = 0;
+        size_t      signals = 0;
+        size_t      flushes = 0;
+        double      compileMs = 0.0;
+    };
+
+    std::vector<size_t>         order;      // kept passes in the order they run
+    std::vector<uint8_t>        culled;     // per pass
+    std::vector<RenderStep>     steps;      // all devices, in a valid global order
+    std::vector<std::string>    errors;     // the graph cannot run as declared
+    Stats                       stats;
+
+    bool Ok() const noexcept { return errors.empty(); }
+
+    // One line per step, "<device>: <step>", for logs and for comparing schedules
+    std::string Format( const RenderGraph& graph ) const;
+
+    // One line: passes, culling, synchronization and compile time
+    std::string FormatStats() const;
+};
+
+// Compiles 'graph' into 'schedule'. False, with schedule.errors filled in, if a resource
+// that is not shared is used on several devices.
+bool CompileRenderGraph( const RenderGraph& graph, RenderSchedule& schedule, const RenderGraphOptions& options = RenderGraphOptions() );
+
+class IRenderGraphBackend
+{
+public:
+    virtual ~IRenderGraphBackend() = default;
+
+    virtual void RunPass( size_t pass ) = 0;
+    virtual void Wait( size_t resource ) = 0;
+    virtual void Signal( size_t resource ) = 0;
+    virtual void Flush() = 0;
+};
+
+// Runs the steps of one device in order
+void ExecuteRenderSchedule( const RenderSchedule& schedule, uint32_t device, IRenderGraphBackend& backend );
@@ -0,0 +1,164 @@
+//--------------------------------------------------------------------------------------
+// File: RenderTargetPool.cpp
+//
+// Pool of render targets keyed by size, format and usage
+//--------------------------------------------------------------------------------------
+
+#include "RenderTargetPool.h"
+
+#include <cstdio>
+
+
+namespace
+{
+    const uint32_t kMinBucketStep = 32;
+}
+
+//--------------------------------------------------------------------------------------
+uint32_t BucketTargetSize( uint32_t size ) noexcept
+{
+    if( size == 0 )
+        return 0;
+
+    uint32_t power = 1;
+    while( power <= size / 2 )
+        power *= 2;
+
+    const uint32_t step = power / 8 > kMinBucketStep ? power / 8 : kMinBucketStep;
+    const uint64_t rounded = ( uint64_t( size ) + step - 1 ) / step * step;
+    return rounded > UINT32_MAX ? size : uint32_t( rounded );
+}
+
+//--------------------------------------------------------------------------------------
+RenderTargetPool::RenderTargetPool( IRenderTargetAllocator& allocator, uint64_t freeBudgetBytes ) :
+    m_allocator( allocator ),
+    m_freeBudget( freeBudgetBytes )
+{
+}
+
+RenderTargetPool::~RenderTargetPool()
+{
+    for( size_t i = 0; i < m_entries.size(); ++i )
+    {
+        if( m_entries[i].state != ENTRY_UNUSED )
+            m_allocator.DestroyTarget( i );
+    }
+}
+
+size_t RenderTargetPool::Acquire( const RenderTargetKey& key, bool bucketed )
+{
+    ++m_stats.acquires;
+
+    RenderTargetKey wanted = key;
+    if( bucketed )
+    {
+        wanted.width = BucketTargetSize( key.width );
+        wanted.height = BucketTargetSize( key.height );
+    }
+
+    //? The most recently released match is the likeliest to still be warm
+    size_t best = kInvalidEntry;
+    for( size_t i = 0; i < m_entries.size(); ++i )
+    {
+        const Entry& entry = m_entries[i];
+        if( entry.state == ENTRY_FREE && entry.key == wanted && ( best == kInvalidEntry || entry.lastUse > m_entries[best].lastUse ) )
+            best = i;
+    }
+    if( best != kInvalidEntry )
+    {
+        Entry& entry = m_entries[best];
+        entry.state = ENTRY_LIVE;
+        m_stats.freeBytes -= entry.bytes;
+        m_stats.liveBytes += entry.bytes;
+        ++m_stats.reused;
+        return best;
+    }
+
+    size_t index = 0;
+    while( index < m_entries.size() && m_entries[index].state != ENTRY_UNUSED )
+        ++index;
+    if( index == m_entries.size() )
+        m_entries.emplace_back();
+
+    uint64_t bytes = 0;
+    if( !m_allocator.CreateTarget( index, wanted, &bytes ) )
+    {
+        ++m_stats.failed;
+        return kInvalidEntry;
+    }
+
+    Entry& entry = m_entries[index];
+    entry.key = wanted;
+    entry.bytes = bytes;
+    entry.state = ENTRY_LIVE;
+    m_stats.liveBytes += bytes;
+    ++m_stats.created;
+    if( m_stats.liveBytes + m_stats.freeBytes > m_stats.peakBytes )
+        m_stats.peakBytes = m_stats.liveBytes + m_stats.freeBytes;
+    return index;
+}
+
+void RenderTargetPool::Release( size_t entry )
+{
+    if( entry >= m_entries.size() || m_entries[entry].state != ENTRY_LIVE )
+        return;
+
+    Entry& released = m_entries[entry];
+    released.state = ENTRY_FREE;
+    released.lastUse = ++m_useCounter;
+    m_stats.liveBytes -= released.bytes;
+    m_stats.freeBytes += released.bytes;
+
+    Trim( m_freeBudget );
+}
+
+void RenderTargetPool::Trim( uint64_t budgetBytes )
+{
+    while( m_stats.freeBytes > budgetBytes )
+    {
+        size_t oldest = kInvalidEntry;
+        for( size_t i = 0; i < m_entries.size(); ++i )
+        {
+            if( m_entries[i].state == ENTRY_FREE && ( oldest == kInvalidEntry || m_entries[i].lastUse < m_entries[oldest].lastUse ) )
+                oldest = i;
+        }
+        if( oldest == kInvalidEntry )
+            break;
+
+        m_stats.freeBytes -= m_entries[oldest].bytes;
+        Destroy( oldest );
+        ++m_stats.evicted;
+    }
+}
+
+void RenderTargetPool::Destroy( size_t entry )
+{
+    m_allocator.DestroyTarget( entry );
+    m_entries[entry] = Entry();
+}
+
+size_t RenderTargetPool::LiveCount() const noexcept
+{
+    size_t count = 0;
+    for( const Entry& entry : m_entries )
+        count += entry.state == ENTRY_LIVE;
+    return count;
+}
+
+size_t RenderTargetPool::FreeCount() const noexcept
+{
+    size_t count = 0;
+    for( const Entry& entry : m_entries )
+        count += entry.state == ENTRY_FREE;
+    return count;
+}
+
+std::string RenderTargetPool::Format() const
+{
+    char line[200];
+    snprintf( line, sizeof( line ), "Target pool: %llu acquires, %llu reused, %llu created, %llu evicted; %.1f MB live, %.1f MB free, %.1f MB peak\n",
+              static_cast<unsigned long long>( m_stats.acquires ), static_cast<unsigned long long>( m_stats.reused ),
+              static_cast<unsigned long long>( m_stats.created ), static_cast<unsigned long long>( m_stats.evicted ),
+              m_stats.liveBytes / ( 1024.0 * 1024.0 ), m_stats.freeBytes / ( 1024.0 * 1024.0 ), m_stats.peakBytes / ( 1024.0 * 1024.0 ) );
+    return line;
+}
@@ -0,0 +1,122 @@
+//--------------------------------------------------------------------------------------
+// File: RenderTargetPool.h
+//
+// Pool of render targets keyed by size, format and usage. Released targets are kept
+// and handed out again to the next request with the same key, so a window resized
+// back and forth, or toggled in and out of fullscreen, reuses what it had instead of
+// allocating on every change. Targets that only have to be at least as large as what
+// is drawn into them (depth buffers) can be requested bucketed: the size is rounded up
+// so nearby sizes share one target.
+//
+// Released targets above a byte budget are destroyed, least recently used first. The
+// pool only talks to an IRenderTargetAllocator, so the bookkeeping is the same for
+// D3D11 textures and for any CPU-side stand-in.
+//--------------------------------------------------------------------------------------
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+
+struct RenderTargetKey
+{
+    uint32_t    width = 0;
+    uint32_t    height = 0;
+    uint32_t    format = 0;         // backend format, e.g. a DXGI_FORMAT
+    uint32_t    bindFlags = 0;      // backend usage, e.g. D3D11_BIND_* flags
+
+    bool operator==( const RenderTargetKey& other ) const noexcept
+    {
+        return width == other.width && height == other.height && format == other.format && bindFlags == other.bindFlags;
+    }
+};
+
+class IRenderTargetAllocator
+{
+public:
+    virtual ~IRenderTargetAllocator() = default;
+
+    // Creates the target behind pool entry 'entry' and reports its size in bytes
+    virtual bool CreateTarget( size_t entry, const RenderTargetKey& key, uint64_t* bytes ) = 0;
+
+    virtual void DestroyTarget( size_t entry ) = 0;
+};
+
+// Size a bucketed request is rounded up to: a multiple of 1/8 of the largest power of
+// two not above it (at least 32), so a bucket wastes at most about 12.5% per dimension
+uint32_t BucketTargetSize( uint32_t size ) noexcept;
+
+class RenderTargetPool
+{
+public:
+    static const size_t kInvalidEntry = SIZE_MAX;
+
+    struct Stats
+    {
+        uint64_t    acquires = 0;
+        uint64_t    reused = 0;         // served from a released target
+        uint64_t    created = 0;
+        uint64_t    failed = 0;         // the allocator could not create the target
+        uint64_t    evicted = 0;        // released targets destroyed to stay within the budget
+        uint64_t    liveBytes = 0;      // targets handed out
+        uint64_t    freeBytes = 0;      // released targets kept for reuse
+        uint64_t    peakBytes = 0;      // largest liveBytes + freeBytes seen
+    };
+
+    // freeBudgetBytes: how much memory released targets may hold
+    RenderTargetPool( IRenderTargetAllocator& allocator, uint64_t freeBudgetBytes );
+    ~RenderTargetPool();
+
+    RenderTargetPool( const RenderTargetPool& ) = delete;
+    RenderTargetPool& operator=( const RenderTargetPool& ) = delete;
+
+    // Returns the entry of a target for 'key', reusing a released one when possible.
+    // bucketed: the target may be larger than asked for; Key() has its actual size.
+    // kInvalidEntry if the allocator fails.
+    size_t Acquire( const RenderTargetKey& key, bool bucketed = false );
+
+    // Hands a target back; it stays allocated for reuse until evicted
+    void Release( size_t entry );
+
+    const RenderTargetKey& Key( size_t entry ) const { return m_entries[entry].key; }
+
+    // Destroys released targets, least recently used first, until they hold no more
+    // than 'budgetBytes'. Trim( 0 ) drops every released target.
+    void Trim( uint64_t budgetBytes );
+
+    uint64_t FreeBudget() const noexcept { return m_freeBudget; }
+    size_t LiveCount() const noexcept;
+    size_t FreeCount() const noexcept;
+
+    const Stats& GetStats() const noexcept { return m_stats; }
+
+    // One line: hits, allocations and memory
+    std::string Format() const;
+
+private:
+    enum EntryState : uint8_t
+    {
+        ENTRY_UNUSED,       // no target; the index may be reused
+        ENTRY_LIVE,
+        ENTRY_FREE,
+    };
+
+    struct Entry
+    {
+        RenderTargetKey key;
+        uint64_t        bytes = 0;
+        uint64_t        lastUse = 0;    // m_useCounter at the last release
+        EntryState      state = ENTRY_UNUSED;
+    };
+
+    void Destroy( size_t entry );
+
+    IRenderTargetAllocator& m_allocator;
+    uint64_t                m_freeBudget;
+    uint64_t                m_useCounter = 0;
+    std::vector<Entry>      m_entries;
+    Stats                   m_stats;
+};
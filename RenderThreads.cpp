@@ -0,0 +1,289 @@
+//--------------------------------------------------------------------------------------
+// File: RenderThreads.cpp
+//
+// Threading scaffolding for the producer and consumer render threads
+//--------------------------------------------------------------------------------------
+
+#include "RenderThreads.h"
+#include "CpuTrace.h"
+
+#include <cstdio>
+
+
+//--------------------------------------------------------------------------------------
+FrameSlotRing::FrameSlotRing( size_t slotCount ) :
+    m_slotCount( slotCount ? slotCount : 1 ),
+    m_free( m_slotCount ),
+    m_ready( m_slotCount ),
+    m_published( 0 ),
+    m_consumed( 0 ),
+    m_producerStalls( 0 ),
+    m_consumerStalls( 0 )
+{
+    for( size_t i = 0; i < m_slotCount; ++i )
+        m_free.Push( i );
+}
+
+bool FrameSlotRing::AcquireForWrite( size_t& slot )
+{
+    bool waited = false;
+    if( !m_free.Pop( slot, &waited ) )
+        return false;
+    if( waited )
+        m_producerStalls.fetch_add( 1, std::memory_order_relaxed );
+    std::lock_guard<std::mutex> lock( m_heldMutex );
+    ++m_held;
+    return true;
+}
+
+void FrameSlotRing::Publish( size_t slot )
+{
+    if( m_ready.Push( slot ) )
+        m_published.fetch_add( 1, std::memory_order_relaxed );
+}
+
+bool FrameSlotRing::AcquireForRead( size_t& slot )
+{
+    bool waited = false;
+    if( !m_ready.Pop( slot, &waited ) )
+        return false;
+    if( waited )
+        m_consumerStalls.fetch_add( 1, std::memory_order_relaxed );
+    return true;
+}
+
+void FrameSlotRing::Release( size_t slot )
+{
+    if( !m_free.Push( slot ) )
+        return;
+    m_consumed.fetch_add( 1, std::memory_order_relaxed );
+    {
+        std::lock_guard<std::mutex> lock( m_heldMutex );
+        --m_held;
+    }
+    m_allFree.notify_all();
+}
+
+bool FrameSlotRing::WaitDrained()
+{
+    std::unique_lock<std::mutex> lock( m_heldMutex );
+    m_allFree.wait( lock, [this] { return m_closed || m_held == 0; } );
+    return !m_closed;
+}
+
+void FrameSlotRing::Close()
+{
+    m_free.Close();
+    m_ready.Close();
+    {
+        std::lock_guard<std::mutex> lock( m_heldMutex );
+        m_closed = true;
+    }
+    m_allFree.notify_all();
+}
+
+void FrameSlotRing::Reset()
+{
+    m_free.Reopen();
+    m_ready.Reopen();
+    for( size_t i = 0; i < m_slotCount; ++i )
+        m_free.Push( i );
+    std::lock_guard<std::mutex> lock( m_heldMutex );
+    m_held = 0;
+    m_closed = false;
+}
+
+FrameSlotRing::Stats FrameSlotRing::GetStats() const noexcept
+{
+    Stats stats;
+    stats.published = m_published.load( std::memory_order_relaxed );
+    stats.consumed = m_consumed.load( std::memory_order_relaxed );
+    stats.producerStalls = m_producerStalls.load( std::memory_order_relaxed );
+    stats.consumerStalls = m_consumerStalls.load( std::memory_order_relaxed );
+    return stats;
+}
+
+//--------------------------------------------------------------------------------------
+void RenderThread::Start( std::function<bool()> frame )
+{
+    Join();
+    m_stop.store( false, std::memory_order_relaxed );
+    m_thread = std::thread( [this, frame]
+    {
+        while( !m_stop.load( std::memory_order_relaxed ) )
+        {
+            if( !frame() )
+                break;
+            m_frames.fetch_add( 1, std::memory_order_relaxed );
+        }
+    } );
+}
+
+void RenderThread::Join()
+{
+    if( m_thread.joinable() )
+        m_thread.join();
+}
+
+//--------------------------------------------------------------------------------------
+WorkerPool::WorkerPool( size_t threadCount ) :
+    m_created( std::chrono::steady_clock::now() )
+{
+    if( threadCount == 0 )
+        threadCount = 1;
+    for( size_t i = 0; i < threadCount; ++i )
+        m_threads.emplace_back( &WorkerPool::WorkerLoop, this, uint32_t( i ) );
+}
+
+WorkerPool::~WorkerPool()
+{
+    WaitAll();
+    {
+        std::lock_guard<std::mutex> lock( m_mutex );
+        m_stop = true;
+    }
+    m_workAvailable.notify_all();
+    for( std::thread& thread : m_threads )
+        thread.join();
+}
+
+double WorkerPool::Now() const
+{
+    return std::chrono::duration<double, std::milli>( std::chrono::steady_clock::now() - m_created ).count();
+}
+
+WorkerPool::JobId WorkerPool::Submit( std::string name, std::function<void()> job, std::vector<JobId> dependencies )
+{
+    std::unique_lock<std::mutex> lock( m_mutex );
+
+    const JobId id = m_jobs.size();
+    m_jobs.emplace_back();
+    Job& entry = m_jobs.back();
+    entry.run = std::move( job );
+    entry.timing.name = std::move( name );
+    entry.timing.submitMs = Now();
+
+    for( JobId dependency : dependencies )
+    {
+        if( dependency < id && !m_jobs[dependency].done )
+        {
+            m_jobs[dependency].dependents.push_back( id );
+            ++entry.pendingDependencies;
+        }
+    }
+    entry.timing.dependencies = std::move( dependencies );
+    ++m_unfinished;
+
+    if( entry.pendingDependencies == 0 )
+    {
+        m_ready.push_back( id );
+        lock.unlock();
+        m_workAvailable.notify_one();
+    }
+    return id;
+}
+
+void WorkerPool::Wait( JobId id )
+{
+    std::unique_lock<std::mutex> lock( m_mutex );
+    if( id >= m_jobs.size() )
+        return;
+    m_jobDone.wait( lock, [this, id] { return m_jobs[id].done; } );
+}
+
+void WorkerPool::WaitAll()
+{
+    std::unique_lock<std::mutex> lock( m_mutex );
+    m_jobDone.wait( lock, [this] { return m_unfinished == 0; } );
+}
+
+void WorkerPool::ClearHistory()
+{
+    std::unique_lock<std::mutex> lock( m_mutex );
+    m_jobDone.wait( lock, [this] { return m_unfinished == 0; } );
+    m_jobs.clear();
+}
+
+void WorkerPool::WorkerLoop( uint32_t worker )
+{
+    CpuTrace::SetThreadName( "Worker" );
+
+    std::unique_lock<std::mutex> lock( m_mutex );
+    for( ;; )
+    {
+        m_workAvailable.wait( lock, [this] { return m_stop || !m_ready.empty(); } );
+        if( m_ready.empty() )
+            return;
+
+        const JobId id = m_ready.front();
+        m_ready.pop_front();
+
+        std::function<void()> run = std::move( m_jobs[id].run );
+        m_jobs[id].timing.worker = worker;
+        m_jobs[id].timing.startMs = Now();
+
+        lock.unlock();
+        if( run )
+            run();
+        lock.lock();
+
+        Job& job = m_jobs[id];
+        job.timing.endMs = Now();
+        job.done = true;
+        --m_unfinished;
+
+        // Release whatever was only waiting for this job
+        size_t released = 0;
+        for( JobId dependent : job.dependents )
+        {
+            if( --m_jobs[dependent].pendingDependencies == 0 )
+            {
+                m_ready.push_back( dependent );
+                ++released;
+            }
+        }
+        if( released > 1 )
+            m_workAvailable.notify_all();
+        else if( released == 1 )
+            m_workAvailable.notify_one();
+        m_jobDone.notify_all();
+    }
+}
+
+std::vector<WorkerPool::JobTiming> WorkerPool::Timings() const
+{
+    std::lock_guard<std::mutex> lock( m_mutex );
+    std::vector<JobTiming> timings;
+    timings.reserve( m_jobs.size() );
+    for( const Job& job : m_jobs )
+        timings.push_back( job.timing );
+    return timings;
+}
+
+std::string WorkerPool::FormatReport( const std::vector<JobTiming>& timings )
+{
+    std::string out;
+    char line[256];
+    double first = 0.0, last = 0.0, serial = 0.0;
+
+    for( size_t i = 0; i < timings.size(); ++i )
+    {
+        const JobTiming& t = timings[i];
+        std::string deps;
+        for( JobId dependency : t.dependencies )
+            deps += ( deps.empty() ? " after " : "," ) + std::to_string( dependency );
+
+        snprintf( line, sizeof( line ), "  job %zu '%s' on worker %u: queued %.2f ms, ran %.2f ms (%.2f -> %.2f)%s\n",
+                  i, t.name.c_str(), t.worker, t.startMs - t.submitMs, t.endMs - t.startMs, t.startMs, t.endMs, deps.c_str() );
+        out += line;
+
+        first = i == 0 ? t.submitMs : ( t.submitMs < first ? t.submitMs : first );
+        last = t.endMs > last ? t.endMs : last;
+        serial += t.endMs - t.startMs;
+    }
+
+    const double wall = last - first;
+    snprintf( line, sizeof( line ), "Worker pool: %zu jobs, %.2f ms wall, %.2f ms serial (%.2fx)\n",
+              timings.size(), wall, serial, wall > 0.0 ? serial / wall : 1.0 );
+    return line + out;
+}
@@ -0,0 +1,264 @@
+//--------------------------------------------------------------------------------------
+// File: RenderThreads.h
+//
+// Threading scaffolding for driving the producer and consumer devices from their own
+// render threads: a bounded blocking queue, the slot ring the two threads hand shared
+// surfaces through, a small render thread wrapper, and a worker pool for one-off jobs
+// such as shader compilation.
+//
+// Only the standard library is used, so the handoff can be driven by any backend.
+//--------------------------------------------------------------------------------------
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+
+//? --------------------------------------------------------------------------------------
+//? Multi-producer/multi-consumer FIFO with a fixed capacity. Push blocks while the queue
+//? is full, Pop while it is empty; Close() wakes every waiter and makes both fail.
+//? --------------------------------------------------------------------------------------
+template <typename T>
+class BoundedQueue
+{
+public:
+    explicit BoundedQueue( size_t capacity ) : m_capacity( capacity ? capacity : 1 ), m_closed( false ) {}
+
+    BoundedQueue( const BoundedQueue& ) = delete;
+    BoundedQueue& operator=( const BoundedQueue& ) = delete;
+
+    // Returns false if the queue was closed. waited is set when the call had to block.
+    bool Push( const T& value, bool* waited = nullptr )
+    {
+        std::unique_lock<std::mutex> lock( m_mutex );
+        if( waited )
+            *waited = !m_closed && m_items.size() >= m_capacity;
+        m_notFull.wait( lock, [this] { return m_closed || m_items.size() < m_capacity; } );
+        if( m_closed )
+            return false;
+        m_items.push_back( value );
+        lock.unlock();
+        m_notEmpty.notify_one();
+        return true;
+    }
+
+    // Returns false once the queue is closed (pending items are discarded).
+    bool Pop( T& value, bool* waited = nullptr )
+    {
+        std::unique_lock<std::mutex> lock( m_mutex );
+        if( waited )
+            *waited = !m_closed && m_items.empty();
+        m_notEmpty.wait( lock, [this] { return m_closed || !m_items.empty(); } );
+        if( m_closed )
+            return false;
+        value = m_items.front();
+        m_items.pop_front();
+        lock.unlock();
+        m_notFull.notify_one();
+        return true;
+    }
+
+    bool TryPop( T& value )
+    {
+        std::unique_lock<std::mutex> lock( m_mutex );
+        if( m_closed || m_items.empty() )
+            return false;
+        value = m_items.front();
+        m_items.pop_front();
+        lock.unlock();
+        m_notFull.notify_one();
+        return true;
+    }
+
+    void Close()
+    {
+        {
+            std::lock_guard<std::mutex> lock( m_mutex );
+            m_closed = true;
+        }
+        m_notFull.notify_all();
+        m_notEmpty.notify_all();
+    }
+
+    void Reopen()
+    {
+        std::lock_guard<std::mutex> lock( m_mutex );
+        m_items.clear();
+        m_closed = false;
+    }
+
+    size_t Size() const
+    {
+        std::lock_guard<std::mutex> lock( m_mutex );
+        return m_items.size();
+    }
+
+private:
+    const size_t                m_capacity;
+    bool                        m_closed;
+    std::deque<T>               m_items;
+    mutable std::mutex          m_mutex;
+    std::condition_variable     m_notFull;
+    std::condition_variable     m_notEmpty;
+};
+
+//? --------------------------------------------------------------------------------------
+//? Ring of shared-surface slots. The producer takes a free slot, renders into it and
+//? publishes it; the consumer takes published slots in order and gives them back.
+//? Both sides block when they get ahead of the other, so at most slotCount frames are
+//? in flight and no frame is ever skipped.
+//? --------------------------------------------------------------------------------------
+class FrameSlotRing
+{
+public:
+    struct Stats
+    {
+        uint64_t    published = 0;
+        uint64_t    consumed = 0;
+        uint64_t    producerStalls = 0;     // producer waited for a free slot
+        uint64_t    consumerStalls = 0;     // consumer waited for a published slot
+    };
+
+    explicit FrameSlotRing( size_t slotCount );
+
+    size_t SlotCount() const noexcept { return m_slotCount; }
+
+    // Producer side
+    bool AcquireForWrite( size_t& slot );
+    void Publish( size_t slot );
+
+    // Consumer side
+    bool AcquireForRead( size_t& slot );
+    void Release( size_t slot );
+
+    // Producer side, between frames: blocks until the consumer gave every slot back, so
+    // neither side is in a frame and the consumer waits for the next publish. False if
+    // the ring was closed meanwhile.
+    bool WaitDrained();
+
+    // Wakes both sides and makes every acquire fail; used for shutdown.
+    void Close();
+
+    // Returns every slot to the free list after Close().
+    void Reset();
+
+    Stats GetStats() const noexcept;
+
+private:
+    const size_t                m_slotCount;
+    BoundedQueue<size_t>        m_free;
+    BoundedQueue<size_t>        m_ready;
+    std::mutex                  m_heldMutex;
+    std::condition_variable     m_allFree;
+    size_t                      m_held = 0;         // acquired for writing and not released yet
+    bool                        m_closed = false;
+    std::atomic<uint64_t>       m_published;
+    std::atomic<uint64_t>       m_consumed;
+    std::atomic<uint64_t>       m_producerStalls;
+    std::atomic<uint64_t>       m_consumerStalls;
+};
+
+//? --------------------------------------------------------------------------------------
+//? A thread that calls a frame function until it returns false or Stop() is called.
+//? --------------------------------------------------------------------------------------
+class RenderThread
+{
+public:
+    RenderThread() noexcept : m_stop( false ), m_frames( 0 ) {}
+    ~RenderThread() { Join(); }
+
+    RenderThread( const RenderThread& ) = delete;
+    RenderThread& operator=( const RenderThread& ) = delete;
+
+    void Start( std::function<bool()> frame );
+
+    // Asks the loop to exit after the current frame. Anything the frame function may
+    // be blocked on (e.g. a FrameSlotRing) has to be closed separately.
+    void RequestStop() noexcept { m_stop.store( true, std::memory_order_relaxed ); }
+
+    void Join();
+
+    bool Running() const noexcept { return m_thread.joinable(); }
+    uint64_t Frames() const noexcept { return m_frames.load( std::memory_order_relaxed ); }
+
+private:
+    std::thread             m_thread;
+    std::atomic<bool>       m_stop;
+    std::atomic<uint64_t>   m_frames;
+};
+
+//? --------------------------------------------------------------------------------------
+//? Fixed set of worker threads running a graph of one-off jobs. A job starts once every
+//? job it depends on has finished; Wait() joins a single job, WaitAll() the whole graph.
+//? Start and end times are kept per job for reporting.
+//? --------------------------------------------------------------------------------------
+class WorkerPool
+{
+public:
+    using JobId = size_t;
+
+    struct JobTiming
+    {
+        std::string         name;
+        std::vector<JobId>  dependencies;
+        uint32_t            worker = 0;
+        double              submitMs = 0.0;     // relative to pool creation
+        double              startMs = 0.0;
+        double              endMs = 0.0;
+    };
+
+    explicit WorkerPool( size_t threadCount );
+    ~WorkerPool();     // finishes every submitted job, then joins the workers
+
+    WorkerPool( const WorkerPool& ) = delete;
+    WorkerPool& operator=( const WorkerPool& ) = delete;
+
+    // Dependencies must have been submitted earlier
+    JobId Submit( std::string name, std::function<void()> job, std::vector<JobId> dependencies = std::vector<JobId>() );
+
+    void Wait( JobId id );
+    void WaitAll();
+
+    // Waits for every job, then forgets them so a pool reused every frame doesn't keep
+    // growing; JobIds start again from 0
+    void ClearHistory();
+
+    size_t ThreadCount() const noexcept { return m_threads.size(); }
+    std::vector<JobTiming> Timings() const;
+
+    // One line per job plus wall time against the serial sum
+    static std::string FormatReport( const std::vector<JobTiming>& timings );
+
+private:
+    struct Job
+    {
+        std::function<void()>   run;
+        std::vector<JobId>      dependents;
+        size_t                  pendingDependencies = 0;
+        bool                    done = false;
+        JobTiming               timing;
+    };
+
+    void WorkerLoop( uint32_t worker );
+    double Now() const;
+
+    std::vector<std::thread>                m_threads;
+    std::deque<Job>                         m_jobs;     // stable addresses, indexed by JobId
+    std::deque<JobId>                       m_ready;
+    size_t                                  m_unfinished = 0;
+    bool                                    m_stop = false;
+    std::chrono::steady_clock::time_point   m_created;
+    mutable std::mutex                      m_mutex;
+    std::condition_variable                 m_workAvailable;
+    std::condition_variable                 m_jobDone;
+};
@@ -0,0 +1,229 @@
+//--------------------------------------------------------------------------------------
+// File: ResourceTracker.cpp
+//
+// GPU memory accounting and leak tracking
+//--------------------------------------------------------------------------------------
+
+#include "ResourceTracker.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <map>
+
+
+namespace
+{
+    const char* KindName( ResourceKind kind )
+    {
+        return kind == RESOURCE_BUFFER ? "buffer" : "texture";
+    }
+
+    double Megabytes( int64_t bytes )
+    {
+        return double( bytes ) / ( 1024.0 * 1024.0 );
+    }
+}
+
+//--------------------------------------------------------------------------------------
+void ResourceTracker::SetRefCounts( IResourceRefCounts* refCounts )
+{
+    std::lock_guard<std::mutex> lock( m_mutex );
+    m_refCounts = refCounts;
+}
+
+bool ResourceTracker::Add( const void* object, ResourceKind kind, const char* owner, uint64_t bytes )
+{
+    std::lock_guard<std::mutex> lock( m_mutex );
+    TrackedResource& resource = m_live[object];
+    if( resource.id )
+        return false;
+
+    resource.id = m_nextId++;
+    resource.object = object;
+    resource.kind = kind;
+    resource.owner = owner;
+    resource.bytes = bytes;
+    resource.frame = m_frame.load( std::memory_order_relaxed );
+
+    ++m_stats.recorded;
+    ++m_stats.liveCount;
+    m_stats.liveBytes += bytes;
+    if( m_stats.liveBytes > m_stats.peakBytes )
+        m_stats.peakBytes = m_stats.liveBytes;
+    return true;
+}
+
+bool ResourceTracker::Remove( const void* object )
+{
+    //? See Snapshot(): objects may only go away on the thread reading their counts
+    assert( m_countingThread.load() == std::thread::id() || m_countingThread.load() == std::this_thread::get_id() );
+
+    std::lock_guard<std::mutex> lock( m_mutex );
+    auto it = m_live.find( object );
+    if( it == m_live.end() )
+        return false;
+
+    ++m_stats.removed;
+    --m_stats.liveCount;
+    m_stats.liveBytes -= it->second.bytes;
+    m_live.erase( it );
+    return true;
+}
+
+bool ResourceTracker::Contains( const void* object ) const
+{
+    std::lock_guard<std::mutex> lock( m_mutex );
+    return m_live.count( object ) != 0;
+}
+
+ResourceSnapshot ResourceTracker::Snapshot() const
+{
+    ResourceSnapshot snapshot;
+    IResourceRefCounts* refCounts = nullptr;
+    {
+        std::lock_guard<std::mutex> lock( m_mutex );
+        refCounts = m_refCounts;
+        snapshot.frame = m_frame.load( std::memory_order_relaxed );
+        snapshot.bytes = m_stats.liveBytes;
+        snapshot.resources.reserve( m_live.size() );
+        for( const auto& live : m_live )
+            snapshot.resources.push_back( live.second );
+    }
+
+    //? Outside the lock: should a count query drop the last reference, the destruction
+    //? comes back through Remove(). Only safe because no other thread releases these
+    //? objects meanwhile, which Remove() checks.
+    if( refCounts )
+    {
+        m_countingThread.store( std::this_thread::get_id() );
+        for( TrackedResource& resource : snapshot.resources )
+            resource.refCount = refCounts->RefCount( resource.object );
+        m_countingThread.store( std::thread::id() );
+    }
+
+    std::sort( snapshot.resources.begin(), snapshot.resources.end(),
+               []( const TrackedResource& a, const TrackedResource& b ) { return a.id < b.id; } );
+    return snapshot;
+}
+
+ResourceTracker::Stats ResourceTracker::GetStats() const
+{
+    std::lock_guard<std::mutex> lock( m_mutex );
+    return m_stats;
+}
+
+std::string ResourceTracker::FormatLive() const
+{
+    struct OwnerTotals
+    {
+        uint64_t    count = 0;
+        uint64_t    bytes = 0;
+    };
+    std::map<std::string, OwnerTotals> owners;
+    uint64_t liveBytes = 0;
+    {
+        std::lock_guard<std::mutex> lock( m_mutex );
+        for( const auto& live : m_live )
+        {
+            OwnerTotals& totals = owners[live.second.owner];
+            ++totals.count;
+            totals.bytes += live.second.bytes;
+        }
+        liveBytes = m_stats.liveBytes;
+    }
+    if( owners.empty() )
+        return std::string();
+
+    std::vector<std::pair<std::string, OwnerTotals>> sorted( owners.begin(), owners.end() );
+    std::stable_sort( sorted.begin(), sorted.end(),
+                      []( const std::pair<std::string, OwnerTotals>& a, const std::pair<std::string, OwnerTotals>& b ) { return a.second.bytes > b.second.bytes; } );
+
+    char line[160];
+    snprintf( line, sizeof( line ), "Resources: %zu owners, %.2f MB live\n", sorted.size(), Megabytes( int64_t( liveBytes ) ) );
+    std::string text = line;
+    for( const auto& owner : sorted )
+    {
+        snprintf( line, sizeof( line ), "  %-24s %4llu resources, %10.2f MB\n", owner.first.c_str(),
+                  static_cast<unsigned long long>( owner.second.count ), Megabytes( int64_t( owner.second.bytes ) ) );
+        text += line;
+    }
+    return text;
+}
+
+//--------------------------------------------------------------------------------------
+ResourceDiff DiffResourceSnapshots( const ResourceSnapshot& before, const ResourceSnapshot& after )
+{
+    ResourceDiff diff;
+    diff.frames = after.frame > before.frame ? after.frame - before.frame : 0;
+    diff.bytes = int64_t( after.bytes ) - int64_t( before.bytes );
+
+    //? Both lists are sorted by id, so one merge pass pairs them up
+    std::map<std::string, ResourceOwnerDelta> owners;
+    size_t b = 0;
+    size_t a = 0;
+    while( b < before.resources.size() || a < after.resources.size() )
+    {
+        const bool takeBefore = a == after.resources.size() || ( b < before.resources.size() && before.resources[b].id < after.resources[a].id );
+        const bool takeAfter = b == before.resources.size() || ( a < after.resources.size() && after.resources[a].id < before.resources[b].id );
+        if( takeBefore )
+        {
+            const TrackedResource& gone = before.resources[b++];
+            diff.destroyed.push_back( gone );
+            ResourceOwnerDelta& owner = owners[gone.owner];
+            --owner.count;
+            owner.bytes -= int64_t( gone.bytes );
+        }
+        else if( takeAfter )
+        {
+            const TrackedResource& added = after.resources[a++];
+            diff.created.push_back( added );
+            ResourceOwnerDelta& owner = owners[added.owner];
+            ++owner.count;
+            owner.bytes += int64_t( added.bytes );
+        }
+        else
+        {
+            const TrackedResource& earlier = before.resources[b++];
+            const TrackedResource& later = after.resources[a++];
+            if( later.refCount > earlier.refCount )
+            {
+                ResourceRefGrowth growth;
+                growth.resource = later;
+                growth.refsBefore = earlier.refCount;
+                diff.refGrowth.push_back( growth );
+            }
+        }
+    }
+
+    for( auto& owner : owners )
+    {
+        if( owner.second.count || owner.second.bytes )
+        {
+            owner.second.owner = owner.first;
+            diff.owners.push_back( owner.second );
+        }
+    }
+    return diff;
+}
+
+std::string ResourceDiff::Format() const
+{
+    char line[192];
+    snprintf( line, sizeof( line ), "Resource changes over %llu frames: %zu created, %zu destroyed, %+.2f MB, %zu gained references\n",
+              static_cast<unsigned long long>( frames ), created.size(), destroyed.size(), Megabytes( bytes ), refGrowth.size() );
+    std::string text = line;
+    for( const ResourceOwnerDelta& owner : owners )
+    {
+        snprintf( line, sizeof( line ), "  %-24s %+4lld resources, %+10.2f MB\n", owner.owner.c_str(),
+                  static_cast<long long>( owner.count ), Megabytes( owner.bytes ) );
+        text += line;
+    }
+    for( const ResourceRefGrowth& growth : refGrowth )
+    {
+        snprintf( line, sizeof( line ), "  %-24s %s #%llu: %u -> %u references\n", growth.resource.owner.c_str(),
+                  KindName( growth.resource.kind ), static_cast<unsigned long long>( growth.resource.id ),
+                  growth.refsBefore, growth.resource.refCount );
+        text += line;
+    }
+    return text;
+}
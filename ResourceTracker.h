@@ -0,0 +1,150 @@
+//--------------------------------------------------------------------------------------
+// File: ResourceTracker.h
+//
+// GPU memory accounting and leak tracking. Every texture and buffer a device creates is
+// recorded with its size in bytes and the tag of whoever owns it; snapshots add each
+// resource's current reference count. DiffResourceSnapshots() compares two snapshots,
+// so resources or references piling up from frame to frame show up as growth between
+// snapshots taken some frames apart, and whatever is still recorded after its owner
+// released everything is a leak.
+//
+// The backend records creations with Add(), reports destructions with Remove() and
+// answers reference-count queries through IResourceRefCounts; nothing in here depends
+// on the platform.
+//--------------------------------------------------------------------------------------
+
+#pragma once
+
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+
+enum ResourceKind : uint8_t
+{
+    RESOURCE_TEXTURE,
+    RESOURCE_BUFFER,
+};
+
+class IResourceRefCounts
+{
+public:
+    virtual ~IResourceRefCounts() = default;
+
+    // Current reference count of a recorded, live object
+    virtual uint32_t RefCount( const void* object ) = 0;
+};
+
+struct TrackedResource
+{
+    uint64_t        id = 0;             // recording order; never reused
+    const void*     object = nullptr;
+    ResourceKind    kind = RESOURCE_TEXTURE;
+    std::string     owner;
+    uint64_t        bytes = 0;
+    uint64_t        frame = 0;          // frame it was recorded in
+    uint32_t        refCount = 0;       // as of the snapshot; 0 without an IResourceRefCounts
+};
+
+struct ResourceSnapshot
+{
+    uint64_t                        frame = 0;
+    uint64_t                        bytes = 0;
+    std::vector<TrackedResource>    resources;      // live ones, by id
+};
+
+struct ResourceOwnerDelta
+{
+    std::string     owner;
+    int64_t         count = 0;
+    int64_t         bytes = 0;
+};
+
+struct ResourceRefGrowth
+{
+    TrackedResource resource;           // refCount is the later one
+    uint32_t        refsBefore = 0;
+};
+
+struct ResourceDiff
+{
+    uint64_t                        frames = 0;     // between the snapshots
+    int64_t                         bytes = 0;
+    std::vector<TrackedResource>    created;        // live in the later snapshot only
+    std::vector<TrackedResource>    destroyed;      // live in the earlier one only
+    std::vector<ResourceRefGrowth>  refGrowth;      // live in both, with more references later
+    std::vector<ResourceOwnerDelta> owners;         // owners whose count or bytes changed
+
+    // More resources, more bytes or more references than before
+    bool Grew() const noexcept { return bytes > 0 || created.size() > destroyed.size() || !refGrowth.empty(); }
+
+    // One summary line, then one line per owner and per resource that gained references
+    std::string Format() const;
+};
+
+// What changed from 'before' to 'after'. Resources are matched by id, so an object
+// destroyed and recreated at the same address counts as both.
+ResourceDiff DiffResourceSnapshots( const ResourceSnapshot& before, const ResourceSnapshot& after );
+
+class ResourceTracker
+{
+public:
+    struct Stats
+    {
+        uint64_t    recorded = 0;
+        uint64_t    removed = 0;
+        uint64_t    liveCount = 0;
+        uint64_t    liveBytes = 0;
+        uint64_t    peakBytes = 0;
+    };
+
+    explicit ResourceTracker( IResourceRefCounts* refCounts = nullptr ) : m_refCounts( refCounts ), m_frame( 0 ), m_countingThread( std::thread::id() ) {}
+
+    ResourceTracker( const ResourceTracker& ) = delete;
+    ResourceTracker& operator=( const ResourceTracker& ) = delete;
+
+    // nullptr once the objects can no longer be queried (e.g. their device is gone)
+    void SetRefCounts( IResourceRefCounts* refCounts );
+
+    // Records a live object. False if it is recorded already; the first record stands.
+    bool Add( const void* object, ResourceKind kind, const char* owner, uint64_t bytes );
+
+    // The object was destroyed. Any thread may call this.
+    bool Remove( const void* object );
+
+    bool Contains( const void* object ) const;
+
+    // Stamps later records and snapshots
+    void SetFrame( uint64_t frame ) noexcept { m_frame.store( frame, std::memory_order_relaxed ); }
+
+    // The live resources with their reference counts.
+    //
+    // Single thread only: call it from the one thread that releases the tracked objects
+    // (a device's render thread between frames), while no other thread holds or drops
+    // references to them. A reference count is read by adding and dropping a reference
+    // outside the lock, since the last release of an object comes back through Remove();
+    // an object another thread is destroying meanwhile would be revived and destroyed a
+    // second time. Debug builds assert that no other thread removes an object while the
+    // counts are read.
+    ResourceSnapshot Snapshot() const;
+
+    Stats GetStats() const;
+
+    // Live resources grouped by owner, most bytes first; empty when none are left
+    std::string FormatLive() const;
+
+private:
+    mutable std::mutex                                  m_mutex;
+    IResourceRefCounts*                                 m_refCounts;
+    std::atomic<uint64_t>                               m_frame;
+    mutable std::atomic<std::thread::id>                m_countingThread;   // Snapshot() reading counts; id(): none
+    uint64_t                                            m_nextId = 1;
+    std::unordered_map<const void*, TrackedResource>    m_live;
+    Stats                                               m_stats;
+};
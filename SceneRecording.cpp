@@ -0,0 +1,121 @@
+//--------------------------------------------------------------------------------------
+// File: SceneRecording.cpp
+//
+// Parallel command recording for scenes of many textured quads
+//--------------------------------------------------------------------------------------
+
+#include "SceneRecording.h"
+#include "RenderThreads.h"
+
+#include <atomic>
+#include <chrono>
+#include <string>
+
+
+namespace
+{
+    using Clock = std::chrono::steady_clock;
+
+    double MillisecondsSince( Clock::time_point start )
+    {
+        return std::chrono::duration<double, std::milli>( Clock::now() - start ).count();
+    }
+}
+
+//--------------------------------------------------------------------------------------
+std::vector<SceneChunk> SplitScene( size_t quadCount, size_t chunkQuads )
+{
+    if( chunkQuads == 0 )
+        chunkQuads = quadCount ? quadCount : 1;
+
+    std::vector<SceneChunk> chunks;
+    chunks.reserve( ( quadCount + chunkQuads - 1 ) / chunkQuads );
+    for( size_t first = 0; first < quadCount; first += chunkQuads )
+    {
+        SceneChunk chunk;
+        chunk.first = first;
+        chunk.count = quadCount - first < chunkQuads ? quadCount - first : chunkQuads;
+        chunks.push_back( chunk );
+    }
+    return chunks;
+}
+
+SceneSubmitStats SubmitScene( CommandRecorder& recorder, const std::vector<FrameConstants>& quads, size_t chunkQuads,
+                              WorkerPool* pool )
+{
+    const std::vector<SceneChunk> chunks = SplitScene( quads.size(), chunkQuads );
+
+    SceneSubmitStats stats;
+    stats.quads = quads.size();
+    stats.chunks = chunks.size();
+    stats.contexts = recorder.ContextCount() < chunks.size() ? recorder.ContextCount() : chunks.size();
+
+    const Clock::time_point start = Clock::now();
+    if( !recorder.BeginSubmission( chunks.size() ) )
+    {
+        stats.ok = false;
+        return stats;
+    }
+
+    // Each context records its chunks in order, so no context is used by two threads
+    std::atomic<bool> ok( true );
+    auto recordContext = [&]( size_t context )
+    {
+        for( size_t chunk = context; chunk < chunks.size(); chunk += stats.contexts )
+        {
+            if( !recorder.RecordChunk( context, chunk, quads.data() + chunks[chunk].first, chunks[chunk].count ) )
+                ok.store( false, std::memory_order_relaxed );
+        }
+    };
+
+    if( pool && stats.contexts > 1 )
+    {
+        for( size_t context = 0; context < stats.contexts; ++context )
+            pool->Submit( "record." + std::to_string( context ), [&recordContext, context] { recordContext( context ); } );
+        pool->ClearHistory();
+    }
+    else
+    {
+        for( size_t context = 0; context < stats.contexts; ++context )
+            recordContext( context );
+    }
+    stats.recordMs = MillisecondsSince( start );
+    stats.ok = ok.load();
+
+    const Clock::time_point execute = Clock::now();
+    recorder.ExecuteChunks();
+    stats.executeMs = MillisecondsSince( execute );
+    return stats;
+}
+
+//--------------------------------------------------------------------------------------
+bool SoftwareCommandRecorder::BeginSubmission( size_t chunkCount )
+{
+    m_chunks.assign( chunkCount, std::vector<Command>() );
+    return true;
+}
+
+bool SoftwareCommandRecorder::RecordChunk( size_t context, size_t chunk, const FrameConstants* quads, size_t count )
+{
+    if( context >= m_contextCount || chunk >= m_chunks.size() )
+        return false;
+
+    std::vector<Command>& commands = m_chunks[chunk];
+    commands.reserve( commands.size() + count );
+    for( size_t i = 0; i < count; ++i )
+    {
+        Command command;
+        command.context = context;
+        command.chunk = chunk;
+        command.constants = quads[i];
+        commands.push_back( command );
+    }
+    return true;
+}
+
+void SoftwareCommandRecorder::ExecuteChunks()
+{
+    for( std::vector<Command>& commands : m_chunks )
+        m_executed.insert( m_executed.end(), commands.begin(), commands.end() );
+    m_chunks.clear();
+}
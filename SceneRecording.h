@@ -0,0 +1,96 @@
+//--------------------------------------------------------------------------------------
+// File: SceneRecording.h
+//
+// Parallel command recording for scenes of many textured quads. The scene is split into
+// fixed-size chunks; each recording context records its share of the chunks on a
+// worker thread (context c takes chunks c, c + N, c + 2N, ...) and the recorded chunks
+// are then executed on the submitting thread strictly in chunk order, so the result
+// matches drawing the scene front to back on one thread.
+//
+// CommandRecorder is the backend side: D3D11CommandRecorder records into deferred
+// contexts and executes command lists, SoftwareCommandRecorder just keeps the
+// commands so the splitting and ordering can be checked without a GPU.
+//--------------------------------------------------------------------------------------
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "RenderDevice.h"
+
+
+class WorkerPool;
+
+struct SceneChunk
+{
+    size_t  first = 0;      // index of the first quad
+    size_t  count = 0;
+};
+
+// Splits quadCount quads into chunks of at most chunkQuads
+std::vector<SceneChunk> SplitScene( size_t quadCount, size_t chunkQuads );
+
+class CommandRecorder
+{
+public:
+    virtual ~CommandRecorder() = default;
+
+    // Recording contexts; each is only ever used by one thread at a time
+    virtual size_t ContextCount() const noexcept = 0;
+
+    // Starts a submission of chunkCount chunks
+    virtual bool BeginSubmission( size_t chunkCount ) = 0;
+
+    // Records one chunk of quads, each drawn with its own constants, on one context
+    virtual bool RecordChunk( size_t context, size_t chunk, const FrameConstants* quads, size_t count ) = 0;
+
+    // Executes every chunk of the submission, in chunk order
+    virtual void ExecuteChunks() = 0;
+};
+
+struct SceneSubmitStats
+{
+    size_t  quads = 0;
+    size_t  chunks = 0;
+    size_t  contexts = 0;
+    double  recordMs = 0.0;     // wall time until every chunk was recorded
+    double  executeMs = 0.0;
+    bool    ok = true;          // every chunk recorded
+};
+
+// Records the scene on the pool (inline without one, or with a single context) and
+// executes it. The pool's job history is cleared afterwards.
+SceneSubmitStats SubmitScene( CommandRecorder& recorder, const std::vector<FrameConstants>& quads, size_t chunkQuads,
+                              WorkerPool* pool );
+
+//? --------------------------------------------------------------------------------------
+//? Recorder without a backend: a chunk is a list of commands, executing appends them to
+//? one log
+//? --------------------------------------------------------------------------------------
+class SoftwareCommandRecorder : public CommandRecorder
+{
+public:
+    struct Command
+    {
+        size_t          context = 0;
+        size_t          chunk = 0;
+        FrameConstants  constants = {};
+    };
+
+    explicit SoftwareCommandRecorder( size_t contextCount ) : m_contextCount( contextCount ? contextCount : 1 ) {}
+
+    size_t ContextCount() const noexcept override { return m_contextCount; }
+    bool BeginSubmission( size_t chunkCount ) override;
+    bool RecordChunk( size_t context, size_t chunk, const FrameConstants* quads, size_t count ) override;
+    void ExecuteChunks() override;
+
+    const std::vector<Command>& Executed() const noexcept { return m_executed; }
+    void ClearExecuted() { m_executed.clear(); }
+
+private:
+    const size_t                        m_contextCount;
+    std::vector<std::vector<Command>>   m_chunks;
+    std::vector<Command>                m_executed;
+};
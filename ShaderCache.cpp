@@ -0,0 +1,385 @@
+//--------------------------------------------------------------------------------------
+// File: ShaderCache.cpp
+//
+// On-disk cache of compiled shader bytecode
+//--------------------------------------------------------------------------------------
+
+#include "ShaderCache.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+
+namespace
+{
+    const uint32_t kPackMagic = 0x50434853;     // 'SHCP'
+    const uint32_t kPackVersion = 1;
+
+    struct PackHeader
+    {
+        uint32_t    magic;
+        uint32_t    version;
+        uint32_t    compilerVersion;
+        uint32_t    entryCount;
+    };
+
+    using Clock = std::chrono::steady_clock;
+
+    double MillisecondsSince( Clock::time_point start )
+    {
+        return std::chrono::duration<double, std::milli>( Clock::now() - start ).count();
+    }
+
+    const uint64_t kFnvOffset = 14695981039346656037ull;
+    const uint64_t kFnvPrime = 1099511628211ull;
+
+    uint64_t Fnv1a( uint64_t hash, const void* data, size_t size ) noexcept
+    {
+        const uint8_t* bytes = static_cast<const uint8_t*>( data );
+        for( size_t i = 0; i < size; ++i )
+        {
+            hash ^= bytes[i];
+            hash *= kFnvPrime;
+        }
+        return hash;
+    }
+
+    // Strings are hashed with their terminator so ("ab", "c") and ("a", "bc") differ
+    uint64_t Fnv1aString( uint64_t hash, const char* s ) noexcept
+    {
+        return Fnv1a( hash, s ? s : "", ( s ? strlen( s ) : 0 ) + 1 );
+    }
+}
+
+uint64_t ShaderCacheKey( const char* source, const char* entryPoint, const char* target, uint64_t flags ) noexcept
+{
+    uint64_t hash = kFnvOffset;
+    hash = Fnv1aString( hash, source );
+    hash = Fnv1aString( hash, entryPoint );
+    hash = Fnv1aString( hash, target );
+    return Fnv1a( hash, &flags, sizeof( flags ) );
+}
+
+//? --------------------------------------------------------------------------------------
+//? Read-only file mapping
+//? --------------------------------------------------------------------------------------
+class MappedFile
+{
+public:
+    ~MappedFile() { Close(); }
+
+    bool Open( const std::string& path )
+    {
+#ifdef _WIN32
+        m_file = CreateFileA( path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr );
+        if( m_file == INVALID_HANDLE_VALUE )
+            return false;
+
+        LARGE_INTEGER size;
+        if( !GetFileSizeEx( m_file, &size ) || size.QuadPart == 0 )
+            return false;
+        m_size = size_t( size.QuadPart );
+
+        m_mapping = CreateFileMappingA( m_file, nullptr, PAGE_READONLY, 0, 0, nullptr );
+        if( !m_mapping )
+            return false;
+
+        m_data = static_cast<const uint8_t*>( MapViewOfFile( m_mapping, FILE_MAP_READ, 0, 0, 0 ) );
+        return m_data != nullptr;
+#else
+        m_fd = open( path.c_str(), O_RDONLY );
+        if( m_fd < 0 )
+            return false;
+
+        struct stat st;
+        if( fstat( m_fd, &st ) != 0 || st.st_size == 0 )
+            return false;
+        m_size = size_t( st.st_size );
+
+        void* data = mmap( nullptr, m_size, PROT_READ, MAP_PRIVATE, m_fd, 0 );
+        if( data == MAP_FAILED )
+            return false;
+        m_data = static_cast<const uint8_t*>( data );
+        return true;
+#endif
+    }
+
+    void Close()
+    {
+#ifdef _WIN32
+        if( m_data ) UnmapViewOfFile( m_data );
+        if( m_mapping ) CloseHandle( m_mapping );
+        if( m_file != INVALID_HANDLE_VALUE ) CloseHandle( m_file );
+        m_mapping = nullptr;
+        m_file = INVALID_HANDLE_VALUE;
+#else
+        if( m_data ) munmap( const_cast<uint8_t*>( m_data ), m_size );
+        if( m_fd >= 0 ) close( m_fd );
+        m_fd = -1;
+#endif
+        m_data = nullptr;
+        m_size = 0;
+    }
+
+    const uint8_t* Data() const noexcept { return m_data; }
+    size_t Size() const noexcept { return m_size; }
+
+private:
+#ifdef _WIN32
+    HANDLE          m_file = INVALID_HANDLE_VALUE;
+    HANDLE          m_mapping = nullptr;
+#else
+    int             m_fd = -1;
+#endif
+    const uint8_t*  m_data = nullptr;
+    size_t          m_size = 0;
+};
+
+//--------------------------------------------------------------------------------------
+ShaderCache::ShaderCache( uint32_t compilerVersion ) :
+    m_compilerVersion( compilerVersion )
+{
+}
+
+ShaderCache::~ShaderCache()
+{
+    CloseMapping();
+}
+
+void ShaderCache::CloseMapping()
+{
+    m_file.reset();
+    m_entries = nullptr;
+    m_entryCount = 0;
+}
+
+bool ShaderCache::Open( const std::string& path )
+{
+    std::lock_guard<std::mutex> lock( m_mutex );
+    m_path = path;
+    return MapPack();
+}
+
+bool ShaderCache::MapPack()
+{
+    CloseMapping();
+
+    std::unique_ptr<MappedFile> file( new MappedFile );
+    if( !file->Open( m_path ) || file->Size() < sizeof( PackHeader ) )
+        return false;
+
+    PackHeader header;
+    memcpy( &header, file->Data(), sizeof( header ) );
+    if( header.magic != kPackMagic || header.version != kPackVersion || header.compilerVersion != m_compilerVersion )
+        return false;
+
+    // Validate the whole index up front so lookups can trust it
+    const size_t indexEnd = sizeof( PackHeader ) + size_t( header.entryCount ) * sizeof( PackEntry );
+    if( indexEnd > file->Size() )
+        return false;
+
+    const PackEntry* entries = reinterpret_cast<const PackEntry*>( file->Data() + sizeof( PackHeader ) );
+    for( uint32_t i = 0; i < header.entryCount; ++i )
+    {
+        if( entries[i].offset < indexEnd || entries[i].offset + entries[i].size > file->Size() )
+            return false;
+        if( i > 0 && entries[i - 1].key >= entries[i].key )
+            return false;
+    }
+
+    m_file = std::move( file );
+    m_entries = entries;
+    m_entryCount = header.entryCount;
+    return true;
+}
+
+const ShaderCache::PackEntry* ShaderCache::FindMapped( uint64_t key ) const noexcept
+{
+    const PackEntry* end = m_entries + m_entryCount;
+    const PackEntry* it = std::lower_bound( m_entries, end, key,
+                                            []( const PackEntry& e, uint64_t k ) { return e.key < k; } );
+    return ( it != end && it->key == key ) ? it : nullptr;
+}
+
+bool ShaderCache::LookupLocked( uint64_t key, std::vector<uint8_t>& bytecode, uint32_t* compileUs )
+{
+    auto pending = m_pending.find( key );
+    if( pending != m_pending.end() )
+    {
+        bytecode = pending->second.bytecode;
+        if( compileUs ) *compileUs = pending->second.compileUs;
+        return true;
+    }
+
+    const PackEntry* entry = FindMapped( key );
+    if( !entry )
+        return false;
+
+    const uint8_t* data = m_file->Data() + entry->offset;
+    bytecode.assign( data, data + entry->size );
+    if( compileUs ) *compileUs = entry->compileUs;
+    return true;
+}
+
+bool ShaderCache::Lookup( uint64_t key, std::vector<uint8_t>& bytecode, uint32_t* compileUs )
+{
+    std::lock_guard<std::mutex> lock( m_mutex );
+    return LookupLocked( key, bytecode, compileUs );
+}
+
+void ShaderCache::Insert( uint64_t key, const uint8_t* data, size_t size, uint32_t compileUs )
+{
+    std::lock_guard<std::mutex> lock( m_mutex );
+    PendingEntry& entry = m_pending[key];
+    entry.bytecode.assign( data, data + size );
+    entry.compileUs = compileUs;
+}
+
+bool ShaderCache::GetOrCompile( const char* source, const char* entryPoint, const char* target, uint64_t flags,
+                                const CompileFn& compile, std::vector<uint8_t>& bytecode )
+{
+    const uint64_t key = ShaderCacheKey( source, entryPoint, target, flags );
+
+    const Clock::time_point lookupStart = Clock::now();
+    {
+        std::lock_guard<std::mutex> lock( m_mutex );
+        uint32_t compileUs = 0;
+        if( LookupLocked( key, bytecode, &compileUs ) )
+        {
+            ++m_stats.hits;
+            m_stats.lookupMs += MillisecondsSince( lookupStart );
+            m_stats.savedMs += compileUs / 1000.0;
+            return true;
+        }
+    }
+
+    const Clock::time_point compileStart = Clock::now();
+    const bool compiled = compile && compile( source, entryPoint, target, bytecode );
+    const double compileMs = MillisecondsSince( compileStart );
+
+    std::lock_guard<std::mutex> lock( m_mutex );
+    ++m_stats.misses;
+    m_stats.compileMs += compileMs;
+    if( !compiled )
+    {
+        ++m_stats.failures;
+        return false;
+    }
+
+    PendingEntry& entry = m_pending[key];
+    entry.bytecode = bytecode;
+    entry.compileUs = uint32_t( std::min( compileMs * 1000.0, double( UINT32_MAX ) ) );
+    return true;
+}
+
+bool ShaderCache::Save()
+{
+    std::lock_guard<std::mutex> lock( m_mutex );
+    if( m_pending.empty() || m_path.empty() )
+        return true;
+
+    // Merge the mapped and the new entries; both are ordered by key
+    struct Source
+    {
+        uint64_t        key;
+        const uint8_t*  data;
+        uint32_t        size;
+        uint32_t        compileUs;
+    };
+    std::vector<Source> merged;
+    merged.reserve( m_entryCount + m_pending.size() );
+    for( size_t i = 0; i < m_entryCount; ++i )
+    {
+        if( m_pending.find( m_entries[i].key ) == m_pending.end() )
+            merged.push_back( Source{ m_entries[i].key, m_file->Data() + m_entries[i].offset, m_entries[i].size, m_entries[i].compileUs } );
+    }
+    for( const auto& pending : m_pending )
+        merged.push_back( Source{ pending.first, pending.second.bytecode.data(), uint32_t( pending.second.bytecode.size() ), pending.second.compileUs } );
+    std::sort( merged.begin(), merged.end(), []( const Source& a, const Source& b ) { return a.key < b.key; } );
+
+    PackHeader header = { kPackMagic, kPackVersion, m_compilerVersion, uint32_t( merged.size() ) };
+    std::vector<PackEntry> index( merged.size() );
+    std::vector<uint8_t> blob( sizeof( PackHeader ) + index.size() * sizeof( PackEntry ) );
+    for( size_t i = 0; i < merged.size(); ++i )
+    {
+        index[i] = PackEntry{ merged[i].key, blob.size(), merged[i].size, merged[i].compileUs };
+        blob.insert( blob.end(), merged[i].data, merged[i].data + merged[i].size );
+    }
+    memcpy( blob.data(), &header, sizeof( header ) );
+    if( !index.empty() )
+        memcpy( blob.data() + sizeof( header ), index.data(), index.size() * sizeof( PackEntry ) );
+
+    // The mapping has to go before the file can be replaced
+    CloseMapping();
+
+    // Write next to the pack and swap it in; on failure the old pack is mapped again
+    const std::string tmp = m_path + ".tmp";
+    FILE* f = fopen( tmp.c_str(), "wb" );
+    bool written = f && fwrite( blob.data(), 1, blob.size(), f ) == blob.size();
+    if( f && fclose( f ) != 0 )
+        written = false;
+    if( !written )
+    {
+        remove( tmp.c_str() );
+        MapPack();
+        return false;
+    }
+
+    remove( m_path.c_str() );
+    if( rename( tmp.c_str(), m_path.c_str() ) != 0 )
+        return false;
+
+    // Serve further lookups from the new pack
+    m_pending.clear();
+    MapPack();
+    return true;
+}
+
+size_t ShaderCache::EntryCount() const
+{
+    std::lock_guard<std::mutex> lock( m_mutex );
+    size_t count = m_pending.size();
+    for( size_t i = 0; i < m_entryCount; ++i )
+    {
+        if( m_pending.find( m_entries[i].key ) == m_pending.end() )
+            ++count;
+    }
+    return count;
+}
+
+bool ShaderCache::Dirty() const
+{
+    std::lock_guard<std::mutex> lock( m_mutex );
+    return !m_pending.empty();
+}
+
+ShaderCache::Stats ShaderCache::GetStats() const
+{
+    std::lock_guard<std::mutex> lock( m_mutex );
+    return m_stats;
+}
+
+std::string ShaderCache::Format( const Stats& stats )
+{
+    char line[256];
+    snprintf( line, sizeof( line ),
+              "Shader cache: %llu hits, %llu misses (%llu failed), %.2f ms compiling, %.2f ms in lookups, ~%.2f ms saved\n",
+              static_cast<unsigned long long>( stats.hits ), static_cast<unsigned long long>( stats.misses ),
+              static_cast<unsigned long long>( stats.failures ), stats.compileMs, stats.lookupMs,
+              stats.savedMs - stats.lookupMs );
+    return line;
+}
@@ -0,0 +1,101 @@
+//--------------------------------------------------------------------------------------
+// File: ShaderCache.h
+//
+// On-disk cache of compiled shader bytecode. Entries are keyed by a 64-bit FNV-1a hash
+// of source, entry point, target profile and compile flags, and live in one pack file:
+//
+//   PackHeader | PackEntry[entryCount] (sorted by key) | bytecode blobs
+//
+// The pack is memory-mapped when opened, so a hit costs a binary search and a copy.
+// Misses are compiled through the caller's function and written back by Save().
+//--------------------------------------------------------------------------------------
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+
+uint64_t ShaderCacheKey( const char* source, const char* entryPoint, const char* target, uint64_t flags ) noexcept;
+
+class MappedFile;
+
+class ShaderCache
+{
+public:
+    struct Stats
+    {
+        uint64_t    hits = 0;
+        uint64_t    misses = 0;
+        uint64_t    failures = 0;       // misses the compiler could not build
+        double      compileMs = 0.0;    // spent compiling misses
+        double      lookupMs = 0.0;     // spent serving hits
+        double      savedMs = 0.0;      // what the hits took to compile when they were cached
+    };
+
+    using CompileFn = std::function<bool( const char* source, const char* entryPoint, const char* target,
+                                          std::vector<uint8_t>& bytecode )>;
+
+    // compilerVersion is stored in the pack; a pack from another compiler is ignored
+    explicit ShaderCache( uint32_t compilerVersion = 0 );
+    ~ShaderCache();
+
+    ShaderCache( const ShaderCache& ) = delete;
+    ShaderCache& operator=( const ShaderCache& ) = delete;
+
+    // Maps an existing pack. A missing or invalid file leaves the cache empty and still
+    // usable; Save() then creates it.
+    bool Open( const std::string& path );
+
+    // Returns cached bytecode or compiles, caches and returns it. Thread-safe; the
+    // compiler runs outside the lock.
+    bool GetOrCompile( const char* source, const char* entryPoint, const char* target, uint64_t flags,
+                       const CompileFn& compile, std::vector<uint8_t>& bytecode );
+
+    bool Lookup( uint64_t key, std::vector<uint8_t>& bytecode, uint32_t* compileUs = nullptr );
+    void Insert( uint64_t key, const uint8_t* data, size_t size, uint32_t compileUs );
+
+    // Writes the mapped and the newly compiled entries to the pack, if anything changed
+    bool Save();
+
+    size_t EntryCount() const;
+    bool Dirty() const;
+    Stats GetStats() const;
+
+    static std::string Format( const Stats& stats );
+
+private:
+    struct PackEntry
+    {
+        uint64_t    key;
+        uint64_t    offset;
+        uint32_t    size;
+        uint32_t    compileUs;
+    };
+
+    struct PendingEntry
+    {
+        std::vector<uint8_t>    bytecode;
+        uint32_t                compileUs;
+    };
+
+    bool MapPack();
+    const PackEntry* FindMapped( uint64_t key ) const noexcept;
+    bool LookupLocked( uint64_t key, std::vector<uint8_t>& bytecode, uint32_t* compileUs );
+    void CloseMapping();
+
+    const uint32_t                      m_compilerVersion;
+    std::string                         m_path;
+    std::unique_ptr<MappedFile>         m_file;
+    const PackEntry*                    m_entries = nullptr;
+    size_t                              m_entryCount = 0;
+    std::map<uint64_t, PendingEntry>    m_pending;
+    Stats                               m_stats;
+    mutable std::mutex                  m_mutex;
+};
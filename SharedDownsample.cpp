@@ -0,0 +1,218 @@
+//--------------------------------------------------------------------------------------
+// File: SharedDownsample.cpp
+//
+// Reduced shared surfaces: negotiation and CPU reference downsampling
+//--------------------------------------------------------------------------------------
+
+#include "SharedDownsample.h"
+
+#include <algorithm>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define SHARED_DOWNSAMPLE_SSE2 1
+#include <emmintrin.h>
+#endif
+
+
+//--------------------------------------------------------------------------------------
+SharedSurfaceDesc NegotiateSharedSurface( const ProducerSurfaceConfig& producer, const ConsumerSurfaceRequest& consumer ) noexcept
+{
+    SharedSurfaceDesc desc;
+    desc.scaleShift = std::min( std::min( producer.scaleShift, consumer.maxScaleShift ), kMaxSharedScaleShift );
+
+    // Never reduce below one pixel
+    while( desc.scaleShift > 0 &&
+           ( ( producer.width >> desc.scaleShift ) == 0 || ( producer.height >> desc.scaleShift ) == 0 ) )
+    {
+        --desc.scaleShift;
+    }
+
+    desc.width = std::max( producer.width >> desc.scaleShift, 1u );
+    desc.height = std::max( producer.height >> desc.scaleShift, 1u );
+    desc.format = ( producer.preferCompact && producer.canRenderCompact && consumer.acceptsCompact )
+        ? SHARED_FORMAT_RGB565 : SHARED_FORMAT_RGBA8;
+    return desc;
+}
+
+DirtyRect ScaleDirtyRectDown( const DirtyRect& rc, uint32_t scaleShift ) noexcept
+{
+    const uint32_t round = ( 1u << scaleShift ) - 1;
+    DirtyRect out;
+    out.left = rc.left >> scaleShift;
+    out.top = rc.top >> scaleShift;
+    out.right = ( rc.right + round ) >> scaleShift;
+    out.bottom = ( rc.bottom + round ) >> scaleShift;
+    return out;
+}
+
+SharedBandwidthReport ComputeSharedBandwidth( const ProducerSurfaceConfig& producer, const SharedSurfaceDesc& desc ) noexcept
+{
+    SharedBandwidthReport report;
+    report.fullFrameBytes = uint64_t( producer.width ) * producer.height * 4;
+    report.reducedFrameBytes = desc.FrameBytes();
+    return report;
+}
+
+//--------------------------------------------------------------------------------------
+void DownsampleBoxScalar(
+    const uint8_t* src, size_t srcPitch, uint32_t srcWidth, uint32_t srcHeight,
+    uint8_t* dst, size_t dstPitch, uint32_t scaleShift ) noexcept
+{
+    const uint32_t box = 1u << scaleShift;
+    const uint32_t boxShift = 2 * scaleShift;
+    const uint32_t bias = boxShift ? 1u << ( boxShift - 1 ) : 0u;
+    const uint32_t dstWidth = srcWidth >> scaleShift;
+    const uint32_t dstHeight = srcHeight >> scaleShift;
+
+    for( uint32_t y = 0; y < dstHeight; ++y )
+    {
+        uint8_t* out = dst + y * dstPitch;
+        for( uint32_t x = 0; x < dstWidth; ++x )
+        {
+            uint32_t sum[4] = {};
+            for( uint32_t sy = 0; sy < box; ++sy )
+            {
+                const uint8_t* in = src + ( y * box + sy ) * srcPitch + size_t( x * box ) * 4;
+                for( uint32_t sx = 0; sx < box; ++sx )
+                {
+                    for( uint32_t c = 0; c < 4; ++c )
+                        sum[c] += in[sx * 4 + c];
+                }
+            }
+            for( uint32_t c = 0; c < 4; ++c )
+                out[x * 4 + c] = uint8_t( ( sum[c] + bias ) >> boxShift );
+        }
+    }
+}
+
+#ifdef SHARED_DOWNSAMPLE_SSE2
+namespace
+{
+    //? Vertical pass: adds 'box' source rows into 16-bit per-channel accumulators.
+    //? 4 * 4 * 255 fits comfortably into 16 bits.
+    void AccumulateRows( const uint8_t* src, size_t srcPitch, uint32_t box, size_t rowBytes, uint16_t* acc ) noexcept
+    {
+        const __m128i zero = _mm_setzero_si128();
+        size_t i = 0;
+        for( ; i + 16 <= rowBytes; i += 16 )
+        {
+            __m128i lo = _mm_setzero_si128();
+            __m128i hi = _mm_setzero_si128();
+            for( uint32_t r = 0; r < box; ++r )
+            {
+                const __m128i v = _mm_loadu_si128( reinterpret_cast<const __m128i*>( src + r * srcPitch + i ) );
+                lo = _mm_add_epi16( lo, _mm_unpacklo_epi8( v, zero ) );
+                hi = _mm_add_epi16( hi, _mm_unpackhi_epi8( v, zero ) );
+            }
+            _mm_storeu_si128( reinterpret_cast<__m128i*>( acc + i ), lo );
+            _mm_storeu_si128( reinterpret_cast<__m128i*>( acc + i + 8 ), hi );
+        }
+        for( ; i < rowBytes; ++i )
+        {
+            uint16_t sum = 0;
+            for( uint32_t r = 0; r < box; ++r )
+                sum = uint16_t( sum + src[r * srcPitch + i] );
+            acc[i] = sum;
+        }
+    }
+
+    //? Horizontal pass: each accumulator pixel is four uint16, two pixels per register
+    inline __m128i SumPixelPairs( __m128i a, __m128i b ) noexcept
+    {
+        // a = [p0, p1], b = [p2, p3] -> [p0 + p1, p2 + p3]
+        return _mm_add_epi16( _mm_unpacklo_epi64( a, b ), _mm_unpackhi_epi64( a, b ) );
+    }
+}
+#endif
+
+void DownsampleBox(
+    const uint8_t* src, size_t srcPitch, uint32_t srcWidth, uint32_t srcHeight,
+    uint8_t* dst, size_t dstPitch, uint32_t scaleShift ) noexcept
+{
+#ifdef SHARED_DOWNSAMPLE_SSE2
+    if( scaleShift == 0 || scaleShift > 2 )
+    {
+        DownsampleBoxScalar( src, srcPitch, srcWidth, srcHeight, dst, dstPitch, scaleShift );
+        return;
+    }
+
+    const uint32_t box = 1u << scaleShift;
+    const uint32_t boxShift = 2 * scaleShift;
+    const uint32_t dstWidth = srcWidth >> scaleShift;
+    const uint32_t dstHeight = srcHeight >> scaleShift;
+    const size_t rowBytes = size_t( dstWidth ) * box * 4;
+    const __m128i bias = _mm_set1_epi16( short( 1 << ( boxShift - 1 ) ) );
+    const __m128i shift = _mm_cvtsi32_si128( int( boxShift ) );
+
+    std::vector<uint16_t> acc( rowBytes + 8 );
+
+    for( uint32_t y = 0; y < dstHeight; ++y )
+    {
+        AccumulateRows( src + size_t( y ) * box * srcPitch, srcPitch, box, rowBytes, acc.data() );
+
+        const uint16_t* in = acc.data();
+        uint8_t* out = dst + y * dstPitch;
+        uint32_t x = 0;
+
+        // Four output pixels per iteration
+        for( ; x + 4 <= dstWidth; x += 4 )
+        {
+            __m128i pair[2];
+            for( int half = 0; half < 2; ++half )
+            {
+                const uint16_t* p = in + size_t( x + half * 2 ) * box * 4;
+                if( box == 2 )
+                {
+                    const __m128i a = _mm_loadu_si128( reinterpret_cast<const __m128i*>( p ) );
+                    const __m128i b = _mm_loadu_si128( reinterpret_cast<const __m128i*>( p + 8 ) );
+                    pair[half] = SumPixelPairs( a, b );
+                }
+                else
+                {
+                    const __m128i a = _mm_loadu_si128( reinterpret_cast<const __m128i*>( p ) );
+                    const __m128i b = _mm_loadu_si128( reinterpret_cast<const __m128i*>( p + 8 ) );
+                    const __m128i c = _mm_loadu_si128( reinterpret_cast<const __m128i*>( p + 16 ) );
+                    const __m128i d = _mm_loadu_si128( reinterpret_cast<const __m128i*>( p + 24 ) );
+                    pair[half] = SumPixelPairs( _mm_add_epi16( a, b ), _mm_add_epi16( c, d ) );
+                }
+                pair[half] = _mm_srl_epi16( _mm_add_epi16( pair[half], bias ), shift );
+            }
+            _mm_storeu_si128( reinterpret_cast<__m128i*>( out + x * 4 ), _mm_packus_epi16( pair[0], pair[1] ) );
+        }
+
+        // Leftover pixels
+        for( ; x < dstWidth; ++x )
+        {
+            for( uint32_t c = 0; c < 4; ++c )
+            {
+                uint32_t sum = 0;
+                for( uint32_t sx = 0; sx < box; ++sx )
+                    sum += in[( size_t( x ) * box + sx ) * 4 + c];
+                out[x * 4 + c] = uint8_t( ( sum + ( 1u << ( boxShift - 1 ) ) ) >> boxShift );
+            }
+        }
+    }
+#else
+    DownsampleBoxScalar( src, srcPitch, srcWidth, srcHeight, dst, dstPitch, scaleShift );
+#endif
+}
+
+//--------------------------------------------------------------------------------------
+void PackRgb565(
+    const uint8_t* src, size_t srcPitch, uint32_t width, uint32_t height,
+    uint8_t* dst, size_t dstPitch ) noexcept
+{
+    for( uint32_t y = 0; y < height; ++y )
+    {
+        const uint8_t* in = src + y * srcPitch;
+        uint16_t* out = reinterpret_cast<uint16_t*>( dst + y * dstPitch );
+        for( uint32_t x = 0; x < width; ++x )
+        {
+            const uint32_t r = ( in[x * 4 + 0] * 31u + 127u ) / 255u;
+            const uint32_t g = ( in[x * 4 + 1] * 63u + 127u ) / 255u;
+            const uint32_t b = ( in[x * 4 + 2] * 31u + 127u ) / 255u;
+            out[x] = uint16_t( ( r << 11 ) | ( g << 5 ) | b );
+        }
+    }
+}
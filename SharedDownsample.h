@@ -0,0 +1,100 @@
+//--------------------------------------------------------------------------------------
+// File: SharedDownsample.h
+//
+// Reduced shared surfaces: negotiation of the size and format the producer publishes
+// for a consumer, bandwidth accounting, and the CPU reference of the box-filter
+// downsample the producer runs on the GPU.
+//
+// The reference kernel works on tightly or loosely pitched R8G8B8A8 rows and uses SSE2
+// when the compiler targets it; DownsampleBoxScalar() is the plain C++ definition the
+// SIMD path has to match bit for bit.
+//--------------------------------------------------------------------------------------
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "DirtyRects.h"
+
+
+enum SharedPixelFormat : uint32_t
+{
+    SHARED_FORMAT_RGBA8 = 0,    // R8G8B8A8_UNORM, 4 bytes per pixel
+    SHARED_FORMAT_RGB565 = 1,   // B5G6R5_UNORM, 2 bytes per pixel, alpha dropped
+};
+
+inline uint32_t SharedFormatBytesPerPixel( SharedPixelFormat format ) noexcept
+{
+    return format == SHARED_FORMAT_RGB565 ? 2u : 4u;
+}
+
+// Largest supported reduction: 1 = half, 2 = quarter resolution
+static const uint32_t kMaxSharedScaleShift = 2;
+
+//? What the producer would like to publish
+struct ProducerSurfaceConfig
+{
+    uint32_t    width = 0;              // full render resolution
+    uint32_t    height = 0;
+    uint32_t    scaleShift = 0;         // 0 = full, 1 = half, 2 = quarter
+    bool        preferCompact = false;  // publish RGB565 if the consumer can take it
+    bool        canRenderCompact = false;
+};
+
+//? What a consumer can take
+struct ConsumerSurfaceRequest
+{
+    uint32_t    maxScaleShift = kMaxSharedScaleShift;
+    bool        acceptsCompact = false;
+};
+
+//? The surface that actually gets shared
+struct SharedSurfaceDesc
+{
+    uint32_t            width = 0;
+    uint32_t            height = 0;
+    uint32_t            scaleShift = 0;
+    SharedPixelFormat   format = SHARED_FORMAT_RGBA8;
+
+    bool IsReduced() const noexcept { return scaleShift != 0 || format != SHARED_FORMAT_RGBA8; }
+    uint64_t FrameBytes() const noexcept { return uint64_t( width ) * height * SharedFormatBytesPerPixel( format ); }
+};
+
+SharedSurfaceDesc NegotiateSharedSurface( const ProducerSurfaceConfig& producer, const ConsumerSurfaceRequest& consumer ) noexcept;
+
+// Converts a full-resolution dirty rectangle to the reduced surface, rounding outward
+DirtyRect ScaleDirtyRectDown( const DirtyRect& rc, uint32_t scaleShift ) noexcept;
+
+//? --------------------------------------------------------------------------------------
+//? CPU reference kernels. The box filter averages (1 << scaleShift)^2 source texels per
+//? channel and rounds halves up. Source dimensions are rounded down to a multiple of the
+//? box size.
+//? --------------------------------------------------------------------------------------
+void DownsampleBoxScalar(
+    const uint8_t* src, size_t srcPitch, uint32_t srcWidth, uint32_t srcHeight,
+    uint8_t* dst, size_t dstPitch, uint32_t scaleShift ) noexcept;
+
+// SIMD version; falls back to the scalar kernel where no vector path exists
+void DownsampleBox(
+    const uint8_t* src, size_t srcPitch, uint32_t srcWidth, uint32_t srcHeight,
+    uint8_t* dst, size_t dstPitch, uint32_t scaleShift ) noexcept;
+
+// R8G8B8A8 -> B5G6R5 with rounding, as the GPU writes a UNORM render target
+void PackRgb565(
+    const uint8_t* src, size_t srcPitch, uint32_t width, uint32_t height,
+    uint8_t* dst, size_t dstPitch ) noexcept;
+
+//? Bandwidth saved by sharing the reduced surface instead of full-resolution RGBA8
+struct SharedBandwidthReport
+{
+    uint64_t    fullFrameBytes = 0;
+    uint64_t    reducedFrameBytes = 0;
+
+    double SavedFraction() const noexcept
+    {
+        return fullFrameBytes ? 1.0 - double( reducedFrameBytes ) / double( fullFrameBytes ) : 0.0;
+    }
+};
+
+SharedBandwidthReport ComputeSharedBandwidth( const ProducerSurfaceConfig& producer, const SharedSurfaceDesc& desc ) noexcept;
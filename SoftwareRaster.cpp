@@ -0,0 +1,622 @@
+//--------------------------------------------------------------------------------------
+// File: SoftwareRaster.cpp
+//
+// Tile-based CPU rasterizer for the textured-quad pipeline
+//--------------------------------------------------------------------------------------
+
+#include "SoftwareRaster.h"
+#include "CpuTrace.h"
+#include "RenderThreads.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+
+#if defined( __SSE2__ ) || defined( _M_X64 ) || ( defined( _M_IX86_FP ) && _M_IX86_FP >= 2 )
+#include <emmintrin.h>
+#define RASTER_SSE2 1
+#else
+#define RASTER_SSE2 0
+#endif
+
+
+namespace
+{
+    //? Sub-pixel precision of the snapped vertices
+    const int32_t kSubPixelBits = 4;
+    const int32_t kSubPixels = 1 << kSubPixelBits;
+    const int32_t kHalfPixel = kSubPixels / 2;
+
+    //? Clip-space x and y are clipped to +-kGuardBand * w, which bounds snapped screen
+    //? coordinates to 2^18 sub-pixels for targets up to kMaxDimension
+    const float kGuardBand = 2.0f;
+
+    const size_t kMaxClipVertices = 9;      // a triangle clipped by six planes
+
+    using Clock = std::chrono::steady_clock;
+
+    //? Signed distance to clip plane 'plane'; the inside is >= 0
+    float ClipDistance( const RasterVertex& v, int plane )
+    {
+        switch( plane )
+        {
+        case 0:  return v.clip[2];                             // z >= 0
+        case 1:  return v.clip[3] - v.clip[2];                 // z <= w
+        case 2:  return kGuardBand * v.clip[3] + v.clip[0];
+        case 3:  return kGuardBand * v.clip[3] - v.clip[0];
+        case 4:  return kGuardBand * v.clip[3] + v.clip[1];
+        default: return kGuardBand * v.clip[3] - v.clip[1];
+        }
+    }
+
+    RasterVertex Lerp( const RasterVertex& a, const RasterVertex& b, float t )
+    {
+        RasterVertex v;
+        for( int i = 0; i < 4; ++i )
+            v.clip[i] = a.clip[i] + ( b.clip[i] - a.clip[i] ) * t;
+        for( int i = 0; i < 2; ++i )
+            v.tex[i] = a.tex[i] + ( b.tex[i] - a.tex[i] ) * t;
+        return v;
+    }
+
+    //? Sutherland-Hodgman against one plane; returns the new vertex count
+    size_t ClipPolygon( const RasterVertex* in, size_t count, int plane, RasterVertex* out )
+    {
+        size_t written = 0;
+        for( size_t i = 0; i < count; ++i )
+        {
+            const RasterVertex& a = in[i];
+            const RasterVertex& b = in[( i + 1 ) % count];
+            const float da = ClipDistance( a, plane );
+            const float db = ClipDistance( b, plane );
+            if( da >= 0.0f )
+                out[written++] = a;
+            if( ( da >= 0.0f ) != ( db >= 0.0f ) )
+                out[written++] = Lerp( a, b, da / ( da - db ) );
+        }
+        return written;
+    }
+
+    int64_t FloorDiv( int64_t a, int64_t b )
+    {
+        return a >= 0 ? a / b : -( ( -a + b - 1 ) / b );
+    }
+
+    //? Level of detail from the screen gradients of (u/w, v/w, 1/w); u = (u/w) * w, so
+    //? du = w * ( d(u/w) - u * d(1/w) )
+    float PixelLod( const SoftwareTexture& texture, float w, float u, float v, const float ddx[3], const float ddy[3] )
+    {
+        return ComputeTextureLod( texture, w * ( ddx[0] - u * ddx[2] ), w * ( ddx[1] - v * ddx[2] ),
+                                  w * ( ddy[0] - u * ddy[2] ), w * ( ddy[1] - v * ddy[2] ) );
+    }
+
+    //? Pixels shaded per sampler call: a block four wide and two high, the AVX2 width
+    const uint32_t kShadeLanes = 8;
+
+    //? Shades the first 'count' lanes with one sampler call; lane i goes to color[i / 4][i % 4],
+    //? and lanes outside 'mask' are left alone
+    void ShadePixels( const RasterDrawState& state, const float* u, const float* v, const float* lod, size_t count, uint32_t mask,
+                      uint32_t* const color[2] )
+    {
+        float texels[kShadeLanes * 4] = {};
+        if( state.texture && !state.texture->Empty() )
+            SampleTextureLinear( *state.texture, u, v, lod, count, texels );
+
+        for( uint32_t lane = 0; lane < count; ++lane )
+        {
+            if( !( mask & ( 1u << lane ) ) )
+                continue;
+            float* sample = &texels[lane * 4];
+            if( state.shader == RASTER_PS_MESH_COLOR_MINUS_TEXTURE )
+            {
+                for( int c = 0; c < 4; ++c )
+                    sample[c] = state.meshColor[c] - sample[c];
+            }
+            color[lane / 4][lane % 4] = PackRasterColor( sample );
+        }
+    }
+}
+
+//--------------------------------------------------------------------------------------
+uint32_t PackRasterColor( const float color[4] )
+{
+    uint32_t rgba = 0;
+    for( int c = 0; c < 4; ++c )
+    {
+        const float v = color[c] > 0.0f ? ( color[c] < 1.0f ? color[c] : 1.0f ) : 0.0f;
+        rgba |= uint32_t( v * 255.0f + 0.5f ) << ( c * 8 );
+    }
+    return rgba;
+}
+
+//--------------------------------------------------------------------------------------
+RasterMatrix RasterIdentity()
+{
+    RasterMatrix r = {};
+    for( int i = 0; i < 4; ++i )
+        r.m[i][i] = 1.0f;
+    return r;
+}
+
+RasterMatrix RasterMultiply( const RasterMatrix& a, const RasterMatrix& b )
+{
+    RasterMatrix r = {};
+    for( int row = 0; row < 4; ++row )
+    {
+        for( int col = 0; col < 4; ++col )
+        {
+            for( int k = 0; k < 4; ++k )
+                r.m[row][col] += a.m[row][k] * b.m[k][col];
+        }
+    }
+    return r;
+}
+
+RasterMatrix RasterTranspose( const float rowMajor[16] )
+{
+    RasterMatrix r;
+    for( int row = 0; row < 4; ++row )
+    {
+        for( int col = 0; col < 4; ++col )
+            r.m[row][col] = rowMajor[col * 4 + row];
+    }
+    return r;
+}
+
+RasterMatrix RasterLookAtLH( const float eye[3], const float at[3], const float up[3] )
+{
+    auto normalize = []( float v[3] )
+    {
+        const float length = sqrtf( v[0] * v[0] + v[1] * v[1] + v[2] * v[2] );
+        for( int i = 0; i < 3; ++i )
+            v[i] /= length;
+    };
+    auto cross = []( const float a[3], const float b[3], float out[3] )
+    {
+        out[0] = a[1] * b[2] - a[2] * b[1];
+        out[1] = a[2] * b[0] - a[0] * b[2];
+        out[2] = a[0] * b[1] - a[1] * b[0];
+    };
+    auto dot = []( const float a[3], const float b[3] ) { return a[0] * b[0] + a[1] * b[1] + a[2] * b[2]; };
+
+    float zAxis[3] = { at[0] - eye[0], at[1] - eye[1], at[2] - eye[2] };
+    normalize( zAxis );
+    float xAxis[3];
+    cross( up, zAxis, xAxis );
+    normalize( xAxis );
+    float yAxis[3];
+    cross( zAxis, xAxis, yAxis );
+
+    RasterMatrix r = RasterIdentity();
+    for( int i = 0; i < 3; ++i )
+    {
+        r.m[i][0] = xAxis[i];
+        r.m[i][1] = yAxis[i];
+        r.m[i][2] = zAxis[i];
+    }
+    r.m[3][0] = -dot( xAxis, eye );
+    r.m[3][1] = -dot( yAxis, eye );
+    r.m[3][2] = -dot( zAxis, eye );
+    return r;
+}
+
+RasterMatrix RasterPerspectiveFovLH( float fovY, float aspect, float zNear, float zFar )
+{
+    const float h = 1.0f / tanf( fovY * 0.5f );
+    const float range = zFar / ( zFar - zNear );
+
+    RasterMatrix r = {};
+    r.m[0][0] = h / aspect;
+    r.m[1][1] = h;
+    r.m[2][2] = range;
+    r.m[2][3] = 1.0f;
+    r.m[3][2] = -range * zNear;
+    return r;
+}
+
+void RasterTransform( const float position[4], const RasterMatrix& matrix, float out[4] )
+{
+    for( int col = 0; col < 4; ++col )
+    {
+        out[col] = position[0] * matrix.m[0][col] + position[1] * matrix.m[1][col] +
+                   position[2] * matrix.m[2][col] + position[3] * matrix.m[3][col];
+    }
+}
+
+//--------------------------------------------------------------------------------------
+TileRasterizer::TileRasterizer( uint32_t width, uint32_t height ) :
+    m_width( std::min( std::max( width, 1u ), uint32_t( kMaxDimension ) ) ),
+    m_height( std::min( std::max( height, 1u ), uint32_t( kMaxDimension ) ) )
+{
+    m_tilesX = ( m_width + kTileSize - 1 ) / kTileSize;
+    m_tilesY = ( m_height + kTileSize - 1 ) / kTileSize;
+    m_color.assign( size_t( m_width ) * m_height, 0 );
+    m_depth.assign( size_t( m_width ) * m_height, 1.0f );
+    m_bins.resize( size_t( m_tilesX ) * m_tilesY );
+}
+
+void TileRasterizer::Clear( const float color[4], float depth )
+{
+    //? Anything binned before the clear would be overwritten anyway
+    m_triangles.clear();
+    m_draws.clear();
+    for( std::vector<uint32_t>& bin : m_bins )
+        bin.clear();
+
+    m_clearPending = true;
+    m_clearColor = PackRasterColor( color );
+    m_clearDepth = depth;
+}
+
+void TileRasterizer::DrawTriangles( const RasterVertex* vertices, const uint16_t* indices, size_t indexCount, const RasterDrawState& state )
+{
+    const uint32_t draw = uint32_t( m_draws.size() );
+    m_draws.push_back( state );
+
+    for( size_t i = 0; i + 2 < indexCount; i += 3 )
+    {
+        ++m_stats.triangles;
+        const RasterVertex* corners[3] = { &vertices[indices[i]], &vertices[indices[i + 1]], &vertices[indices[i + 2]] };
+
+        //? Trivial accept and reject before paying for the clipper
+        uint32_t outside[3] = {};
+        for( int v = 0; v < 3; ++v )
+        {
+            for( int plane = 0; plane < 6; ++plane )
+            {
+                if( ClipDistance( *corners[v], plane ) < 0.0f )
+                    outside[v] |= 1u << plane;
+            }
+        }
+        if( outside[0] & outside[1] & outside[2] )
+        {
+            ++m_stats.culled;
+            continue;
+        }
+        if( !( outside[0] | outside[1] | outside[2] ) )
+        {
+            SetupTriangle( *corners[0], *corners[1], *corners[2], draw );
+            continue;
+        }
+
+        ++m_stats.clipped;
+        RasterVertex polygon[2][kMaxClipVertices];
+        size_t count = 3;
+        for( int v = 0; v < 3; ++v )
+            polygon[0][v] = *corners[v];
+        int current = 0;
+        for( int plane = 0; plane < 6 && count >= 3; ++plane )
+        {
+            if( !( ( outside[0] | outside[1] | outside[2] ) & ( 1u << plane ) ) )
+                continue;
+            count = ClipPolygon( polygon[current], count, plane, polygon[current ^ 1] );
+            current ^= 1;
+        }
+        if( count < 3 )
+        {
+            ++m_stats.culled;
+            continue;
+        }
+        for( size_t v = 1; v + 1 < count; ++v )
+            SetupTriangle( polygon[current][0], polygon[current][v], polygon[current][v + 1], draw );
+    }
+}
+
+void TileRasterizer::SetupTriangle( const RasterVertex& v0, const RasterVertex& v1, const RasterVertex& v2, uint32_t draw )
+{
+    const RasterVertex* corners[3] = { &v0, &v1, &v2 };
+
+    Triangle tri;
+    tri.draw = draw;
+    double values[PLANE_COUNT][3];
+    for( int v = 0; v < 3; ++v )
+    {
+        const float w = corners[v]->clip[3];
+        if( !( w > 0.0f ) )
+        {
+            ++m_stats.culled;
+            return;
+        }
+
+        //? Viewport transform: y points down, depth keeps the 0..1 range
+        const float invW = 1.0f / w;
+        const float sx = ( corners[v]->clip[0] * invW * 0.5f + 0.5f ) * float( m_width );
+        const float sy = ( 0.5f - corners[v]->clip[1] * invW * 0.5f ) * float( m_height );
+        tri.x[v] = int32_t( floorf( sx * float( kSubPixels ) + 0.5f ) );
+        tri.y[v] = int32_t( floorf( sy * float( kSubPixels ) + 0.5f ) );
+
+        values[PLANE_Z][v] = corners[v]->clip[2] * invW;
+        values[PLANE_INV_W][v] = invW;
+        values[PLANE_U_OVER_W][v] = corners[v]->tex[0] * invW;
+        values[PLANE_V_OVER_W][v] = corners[v]->tex[1] * invW;
+    }
+
+    //? Positive for clockwise triangles on screen, the front faces
+    const int64_t area = int64_t( tri.x[1] - tri.x[0] ) * ( tri.y[2] - tri.y[0] ) - int64_t( tri.x[2] - tri.x[0] ) * ( tri.y[1] - tri.y[0] );
+    if( area <= 0 )
+    {
+        ++m_stats.culled;
+        return;
+    }
+
+    //? Pixels whose centers fall inside the bounding box
+    const int32_t minX = std::min( tri.x[0], std::min( tri.x[1], tri.x[2] ) );
+    const int32_t maxX = std::max( tri.x[0], std::max( tri.x[1], tri.x[2] ) );
+    const int32_t minY = std::min( tri.y[0], std::min( tri.y[1], tri.y[2] ) );
+    const int32_t maxY = std::max( tri.y[0], std::max( tri.y[1], tri.y[2] ) );
+    tri.minX = std::max( int32_t( -FloorDiv( -( minX - kHalfPixel ), kSubPixels ) ), 0 );
+    tri.minY = std::max( int32_t( -FloorDiv( -( minY - kHalfPixel ), kSubPixels ) ), 0 );
+    tri.maxX = std::min( int32_t( FloorDiv( maxX - kHalfPixel, kSubPixels ) ), int32_t( m_width ) - 1 );
+    tri.maxY = std::min( int32_t( FloorDiv( maxY - kHalfPixel, kSubPixels ) ), int32_t( m_height ) - 1 );
+    if( tri.minX > tri.maxX || tri.minY > tri.maxY )
+    {
+        ++m_stats.culled;
+        return;
+    }
+
+    //? Barycentric weight i is edge function i over the area; each plane is the weighted
+    //? sum, evaluated at the center of pixel (0,0) and stepped per pixel
+    for( int plane = 0; plane < PLANE_COUNT; ++plane )
+    {
+        double at = 0.0, dx = 0.0, dy = 0.0;
+        for( int i = 0; i < 3; ++i )
+        {
+            const int a = ( i + 1 ) % 3;
+            const int b = ( i + 2 ) % 3;
+            const double edgeA = double( tri.y[a] ) - tri.y[b];
+            const double edgeB = double( tri.x[b] ) - tri.x[a];
+            const double edge = edgeB * ( kHalfPixel - tri.y[a] ) + edgeA * ( kHalfPixel - tri.x[a] );
+            at += values[plane][i] * edge;
+            dx += values[plane][i] * edgeA * kSubPixels;
+            dy += values[plane][i] * edgeB * kSubPixels;
+        }
+        tri.planes[plane][0] = at / double( area );
+        tri.planes[plane][1] = dx / double( area );
+        tri.planes[plane][2] = dy / double( area );
+    }
+
+    const uint32_t index = uint32_t( m_triangles.size() );
+    m_triangles.push_back( tri );
+    for( uint32_t ty = uint32_t( tri.minY ) / kTileSize; ty <= uint32_t( tri.maxY ) / kTileSize; ++ty )
+    {
+        for( uint32_t tx = uint32_t( tri.minX ) / kTileSize; tx <= uint32_t( tri.maxX ) / kTileSize; ++tx )
+        {
+            m_bins[ty * m_tilesX + tx].push_back( index );
+            ++m_stats.binned;
+        }
+    }
+}
+
+void TileRasterizer::Flush( WorkerPool* pool )
+{
+    if( !Pending() )
+        return;
+
+    CPU_TRACE_SCOPE( "TileRasterizer::Flush" );
+    const Clock::time_point start = Clock::now();
+
+    //? Tiles are handed out one at a time, so threads that get cheap tiles take more
+    const uint32_t tileCount = m_tilesX * m_tilesY;
+    std::atomic<uint32_t> next( 0 );
+    auto work = [this, &next, tileCount]()
+    {
+        for( uint32_t tile = next.fetch_add( 1 ); tile < tileCount; tile = next.fetch_add( 1 ) )
+            RasterizeTile( tile );
+    };
+    const size_t helpers = pool ? std::min<size_t>( pool->ThreadCount(), tileCount - 1 ) : 0;
+    for( size_t i = 0; i < helpers; ++i )
+        pool->Submit( "raster", work );
+    work();
+    if( helpers )
+        pool->ClearHistory();
+
+    m_triangles.clear();
+    m_draws.clear();
+    for( std::vector<uint32_t>& bin : m_bins )
+        bin.clear();
+    m_clearPending = false;
+
+    ++m_stats.flushes;
+    m_stats.lastFlushMs = std::chrono::duration<double, std::milli>( Clock::now() - start ).count();
+}
+
+void TileRasterizer::RasterizeTile( uint32_t tile )
+{
+    const uint32_t x0 = ( tile % m_tilesX ) * kTileSize;
+    const uint32_t y0 = ( tile / m_tilesX ) * kTileSize;
+    const uint32_t x1 = std::min( x0 + kTileSize, m_width );
+    const uint32_t y1 = std::min( y0 + kTileSize, m_height );
+
+    if( m_clearPending )
+    {
+        for( uint32_t y = y0; y < y1; ++y )
+        {
+            std::fill_n( &m_color[size_t( y ) * m_width + x0], x1 - x0, m_clearColor );
+            std::fill_n( &m_depth[size_t( y ) * m_width + x0], x1 - x0, m_clearDepth );
+        }
+    }
+
+    for( uint32_t index : m_bins[tile] )
+    {
+        const Triangle& tri = m_triangles[index];
+        const uint32_t rx0 = std::max( x0, uint32_t( tri.minX ) );
+        const uint32_t ry0 = std::max( y0, uint32_t( tri.minY ) );
+        const uint32_t rx1 = std::min( x1, uint32_t( tri.maxX ) + 1 );
+        const uint32_t ry1 = std::min( y1, uint32_t( tri.maxY ) + 1 );
+        if( rx0 < rx1 && ry0 < ry1 )
+            RasterizeTriangle( tri, rx0, ry0, rx1, ry1 );
+    }
+}
+
+void TileRasterizer::RasterizeTriangle( const Triangle& tri, uint32_t x0, uint32_t y0, uint32_t x1, uint32_t y1 )
+{
+    //? Edge i is opposite vertex i. The top-left rule makes pixels exactly on any other
+    //? edge fail, by biasing it down by one. An edge that passes at every corner of the
+    //? rectangle is dropped, so the ones left cross it and stay within 32 bits.
+    int32_t edge[3], stepX[3], stepY[3];
+    for( int i = 0; i < 3; ++i )
+    {
+        const int a = ( i + 1 ) % 3;
+        const int b = ( i + 2 ) % 3;
+        const int64_t edgeA = int64_t( tri.y[a] ) - tri.y[b];
+        const int64_t edgeB = int64_t( tri.x[b] ) - tri.x[a];
+        const bool topLeft = edgeA > 0 || ( edgeA == 0 && edgeB > 0 );
+        const int64_t origin = edgeB * ( int64_t( y0 ) * kSubPixels + kHalfPixel - tri.y[a] ) +
+                               edgeA * ( int64_t( x0 ) * kSubPixels + kHalfPixel - tri.x[a] ) - ( topLeft ? 0 : 1 );
+        const int64_t spanX = edgeA * kSubPixels * int64_t( x1 - x0 - 1 );
+        const int64_t spanY = edgeB * kSubPixels * int64_t( y1 - y0 - 1 );
+        const int64_t low = origin + std::min<int64_t>( spanX, 0 ) + std::min<int64_t>( spanY, 0 );
+        const int64_t high = origin + std::max<int64_t>( spanX, 0 ) + std::max<int64_t>( spanY, 0 );
+        if( high < 0 )
+            return;
+        if( low >= 0 )
+        {
+            edge[i] = stepX[i] = stepY[i] = 0;
+            continue;
+        }
+        edge[i] = int32_t( origin );
+        stepX[i] = int32_t( edgeA * kSubPixels );
+        stepY[i] = int32_t( edgeB * kSubPixels );
+    }
+
+    float origin[PLANE_COUNT], planeX[PLANE_COUNT], planeY[PLANE_COUNT];
+    for( int plane = 0; plane < PLANE_COUNT; ++plane )
+    {
+        origin[plane] = float( tri.planes[plane][0] + tri.planes[plane][1] * x0 + tri.planes[plane][2] * y0 );
+        planeX[plane] = float( tri.planes[plane][1] );
+        planeY[plane] = float( tri.planes[plane][2] );
+    }
+
+    const RasterDrawState& state = m_draws[tri.draw];
+    const float ddx[3] = { planeX[PLANE_U_OVER_W], planeX[PLANE_V_OVER_W], planeX[PLANE_INV_W] };
+    const float ddy[3] = { planeY[PLANE_U_OVER_W], planeY[PLANE_V_OVER_W], planeY[PLANE_INV_W] };
+    const bool textured = state.texture && !state.texture->Empty();
+
+#if RASTER_SSE2
+    const __m128i laneEdge0 = _mm_setr_epi32( 0, stepX[0], stepX[0] * 2, stepX[0] * 3 );
+    const __m128i laneEdge1 = _mm_setr_epi32( 0, stepX[1], stepX[1] * 2, stepX[1] * 3 );
+    const __m128i laneEdge2 = _mm_setr_epi32( 0, stepX[2], stepX[2] * 2, stepX[2] * 3 );
+    const __m128i groupEdge0 = _mm_set1_epi32( stepX[0] * 4 );
+    const __m128i groupEdge1 = _mm_set1_epi32( stepX[1] * 4 );
+    const __m128i groupEdge2 = _mm_set1_epi32( stepX[2] * 4 );
+    const __m128 lanes = _mm_setr_ps( 0.0f, 1.0f, 2.0f, 3.0f );
+    const __m128 one = _mm_set1_ps( 1.0f );
+
+    //? Two rows at a time, so each step covers a 4x2 block for the sampler
+    for( uint32_t y = y0; y < y1; y += 2 )
+    {
+        const uint32_t rows = std::min( y1 - y, 2u );
+        __m128i e0[2], e1[2], e2[2];
+        float rowStart[2][PLANE_COUNT];
+        uint32_t* color[2] = {};
+        float* depth[2] = {};
+        for( uint32_t r = 0; r < rows; ++r )
+        {
+            const int32_t row = int32_t( y + r - y0 );
+            e0[r] = _mm_add_epi32( _mm_set1_epi32( edge[0] + stepY[0] * row ), laneEdge0 );
+            e1[r] = _mm_add_epi32( _mm_set1_epi32( edge[1] + stepY[1] * row ), laneEdge1 );
+            e2[r] = _mm_add_epi32( _mm_set1_epi32( edge[2] + stepY[2] * row ), laneEdge2 );
+            for( int plane = 0; plane < PLANE_COUNT; ++plane )
+                rowStart[r][plane] = origin[plane] + planeY[plane] * float( row );
+            color[r] = &m_color[size_t( y + r ) * m_width];
+            depth[r] = &m_depth[size_t( y + r ) * m_width];
+        }
+
+        for( uint32_t x = x0; x < x1; x += 4 )
+        {
+            const uint32_t valid = x1 - x >= 4 ? 0xfu : ( 1u << ( x1 - x ) ) - 1u;
+            const __m128 column = _mm_add_ps( _mm_set1_ps( float( x - x0 ) ), lanes );
+            float us[kShadeLanes] = {}, vs[kShadeLanes] = {}, lods[kShadeLanes] = {};
+            uint32_t blockMask = 0;
+            for( uint32_t r = 0; r < rows; ++r )
+            {
+                //? Sign bits of the three edges: a lane is covered if none is negative
+                const __m128i outside = _mm_or_si128( _mm_or_si128( e0[r], e1[r] ), e2[r] );
+                uint32_t mask = ~uint32_t( _mm_movemask_ps( _mm_castsi128_ps( outside ) ) ) & valid;
+                e0[r] = _mm_add_epi32( e0[r], groupEdge0 );
+                e1[r] = _mm_add_epi32( e1[r], groupEdge1 );
+                e2[r] = _mm_add_epi32( e2[r], groupEdge2 );
+                if( !mask )
+                    continue;
+
+                const float* start = rowStart[r];
+                const __m128 z = _mm_add_ps( _mm_set1_ps( start[PLANE_Z] ), _mm_mul_ps( column, _mm_set1_ps( planeX[PLANE_Z] ) ) );
+                float stored[4];
+                if( valid == 0xfu )
+                {
+                    stored[0] = depth[r][x]; stored[1] = depth[r][x + 1]; stored[2] = depth[r][x + 2]; stored[3] = depth[r][x + 3];
+                }
+                else
+                {
+                    for( uint32_t lane = 0; lane < 4; ++lane )
+                        stored[lane] = lane < x1 - x ? depth[r][x + lane] : 0.0f;
+                }
+                mask &= uint32_t( _mm_movemask_ps( _mm_cmplt_ps( z, _mm_loadu_ps( stored ) ) ) );
+                if( !mask )
+                    continue;
+
+                const __m128 invW = _mm_add_ps( _mm_set1_ps( start[PLANE_INV_W] ), _mm_mul_ps( column, _mm_set1_ps( planeX[PLANE_INV_W] ) ) );
+                const __m128 w = _mm_div_ps( one, invW );
+                const __m128 uOverW = _mm_add_ps( _mm_set1_ps( start[PLANE_U_OVER_W] ), _mm_mul_ps( column, _mm_set1_ps( planeX[PLANE_U_OVER_W] ) ) );
+                const __m128 vOverW = _mm_add_ps( _mm_set1_ps( start[PLANE_V_OVER_W] ), _mm_mul_ps( column, _mm_set1_ps( planeX[PLANE_V_OVER_W] ) ) );
+                float zs[4], ws[4];
+                float* u = &us[r * 4];
+                float* v = &vs[r * 4];
+                _mm_storeu_ps( zs, z );
+                _mm_storeu_ps( ws, w );
+                _mm_storeu_ps( u, _mm_mul_ps( uOverW, w ) );
+                _mm_storeu_ps( v, _mm_mul_ps( vOverW, w ) );
+                for( uint32_t lane = 0; lane < 4; ++lane )
+                {
+                    if( mask & ( 1u << lane ) )
+                    {
+                        depth[r][x + lane] = zs[lane];
+                        if( textured )
+                            lods[r * 4 + lane] = PixelLod( *state.texture, ws[lane], u[lane], v[lane], ddx, ddy );
+                    }
+                    else
+                    {
+                        u[lane] = v[lane] = 0.0f;
+                    }
+                }
+                blockMask |= mask << ( r * 4 );
+            }
+            if( !blockMask )
+                continue;
+
+            uint32_t* block[2] = { color[0] + x, rows > 1 ? color[1] + x : nullptr };
+            ShadePixels( state, us, vs, lods, rows * 4, blockMask, block );
+        }
+    }
+#else
+    for( uint32_t y = y0; y < y1; ++y )
+    {
+        const int32_t row = int32_t( y - y0 );
+        uint32_t* color = &m_color[size_t( y ) * m_width];
+        float* depth = &m_depth[size_t( y ) * m_width];
+        for( uint32_t x = x0; x < x1; ++x )
+        {
+            const int32_t column = int32_t( x - x0 );
+            if( ( edge[0] + stepY[0] * row + stepX[0] * column ) < 0 ||
+                ( edge[1] + stepY[1] * row + stepX[1] * column ) < 0 ||
+                ( edge[2] + stepY[2] * row + stepX[2] * column ) < 0 )
+                continue;
+
+            float value[PLANE_COUNT];
+            for( int plane = 0; plane < PLANE_COUNT; ++plane )
+                value[plane] = origin[plane] + planeY[plane] * float( row ) + planeX[plane] * float( column );
+            if( !( value[PLANE_Z] < depth[x] ) )
+                continue;
+
+            const float w = 1.0f / value[PLANE_INV_W];
+            float u[1] = { value[PLANE_U_OVER_W] * w }, v[1] = { value[PLANE_V_OVER_W] * w }, lod[1] = {};
+            if( textured )
+                lod[0] = PixelLod( *state.texture, w, u[0], v[0], ddx, ddy );
+            depth[x] = value[PLANE_Z];
+            uint32_t* pixel[2] = { &color[x], nullptr };
+            ShadePixels( state, u, v, lod, 1, 1u, pixel );
+        }
+    }
+#endif
+}
@@ -0,0 +1,146 @@
+//--------------------------------------------------------------------------------------
+// File: SoftwareRaster.h
+//
+// Tile-based CPU rasterizer for the textured-quad pipeline. Draws run the vertex stage
+// immediately: triangles are clipped against the depth range and a guard band, culled
+// like the default D3D11 rasterizer state (clockwise front faces, back faces culled),
+// snapped to 1/16 pixel and binned into 64x64 tiles. Flush() then rasterizes the tiles
+// in parallel, each tile walking its triangles in submission order, so the output does
+// not depend on the thread count.
+//
+// Coverage follows the D3D11 rules: pixel centers at +0.5 and the top-left fill rule.
+// Edge functions are evaluated four pixels at a time with SSE2 where available. Depth
+// is tested LESS against a float buffer; texture coordinates are interpolated with
+// perspective correction, and their analytic screen derivatives pick the mip level for
+// the trilinear sampler in TextureSampler.h, one 4x2 block of pixels per call so the
+// AVX2 sampler fills its eight lanes.
+//--------------------------------------------------------------------------------------
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "TextureSampler.h"
+
+
+class WorkerPool;
+
+//? Row-vector 4x4 matrix, m[row][column], multiplied as v * M like DirectXMath
+struct RasterMatrix
+{
+    float   m[4][4];
+};
+
+RasterMatrix RasterIdentity();
+RasterMatrix RasterMultiply( const RasterMatrix& a, const RasterMatrix& b );
+RasterMatrix RasterTranspose( const float rowMajor[16] );       // a matrix stored transposed for HLSL
+RasterMatrix RasterLookAtLH( const float eye[3], const float at[3], const float up[3] );
+RasterMatrix RasterPerspectiveFovLH( float fovY, float aspect, float zNear, float zFar );
+void RasterTransform( const float position[4], const RasterMatrix& matrix, float out[4] );
+
+//? Vertex stage output: clip-space position and texture coordinate
+struct RasterVertex
+{
+    float   clip[4];
+    float   tex[2];
+};
+
+enum RasterPixelShader : uint32_t
+{
+    RASTER_PS_TEXTURE,                      // txDiffuse.Sample( samLinear, tex )
+    RASTER_PS_MESH_COLOR_MINUS_TEXTURE,     // vMeshColor - txDiffuse.Sample( samLinear, tex )
+};
+
+//? Pixel state of one draw. The texture is read at Flush(), so it must live until then;
+//? without one, samples are zero as with an unbound SRV.
+struct RasterDrawState
+{
+    RasterPixelShader           shader = RASTER_PS_TEXTURE;
+    const SoftwareTexture*      texture = nullptr;
+    float                       meshColor[4] = { 1.0f, 1.0f, 1.0f, 1.0f };
+};
+
+class TileRasterizer
+{
+public:
+    static const uint32_t kTileSize = 64;
+    static const uint32_t kMaxDimension = 8192;     // keeps edge functions within 32 bits per tile
+
+    struct Stats
+    {
+        uint64_t    triangles = 0;      // submitted
+        uint64_t    culled = 0;         // back-facing, degenerate or clipped away
+        uint64_t    clipped = 0;        // crossed a clip plane and were split
+        uint64_t    binned = 0;         // triangle-tile pairs
+        uint64_t    flushes = 0;
+        double      lastFlushMs = 0.0;
+    };
+
+    // Dimensions are clamped to 1..kMaxDimension
+    TileRasterizer( uint32_t width, uint32_t height );
+
+    uint32_t Width() const noexcept { return m_width; }
+    uint32_t Height() const noexcept { return m_height; }
+
+    // Clears color and depth; applied per tile at the next Flush()
+    void Clear( const float color[4], float depth = 1.0f );
+
+    // Clips, culls, sets up and bins an indexed triangle list
+    void DrawTriangles( const RasterVertex* vertices, const uint16_t* indices, size_t indexCount, const RasterDrawState& state );
+
+    // Rasterizes everything binned since the last flush, on the pool's threads if given
+    void Flush( WorkerPool* pool = nullptr );
+    bool Pending() const noexcept { return m_clearPending || !m_triangles.empty(); }
+
+    // Valid after Flush(); RGBA8 rows of Width() pixels
+    const uint32_t* Color() const noexcept { return m_color.data(); }
+    const float* Depth() const noexcept { return m_depth.data(); }
+
+    const Stats& GetStats() const noexcept { return m_stats; }
+
+private:
+    //? Values interpolated linearly in screen space: depth, and 1/w, u/w, v/w for
+    //? perspective-correct texture coordinates
+    enum Plane
+    {
+        PLANE_Z,
+        PLANE_INV_W,
+        PLANE_U_OVER_W,
+        PLANE_V_OVER_W,
+        PLANE_COUNT
+    };
+
+    //? A triangle after setup: fixed-point screen vertices (1/16 pixel) and each plane as
+    //? its value at the center of pixel (0,0) and its change per pixel in x and y
+    struct Triangle
+    {
+        int32_t     x[3];
+        int32_t     y[3];
+        double      planes[PLANE_COUNT][3];
+        int32_t     minX, minY, maxX, maxY;     // pixel bounds, clamped to the target
+        uint32_t    draw;
+    };
+
+    void SetupTriangle( const RasterVertex& v0, const RasterVertex& v1, const RasterVertex& v2, uint32_t draw );
+    void RasterizeTile( uint32_t tile );
+    void RasterizeTriangle( const Triangle& tri, uint32_t x0, uint32_t y0, uint32_t x1, uint32_t y1 );
+
+    uint32_t                            m_width;
+    uint32_t                            m_height;
+    uint32_t                            m_tilesX;
+    uint32_t                            m_tilesY;
+    std::vector<uint32_t>               m_color;
+    std::vector<float>                  m_depth;
+    bool                                m_clearPending = false;
+    uint32_t                            m_clearColor = 0;
+    float                               m_clearDepth = 1.0f;
+    std::vector<RasterDrawState>        m_draws;
+    std::vector<Triangle>               m_triangles;
+    std::vector<std::vector<uint32_t>>  m_bins;         // triangle indices per tile
+    Stats                               m_stats;
+};
+
+// Packs a float color into RGBA8, saturating like a UNORM render target
+uint32_t PackRasterColor( const float color[4] );
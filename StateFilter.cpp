@@ -0,0 +1,121 @@
+//--------------------------------------------------------------------------------------
+// File: StateFilter.cpp
+//
+// Redundant state-change filtering
+//--------------------------------------------------------------------------------------
+
+#include "StateFilter.h"
+
+#include <cstdio>
+#include <cstring>
+
+
+//--------------------------------------------------------------------------------------
+bool StateFilter::Update( StateCall call, uint32_t startSlot, uint32_t count, const void* args, size_t slotBytes,
+                          uint32_t* issueStart, uint32_t* issueCount )
+{
+    std::vector<Slot>& slots = m_slots[call];
+    if( slots.size() < size_t( startSlot ) + count )
+        slots.resize( size_t( startSlot ) + count );
+
+    const uint8_t* bytes = static_cast<const uint8_t*>( args );
+    uint32_t first = count;
+    uint32_t last = 0;
+    for( uint32_t i = 0; i < count; ++i )
+    {
+        Slot& slot = slots[startSlot + i];
+        const uint8_t* arg = bytes + i * slotBytes;
+        if( slot.known && slot.args.size() == slotBytes && memcmp( slot.args.data(), arg, slotBytes ) == 0 )
+            continue;
+
+        slot.args.assign( arg, arg + slotBytes );
+        slot.known = true;
+        if( first == count )
+            first = i;
+        last = i;
+    }
+
+    if( first == count )
+    {
+        ++m_counters.filtered[call];
+        return false;
+    }
+
+    ++m_counters.issued[call];
+    if( issueStart )
+        *issueStart = startSlot + first;
+    if( issueCount )
+        *issueCount = last - first + 1;
+    return true;
+}
+
+const void* StateFilter::Last( StateCall call, uint32_t slot, size_t slotBytes ) const noexcept
+{
+    const std::vector<Slot>& slots = m_slots[call];
+    if( slot >= slots.size() || !slots[slot].known || slots[slot].args.size() != slotBytes )
+        return nullptr;
+    return slots[slot].args.data();
+}
+
+void StateFilter::Invalidate( StateCall call ) noexcept
+{
+    for( Slot& slot : m_slots[call] )
+        slot.known = false;
+}
+
+void StateFilter::InvalidateAll() noexcept
+{
+    for( uint32_t call = 0; call < STATE_CALL_COUNT; ++call )
+        Invalidate( StateCall( call ) );
+}
+
+const char* StateFilter::CallName( StateCall call ) noexcept
+{
+    switch( call )
+    {
+    case STATE_IA_INPUT_LAYOUT:         return "IASetInputLayout";
+    case STATE_IA_VERTEX_BUFFERS:       return "IASetVertexBuffers";
+    case STATE_IA_INDEX_BUFFER:         return "IASetIndexBuffer";
+    case STATE_IA_TOPOLOGY:             return "IASetPrimitiveTopology";
+    case STATE_VS_SHADER:               return "VSSetShader";
+    case STATE_VS_CONSTANT_BUFFERS:     return "VSSetConstantBuffers";
+    case STATE_PS_SHADER:               return "PSSetShader";
+    case STATE_PS_CONSTANT_BUFFERS:     return "PSSetConstantBuffers";
+    case STATE_PS_SHADER_RESOURCES:     return "PSSetShaderResources";
+    case STATE_PS_SAMPLERS:             return "PSSetSamplers";
+    case STATE_RS_STATE:                return "RSSetState";
+    case STATE_RS_VIEWPORTS:            return "RSSetViewports";
+    case STATE_RS_SCISSOR_RECTS:        return "RSSetScissorRects";
+    case STATE_OM_RENDER_TARGETS:       return "OMSetRenderTargets";
+    default:                            return "?";
+    }
+}
+
+std::string StateFilter::Format( const Counters& counters )
+{
+    uint64_t issued = 0;
+    uint64_t filtered = 0;
+    for( uint32_t call = 0; call < STATE_CALL_COUNT; ++call )
+    {
+        issued += counters.issued[call];
+        filtered += counters.filtered[call];
+    }
+
+    char line[160];
+    const uint64_t total = issued + filtered;
+    snprintf( line, sizeof( line ), "State changes: %llu issued, %llu filtered (%.1f%%)\n",
+              static_cast<unsigned long long>( issued ), static_cast<unsigned long long>( filtered ),
+              total ? 100.0 * double( filtered ) / double( total ) : 0.0 );
+    std::string out = line;
+
+    for( uint32_t call = 0; call < STATE_CALL_COUNT; ++call )
+    {
+        if( counters.issued[call] + counters.filtered[call] == 0 )
+            continue;
+        snprintf( line, sizeof( line ), "  %-24s %8llu issued %8llu filtered\n", CallName( StateCall( call ) ),
+                  static_cast<unsigned long long>( counters.issued[call] ),
+                  static_cast<unsigned long long>( counters.filtered[call] ) );
+        out += line;
+    }
+    return out;
+}
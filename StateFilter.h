@@ -0,0 +1,79 @@
+//--------------------------------------------------------------------------------------
+// File: StateFilter.h
+//
+// Redundant state-change filtering. Remembers the arguments last issued for each slot
+// of each pipeline call and tells the caller whether a new call changes anything; a
+// call whose slots all match is dropped, and a partly matching one is trimmed to the
+// slots that changed. Counts issued and filtered calls per kind.
+//
+// Only the bookkeeping lives here; D3D11StateCache applies it to a device context.
+// Anything that changes bindings behind the filter's back (ClearState, executing a
+// command list, hazard unbinds by the runtime) must be followed by an Invalidate.
+//--------------------------------------------------------------------------------------
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+
+enum StateCall : uint32_t
+{
+    STATE_IA_INPUT_LAYOUT,
+    STATE_IA_VERTEX_BUFFERS,
+    STATE_IA_INDEX_BUFFER,
+    STATE_IA_TOPOLOGY,
+    STATE_VS_SHADER,
+    STATE_VS_CONSTANT_BUFFERS,
+    STATE_PS_SHADER,
+    STATE_PS_CONSTANT_BUFFERS,
+    STATE_PS_SHADER_RESOURCES,
+    STATE_PS_SAMPLERS,
+    STATE_RS_STATE,
+    STATE_RS_VIEWPORTS,
+    STATE_RS_SCISSOR_RECTS,
+    STATE_OM_RENDER_TARGETS,
+    STATE_CALL_COUNT
+};
+
+class StateFilter
+{
+public:
+    struct Counters
+    {
+        uint64_t    issued[STATE_CALL_COUNT] = {};
+        uint64_t    filtered[STATE_CALL_COUNT] = {};
+    };
+
+    // Compares 'count' slots from 'startSlot' on, each 'slotBytes' of 'args', with what
+    // was last issued. Returns false if the call is redundant. Otherwise remembers the
+    // new arguments and returns the smallest range of slots that has to be issued.
+    bool Update( StateCall call, uint32_t startSlot, uint32_t count, const void* args, size_t slotBytes,
+                 uint32_t* issueStart = nullptr, uint32_t* issueCount = nullptr );
+
+    // Last arguments issued for a slot, or nullptr if unknown
+    const void* Last( StateCall call, uint32_t slot, size_t slotBytes ) const noexcept;
+
+    void Invalidate( StateCall call ) noexcept;
+    void InvalidateAll() noexcept;
+
+    const Counters& GetCounters() const noexcept { return m_counters; }
+    void ResetCounters() noexcept { m_counters = Counters(); }
+
+    static const char* CallName( StateCall call ) noexcept;
+
+    // One line with the totals, then one per call kind that was used
+    static std::string Format( const Counters& counters );
+
+private:
+    struct Slot
+    {
+        std::vector<uint8_t>    args;
+        bool                    known = false;
+    };
+
+    std::vector<Slot>   m_slots[STATE_CALL_COUNT];
+    Counters            m_counters;
+};
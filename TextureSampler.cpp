@@ -0,0 +1,783 @@
+//--------------------------------------------------------------------------------------
+// File: TextureSampler.cpp
+//
+// CPU textures, BC decoding and the trilinear WRAP sampler
+//--------------------------------------------------------------------------------------
+
+#include "TextureSampler.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+
+#if defined( _M_X64 ) || defined( __x86_64__ ) || defined( _M_IX86 ) || defined( __i386__ )
+#define SAMPLER_X86 1
+#include <immintrin.h>
+#if defined( _MSC_VER ) && !defined( __clang__ )
+#include <intrin.h>
+#define SAMPLER_AVX2_TARGET
+#else
+#define SAMPLER_AVX2_TARGET __attribute__( ( target( "avx2" ) ) )
+#endif
+#else
+#define SAMPLER_X86 0
+#endif
+
+
+namespace
+{
+    //? Levels of detail beyond this many mips are never needed for 2D textures
+    const size_t kMaxLevels = 32;
+
+    //? Filter weights keep 8 fraction bits
+    const float kWeightSteps = 256.0f;
+
+    uint32_t ReadLE32( const uint8_t* p )
+    {
+        return uint32_t( p[0] ) | ( uint32_t( p[1] ) << 8 ) | ( uint32_t( p[2] ) << 16 ) | ( uint32_t( p[3] ) << 24 );
+    }
+
+    //? Moves the bits under 'mask' to the low byte
+    uint32_t ExtractChannel( uint32_t pixel, uint32_t mask, uint32_t fallback )
+    {
+        if( !mask )
+            return fallback;
+        uint32_t shift = 0;
+        while( !( ( mask >> shift ) & 1 ) )
+            ++shift;
+        return ( pixel & mask ) >> shift;
+    }
+
+    uint32_t PackRGBA( uint32_t r, uint32_t g, uint32_t b, uint32_t a )
+    {
+        return r | ( g << 8 ) | ( b << 16 ) | ( a << 24 );
+    }
+
+    //? BC1-BC3 color block. BC2 and BC3 always use the four-color mode.
+    void DecodeColorBlock( const uint8_t* block, bool punchThrough, uint32_t out[16] )
+    {
+        const uint32_t c0 = uint32_t( block[0] ) | ( uint32_t( block[1] ) << 8 );
+        const uint32_t c1 = uint32_t( block[2] ) | ( uint32_t( block[3] ) << 8 );
+        uint32_t rgb[4][3];
+        for( int i = 0; i < 2; ++i )
+        {
+            const uint32_t c = i ? c1 : c0;
+            const uint32_t r = ( c >> 11 ) & 31, g = ( c >> 5 ) & 63, b = c & 31;
+            rgb[i][0] = ( r << 3 ) | ( r >> 2 );
+            rgb[i][1] = ( g << 2 ) | ( g >> 4 );
+            rgb[i][2] = ( b << 3 ) | ( b >> 2 );
+        }
+
+        uint32_t palette[4];
+        palette[0] = PackRGBA( rgb[0][0], rgb[0][1], rgb[0][2], 255 );
+        palette[1] = PackRGBA( rgb[1][0], rgb[1][1], rgb[1][2], 255 );
+        if( c0 > c1 || !punchThrough )
+        {
+            uint32_t mix[2][3];
+            for( int k = 0; k < 3; ++k )
+            {
+                mix[0][k] = ( 2 * rgb[0][k] + rgb[1][k] + 1 ) / 3;
+                mix[1][k] = ( rgb[0][k] + 2 * rgb[1][k] + 1 ) / 3;
+            }
+            palette[2] = PackRGBA( mix[0][0], mix[0][1], mix[0][2], 255 );
+            palette[3] = PackRGBA( mix[1][0], mix[1][1], mix[1][2], 255 );
+        }
+        else
+        {
+            palette[2] = PackRGBA( ( rgb[0][0] + rgb[1][0] + 1 ) / 2, ( rgb[0][1] + rgb[1][1] + 1 ) / 2, ( rgb[0][2] + rgb[1][2] + 1 ) / 2, 255 );
+            palette[3] = 0;
+        }
+
+        const uint32_t indices = ReadLE32( block + 4 );
+        for( int i = 0; i < 16; ++i )
+            out[i] = palette[( indices >> ( 2 * i ) ) & 3];
+    }
+
+    void DecodeExplicitAlpha( const uint8_t* block, uint32_t out[16] )
+    {
+        for( int i = 0; i < 16; ++i )
+        {
+            const uint32_t a = ( block[i / 2] >> ( 4 * ( i & 1 ) ) ) & 15;
+            out[i] = ( out[i] & 0x00ffffffu ) | ( ( a * 17 ) << 24 );
+        }
+    }
+
+    void DecodeInterpolatedAlpha( const uint8_t* block, uint32_t out[16] )
+    {
+        const uint32_t a0 = block[0], a1 = block[1];
+        uint32_t palette[8] = { a0, a1 };
+        if( a0 > a1 )
+        {
+            for( uint32_t i = 1; i < 7; ++i )
+                palette[i + 1] = ( ( 7 - i ) * a0 + i * a1 + 3 ) / 7;
+        }
+        else
+        {
+            for( uint32_t i = 1; i < 5; ++i )
+                palette[i + 1] = ( ( 5 - i ) * a0 + i * a1 + 2 ) / 5;
+            palette[6] = 0;
+            palette[7] = 255;
+        }
+
+        uint64_t indices = 0;
+        for( int i = 0; i < 6; ++i )
+            indices |= uint64_t( block[2 + i] ) << ( 8 * i );
+        for( int i = 0; i < 16; ++i )
+            out[i] = ( out[i] & 0x00ffffffu ) | ( palette[( indices >> ( 3 * i ) ) & 7] << 24 );
+    }
+
+    //? Fraction snapped to the filter's fixed-point weights
+    float QuantizeWeight( float fraction )
+    {
+        return float( int32_t( fraction * kWeightSteps + 0.5f ) ) * ( 1.0f / kWeightSteps );
+    }
+
+    //? The fractional part of a texture coordinate; 0 for anything not finite
+    float WrapCoordinate( float u )
+    {
+        const float wrapped = u - floorf( u );
+        return wrapped >= 0.0f && wrapped < 1.0f ? wrapped : 0.0f;
+    }
+
+    //? The two texels a coordinate falls between along one axis, and the weight of the second
+    void LinearTaps( float wrapped, uint32_t size, uint32_t* first, uint32_t* second, float* weight )
+    {
+        const float x = wrapped * float( size ) - 0.5f;
+        const int32_t floor = int32_t( x + 1.0f ) - 1;
+        *weight = QuantizeWeight( x - float( floor ) );
+        *first = floor < 0 ? size - 1 : uint32_t( floor );
+        *second = uint32_t( floor + 1 ) == size ? 0 : uint32_t( floor + 1 );
+    }
+
+    void SampleLevelScalar( const SoftwareTexture& texture, size_t level, float u, float v, float out[4] )
+    {
+        const SoftwareTexture::Level& l = texture.levels[level];
+        uint32_t x0, x1, y0, y1;
+        float wx, wy;
+        LinearTaps( WrapCoordinate( u ), l.width, &x0, &x1, &wx );
+        LinearTaps( WrapCoordinate( v ), l.height, &y0, &y1, &wy );
+
+        const uint32_t t00 = texture.Fetch( level, x0, y0 ), t10 = texture.Fetch( level, x1, y0 );
+        const uint32_t t01 = texture.Fetch( level, x0, y1 ), t11 = texture.Fetch( level, x1, y1 );
+        for( int c = 0; c < 4; ++c )
+        {
+            const float a00 = float( ( t00 >> ( 8 * c ) ) & 0xff ), a10 = float( ( t10 >> ( 8 * c ) ) & 0xff );
+            const float a01 = float( ( t01 >> ( 8 * c ) ) & 0xff ), a11 = float( ( t11 >> ( 8 * c ) ) & 0xff );
+            const float top = a00 + ( a10 - a00 ) * wx;
+            const float bottom = a01 + ( a11 - a01 ) * wx;
+            out[c] = top + ( bottom - top ) * wy;
+        }
+    }
+
+    //? Splits a level of detail into the finer level and the weight of the next one
+    void SelectLevels( const SoftwareTexture& texture, float lod, size_t* fine, size_t* coarse, float* weight )
+    {
+        const float top = float( texture.levels.size() - 1 );
+        const float clamped = std::min( lod > 0.0f ? lod : 0.0f, top );
+        *fine = size_t( clamped );
+        *coarse = std::min( *fine + 1, texture.levels.size() - 1 );
+        *weight = QuantizeWeight( clamped - float( *fine ) );
+    }
+
+    void SampleScalar( const SoftwareTexture& texture, const float* u, const float* v, const float* lod, size_t count, float* rgba )
+    {
+        for( size_t i = 0; i < count; ++i )
+        {
+            size_t fine, coarse;
+            float weight;
+            SelectLevels( texture, lod[i], &fine, &coarse, &weight );
+
+            float a[4], b[4];
+            SampleLevelScalar( texture, fine, u[i], v[i], a );
+            SampleLevelScalar( texture, coarse, u[i], v[i], b );
+            for( int c = 0; c < 4; ++c )
+                rgba[4 * i + c] = ( a[c] + ( b[c] - a[c] ) * weight ) * ( 1.0f / 255.0f );
+        }
+    }
+
+#if SAMPLER_X86
+    bool CpuHasAVX2()
+    {
+#if defined( _MSC_VER ) && !defined( __clang__ )
+        int info[4];
+        __cpuid( info, 0 );
+        if( info[0] < 7 )
+            return false;
+        __cpuid( info, 1 );
+        const bool osSavesYmm = ( info[2] & ( 1 << 27 ) ) && ( info[2] & ( 1 << 28 ) ) && ( _xgetbv( 0 ) & 6 ) == 6;
+        __cpuidex( info, 7, 0 );
+        return osSavesYmm && ( info[1] & ( 1 << 5 ) );
+#else
+        return __builtin_cpu_supports( "avx2" );
+#endif
+    }
+
+    //? Lanes of SSE2 floor for |x| < 2^31; anything larger fails the range check after it
+    __m128 WrapCoordinateSSE2( __m128 u )
+    {
+        const __m128 one = _mm_set1_ps( 1.0f );
+        __m128 floor = _mm_cvtepi32_ps( _mm_cvttps_epi32( u ) );
+        floor = _mm_sub_ps( floor, _mm_and_ps( _mm_cmpgt_ps( floor, u ), one ) );
+        const __m128 wrapped = _mm_sub_ps( u, floor );
+        return _mm_and_ps( wrapped, _mm_and_ps( _mm_cmpge_ps( wrapped, _mm_setzero_ps() ), _mm_cmplt_ps( wrapped, one ) ) );
+    }
+
+    __m128 QuantizeWeightSSE2( __m128 fraction )
+    {
+        const __m128i steps = _mm_cvttps_epi32( _mm_add_ps( _mm_mul_ps( fraction, _mm_set1_ps( kWeightSteps ) ), _mm_set1_ps( 0.5f ) ) );
+        return _mm_mul_ps( _mm_cvtepi32_ps( steps ), _mm_set1_ps( 1.0f / kWeightSteps ) );
+    }
+
+    void LinearTapsSSE2( __m128 wrapped, __m128i size, __m128i* first, __m128i* second, __m128* weight )
+    {
+        const __m128i one = _mm_set1_epi32( 1 );
+        const __m128 x = _mm_sub_ps( _mm_mul_ps( wrapped, _mm_cvtepi32_ps( size ) ), _mm_set1_ps( 0.5f ) );
+        const __m128i floor = _mm_sub_epi32( _mm_cvttps_epi32( _mm_add_ps( x, _mm_set1_ps( 1.0f ) ) ), one );
+        *weight = QuantizeWeightSSE2( _mm_sub_ps( x, _mm_cvtepi32_ps( floor ) ) );
+        *first = _mm_add_epi32( floor, _mm_and_si128( size, _mm_cmplt_epi32( floor, _mm_setzero_si128() ) ) );
+        const __m128i next = _mm_add_epi32( floor, one );
+        *second = _mm_andnot_si128( _mm_cmpeq_epi32( next, size ), next );
+    }
+
+    //? Four points, each on its own level; texel addresses are per lane
+    void SampleLevelSSE2( const SoftwareTexture& texture, const uint32_t level[4], __m128 u, __m128 v, __m128 out[4] )
+    {
+        const SoftwareTexture::Level* levels[4] = { &texture.levels[level[0]], &texture.levels[level[1]],
+                                                    &texture.levels[level[2]], &texture.levels[level[3]] };
+        const __m128i width = _mm_setr_epi32( int32_t( levels[0]->width ), int32_t( levels[1]->width ),
+                                              int32_t( levels[2]->width ), int32_t( levels[3]->width ) );
+        const __m128i height = _mm_setr_epi32( int32_t( levels[0]->height ), int32_t( levels[1]->height ),
+                                               int32_t( levels[2]->height ), int32_t( levels[3]->height ) );
+
+        __m128i x0, x1, y0, y1;
+        __m128 wx, wy;
+        LinearTapsSSE2( WrapCoordinateSSE2( u ), width, &x0, &x1, &wx );
+        LinearTapsSSE2( WrapCoordinateSSE2( v ), height, &y0, &y1, &wy );
+
+        uint32_t xs[2][4], ys[2][4], texels[4][4];
+        _mm_storeu_si128( reinterpret_cast<__m128i*>( xs[0] ), x0 );
+        _mm_storeu_si128( reinterpret_cast<__m128i*>( xs[1] ), x1 );
+        _mm_storeu_si128( reinterpret_cast<__m128i*>( ys[0] ), y0 );
+        _mm_storeu_si128( reinterpret_cast<__m128i*>( ys[1] ), y1 );
+        for( int lane = 0; lane < 4; ++lane )
+        {
+            texels[0][lane] = texture.Fetch( level[lane], xs[0][lane], ys[0][lane] );
+            texels[1][lane] = texture.Fetch( level[lane], xs[1][lane], ys[0][lane] );
+            texels[2][lane] = texture.Fetch( level[lane], xs[0][lane], ys[1][lane] );
+            texels[3][lane] = texture.Fetch( level[lane], xs[1][lane], ys[1][lane] );
+        }
+        const __m128i t00 = _mm_loadu_si128( reinterpret_cast<const __m128i*>( texels[0] ) );
+        const __m128i t10 = _mm_loadu_si128( reinterpret_cast<const __m128i*>( texels[1] ) );
+        const __m128i t01 = _mm_loadu_si128( reinterpret_cast<const __m128i*>( texels[2] ) );
+        const __m128i t11 = _mm_loadu_si128( reinterpret_cast<const __m128i*>( texels[3] ) );
+
+        const __m128i byte = _mm_set1_epi32( 0xff );
+        for( int c = 0; c < 4; ++c )
+        {
+            const __m128i shift = _mm_cvtsi32_si128( 8 * c );
+            const __m128 a00 = _mm_cvtepi32_ps( _mm_and_si128( _mm_srl_epi32( t00, shift ), byte ) );
+            const __m128 a10 = _mm_cvtepi32_ps( _mm_and_si128( _mm_srl_epi32( t10, shift ), byte ) );
+            const __m128 a01 = _mm_cvtepi32_ps( _mm_and_si128( _mm_srl_epi32( t01, shift ), byte ) );
+            const __m128 a11 = _mm_cvtepi32_ps( _mm_and_si128( _mm_srl_epi32( t11, shift ), byte ) );
+            const __m128 top = _mm_add_ps( a00, _mm_mul_ps( _mm_sub_ps( a10, a00 ), wx ) );
+            const __m128 bottom = _mm_add_ps( a01, _mm_mul_ps( _mm_sub_ps( a11, a01 ), wx ) );
+            out[c] = _mm_add_ps( top, _mm_mul_ps( _mm_sub_ps( bottom, top ), wy ) );
+        }
+    }
+
+    void SampleSSE2( const SoftwareTexture& texture, const float* u, const float* v, const float* lod, size_t count, float* rgba )
+    {
+        const __m128 top = _mm_set1_ps( float( texture.levels.size() - 1 ) );
+        const __m128 scale = _mm_set1_ps( 1.0f / 255.0f );
+        for( size_t i = 0; i < count; i += 4 )
+        {
+            //? A short last batch samples padding at 0 and drops it
+            const size_t lanes = std::min<size_t>( count - i, 4 );
+            float us[4] = {}, vs[4] = {}, lods[4] = {};
+            memcpy( us, u + i, lanes * sizeof( float ) );
+            memcpy( vs, v + i, lanes * sizeof( float ) );
+            memcpy( lods, lod + i, lanes * sizeof( float ) );
+
+            //? max() returns its second operand for NaN, so a NaN level of detail is 0
+            const __m128 clamped = _mm_min_ps( _mm_max_ps( _mm_loadu_ps( lods ), _mm_setzero_ps() ), top );
+            const __m128i fine = _mm_cvttps_epi32( clamped );
+            const __m128 weight = QuantizeWeightSSE2( _mm_sub_ps( clamped, _mm_cvtepi32_ps( fine ) ) );
+            uint32_t fineLevels[4], coarseLevels[4];
+            _mm_storeu_si128( reinterpret_cast<__m128i*>( fineLevels ), fine );
+            for( int lane = 0; lane < 4; ++lane )
+                coarseLevels[lane] = std::min<uint32_t>( fineLevels[lane] + 1, uint32_t( texture.levels.size() - 1 ) );
+
+            __m128 a[4], b[4];
+            SampleLevelSSE2( texture, fineLevels, _mm_loadu_ps( us ), _mm_loadu_ps( vs ), a );
+            SampleLevelSSE2( texture, coarseLevels, _mm_loadu_ps( us ), _mm_loadu_ps( vs ), b );
+
+            float channels[4][4];
+            for( int c = 0; c < 4; ++c )
+                _mm_storeu_ps( channels[c], _mm_mul_ps( _mm_add_ps( a[c], _mm_mul_ps( _mm_sub_ps( b[c], a[c] ), weight ) ), scale ) );
+            for( size_t lane = 0; lane < lanes; ++lane )
+            {
+                for( int c = 0; c < 4; ++c )
+                    rgba[4 * ( i + lane ) + c] = channels[c][lane];
+            }
+        }
+    }
+
+    //? The per-level values the AVX2 path gathers by level index
+    struct LevelTable
+    {
+        int32_t     width[kMaxLevels];
+        int32_t     height[kMaxLevels];
+        int32_t     tilesX[kMaxLevels];
+        int32_t     offset[kMaxLevels];
+    };
+
+    SAMPLER_AVX2_TARGET __m256 WrapCoordinateAVX2( __m256 u )
+    {
+        const __m256 one = _mm256_set1_ps( 1.0f );
+        __m256 floor = _mm256_cvtepi32_ps( _mm256_cvttps_epi32( u ) );
+        floor = _mm256_sub_ps( floor, _mm256_and_ps( _mm256_cmp_ps( floor, u, _CMP_GT_OQ ), one ) );
+        const __m256 wrapped = _mm256_sub_ps( u, floor );
+        return _mm256_and_ps( wrapped, _mm256_and_ps( _mm256_cmp_ps( wrapped, _mm256_setzero_ps(), _CMP_GE_OQ ),
+                                                      _mm256_cmp_ps( wrapped, one, _CMP_LT_OQ ) ) );
+    }
+
+    SAMPLER_AVX2_TARGET __m256 QuantizeWeightAVX2( __m256 fraction )
+    {
+        const __m256i steps = _mm256_cvttps_epi32( _mm256_add_ps( _mm256_mul_ps( fraction, _mm256_set1_ps( kWeightSteps ) ), _mm256_set1_ps( 0.5f ) ) );
+        return _mm256_mul_ps( _mm256_cvtepi32_ps( steps ), _mm256_set1_ps( 1.0f / kWeightSteps ) );
+    }
+
+    SAMPLER_AVX2_TARGET void LinearTapsAVX2( __m256 wrapped, __m256i size, __m256i* first, __m256i* second, __m256* weight )
+    {
+        const __m256i one = _mm256_set1_epi32( 1 );
+        const __m256 x = _mm256_sub_ps( _mm256_mul_ps( wrapped, _mm256_cvtepi32_ps( size ) ), _mm256_set1_ps( 0.5f ) );
+        const __m256i floor = _mm256_sub_epi32( _mm256_cvttps_epi32( _mm256_add_ps( x, _mm256_set1_ps( 1.0f ) ) ), one );
+        *weight = QuantizeWeightAVX2( _mm256_sub_ps( x, _mm256_cvtepi32_ps( floor ) ) );
+        *first = _mm256_add_epi32( floor, _mm256_and_si256( size, _mm256_cmpgt_epi32( _mm256_setzero_si256(), floor ) ) );
+        const __m256i next = _mm256_add_epi32( floor, one );
+        *second = _mm256_andnot_si256( _mm256_cmpeq_epi32( next, size ), next );
+    }
+
+    //? Spreads the three low bits of each lane to the even bits
+    SAMPLER_AVX2_TARGET __m256i SpreadBitsAVX2( __m256i v )
+    {
+        return _mm256_or_si256( _mm256_and_si256( v, _mm256_set1_epi32( 1 ) ),
+                                _mm256_or_si256( _mm256_slli_epi32( _mm256_and_si256( v, _mm256_set1_epi32( 2 ) ), 1 ),
+                                                 _mm256_slli_epi32( _mm256_and_si256( v, _mm256_set1_epi32( 4 ) ), 2 ) ) );
+    }
+
+    SAMPLER_AVX2_TARGET __m256i TexelIndexAVX2( const SoftwareTexture& texture, __m256i tilesX, __m256i offset, __m256i width,
+                                                __m256i x, __m256i y )
+    {
+        if( texture.layout == TEXEL_LAYOUT_LINEAR )
+            return _mm256_add_epi32( offset, _mm256_add_epi32( _mm256_mullo_epi32( y, width ), x ) );
+
+        const __m256i seven = _mm256_set1_epi32( 7 );
+        const __m256i tile = _mm256_add_epi32( _mm256_mullo_epi32( _mm256_srli_epi32( y, 3 ), tilesX ), _mm256_srli_epi32( x, 3 ) );
+        const __m256i morton = _mm256_or_si256( SpreadBitsAVX2( _mm256_and_si256( x, seven ) ),
+                                                _mm256_slli_epi32( SpreadBitsAVX2( _mm256_and_si256( y, seven ) ), 1 ) );
+        return _mm256_add_epi32( offset, _mm256_add_epi32( _mm256_slli_epi32( tile, 6 ), morton ) );
+    }
+
+    SAMPLER_AVX2_TARGET void SampleLevelAVX2( const SoftwareTexture& texture, const LevelTable& table, __m256i level,
+                                              __m256 u, __m256 v, __m256 out[4] )
+    {
+        const __m256i width = _mm256_i32gather_epi32( table.width, level, 4 );
+        const __m256i height = _mm256_i32gather_epi32( table.height, level, 4 );
+        const __m256i tilesX = _mm256_i32gather_epi32( table.tilesX, level, 4 );
+        const __m256i offset = _mm256_i32gather_epi32( table.offset, level, 4 );
+
+        __m256i x0, x1, y0, y1;
+        __m256 wx, wy;
+        LinearTapsAVX2( WrapCoordinateAVX2( u ), width, &x0, &x1, &wx );
+        LinearTapsAVX2( WrapCoordinateAVX2( v ), height, &y0, &y1, &wy );
+
+        const int* texels = reinterpret_cast<const int*>( texture.texels.data() );
+        const __m256i t00 = _mm256_i32gather_epi32( texels, TexelIndexAVX2( texture, tilesX, offset, width, x0, y0 ), 4 );
+        const __m256i t10 = _mm256_i32gather_epi32( texels, TexelIndexAVX2( texture, tilesX, offset, width, x1, y0 ), 4 );
+        const __m256i t01 = _mm256_i32gather_epi32( texels, TexelIndexAVX2( texture, tilesX, offset, width, x0, y1 ), 4 );
+        const __m256i t11 = _mm256_i32gather_epi32( texels, TexelIndexAVX2( texture, tilesX, offset, width, x1, y1 ), 4 );
+
+        const __m256i byte = _mm256_set1_epi32( 0xff );
+        for( int c = 0; c < 4; ++c )
+        {
+            const __m128i shift = _mm_cvtsi32_si128( 8 * c );
+            const __m256 a00 = _mm256_cvtepi32_ps( _mm256_and_si256( _mm256_srl_epi32( t00, shift ), byte ) );
+            const __m256 a10 = _mm256_cvtepi32_ps( _mm256_and_si256( _mm256_srl_epi32( t10, shift ), byte ) );
+            const __m256 a01 = _mm256_cvtepi32_ps( _mm256_and_si256( _mm256_srl_epi32( t01, shift ), byte ) );
+            const __m256 a11 = _mm256_cvtepi32_ps( _mm256_and_si256( _mm256_srl_epi32( t11, shift ), byte ) );
+            const __m256 top = _mm256_add_ps( a00, _mm256_mul_ps( _mm256_sub_ps( a10, a00 ), wx ) );
+            const __m256 bottom = _mm256_add_ps( a01, _mm256_mul_ps( _mm256_sub_ps( a11, a01 ), wx ) );
+            out[c] = _mm256_add_ps( top, _mm256_mul_ps( _mm256_sub_ps( bottom, top ), wy ) );
+        }
+    }
+
+    SAMPLER_AVX2_TARGET void SampleAVX2( const SoftwareTexture& texture, const float* u, const float* v, const float* lod, size_t count, float* rgba )
+    {
+        LevelTable table;
+        for( size_t i = 0; i < texture.levels.size(); ++i )
+        {
+            table.width[i] = int32_t( texture.levels[i].width );
+            table.height[i] = int32_t( texture.levels[i].height );
+            table.tilesX[i] = int32_t( texture.levels[i].tilesX );
+            table.offset[i] = int32_t( texture.levels[i].offset );
+        }
+
+        const __m256 top = _mm256_set1_ps( float( texture.levels.size() - 1 ) );
+        const __m256i lastLevel = _mm256_set1_epi32( int32_t( texture.levels.size() - 1 ) );
+        const __m256 scale = _mm256_set1_ps( 1.0f / 255.0f );
+        for( size_t i = 0; i < count; i += 8 )
+        {
+            const size_t lanes = std::min<size_t>( count - i, 8 );
+            float us[8] = {}, vs[8] = {}, lods[8] = {};
+            memcpy( us, u + i, lanes * sizeof( float ) );
+            memcpy( vs, v + i, lanes * sizeof( float ) );
+            memcpy( lods, lod + i, lanes * sizeof( float ) );
+
+            const __m256 clamped = _mm256_min_ps( _mm256_max_ps( _mm256_loadu_ps( lods ), _mm256_setzero_ps() ), top );
+            const __m256i fine = _mm256_cvttps_epi32( clamped );
+            const __m256i coarse = _mm256_min_epi32( _mm256_add_epi32( fine, _mm256_set1_epi32( 1 ) ), lastLevel );
+            const __m256 weight = QuantizeWeightAVX2( _mm256_sub_ps( clamped, _mm256_cvtepi32_ps( fine ) ) );
+
+            __m256 a[4], b[4];
+            SampleLevelAVX2( texture, table, fine, _mm256_loadu_ps( us ), _mm256_loadu_ps( vs ), a );
+            SampleLevelAVX2( texture, table, coarse, _mm256_loadu_ps( us ), _mm256_loadu_ps( vs ), b );
+
+            float channels[4][8];
+            for( int c = 0; c < 4; ++c )
+                _mm256_storeu_ps( channels[c], _mm256_mul_ps( _mm256_add_ps( a[c], _mm256_mul_ps( _mm256_sub_ps( b[c], a[c] ), weight ) ), scale ) );
+            for( size_t lane = 0; lane < lanes; ++lane )
+            {
+                for( int c = 0; c < 4; ++c )
+                    rgba[4 * ( i + lane ) + c] = channels[c][lane];
+            }
+        }
+    }
+#endif
+}
+
+//--------------------------------------------------------------------------------------
+void AppendTextureLevel( SoftwareTexture& texture, uint32_t width, uint32_t height, const uint32_t* rgba )
+{
+    SoftwareTexture::Level level;
+    level.width = width;
+    level.height = height;
+    level.tilesX = ( width + SoftwareTexture::kTileSize - 1 ) / SoftwareTexture::kTileSize;
+    level.offset = uint32_t( texture.texels.size() );
+
+    const uint32_t tilesY = ( height + SoftwareTexture::kTileSize - 1 ) / SoftwareTexture::kTileSize;
+    const size_t texels = texture.layout == TEXEL_LAYOUT_LINEAR ? size_t( width ) * height
+                                                                : size_t( level.tilesX ) * tilesY * SoftwareTexture::kTileSize * SoftwareTexture::kTileSize;
+    texture.texels.resize( texture.texels.size() + texels, 0 );
+    texture.levels.push_back( level );
+
+    const size_t index = texture.levels.size() - 1;
+    for( uint32_t y = 0; y < height; ++y )
+    {
+        for( uint32_t x = 0; x < width; ++x )
+            texture.texels[texture.TexelIndex( index, x, y )] = rgba[size_t( y ) * width + x];
+    }
+}
+
+void SetTextureLayout( SoftwareTexture& texture, TexelLayout layout )
+{
+    if( texture.layout == layout )
+        return;
+
+    SoftwareTexture converted;
+    converted.layout = layout;
+    std::vector<uint32_t> rows;
+    for( size_t i = 0; i < texture.levels.size(); ++i )
+    {
+        const SoftwareTexture::Level& level = texture.levels[i];
+        rows.resize( size_t( level.width ) * level.height );
+        for( uint32_t y = 0; y < level.height; ++y )
+        {
+            for( uint32_t x = 0; x < level.width; ++x )
+                rows[size_t( y ) * level.width + x] = texture.Fetch( i, x, y );
+        }
+        AppendTextureLevel( converted, level.width, level.height, rows.data() );
+    }
+    texture = std::move( converted );
+}
+
+void GenerateTextureMips( SoftwareTexture& texture )
+{
+    if( texture.Empty() )
+        return;
+
+    uint32_t width = texture.levels[0].width;
+    uint32_t height = texture.levels[0].height;
+    std::vector<uint32_t> rows( size_t( width ) * height );
+    for( uint32_t y = 0; y < height; ++y )
+    {
+        for( uint32_t x = 0; x < width; ++x )
+            rows[size_t( y ) * width + x] = texture.Fetch( 0, x, y );
+    }
+
+    SoftwareTexture chain;
+    chain.layout = texture.layout;
+    AppendTextureLevel( chain, width, height, rows.data() );
+
+    //? Odd sizes round down; their last row or column is folded into the one before
+    std::vector<uint32_t> next;
+    while( ( width > 1 || height > 1 ) && chain.levels.size() < kMaxLevels )
+    {
+        const uint32_t nextWidth = std::max( width / 2, 1u );
+        const uint32_t nextHeight = std::max( height / 2, 1u );
+        next.resize( size_t( nextWidth ) * nextHeight );
+        for( uint32_t y = 0; y < nextHeight; ++y )
+        {
+            const uint32_t sy0 = std::min( y * 2, height - 1 ), sy1 = std::min( y * 2 + 1, height - 1 );
+            for( uint32_t x = 0; x < nextWidth; ++x )
+            {
+                const uint32_t sx0 = std::min( x * 2, width - 1 ), sx1 = std::min( x * 2 + 1, width - 1 );
+                const uint32_t taps[4] = { rows[size_t( sy0 ) * width + sx0], rows[size_t( sy0 ) * width + sx1],
+                                           rows[size_t( sy1 ) * width + sx0], rows[size_t( sy1 ) * width + sx1] };
+                uint32_t texel = 0;
+                for( int c = 0; c < 4; ++c )
+                {
+                    uint32_t sum = 2;
+                    for( uint32_t tap : taps )
+                        sum += ( tap >> ( 8 * c ) ) & 0xff;
+                    texel |= ( sum / 4 ) << ( 8 * c );
+                }
+                next[size_t( y ) * nextWidth + x] = texel;
+            }
+        }
+        AppendTextureLevel( chain, nextWidth, nextHeight, next.data() );
+        rows.swap( next );
+        width = nextWidth;
+        height = nextHeight;
+    }
+    texture = std::move( chain );
+}
+
+size_t BCImageBytes( BCFormat format, uint32_t width, uint32_t height )
+{
+    const size_t blocks = size_t( ( width + 3 ) / 4 ) * ( ( height + 3 ) / 4 );
+    return blocks * ( format == BC_FORMAT_BC1 ? 8 : 16 );
+}
+
+void DecodeBC( BCFormat format, const uint8_t* blocks, uint32_t width, uint32_t height, uint32_t* rgba )
+{
+    const size_t blockBytes = format == BC_FORMAT_BC1 ? 8 : 16;
+    const uint32_t blocksX = ( width + 3 ) / 4;
+    const uint32_t blocksY = ( height + 3 ) / 4;
+    for( uint32_t by = 0; by < blocksY; ++by )
+    {
+        for( uint32_t bx = 0; bx < blocksX; ++bx )
+        {
+            const uint8_t* block = blocks + ( size_t( by ) * blocksX + bx ) * blockBytes;
+            uint32_t texels[16];
+            if( format == BC_FORMAT_BC1 )
+            {
+                DecodeColorBlock( block, true, texels );
+            }
+            else
+            {
+                DecodeColorBlock( block + 8, false, texels );
+                if( format == BC_FORMAT_BC2 )
+                    DecodeExplicitAlpha( block, texels );
+                else
+                    DecodeInterpolatedAlpha( block, texels );
+            }
+
+            for( uint32_t y = 0; y < 4 && by * 4 + y < height; ++y )
+            {
+                for( uint32_t x = 0; x < 4 && bx * 4 + x < width; ++x )
+                    rgba[size_t( by * 4 + y ) * width + bx * 4 + x] = texels[y * 4 + x];
+            }
+        }
+    }
+}
+
+bool LoadSoftwareTextureDDS( const char* path, SoftwareTexture& texture )
+{
+    FILE* file = fopen( path, "rb" );
+    if( !file )
+        return false;
+
+    std::vector<uint8_t> data;
+    uint8_t chunk[4096];
+    size_t read = 0;
+    while( ( read = fread( chunk, 1, sizeof( chunk ), file ) ) > 0 )
+        data.insert( data.end(), chunk, chunk + read );
+    fclose( file );
+
+    //? Magic, then the 124-byte header; the pixel format starts 76 bytes in
+    if( data.size() < 128 || memcmp( data.data(), "DDS ", 4 ) != 0 )
+        return false;
+
+    const uint32_t flags = ReadLE32( &data[8] );
+    const uint32_t height = ReadLE32( &data[12] );
+    const uint32_t width = ReadLE32( &data[16] );
+    const uint32_t mipMapCount = ReadLE32( &data[28] );
+    const uint32_t formatFlags = ReadLE32( &data[80] );
+    const uint32_t fourCC = ReadLE32( &data[84] );
+    const uint32_t bitCount = ReadLE32( &data[88] );
+    const uint32_t caps2 = ReadLE32( &data[112] );
+    uint32_t masks[4] = { ReadLE32( &data[92] ), ReadLE32( &data[96] ), ReadLE32( &data[100] ), ReadLE32( &data[104] ) };
+    size_t offset = 128;
+
+    const uint32_t kMipMapCount = 0x20000;
+    const uint32_t kFourCC = 0x4;
+    const uint32_t kAlphaPixels = 0x1;
+    const uint32_t kRGB = 0x40;
+    const uint32_t kVolume = 0x200000;
+    if( caps2 & kVolume )
+        return false;
+
+    bool compressed = false;
+    BCFormat bcFormat = BC_FORMAT_BC1;
+    if( formatFlags & kFourCC )
+    {
+        compressed = true;
+        switch( fourCC )
+        {
+        case 0x31545844: bcFormat = BC_FORMAT_BC1; break;                           // 'DXT1'
+        case 0x32545844: case 0x33545844: bcFormat = BC_FORMAT_BC2; break;          // 'DXT2', 'DXT3'
+        case 0x34545844: case 0x35545844: bcFormat = BC_FORMAT_BC3; break;          // 'DXT4', 'DXT5'
+        case 0x30315844:                                                            // 'DX10'
+        {
+            if( data.size() < 148 || ReadLE32( &data[132] ) == 4 )                  // TEXTURE3D
+                return false;
+            const uint32_t dxgiFormat = ReadLE32( &data[128] );
+            offset = 148;
+            compressed = false;
+            if( dxgiFormat == 28 || dxgiFormat == 29 )          // R8G8B8A8_UNORM(_SRGB)
+            {
+                masks[0] = 0x000000ff; masks[1] = 0x0000ff00; masks[2] = 0x00ff0000; masks[3] = 0xff000000;
+            }
+            else if( dxgiFormat == 87 || dxgiFormat == 91 )     // B8G8R8A8_UNORM(_SRGB)
+            {
+                masks[0] = 0x00ff0000; masks[1] = 0x0000ff00; masks[2] = 0x000000ff; masks[3] = 0xff000000;
+            }
+            else if( dxgiFormat == 71 || dxgiFormat == 72 )     // BC1_UNORM(_SRGB)
+            {
+                compressed = true;
+                bcFormat = BC_FORMAT_BC1;
+            }
+            else if( dxgiFormat == 74 || dxgiFormat == 75 )     // BC2_UNORM(_SRGB)
+            {
+                compressed = true;
+                bcFormat = BC_FORMAT_BC2;
+            }
+            else if( dxgiFormat == 77 || dxgiFormat == 78 )     // BC3_UNORM(_SRGB)
+            {
+                compressed = true;
+                bcFormat = BC_FORMAT_BC3;
+            }
+            else
+            {
+                return false;
+            }
+            break;
+        }
+        default:
+            return false;
+        }
+    }
+    else if( !( formatFlags & kRGB ) || bitCount != 32 )
+    {
+        return false;
+    }
+    else if( !( formatFlags & kAlphaPixels ) )
+    {
+        masks[3] = 0;
+    }
+
+    if( !width || !height )
+        return false;
+
+    //? Only as many levels as the chain has, whatever the header claims
+    uint32_t levels = ( flags & kMipMapCount ) && mipMapCount ? mipMapCount : 1;
+    uint32_t fullChain = 1;
+    while( ( std::max( width, height ) >> fullChain ) > 0 )
+        ++fullChain;
+    levels = std::min( levels, fullChain );
+
+    SoftwareTexture loaded;
+    std::vector<uint32_t> rows;
+    for( uint32_t level = 0; level < levels; ++level )
+    {
+        const uint32_t levelWidth = std::max( width >> level, 1u );
+        const uint32_t levelHeight = std::max( height >> level, 1u );
+        const size_t bytes = compressed ? BCImageBytes( bcFormat, levelWidth, levelHeight ) : size_t( levelWidth ) * levelHeight * 4;
+        if( data.size() - offset < bytes )
+            return false;
+
+        rows.resize( size_t( levelWidth ) * levelHeight );
+        if( compressed )
+        {
+            DecodeBC( bcFormat, &data[offset], levelWidth, levelHeight, rows.data() );
+        }
+        else
+        {
+            for( size_t i = 0; i < rows.size(); ++i )
+            {
+                const uint32_t pixel = ReadLE32( &data[offset + i * 4] );
+                rows[i] = PackRGBA( ExtractChannel( pixel, masks[0], 0 ), ExtractChannel( pixel, masks[1], 0 ),
+                                    ExtractChannel( pixel, masks[2], 0 ), ExtractChannel( pixel, masks[3], 0xff ) );
+            }
+        }
+        AppendTextureLevel( loaded, levelWidth, levelHeight, rows.data() );
+        offset += bytes;
+    }
+
+    texture = std::move( loaded );
+    return true;
+}
+
+float ComputeTextureLod( const SoftwareTexture& texture, float dudx, float dvdx, float dudy, float dvdy )
+{
+    if( texture.Empty() )
+        return 0.0f;
+
+    const float width = float( texture.levels[0].width );
+    const float height = float( texture.levels[0].height );
+    const float x = ( dudx * width ) * ( dudx * width ) + ( dvdx * height ) * ( dvdx * height );
+    const float y = ( dudy * width ) * ( dudy * width ) + ( dvdy * height ) * ( dvdy * height );
+
+    //? log2( sqrt( a ) ) == 0.5 * log2( a )
+    return 0.5f * log2f( std::max( x, y ) );
+}
+
+SamplerPath BestSamplerPath()
+{
+#if SAMPLER_X86
+    static const SamplerPath best = CpuHasAVX2() ? SAMPLER_PATH_AVX2 : SAMPLER_PATH_SSE2;
+    return best;
+#else
+    return SAMPLER_PATH_SCALAR;
+#endif
+}
+
+void SampleTextureLinear( const SoftwareTexture& texture, const float* u, const float* v, const float* lod, size_t count,
+                          float* rgba, SamplerPath path )
+{
+    if( texture.Empty() )
+    {
+        std::fill_n( rgba, count * 4, 0.0f );
+        return;
+    }
+
+    const SamplerPath best = BestSamplerPath();
+    if( path == SAMPLER_PATH_AUTO || path > best )
+        path = best;
+
+#if SAMPLER_X86
+    if( path == SAMPLER_PATH_AVX2 && texture.levels.size() <= kMaxLevels )
+    {
+        SampleAVX2( texture, u, v, lod, count, rgba );
+        return;
+    }
+    if( path != SAMPLER_PATH_SCALAR )
+    {
+        SampleSSE2( texture, u, v, lod, count, rgba );
+        return;
+    }
+#endif
+    SampleScalar( texture, u, v, lod, count, rgba );
+}
@@ -0,0 +1,116 @@
+//--------------------------------------------------------------------------------------
+// File: TextureSampler.h
+//
+// CPU textures and the sampler the D3D11 path uses: D3D11_FILTER_MIN_MAG_MIP_LINEAR
+// with WRAP addressing. The level of detail comes from texture-coordinate derivatives
+// as in the D3D11 specification, and bilinear and mip weights are snapped to 8 fraction
+// bits like the fixed-point filter hardware uses, so CPU images can be compared with
+// GPU ones.
+//
+// Textures are RGBA8 with their whole mip chain in one array. BC1-BC3 data is decoded
+// at load time. The texels can be kept in rows or in 8x8 tiles with Morton order inside
+// each tile; the tiled layout keeps the four texels of a bilinear footprint within one
+// or two cache lines far more often when the sampling direction is not along rows.
+//
+// SampleTextureLinear filters a batch of points: 8 at a time with AVX2 gathers when the
+// CPU has them, 4 at a time with SSE2 otherwise. Every path gives the same bits.
+//--------------------------------------------------------------------------------------
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+
+enum TexelLayout : uint32_t
+{
+    TEXEL_LAYOUT_LINEAR,        // rows
+    TEXEL_LAYOUT_MORTON,        // 8x8 tiles in rows, Morton order within each tile
+};
+
+//? RGBA8 texels, red in the low byte, for every level of the mip chain
+struct SoftwareTexture
+{
+    static const uint32_t kTileSize = 8;
+
+    struct Level
+    {
+        uint32_t    width = 0;
+        uint32_t    height = 0;
+        uint32_t    tilesX = 0;         // tiles per row in the Morton layout
+        uint32_t    offset = 0;         // first texel in 'texels'
+    };
+
+    TexelLayout             layout = TEXEL_LAYOUT_LINEAR;
+    std::vector<Level>      levels;     // level 0 first
+    std::vector<uint32_t>   texels;
+
+    bool Empty() const noexcept { return levels.empty(); }
+
+    // Index into 'texels' of texel (x, y) of a level
+    uint32_t TexelIndex( size_t level, uint32_t x, uint32_t y ) const noexcept
+    {
+        const Level& l = levels[level];
+        if( layout == TEXEL_LAYOUT_LINEAR )
+            return l.offset + y * l.width + x;
+        const uint32_t tile = ( y / kTileSize ) * l.tilesX + x / kTileSize;
+        return l.offset + tile * kTileSize * kTileSize + MortonCode( x % kTileSize, y % kTileSize );
+    }
+
+    uint32_t Fetch( size_t level, uint32_t x, uint32_t y ) const noexcept { return texels[TexelIndex( level, x, y )]; }
+
+    // Interleaves the three low bits of x and y, x in the even bits
+    static uint32_t MortonCode( uint32_t x, uint32_t y ) noexcept
+    {
+        return ( x & 1 ) | ( ( x & 2 ) << 1 ) | ( ( x & 4 ) << 2 ) | ( ( y & 1 ) << 1 ) | ( ( y & 2 ) << 2 ) | ( ( y & 4 ) << 3 );
+    }
+};
+
+// Appends a level given as rows of RGBA8; its size must halve the previous level's
+void AppendTextureLevel( SoftwareTexture& texture, uint32_t width, uint32_t height, const uint32_t* rgba );
+
+// Rearranges every level into 'layout'
+void SetTextureLayout( SoftwareTexture& texture, TexelLayout layout );
+
+// Replaces every level below the top with a 2x2 box-filtered chain down to 1x1
+void GenerateTextureMips( SoftwareTexture& texture );
+
+enum BCFormat : uint32_t
+{
+    BC_FORMAT_BC1,      // DXT1, with the 1-bit alpha mode
+    BC_FORMAT_BC2,      // DXT3, explicit 4-bit alpha
+    BC_FORMAT_BC3,      // DXT5, interpolated alpha
+};
+
+// Bytes of BC data for a width x height image
+size_t BCImageBytes( BCFormat format, uint32_t width, uint32_t height );
+
+// Decodes a BC image into width x height rows of RGBA8
+void DecodeBC( BCFormat format, const uint8_t* blocks, uint32_t width, uint32_t height, uint32_t* rgba );
+
+// Reads a 2D DDS file with its mip chain: uncompressed 32-bit (masked RGB/RGBA, or a DX10
+// header with an R8G8B8A8 or B8G8R8A8 format) or BC1-BC3. Arrays and cube maps give
+// their first image. False if the file is missing or of another format.
+bool LoadSoftwareTextureDDS( const char* path, SoftwareTexture& texture );
+
+// D3D11 level of detail from the derivatives of (u, v) along screen x and y:
+// log2 of the longer footprint axis in level-0 texels
+float ComputeTextureLod( const SoftwareTexture& texture, float dudx, float dvdx, float dudy, float dvdy );
+
+enum SamplerPath : uint32_t
+{
+    SAMPLER_PATH_AUTO,          // the fastest the CPU supports
+    SAMPLER_PATH_SCALAR,
+    SAMPLER_PATH_SSE2,
+    SAMPLER_PATH_AVX2,
+};
+
+// The path SAMPLER_PATH_AUTO resolves to
+SamplerPath BestSamplerPath();
+
+// Samples 'count' points at the given levels of detail, writing RGBA floats in 0..1 to
+// rgba[4 * i]. A path the CPU lacks falls back to the next best. Coordinates that are not
+// finite sample at 0.
+void SampleTextureLinear( const SoftwareTexture& texture, const float* u, const float* v, const float* lod, size_t count,
+                          float* rgba, SamplerPath path = SAMPLER_PATH_AUTO );
@@ -0,0 +1,264 @@
+//--------------------------------------------------------------------------------------
+// File: TransientTargets.cpp
+//
+// Lifetimes and aliasing of per-frame transient render targets
+//--------------------------------------------------------------------------------------
+
+#include "TransientTargets.h"
+
+#include <algorithm>
+#include <cstdio>
+
+
+namespace
+{
+    uint64_t TargetBytes( uint32_t width, uint32_t height, uint32_t texelBytes )
+    {
+        return uint64_t( width ) * height * texelBytes;
+    }
+
+    double Megabytes( uint64_t bytes )
+    {
+        return double( bytes ) / ( 1024.0 * 1024.0 );
+    }
+}
+
+//--------------------------------------------------------------------------------------
+void TransientFrame::Clear() noexcept
+{
+    m_textureCount = 0;
+    m_passCount = 0;
+    m_accesses.clear();
+}
+
+size_t TransientFrame::AddTexture( const TransientTextureDesc& desc )
+{
+    if( m_textureCount == m_textures.size() )
+        m_textures.push_back( desc );
+    else
+        m_textures[m_textureCount] = desc;
+    return m_textureCount++;
+}
+
+size_t TransientFrame::AddPass( const char* name )
+{
+    if( m_passCount == m_passes.size() )
+        m_passes.emplace_back( name );
+    else
+        m_passes[m_passCount] = name;
+    return m_passCount++;
+}
+
+//--------------------------------------------------------------------------------------
+void ComputeTransientLifetimes( const TransientFrame& frame, std::vector<TransientLifetime>& lifetimes )
+{
+    lifetimes.assign( frame.TextureCount(), TransientLifetime() );
+    for( const TransientFrame::Access& access : frame.Accesses() )
+    {
+        TransientLifetime& lifetime = lifetimes[access.texture];
+        if( !lifetime.Used() || access.pass < lifetime.first )
+            lifetime.first = access.pass;
+        if( lifetime.last == kNoTransient || access.pass > lifetime.last )
+            lifetime.last = access.pass;
+        if( access.write && ( lifetime.firstWrite == kNoTransient || access.pass < lifetime.firstWrite ) )
+            lifetime.firstWrite = access.pass;
+    }
+
+    //? A pass reading what it writes itself reads the previous contents, so a read is
+    //? only defined after an earlier pass wrote the texture
+    for( const TransientFrame::Access& access : frame.Accesses() )
+    {
+        TransientLifetime& lifetime = lifetimes[access.texture];
+        if( !access.write && ( lifetime.firstWrite == kNoTransient || lifetime.firstWrite >= access.pass ) )
+            lifetime.readBeforeWrite = true;
+    }
+}
+
+void PlanTransientAliasing( const TransientFrame& frame, TransientPlan& plan )
+{
+    ComputeTransientLifetimes( frame, plan.lifetimes );
+    plan.targetOf.assign( frame.TextureCount(), kNoTransient );
+    plan.targets.clear();
+    plan.requestedBytes = 0;
+    plan.plannedBytes = 0;
+    plan.undefinedReads = 0;
+
+    std::vector<size_t> order;
+    order.reserve( frame.TextureCount() );
+    for( size_t texture = 0; texture < frame.TextureCount(); ++texture )
+    {
+        if( plan.lifetimes[texture].Used() )
+            order.push_back( texture );
+    }
+
+    //? By first use; of textures first used together, the largest first, so the smaller
+    //? ones can fit into what it leaves behind later
+    std::stable_sort( order.begin(), order.end(), [&]( size_t a, size_t b )
+    {
+        if( plan.lifetimes[a].first != plan.lifetimes[b].first )
+            return plan.lifetimes[a].first < plan.lifetimes[b].first;
+        const RenderTargetKey& ka = frame.Texture( a ).key;
+        const RenderTargetKey& kb = frame.Texture( b ).key;
+        return uint64_t( ka.width ) * ka.height > uint64_t( kb.width ) * kb.height;
+    } );
+
+    for( size_t texture : order )
+    {
+        const TransientTextureDesc& desc = frame.Texture( texture );
+        const TransientLifetime& lifetime = plan.lifetimes[texture];
+        const uint64_t bytes = TargetBytes( desc.key.width, desc.key.height, desc.texelBytes );
+        plan.requestedBytes += bytes;
+        if( lifetime.readBeforeWrite )
+            ++plan.undefinedReads;
+
+        //? Best target that already fits, else the one that grows the least; growing only
+        //? pays while the grown target is smaller than the two apart
+        size_t fits = kNoTransient;
+        uint64_t fitsBytes = 0;
+        size_t grows = kNoTransient;
+        uint64_t growsBytes = 0;
+        for( size_t i = 0; i < plan.targets.size(); ++i )
+        {
+            const TransientTarget& target = plan.targets[i];
+            if( target.lastPass >= lifetime.first || target.key.format != desc.key.format || target.key.bindFlags != desc.key.bindFlags )
+                continue;
+
+            if( target.key == desc.key || ( desc.mayBeLarger && target.key.width >= desc.key.width && target.key.height >= desc.key.height ) )
+            {
+                if( fits == kNoTransient || target.bytes < fitsBytes )
+                {
+                    fits = i;
+                    fitsBytes = target.bytes;
+                }
+            }
+            else if( desc.mayBeLarger && target.mayBeLarger )
+            {
+                const uint32_t width = target.key.width > desc.key.width ? target.key.width : desc.key.width;
+                const uint32_t height = target.key.height > desc.key.height ? target.key.height : desc.key.height;
+                const uint64_t grown = TargetBytes( width, height, desc.texelBytes );
+                if( grown < target.bytes + bytes && ( grows == kNoTransient || grown < growsBytes ) )
+                {
+                    grows = i;
+                    growsBytes = grown;
+                }
+            }
+        }
+
+        size_t chosen = fits != kNoTransient ? fits : grows;
+        if( chosen == kNoTransient )
+        {
+            chosen = plan.targets.size();
+            plan.targets.emplace_back();
+            TransientTarget& target = plan.targets.back();
+            target.key = desc.key;
+            target.mayBeLarger = desc.mayBeLarger;
+            target.bytes = bytes;
+        }
+        else if( chosen == grows )
+        {
+            TransientTarget& target = plan.targets[chosen];
+            target.key.width = target.key.width > desc.key.width ? target.key.width : desc.key.width;
+            target.key.height = target.key.height > desc.key.height ? target.key.height : desc.key.height;
+            target.bytes = growsBytes;
+        }
+
+        TransientTarget& target = plan.targets[chosen];
+        target.mayBeLarger = target.mayBeLarger && desc.mayBeLarger;
+        target.lastPass = lifetime.last;
+        ++target.textures;
+        plan.targetOf[texture] = chosen;
+    }
+
+    for( const TransientTarget& target : plan.targets )
+        plan.plannedBytes += target.bytes;
+}
+
+std::string TransientPlan::Format() const
+{
+    size_t used = 0;
+    for( const TransientLifetime& lifetime : lifetimes )
+        used += lifetime.Used() ? 1 : 0;
+
+    char line[192];
+    snprintf( line, sizeof( line ), "Transient targets: %zu textures in %zu targets, %.2f MB instead of %.2f MB, %zu read before written\n",
+              used, targets.size(), Megabytes( plannedBytes ), Megabytes( requestedBytes ), undefinedReads );
+    return line;
+}
+
+//--------------------------------------------------------------------------------------
+bool TransientTargetSet::Realize( const TransientPlan& plan )
+{
+    ++m_stats.plans;
+    m_stats.peakRequestedBytes = std::max( m_stats.peakRequestedBytes, plan.requestedBytes );
+    m_stats.peakPlannedBytes = std::max( m_stats.peakPlannedBytes, plan.plannedBytes );
+
+    //? Keep whatever the plan asks for again...
+    m_next.assign( plan.targets.size(), Held() );
+    for( size_t i = 0; i < plan.targets.size(); ++i )
+    {
+        const TransientTarget& target = plan.targets[i];
+        for( Held& held : m_held )
+        {
+            if( held.entry != RenderTargetPool::kInvalidEntry && held.key == target.key && held.mayBeLarger == target.mayBeLarger )
+            {
+                m_next[i] = held;
+                held.entry = RenderTargetPool::kInvalidEntry;
+                ++m_stats.kept;
+                break;
+            }
+        }
+    }
+
+    //? ...hand back the rest first, so the new targets can come straight out of it...
+    for( const Held& held : m_held )
+    {
+        if( held.entry != RenderTargetPool::kInvalidEntry )
+            m_pool.Release( held.entry );
+    }
+
+    //? ...and take the missing ones from the pool
+    bool ok = true;
+    for( size_t i = 0; i < plan.targets.size(); ++i )
+    {
+        Held& held = m_next[i];
+        if( held.entry != RenderTargetPool::kInvalidEntry )
+            continue;
+        held.key = plan.targets[i].key;
+        held.mayBeLarger = plan.targets[i].mayBeLarger;
+        held.entry = m_pool.Acquire( held.key, held.mayBeLarger );
+        if( held.entry == RenderTargetPool::kInvalidEntry )
+        {
+            ++m_stats.failed;
+            ok = false;
+            continue;
+        }
+        ++m_stats.acquired;
+    }
+
+    m_held.swap( m_next );
+    m_entries.resize( m_held.size() );
+    for( size_t i = 0; i < m_held.size(); ++i )
+        m_entries[i] = m_held[i].entry;
+    return ok;
+}
+
+void TransientTargetSet::Release()
+{
+    for( const Held& held : m_held )
+    {
+        if( held.entry != RenderTargetPool::kInvalidEntry )
+            m_pool.Release( held.entry );
+    }
+    m_held.clear();
+    m_entries.clear();
+}
+
+std::string TransientTargetSet::Format() const
+{
+    char line[192];
+    snprintf( line, sizeof( line ), "Transient targets: %llu plans, %llu targets kept, %llu acquired, %llu failed; peak %.2f MB instead of %.2f MB\n",
+              static_cast<unsigned long long>( m_stats.plans ), static_cast<unsigned long long>( m_stats.kept ),
+              static_cast<unsigned long long>( m_stats.acquired ), static_cast<unsigned long long>( m_stats.failed ),
+              Megabytes( m_stats.peakPlannedBytes ), Megabytes( m_stats.peakRequestedBytes ) );
+    return line;
+}
@@ -0,0 +1,173 @@
+//--------------------------------------------------------------------------------------
+// File: TransientTargets.h
+//
+// Per-frame transient render targets. The passes of a frame declare, in the order they
+// run, which textures they write and read; a texture only has to exist from the first
+// pass using it to the last. PlanTransientAliasing() works out those lifetimes and lets
+// textures whose lifetimes do not overlap share one physical target, so a frame drawing
+// several windows one after the other needs one depth buffer rather than one per window.
+//
+// D3D11 cannot place two textures in one allocation, so textures share a target only
+// where one texture can stand in for the other: same format and usage, and either the
+// same size or, for textures that may be larger than drawn into (depth buffers), a
+// target at least as large. TransientTargetSet backs a plan with targets from a
+// RenderTargetPool and keeps them for as long as later plans ask for the same ones.
+//
+// Only the standard library and RenderTargetPool are used.
+//--------------------------------------------------------------------------------------
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "RenderTargetPool.h"
+
+
+static const size_t kNoTransient = SIZE_MAX;
+
+struct TransientTextureDesc
+{
+    std::string     name;
+    RenderTargetKey key;
+    uint32_t        texelBytes = 4;
+    bool            mayBeLarger = false;    // any target of at least key.width x key.height will do
+};
+
+//? --------------------------------------------------------------------------------------
+//? One frame's passes and the textures they use. Clear() keeps the storage, so the same
+//? frame can be declared again every frame without allocating.
+//? --------------------------------------------------------------------------------------
+class TransientFrame
+{
+public:
+    struct Access
+    {
+        size_t  pass;
+        size_t  texture;
+        bool    write;
+    };
+
+    void Clear() noexcept;
+
+    size_t AddTexture( const TransientTextureDesc& desc );
+
+    // Passes run in the order they are added
+    size_t AddPass( const char* name );
+
+    void Write( size_t pass, size_t texture ) { m_accesses.push_back( Access{ pass, texture, true } ); }
+    void Read( size_t pass, size_t texture ) { m_accesses.push_back( Access{ pass, texture, false } ); }
+
+    size_t TextureCount() const noexcept { return m_textureCount; }
+    size_t PassCount() const noexcept { return m_passCount; }
+    const TransientTextureDesc& Texture( size_t texture ) const { return m_textures[texture]; }
+    const std::string& PassName( size_t pass ) const { return m_passes[pass]; }
+    const std::vector<Access>& Accesses() const noexcept { return m_accesses; }
+
+private:
+    std::vector<TransientTextureDesc>   m_textures;     // the first m_textureCount are in use
+    std::vector<std::string>            m_passes;
+    std::vector<Access>                 m_accesses;
+    size_t                              m_textureCount = 0;
+    size_t                              m_passCount = 0;
+};
+
+struct TransientLifetime
+{
+    size_t  first = kNoTransient;       // first pass using the texture; kNoTransient: unused
+    size_t  last = kNoTransient;
+    size_t  firstWrite = kNoTransient;
+    bool    readBeforeWrite = false;    // some pass reads it before any pass wrote it
+
+    bool Used() const noexcept { return first != kNoTransient; }
+    bool Overlaps( const TransientLifetime& other ) const noexcept { return first <= other.last && other.first <= last; }
+};
+
+// First and last pass of every texture in 'frame'
+void ComputeTransientLifetimes( const TransientFrame& frame, std::vector<TransientLifetime>& lifetimes );
+
+//? A physical target and the textures planned into it
+struct TransientTarget
+{
+    RenderTargetKey key;                // large enough for every texture in it
+    bool            mayBeLarger = false;
+    uint64_t        bytes = 0;
+    size_t          textures = 0;
+    size_t          lastPass = 0;       // last pass of the latest texture in it
+};
+
+struct TransientPlan
+{
+    std::vector<TransientLifetime>  lifetimes;      // per texture
+    std::vector<size_t>             targetOf;       // per texture; kNoTransient when unused
+    std::vector<TransientTarget>    targets;
+    uint64_t                        requestedBytes = 0; // every used texture in a target of its own
+    uint64_t                        plannedBytes = 0;   // the targets
+    size_t                          undefinedReads = 0; // textures read before written
+
+    // One line: textures, targets and bytes saved
+    std::string Format() const;
+};
+
+// Lifetimes of 'frame' and the targets its textures share. Textures are placed in the
+// order they are first used, each into the free compatible target it wastes the least
+// of, into one it grows where that costs less than a target of its own, or else into a
+// new one. 'plan' keeps its storage between calls.
+void PlanTransientAliasing( const TransientFrame& frame, TransientPlan& plan );
+
+//? --------------------------------------------------------------------------------------
+//? The targets of the latest plan, held in a RenderTargetPool. Targets a new plan asks
+//? for again are kept; the others go back to the pool.
+//? --------------------------------------------------------------------------------------
+class TransientTargetSet
+{
+public:
+    struct Stats
+    {
+        uint64_t    plans = 0;
+        uint64_t    kept = 0;               // targets carried over from the previous plan
+        uint64_t    acquired = 0;           // targets taken from the pool
+        uint64_t    failed = 0;
+        uint64_t    peakRequestedBytes = 0; // largest requestedBytes of a plan
+        uint64_t    peakPlannedBytes = 0;
+    };
+
+    explicit TransientTargetSet( RenderTargetPool& pool ) : m_pool( pool ) {}
+    ~TransientTargetSet() { Release(); }
+
+    TransientTargetSet( const TransientTargetSet& ) = delete;
+    TransientTargetSet& operator=( const TransientTargetSet& ) = delete;
+
+    // Holds a target for each of the plan's targets. False if the pool failed for any;
+    // those targets have no entry.
+    bool Realize( const TransientPlan& plan );
+
+    // Pool entry of a target of the last realized plan, or of the target a texture was
+    // planned into; RenderTargetPool::kInvalidEntry if it has none
+    size_t TargetEntry( size_t target ) const { return target < m_entries.size() ? m_entries[target] : RenderTargetPool::kInvalidEntry; }
+    size_t TextureEntry( const TransientPlan& plan, size_t texture ) const { return TargetEntry( plan.targetOf[texture] ); }
+
+    // Hands every target back to the pool
+    void Release();
+
+    const Stats& GetStats() const noexcept { return m_stats; }
+
+    // One line: plans, reuse and the largest frame with and without aliasing
+    std::string Format() const;
+
+private:
+    struct Held
+    {
+        RenderTargetKey key;                // as planned; the pool may have bucketed it
+        bool            mayBeLarger = false;
+        size_t          entry = RenderTargetPool::kInvalidEntry;
+    };
+
+    RenderTargetPool&   m_pool;
+    std::vector<Held>   m_held;
+    std::vector<Held>   m_next;             // scratch for Realize()
+    std::vector<size_t> m_entries;          // per target of the last plan
+    Stats               m_stats;
+};
@@ -0,0 +1,127 @@
+//--------------------------------------------------------------------------------------
+// File: UploadRing.cpp
+//
+// Sub-allocator for a ring of upload memory
+//--------------------------------------------------------------------------------------
+
+#include "UploadRing.h"
+
+
+//--------------------------------------------------------------------------------------
+UploadRing::UploadRing( uint64_t capacity, uint64_t alignment, WrapPolicy policy ) noexcept :
+    m_capacity( capacity ),
+    m_alignment( alignment ? alignment : 1 ),
+    m_policy( policy )
+{
+}
+
+UploadRing::Allocation UploadRing::Take( uint64_t offset, uint64_t size, bool discard ) noexcept
+{
+    Allocation allocation;
+    allocation.offset = offset;
+    allocation.size = size;
+    allocation.discard = discard;
+    allocation.valid = true;
+
+    m_head = offset + size;
+    m_allocatedTotal += size;
+    m_mapped = true;
+
+    ++m_stats.allocations;
+    m_stats.bytesAllocated += size;
+    if( discard )
+        ++m_stats.discards;
+    return allocation;
+}
+
+UploadRing::Allocation UploadRing::Allocate( uint64_t size ) noexcept
+{
+    size = ( size + m_alignment - 1 ) / m_alignment * m_alignment;
+    if( size == 0 || size > m_capacity )
+    {
+        ++m_stats.failed;
+        return Allocation();
+    }
+
+    if( !m_mapped )
+        return Take( 0, size, true );
+
+    if( m_policy == WRAP_DISCARD )
+    {
+        if( m_head + size <= m_capacity )
+            return Take( m_head, size, false );
+
+        // The driver renames the buffer, so nothing that is still in flight gets overwritten
+        ++m_stats.wraps;
+        m_stats.bytesSkipped += m_capacity - m_head;
+        m_fences.clear();
+        m_tail = 0;
+        m_retiredTotal = m_allocatedTotal;
+        return Take( 0, size, true );
+    }
+
+    // Fenced: the live region runs from tail to head, possibly wrapping around the end
+    const uint64_t inUse = BytesInUse();
+    if( inUse == 0 )
+    {
+        // Nothing in flight; restart at the front to keep allocations contiguous
+        m_tail = 0;
+        m_head = 0;
+    }
+
+    if( m_head >= m_tail && ( inUse == 0 || m_head != m_tail ) )
+    {
+        if( m_head + size <= m_capacity )
+            return Take( m_head, size, false );
+
+        // Wrap if the retired space at the front is large enough
+        if( size <= m_tail )
+        {
+            ++m_stats.wraps;
+            m_stats.bytesSkipped += m_capacity - m_head;
+            m_allocatedTotal += m_capacity - m_head;
+            return Take( 0, size, false );
+        }
+    }
+    else if( m_head + size <= m_tail )
+    {
+        return Take( m_head, size, false );
+    }
+
+    ++m_stats.failed;
+    return Allocation();
+}
+
+void UploadRing::EndFrame( uint64_t frameId )
+{
+    // Frames without allocations don't need a fence
+    if( !m_fences.empty() && m_fences.back().allocatedTotal == m_allocatedTotal )
+        return;
+    if( m_fences.empty() && m_allocatedTotal == m_retiredTotal )
+        return;
+
+    Fence fence;
+    fence.frameId = frameId;
+    fence.head = m_head;
+    fence.allocatedTotal = m_allocatedTotal;
+    m_fences.push_back( fence );
+}
+
+void UploadRing::Retire( uint64_t completedFrameId ) noexcept
+{
+    while( !m_fences.empty() && m_fences.front().frameId <= completedFrameId )
+    {
+        m_tail = m_fences.front().head;
+        m_retiredTotal = m_fences.front().allocatedTotal;
+        m_fences.pop_front();
+    }
+}
+
+void UploadRing::Reset() noexcept
+{
+    m_fences.clear();
+    m_head = 0;
+    m_tail = 0;
+    m_retiredTotal = m_allocatedTotal;
+    m_mapped = false;
+}
@@ -0,0 +1,93 @@
+//--------------------------------------------------------------------------------------
+// File: UploadRing.h
+//
+// Sub-allocator for a ring of upload memory, such as one large dynamic constant buffer
+// that a context writes per-draw data into. Allocations are aligned and handed out
+// front to back; what happens when the end is reached depends on the wrap policy:
+//
+//  WRAP_DISCARD    start over at offset 0 and tell the caller to map with DISCARD, so
+//                  the driver renames the buffer and nothing in flight is touched.
+//  WRAP_FENCED     start over at offset 0 only once the frames that used that memory
+//                  have been retired; otherwise the allocation fails and the caller
+//                  falls back to another upload path.
+//
+// Only offsets are managed here; the memory itself belongs to the backend.
+//--------------------------------------------------------------------------------------
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+
+
+class UploadRing
+{
+public:
+    enum WrapPolicy
+    {
+        WRAP_DISCARD,
+        WRAP_FENCED,
+    };
+
+    struct Allocation
+    {
+        uint64_t    offset = 0;
+        uint64_t    size = 0;           // rounded up to the alignment
+        bool        discard = false;    // the backend must map with DISCARD for this one
+        bool        valid = false;
+    };
+
+    struct Stats
+    {
+        uint64_t    allocations = 0;
+        uint64_t    discards = 0;
+        uint64_t    wraps = 0;
+        uint64_t    failed = 0;         // fenced ring had no retired space left
+        uint64_t    bytesAllocated = 0;
+        uint64_t    bytesSkipped = 0;   // tail space left unused by a wrap
+    };
+
+    UploadRing( uint64_t capacity, uint64_t alignment, WrapPolicy policy ) noexcept;
+
+    Allocation Allocate( uint64_t size ) noexcept;
+
+    // Everything allocated since the previous fence belongs to frameId
+    void EndFrame( uint64_t frameId );
+
+    // The GPU is done with every frame up to and including completedFrameId
+    void Retire( uint64_t completedFrameId ) noexcept;
+
+    // Starts over at offset 0 with a DISCARD, dropping every fence. For memory that is
+    // written afresh per recording, such as a D3D11 deferred context's command list.
+    void Reset() noexcept;
+
+    uint64_t Capacity() const noexcept { return m_capacity; }
+    uint64_t Alignment() const noexcept { return m_alignment; }
+    uint64_t Head() const noexcept { return m_head; }
+    uint64_t Tail() const noexcept { return m_tail; }
+    uint64_t BytesInUse() const noexcept { return m_allocatedTotal - m_retiredTotal; }
+    size_t FramesInFlight() const noexcept { return m_fences.size(); }
+    const Stats& GetStats() const noexcept { return m_stats; }
+
+private:
+    struct Fence
+    {
+        uint64_t    frameId;
+        uint64_t    head;               // ring position after the frame's last allocation
+        uint64_t    allocatedTotal;     // running byte count at that point
+    };
+
+    Allocation Take( uint64_t offset, uint64_t size, bool discard ) noexcept;
+
+    const uint64_t      m_capacity;
+    const uint64_t      m_alignment;
+    const WrapPolicy    m_policy;
+    uint64_t            m_head = 0;
+    uint64_t            m_tail = 0;
+    uint64_t            m_allocatedTotal = 0;   // including skipped tail space
+    uint64_t            m_retiredTotal = 0;
+    bool                m_mapped = false;       // the first allocation always discards
+    std::deque<Fence>   m_fences;
+    Stats               m_stats;
+};
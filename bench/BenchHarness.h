@@ -0,0 +1,57 @@
+//--------------------------------------------------------------------------------------
+// File: BenchHarness.h
+//
+// Timing helpers for the benchmarks of the host build. Each module's benchmark is an
+// executable of its own, bench/<Module>Bench.cpp, that prints one line per case. They
+// are run by hand, on a Release build, rather than by ctest:
+//
+//  cmake --build _build --target DirtyRectsBench && _build/DirtyRectsBench
+//--------------------------------------------------------------------------------------
+
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+
+
+class BenchTimer
+{
+public:
+    BenchTimer() : m_start( std::chrono::steady_clock::now() ) {}
+
+    void Restart() { m_start = std::chrono::steady_clock::now(); }
+
+    double ElapsedMs() const
+    {
+        return std::chrono::duration<double, std::milli>( std::chrono::steady_clock::now() - m_start ).count();
+    }
+
+private:
+    std::chrono::steady_clock::time_point   m_start;
+};
+
+// Stores a result where the compiler cannot see it unused, so the work producing it is
+// not optimized away
+inline volatile uint64_t g_benchResult = 0;
+
+inline void KeepResult( uint64_t value )
+{
+    g_benchResult = value;
+}
+
+// Calls 'fn' once to warm up, then in doubling batches until a batch takes 'minMs';
+// returns the nanoseconds per call of that batch
+template <typename Fn>
+double NanosecondsPerCall( Fn&& fn, double minMs = 200.0 )
+{
+    fn();
+    for( uint64_t calls = 1; ; calls *= 2 )
+    {
+        BenchTimer timer;
+        for( uint64_t i = 0; i < calls; ++i )
+            fn();
+        const double ms = timer.ElapsedMs();
+        if( ms >= minMs )
+            return ms * 1e6 / double( calls );
+    }
+}
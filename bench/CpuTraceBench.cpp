@@ -0,0 +1,83 @@
+//--------------------------------------------------------------------------------------
+// File: CpuTraceBench.cpp
+//
+// What a CPU_TRACE_SCOPE costs a function while tracing is disabled, while it records,
+// and once its thread's buffer is full
+//--------------------------------------------------------------------------------------
+
+#include "BenchHarness.h"
+#include "CpuTrace.h"
+
+#include <cstdio>
+#include <thread>
+
+#if defined( _MSC_VER )
+#define BENCH_NOINLINE __declspec( noinline )
+#else
+#define BENCH_NOINLINE __attribute__( ( noinline ) )
+#endif
+
+
+namespace
+{
+    volatile uint64_t g_counter = 0;
+
+    //? The same small function with and without a marker; not inlined, as a marked
+    //? render function would not be
+    BENCH_NOINLINE void Bare()
+    {
+        g_counter = g_counter + 1;
+    }
+
+    BENCH_NOINLINE void Traced()
+    {
+        CPU_TRACE_SCOPE( "Traced" );
+        g_counter = g_counter + 1;
+    }
+
+    //? Nanoseconds per call of 'calls' calls, timed once: a recording thread's buffer
+    //? only holds CpuTrace::kEventsPerThread events
+    template <typename Fn>
+    double NanosecondsPerCallOnce( Fn fn, uint64_t calls )
+    {
+        BenchTimer timer;
+        for( uint64_t i = 0; i < calls; ++i )
+            fn();
+        return timer.ElapsedMs() * 1e6 / double( calls );
+    }
+}
+
+int main()
+{
+    const double bareNs = NanosecondsPerCall( [] { Bare(); } );
+    const double disabledNs = NanosecondsPerCall( [] { Traced(); } );
+
+    //? Each on a fresh thread, so it starts with an empty buffer
+    CpuTrace::Enable( true );
+    double recordingNs = 0.0;
+    double fullNs = 0.0;
+    std::thread recorder( [&]
+    {
+        CpuTrace::SetThreadName( "recording" );
+        recordingNs = NanosecondsPerCallOnce( [] { Traced(); }, CpuTrace::kEventsPerThread - 1 );
+    } );
+    recorder.join();
+    std::thread dropper( [&]
+    {
+        CpuTrace::SetThreadName( "full" );
+        for( size_t i = 0; i < CpuTrace::kEventsPerThread; ++i )
+            Traced();
+        fullNs = NanosecondsPerCallOnce( [] { Traced(); }, 10000000 );
+    } );
+    dropper.join();
+    CpuTrace::Enable( false );
+
+    printf( "Per call of a small function:\n" );
+    printf( "  bare                 %6.2f ns\n", bareNs );
+    printf( "  traced, disabled     %6.2f ns (%+.2f)\n", disabledNs, disabledNs - bareNs );
+    printf( "  traced, recording    %6.2f ns (%+.2f)\n", recordingNs, recordingNs - bareNs );
+    printf( "  traced, buffer full  %6.2f ns (%+.2f)\n", fullNs, fullNs - bareNs );
+    printf( "%llu events recorded, %llu dropped\n", static_cast<unsigned long long>( CpuTrace::EventCount() ),
+            static_cast<unsigned long long>( CpuTrace::DroppedCount() ) );
+    return 0;
+}
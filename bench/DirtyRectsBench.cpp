@@ -0,0 +1,118 @@
+//--------------------------------------------------------------------------------------
+// File: DirtyRectsBench.cpp
+//
+// Bytes the consumer copies per frame with dirty rectangles, against copying the whole
+// shared surface, for a few kinds of frames; and what Coalesce() costs per frame
+//--------------------------------------------------------------------------------------
+
+#include "BenchHarness.h"
+#include "DirtyRects.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+
+namespace
+{
+    const uint32_t kWidth = 800;
+    const uint32_t kHeight = 600;
+    const uint32_t kBytesPerPixel = 4;
+    const int kFrames = 3600;
+
+    //? Screen bounds of a square of half size 'half' centered at (x, y), turned by 'angle'
+    DirtyRect SpinningSquare( double x, double y, double half, double angle )
+    {
+        const double extent = half * ( std::fabs( std::cos( angle ) ) + std::fabs( std::sin( angle ) ) );
+        return DirtyRect{ uint32_t( std::max( 0.0, x - extent ) ), uint32_t( std::max( 0.0, y - extent ) ),
+                          uint32_t( std::ceil( x + extent ) ), uint32_t( std::ceil( y + extent ) ) };
+    }
+
+    //? A frame's damage: the rectangles it adds to the region
+    using FrameDamage = void (*)( int frame, DirtyRegion& region, std::mt19937& random );
+
+    //? The application's scene: the quad spinning in place. A frame redraws where the
+    //? quad was and where it is now.
+    void SpinningQuad( int frame, DirtyRegion& region, std::mt19937& )
+    {
+        const double step = 0.02;
+        region.Add( SpinningSquare( kWidth / 2, kHeight / 2, 120.0, ( frame - 1 ) * step ) );
+        region.Add( SpinningSquare( kWidth / 2, kHeight / 2, 120.0, frame * step ) );
+    }
+
+    //? Two small quads orbiting on opposite sides, far enough apart to stay two copies
+    void OrbitingQuads( int frame, DirtyRegion& region, std::mt19937& )
+    {
+        for( int quad = 0; quad < 2; ++quad )
+        {
+            for( int f = frame - 1; f <= frame; ++f )
+            {
+                const double angle = f * 0.01 + quad * 3.14159265;
+                region.Add( SpinningSquare( kWidth / 2 + 280.0 * std::cos( angle ), kHeight / 2 + 200.0 * std::sin( angle ),
+                                            40.0, f * 0.05 ) );
+            }
+        }
+    }
+
+    //? Widgets updating all over the surface: 40 small rectangles a frame
+    void ScatteredWidgets( int, DirtyRegion& region, std::mt19937& random )
+    {
+        for( int i = 0; i < 40; ++i )
+        {
+            const uint32_t x = uint32_t( random() % ( kWidth - 64 ) );
+            const uint32_t y = uint32_t( random() % ( kHeight - 24 ) );
+            region.Add( DirtyRect{ x, y, x + 16 + uint32_t( random() % 48 ), y + 8 + uint32_t( random() % 16 ) } );
+        }
+    }
+
+    //? A camera move: everything changes
+    void WholeFrame( int, DirtyRegion& region, std::mt19937& )
+    {
+        region.AddAll();
+    }
+
+    void Run( const char* name, FrameDamage damage )
+    {
+        DirtyRegion region;
+        region.Reset( kWidth, kHeight );
+        DirtyCopyStats stats;
+        DirtyRectCost cost;
+        std::mt19937 random( 1 );
+        uint64_t rects = 0;
+        for( int frame = 1; frame <= kFrames; ++frame )
+        {
+            region.Clear();
+            damage( frame, region, random );
+            region.Coalesce( cost );
+            stats.Record( region, kBytesPerPixel );
+            rects += stats.lastFrameRects;
+        }
+
+        //? The same frames again, timed: adding and coalescing only
+        int frame = 0;
+        random.seed( 1 );
+        const double ns = NanosecondsPerCall( [&]
+        {
+            region.Clear();
+            damage( frame++ % kFrames + 1, region, random );
+            region.Coalesce( cost );
+            KeepResult( region.Pixels() );
+        } );
+
+        printf( "%-18s %9.0f bytes/frame (full copy %u), %5.1f%% of full, %.2f copies/frame, %7.0f ns to build and coalesce\n",
+                name, stats.BytesPerFrame(), kWidth * kHeight * kBytesPerPixel, 100.0 * stats.CopyRatio(),
+                double( rects ) / double( stats.frames ), ns );
+    }
+}
+
+int main()
+{
+    printf( "Dirty rectangles on a %ux%u surface, %u bytes per pixel, %d frames\n", kWidth, kHeight, kBytesPerPixel, kFrames );
+    Run( "spinning quad", SpinningQuad );
+    Run( "orbiting quads", OrbitingQuads );
+    Run( "scattered widgets", ScatteredWidgets );
+    Run( "whole frame", WholeFrame );
+    return 0;
+}
@@ -0,0 +1,90 @@
+//--------------------------------------------------------------------------------------
+// File: QuadBatchBench.cpp
+//
+// QuadBatcher::Build() from 10k to 1M quads over 1 to 256 materials, against packing
+// the same quads one at a time after a comparison sort by material, which has to give
+// the same instances
+//--------------------------------------------------------------------------------------
+
+#include "BenchHarness.h"
+#include "QuadBatch.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <numeric>
+#include <vector>
+
+
+namespace
+{
+    //? A grid of small quads, each turned a little more than the last, with materials
+    //? spread over the grid rather than in runs
+    void FillGrid( QuadList& quads, size_t count, uint32_t materials )
+    {
+        quads.Clear();
+        quads.Reserve( count );
+        const size_t columns = 1000;
+        for( size_t i = 0; i < count; ++i )
+        {
+            quads.Add( float( i % columns ) / columns * 2.0f - 1.0f, float( i / columns ) / float( count / columns + 1 ) * 2.0f - 1.0f,
+                       0.001f, 0.001f, float( i ) * 0.01f, uint32_t( i * 7919 % materials ), uint32_t( i % 16 ) );
+        }
+    }
+
+    //? The straightforward version: sort quad indices by material, then build each
+    //? instance on its own
+    void BuildSorted( const QuadList& quads, std::vector<uint32_t>& order, std::vector<QuadInstance>& instances )
+    {
+        order.resize( quads.Size() );
+        std::iota( order.begin(), order.end(), 0u );
+        std::stable_sort( order.begin(), order.end(), [&]( uint32_t a, uint32_t b ) { return quads.material[a] < quads.material[b]; } );
+        instances.resize( quads.Size() );
+        for( size_t i = 0; i < order.size(); ++i )
+        {
+            const uint32_t q = order[i];
+            QuadInstance& instance = instances[i];
+            instance.row0[0] = quads.scaleX[q] * quads.cosAngle[q];
+            instance.row0[1] = -quads.scaleY[q] * quads.sinAngle[q];
+            instance.row0[2] = quads.x[q];
+            instance.row1[0] = quads.scaleX[q] * quads.sinAngle[q];
+            instance.row1[1] = quads.scaleY[q] * quads.cosAngle[q];
+            instance.row1[2] = quads.y[q];
+            instance.slice = quads.slice[q];
+            instance.unused = 0;
+        }
+    }
+}
+
+int main()
+{
+    const size_t counts[] = { 10000, 100000, 1000000 };
+    const uint32_t materialCounts[] = { 1, 16, 256 };
+
+    QuadList quads;
+    QuadBatcher batcher;
+    std::vector<uint32_t> order;
+    std::vector<QuadInstance> sorted;
+    bool matches = true;
+    for( size_t count : counts )
+    {
+        for( uint32_t materials : materialCounts )
+        {
+            FillGrid( quads, count, materials );
+            const double buildNs = NanosecondsPerCall( [&] { KeepResult( batcher.Build( quads, materials ) ); } );
+            const double sortedNs = NanosecondsPerCall( [&]
+            {
+                BuildSorted( quads, order, sorted );
+                KeepResult( sorted.back().slice );
+            } );
+            const bool same = memcmp( sorted.data(), batcher.Instances().data(), sorted.size() * sizeof( QuadInstance ) ) == 0;
+            matches = matches && same;
+            printf( "%7zu quads, %3u materials: Build %8.3f ms (%5.2f ns/quad), sorted %8.3f ms (%5.2f ns/quad), %.1fx; "
+                    "%zu draws, %.1f MB of instances%s\n",
+                    count, materials, buildNs / 1e6, buildNs / double( count ), sortedNs / 1e6, sortedNs / double( count ),
+                    sortedNs / buildNs, batcher.Batches().size(),
+                    double( batcher.Instances().size() * sizeof( QuadInstance ) ) / ( 1024.0 * 1024.0 ), same ? "" : ", MISMATCH" );
+        }
+    }
+    return matches ? 0 : 1;
+}
@@ -0,0 +1,100 @@
+//--------------------------------------------------------------------------------------
+// File: ReadbackRingBench.cpp
+//
+// The readback ring against a simulated staging backend whose copies finish a set
+// number of frames after they were issued: frames delivered or dropped, polls that
+// found a copy unfinished, delivery latency and the CPU cost of a frame's readback
+//--------------------------------------------------------------------------------------
+
+#include "BenchHarness.h"
+#include "ReadbackRing.h"
+
+#include <cstdio>
+#include <vector>
+
+
+namespace
+{
+    const uint32_t kWidth = 1920;
+    const uint32_t kHeight = 1080;
+    const uint32_t kBytesPerPixel = 4;
+    const uint64_t kFrames = 600;
+
+    //? Staging slots with D3D11's 256-byte row pitch alignment. A copy is done once the
+    //? clock reaches the frame it was issued in plus gpuFrames.
+    class SimulatedStaging : public IStagingBackend
+    {
+    public:
+        SimulatedStaging( size_t slotCount, uint64_t gpuFrames ) :
+            m_pitch( ( size_t( kWidth ) * kBytesPerPixel + 255 ) & ~size_t( 255 ) ),
+            m_gpuFrames( gpuFrames ),
+            m_readyAt( slotCount, 0 ),
+            m_memory( slotCount, std::vector<uint8_t>( m_pitch * kHeight, 0x80 ) ) {}
+
+        uint64_t    frame = 0;
+
+        bool IssueCopy( size_t slot ) override
+        {
+            m_readyAt[slot] = frame + m_gpuFrames;
+            return true;
+        }
+
+        MapResult TryMap( size_t slot, const uint8_t** data, size_t* rowPitch ) override
+        {
+            if( frame < m_readyAt[slot] )
+                return MAP_BUSY;
+            *data = m_memory[slot].data();
+            *rowPitch = m_pitch;
+            return MAP_OK;
+        }
+
+        void Unmap( size_t ) override {}
+
+    private:
+        const size_t                        m_pitch;
+        const uint64_t                      m_gpuFrames;
+        std::vector<uint64_t>               m_readyAt;
+        std::vector<std::vector<uint8_t>>   m_memory;
+    };
+
+    void Run( size_t slots, uint32_t latency, uint64_t gpuFrames )
+    {
+        SimulatedStaging staging( slots, gpuFrames );
+        ReadbackRing ring( staging, slots, latency, kWidth, kHeight, kBytesPerPixel );
+        uint64_t latencySum = 0;
+        ring.SetCallback( [&]( const ReadbackFrame& frame )
+        {
+            latencySum += staging.frame - frame.frameId;
+            KeepResult( frame.data[frame.size - 1] );
+        } );
+
+        BenchTimer timer;
+        for( uint64_t frame = 1; frame <= kFrames; ++frame )
+        {
+            staging.frame = frame;
+            ring.Capture( frame );
+            ring.Poll( frame );
+        }
+        const double ms = timer.ElapsedMs();
+
+        const ReadbackRing::Stats& stats = ring.GetStats();
+        printf( "%zu slots, k=%u, copies take %llu frames: %5.1f%% delivered, %3llu dropped, %.2f busy polls/frame, "
+                "%.1f frames latency, %.3f ms/frame\n",
+                slots, latency, static_cast<unsigned long long>( gpuFrames ), 100.0 * double( stats.delivered ) / double( kFrames ),
+                static_cast<unsigned long long>( stats.droppedNoSlot ), double( stats.mapBusy ) / double( kFrames ),
+                stats.delivered ? double( latencySum ) / double( stats.delivered ) : 0.0, ms / double( kFrames ) );
+    }
+}
+
+int main()
+{
+    printf( "Readback of %ux%u RGBA8 frames, %llu frames per run\n", kWidth, kHeight, static_cast<unsigned long long>( kFrames ) );
+    for( uint64_t gpuFrames = 1; gpuFrames <= 3; ++gpuFrames )
+    {
+        Run( 1, 0, gpuFrames );
+        Run( 2, 1, gpuFrames );
+        Run( 3, 2, gpuFrames );
+        Run( 4, 3, gpuFrames );
+    }
+    return 0;
+}
@@ -0,0 +1,80 @@
+//--------------------------------------------------------------------------------------
+// File: SharedDownsampleBench.cpp
+//
+// The box-filter downsample's SIMD path against its scalar definition, at the sizes a
+// window renders at, and the RGB565 packing. SharedDownsampleTests checks that the two
+// paths give the same bytes.
+//--------------------------------------------------------------------------------------
+
+#include "BenchHarness.h"
+#include "SharedDownsample.h"
+
+#include <cstdio>
+#include <random>
+#include <vector>
+
+
+namespace
+{
+    struct Size
+    {
+        uint32_t    width;
+        uint32_t    height;
+    };
+
+    const Size kSizes[] = { { 800, 600 }, { 1920, 1080 }, { 3840, 2160 } };
+
+    //? Source megapixels per second
+    double Throughput( uint32_t width, uint32_t height, double ns )
+    {
+        return double( width ) * height / ns * 1e3;
+    }
+}
+
+int main()
+{
+    std::mt19937 random( 1 );
+    for( const Size& size : kSizes )
+    {
+        //? A padded pitch, as a mapped texture has
+        const size_t srcPitch = size_t( size.width ) * 4 + 64;
+        std::vector<uint8_t> src( srcPitch * size.height );
+        for( uint8_t& byte : src )
+            byte = uint8_t( random() );
+
+        for( uint32_t shift = 1; shift <= kMaxSharedScaleShift; ++shift )
+        {
+            const uint32_t dstWidth = size.width >> shift;
+            const uint32_t dstHeight = size.height >> shift;
+            const size_t dstPitch = size_t( dstWidth ) * 4;
+            std::vector<uint8_t> scalar( dstPitch * dstHeight );
+            std::vector<uint8_t> simd( dstPitch * dstHeight );
+
+            const double scalarNs = NanosecondsPerCall( [&]
+            {
+                DownsampleBoxScalar( src.data(), srcPitch, size.width, size.height, scalar.data(), dstPitch, shift );
+                KeepResult( scalar[0] );
+            } );
+            const double simdNs = NanosecondsPerCall( [&]
+            {
+                DownsampleBox( src.data(), srcPitch, size.width, size.height, simd.data(), dstPitch, shift );
+                KeepResult( simd[0] );
+            } );
+            printf( "%4ux%-4u 1/%u: scalar %8.3f ms (%6.0f MP/s), simd %8.3f ms (%6.0f MP/s), %.2fx\n",
+                    size.width, size.height, 1u << shift,
+                    scalarNs / 1e6, Throughput( size.width, size.height, scalarNs ),
+                    simdNs / 1e6, Throughput( size.width, size.height, simdNs ),
+                    scalarNs / simdNs );
+        }
+
+        std::vector<uint8_t> packed( size_t( size.width ) * 2 * size.height );
+        const double packNs = NanosecondsPerCall( [&]
+        {
+            PackRgb565( src.data(), srcPitch, size.width, size.height, packed.data(), size_t( size.width ) * 2 );
+            KeepResult( packed[0] );
+        } );
+        printf( "%4ux%-4u rgb565 pack: %8.3f ms (%6.0f MP/s)\n", size.width, size.height, packNs / 1e6,
+                Throughput( size.width, size.height, packNs ) );
+    }
+    return 0;
+}
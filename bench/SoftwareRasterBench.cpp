@@ -0,0 +1,106 @@
+//--------------------------------------------------------------------------------------
+// File: SoftwareRasterBench.cpp
+//
+// Frames per second of the software backend at 800x600 and 3840x2160: window A's
+// textured quad spinning, and the benchmark's grid of 256 quads, on one thread and on
+// the device's worker pool. Run from the source directory, so test.dds is found.
+//--------------------------------------------------------------------------------------
+
+#include "BenchHarness.h"
+#include "FrameBenchmark.h"
+#include "FrameLoop.h"
+#include "RenderDeviceSoftware.h"
+#include "RenderThreads.h"
+
+#include <cstdio>
+#include <memory>
+#include <vector>
+
+
+namespace
+{
+    const uint64_t kFrames = 60;
+
+    std::unique_ptr<SoftwareRenderDevice> CreateDevice( SharedRenderAssets& assets, size_t program, size_t helpers )
+    {
+        std::unique_ptr<SoftwareRenderDevice> device( new SoftwareRenderDevice( assets, helpers ) );
+        device->SetProgram( program, SoftwareProgram() );
+        return device->Create() ? std::move( device ) : nullptr;
+    }
+
+    void Report( const char* scene, uint32_t width, uint32_t height, const SoftwareRenderDevice& device, const TimingSummary& frames )
+    {
+        printf( "%4ux%-4u %-14s %2zu threads: %7.1f fps (mean %7.2f ms, p95 %7.2f ms)\n", width, height, scene,
+                device.Pool() ? device.Pool()->ThreadCount() + 1 : size_t( 1 ), 1000.0 / frames.meanMs, frames.meanMs, frames.p95Ms );
+    }
+
+    //? Window A as the application draws it: one textured quad, turning each frame
+    bool RunSpinningQuad( SharedRenderAssets& assets, size_t program, uint32_t width, uint32_t height, size_t helpers )
+    {
+        std::unique_ptr<SoftwareRenderDevice> device = CreateDevice( assets, program, helpers );
+        RenderWindowDesc desc;
+        desc.name = "A";
+        desc.program = program;
+        desc.width = width;
+        desc.height = height;
+        desc.offscreen = true;
+        desc.textureFile = L"test.dds";
+        RenderWindow* window = device ? device->CreateRenderWindow( desc ) : nullptr;
+        if( !window )
+            return false;
+
+        const float white[4] = { 1.0f, 1.0f, 1.0f, 1.0f };
+        std::vector<double> frameMs;
+        for( uint64_t frame = 0; frame < kFrames + 5; ++frame )
+        {
+            BenchTimer timer;
+            window->BeginFrame();
+            window->UpdateFrameConstants( SpinningQuadConstants( float( frame ) * 0.05f, white ) );
+            window->DrawQuad();
+            window->Present();
+            if( frame >= 5 )
+                frameMs.push_back( timer.ElapsedMs() );
+        }
+        Report( "spinning quad", width, height, *device, SummarizeTimings( frameMs ) );
+        return true;
+    }
+
+    //? The -benchmark scene: a grid of untextured quads through FrameLoop
+    bool RunGrid( SharedRenderAssets& assets, size_t program, uint32_t width, uint32_t height, size_t helpers )
+    {
+        std::unique_ptr<SoftwareRenderDevice> device = CreateDevice( assets, program, helpers );
+        BenchmarkConfig config;
+        config.width = width;
+        config.height = height;
+        config.frames = kFrames;
+        config.warmupFrames = 5;
+        config.quads = 256;
+        FrameBenchmark benchmark( config.warmupFrames );
+        if( !device || !RunFrameBenchmark( *device, program, config, benchmark ) )
+            return false;
+        Report( "256 quads", width, height, *device, benchmark.FrameSummary() );
+        return true;
+    }
+}
+
+int main()
+{
+    SharedRenderAssets assets;
+    const size_t program = assets.AddProgram( "A", "" );
+    const uint32_t sizes[][2] = { { 800, 600 }, { 3840, 2160 } };
+
+    bool ok = true;
+    for( const auto& size : sizes )
+    {
+        //? No helper threads, so Flush() rasterizes on the calling thread; then a helper per
+        //? further core
+        for( size_t helpers : { size_t( 0 ), SIZE_MAX } )
+        {
+            ok = RunSpinningQuad( assets, program, size[0], size[1], helpers ) && ok;
+            ok = RunGrid( assets, program, size[0], size[1], helpers ) && ok;
+        }
+    }
+    if( !ok )
+        fprintf( stderr, "A run failed; run from the source directory, where test.dds is\n" );
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,130 @@
+//--------------------------------------------------------------------------------------
+// File: TextureSamplerBench.cpp
+//
+// Samples per second of SampleTextureLinear on each path, with texels in rows and in
+// Morton-ordered tiles, for a quad drawn straight, rotated, magnified and minified.
+// Points come eight at a time, 4x2 pixel blocks in 64x64 screen tiles, as the rasterizer
+// asks for them.
+//--------------------------------------------------------------------------------------
+
+#include "BenchHarness.h"
+#include "TextureSampler.h"
+
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+
+namespace
+{
+    const uint32_t kScreen = 512;
+    const uint32_t kTile = 64;
+    const uint32_t kBatch = 8;
+
+    //? How the screen maps onto level 0 of the texture: turned by 'angle', with
+    //? 'texelsPerPixel' level-0 texels per pixel step
+    struct Mapping
+    {
+        const char* name;
+        float       angle;
+        float       texelsPerPixel;
+    };
+
+    const Mapping kMappings[] = {
+        { "straight", 0.0f, 1.0f },
+        { "rotated 30", 0.5236f, 1.0f },
+        { "rotated 90", 1.5708f, 1.0f },            // walks the texture down its columns
+        { "magnified x4", 0.5236f, 0.25f },
+        { "minified x4", 0.5236f, 4.0f },
+    };
+
+    struct Points
+    {
+        std::vector<float>  u;
+        std::vector<float>  v;
+        std::vector<float>  lod;
+    };
+
+    //? Screen pixels in the rasterizer's order: tile by tile, and within a tile 4x2 blocks
+    //? of one sampler call each, the top row first
+    void MapScreen( const SoftwareTexture& texture, const Mapping& mapping, Points& points )
+    {
+        const float scale = mapping.texelsPerPixel / float( texture.levels[0].width );
+        const float dudx = scale * cosf( mapping.angle );
+        const float dvdx = scale * sinf( mapping.angle );
+        const float dudy = -dvdx;
+        const float dvdy = dudx;
+        const float lod = ComputeTextureLod( texture, dudx, dvdx, dudy, dvdy );
+        points.u.clear();
+        points.v.clear();
+        points.lod.clear();
+        for( uint32_t ty = 0; ty < kScreen; ty += kTile )
+            for( uint32_t tx = 0; tx < kScreen; tx += kTile )
+                for( uint32_t by = ty; by < ty + kTile; by += 2 )
+                    for( uint32_t bx = tx; bx < tx + kTile; bx += 4 )
+                        for( uint32_t i = 0; i < kBatch; ++i )
+                        {
+                            const float x = float( bx + i % 4 ) + 0.5f;
+                            const float y = float( by + i / 4 ) + 0.5f;
+                            points.u.push_back( x * dudx + y * dudy );
+                            points.v.push_back( x * dvdx + y * dvdy );
+                            points.lod.push_back( lod );
+                        }
+    }
+
+    SoftwareTexture RandomTexture( uint32_t size, TexelLayout layout )
+    {
+        std::mt19937 random( size );
+        std::vector<uint32_t> texels( size_t( size ) * size );
+        for( uint32_t& texel : texels )
+            texel = uint32_t( random() );
+        SoftwareTexture texture;
+        AppendTextureLevel( texture, size, size, texels.data() );
+        GenerateTextureMips( texture );
+        SetTextureLayout( texture, layout );
+        return texture;
+    }
+
+    const char* PathName( SamplerPath path )
+    {
+        return path == SAMPLER_PATH_AVX2 ? "avx2" : path == SAMPLER_PATH_SSE2 ? "sse2" : "scalar";
+    }
+}
+
+int main()
+{
+    const SamplerPath best = BestSamplerPath();
+    printf( "Bilinear/trilinear samples, %ux%u pixels per run, best path %s\n", kScreen, kScreen, PathName( best ) );
+
+    std::vector<float> rgba( size_t( kScreen ) * kScreen * 4 );
+    Points points;
+    for( uint32_t size : { 256u, 2048u } )
+    {
+        const SoftwareTexture linear = RandomTexture( size, TEXEL_LAYOUT_LINEAR );
+        const SoftwareTexture tiled = RandomTexture( size, TEXEL_LAYOUT_MORTON );
+        for( const Mapping& mapping : kMappings )
+        {
+            MapScreen( linear, mapping, points );
+            for( uint32_t p = SAMPLER_PATH_SCALAR; p <= uint32_t( best ); ++p )
+            {
+                const SamplerPath path = SamplerPath( p );
+                double samplesPerSecond[2];
+                const SoftwareTexture* textures[2] = { &linear, &tiled };
+                for( int t = 0; t < 2; ++t )
+                {
+                    const double ns = NanosecondsPerCall( [&]
+                    {
+                        for( size_t i = 0; i < points.u.size(); i += kBatch )
+                            SampleTextureLinear( *textures[t], &points.u[i], &points.v[i], &points.lod[i], kBatch, &rgba[4 * i], path );
+                        KeepResult( uint64_t( rgba[0] * 255.0f ) );
+                    }, 50.0 );
+                    samplesPerSecond[t] = double( points.u.size() ) / ns * 1e3;
+                }
+                printf( "%4ux%-4u %-13s %-6s rows %7.1f Msamples/s, tiled %7.1f Msamples/s, %.2fx\n", size, size, mapping.name,
+                        PathName( path ), samplesPerSecond[0], samplesPerSecond[1], samplesPerSecond[1] / samplesPerSecond[0] );
+            }
+        }
+    }
+    return 0;
+}
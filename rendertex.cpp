@@ -19,7 +19,37 @@
 #include <d3dcompiler.h>
 #include <directxmath.h>
 #include <directxcolors.h>
+#include <atomic>
+#include <cfloat>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+#include "CpuTrace.h"
 #include "DDSTextureLoader.h"
+#include "DamageTracker.h"
+#include "DirtyRects.h"
+#include "FrameBenchmark.h"
+#include "FrameLatency.h"
+#include "FrameLoop.h"
+#include "FramePacing.h"
+#include "GoldenImage.h"
+#include "GpuProfiler.h"
+#include "HeadlessDriver.h"
+#include "RenderThreads.h"
+#include "SharedDownsample.h"
+#include "ReadbackRing.h"
+#include "RenderDeviceD3D11.h"
+#include "RenderGraph.h"
+#include "ResourceTracker.h"
+#include "D3D11CommandRecorder.h"
+#include "D3D11GpuProfiler.h"
+#include "D3D11QuadBatch.h"
+#include "SceneRecording.h"
+#include "ShaderCache.h"
 #include "resource.h"
 #include "DirectXTex/DirectXTex/DirectXTexP.h"
 #include "DirectXTex/DirectXTex/DirectXTex.h"
@@ -29,27 +59,37 @@ using namespace DirectX;
 //? --------------------------------------------------------------------------------------
 //? Structures
 //? --------------------------------------------------------------------------------------
-struct SimpleVertex
+struct CBDownsample
 {
-    XMFLOAT3 Pos;
-    XMFLOAT2 Tex;
+    UINT Scale;
+    UINT Pad[3];
 };
 
-struct CBNeverChanges
+//? What window A hands to window B along with the pixels in the shared surface
+struct SharedFrame
 {
-    XMMATRIX mView;
+    FrameStamp      stamp;
+    DirtyRegion     dirty;
+    FrameConstants  constants;      // B's quad turns with A's
+    bool            published = false;  // A took the keyed mutex and hands the key to B
 };
 
-struct CBChangeOnResize
+//? One shared surface of the handoff ring, created on device A and opened on device B.
+//? The keyed mutex orders A's copy into the surface before B's copy out of it.
+struct SharedSlot
 {
-    XMMATRIX mProjection;
+    ID3D11Texture2D*    texA = nullptr;
+    ID3D11RenderTargetView* rtvA = nullptr;     // only for reduced surfaces
+    IDXGIKeyedMutex*    mutexA = nullptr;
+    HANDLE              handle = nullptr;
+    ID3D11Texture2D*    texB = nullptr;
+    IDXGIKeyedMutex*    mutexB = nullptr;
+    SharedFrame         frame;
 };
 
-struct CBChangesEveryFrame
-{
-    XMMATRIX mWorld;
-    XMFLOAT4 vMeshColor;
-};
+static const UINT64 kKeyProducer = 0;
+static const UINT64 kKeyConsumer = 1;
+static const UINT kSharedSlotCount = 3;
 
 
 //? --------------------------------------------------------------------------------------
@@ -57,74 +97,225 @@ struct CBChangesEveryFrame
 //? --------------------------------------------------------------------------------------
 HINSTANCE                           g_hInst = nullptr;
 HWND                                g_hWnd = nullptr;
-HWND                                g_hWndB = nullptr;
-D3D_DRIVER_TYPE                     g_driverType = D3D_DRIVER_TYPE_NULL;
-D3D_FEATURE_LEVEL                   g_featureLevel = D3D_FEATURE_LEVEL_11_0;
-ID3D11Device*                       g_pd3dDeviceA = nullptr;
-ID3D11Device1*                      g_pd3dDevice1A = nullptr;
-ID3D11Device*                       g_pd3dDeviceB = nullptr;
-ID3D11Device1*                      g_pd3dDevice1B = nullptr;
-ID3D11DeviceContext*                g_pImmediateContextA = nullptr;
-ID3D11DeviceContext1*               g_pImmediateContext1A = nullptr;
-ID3D11DeviceContext*                g_pImmediateContextB = nullptr;
-ID3D11DeviceContext1*               g_pImmediateContext1B = nullptr;
-IDXGISwapChain*                     g_pSwapChainA = nullptr;
-IDXGISwapChain1*                    g_pSwapChain1A = nullptr;
-ID3D11RenderTargetView*             g_pRenderTargetViewA = nullptr;
-IDXGISwapChain*                     g_pSwapChainB = nullptr;
-IDXGISwapChain1*                    g_pSwapChain1B = nullptr;
-ID3D11RenderTargetView*             g_pRenderTargetViewB = nullptr;
-ID3D11Texture2D*                    g_pDepthStencilA = nullptr;
-ID3D11DepthStencilView*             g_pDepthStencilViewA = nullptr;
-ID3D11Texture2D*                    g_pDepthStencilB = nullptr;
-ID3D11DepthStencilView*             g_pDepthStencilViewB = nullptr;
-ID3D11VertexShader*                 g_pVertexShader = nullptr;
-ID3D11VertexShader*                 g_pVertexShader1 = nullptr;
-ID3D11PixelShader*                  g_pPixelShader = nullptr;
-ID3D11PixelShader*                  g_pPixelShader1 = nullptr;
-ID3D11VertexShader*                 g_pVertexShaderB = nullptr;
-ID3D11VertexShader*                 g_pVertexShader1B = nullptr;
-ID3D11PixelShader*                  g_pPixelShaderB = nullptr;
-ID3D11PixelShader*                  g_pPixelShader1B = nullptr;
-ID3D11InputLayout*                  g_pVertexLayout = nullptr;
-ID3D11InputLayout*                  g_pVertexLayoutB = nullptr;
-ID3D11Buffer*                       g_pVertexBuffer = nullptr;
-ID3D11Buffer*                       g_pVertexBufferB = nullptr;
-ID3D11Buffer*                       g_pIndexBuffer = nullptr;
-ID3D11Buffer*                       g_pIndexBufferB = nullptr;
-ID3D11Buffer*                       g_pCBNeverChanges = nullptr;
-ID3D11Buffer*                       g_pCBChangeOnResize = nullptr;
-ID3D11Buffer*                       g_pCBChangesEveryFrame = nullptr;
-ID3D11Buffer*                       g_pCBNeverChangesB = nullptr;
-ID3D11Buffer*                       g_pCBChangeOnResizeB = nullptr;
-ID3D11Buffer*                       g_pCBChangesEveryFrameB = nullptr;
-ID3D11Buffer*                       g_pSwapARenderBackBuffer = nullptr;
-ID3D11ShaderResourceView*           g_pTextureRV = nullptr;
+std::vector<HWND>                   g_hWndB;                    // one or more consumer windows
+UINT                                g_windowCountB = 1;
 ID3D11ShaderResourceView*           g_pTextureRV1 = nullptr;
-ID3D11SamplerState*                 g_pSamplerLinear = nullptr;
-ID3D11SamplerState*                 g_pSamplerLinear1 = nullptr;
-ID3D11Texture2D*                    g_pRenderedTex = nullptr;
-ID3D11Texture2D*                    g_pRenderedTexB = nullptr;
-IDXGIFactory1*                      dxgiFactory = nullptr;
-IDXGIFactory2*                      dxgiFactory2 = nullptr;
-IDXGIResource*                      sharedRes = nullptr;
-XMMATRIX                            g_World;
-XMMATRIX                            g_View;
-XMMATRIX                            g_Projection;
+ID3D11Texture2D*                    g_pRenderedTexB = nullptr;  // owned by device B's target pool
+size_t                              g_renderedTexEntryB = RenderTargetPool::kInvalidEntry;
+
+//? Compiled shaders are kept on disk between launches. Must outlive g_compilePool.
+static const DWORD                  kShaderCompileFlags = D3DCOMPILE_ENABLE_STRICTNESS;
+static const char                   kShaderCachePath[] = "rendertex_shaders.pack";
+ShaderCache                         g_shaderCache( D3D_COMPILER_VERSION );
+
+//? Devices and windows. Shader bytecode and the quad are shared by all of them.
+SharedRenderAssets                  g_assets;
+size_t                              g_programA = 0;
+size_t                              g_programB = 0;
+size_t                              g_programDownsample = 0;
+size_t                              g_programBatch = 0;
+std::unique_ptr<WorkerPool>         g_compilePool;              // startup shader compiles
+std::unique_ptr<D3D11RenderDevice>  g_deviceA;
+std::unique_ptr<D3D11RenderDevice>  g_deviceB;
+D3D11RenderWindow*                  g_windowA = nullptr;
 XMFLOAT4                            g_vMeshColor( 1.0f, 1.0f, 1.0f, 1.0f );
-HANDLE                              texHandle;
+
+//? Animation time is derived from the frame id, so every run renders the same frames
+static const double                 kAnimationStepSeconds = 1.0 / 60.0;
+
+//? Frame handoff between window A (producer) and window B (consumer)
+SharedSlot                          g_sharedSlots[kSharedSlotCount];
+FrameSlotRing                       g_frameRing( kSharedSlotCount );
+bool                                g_threadedRender = false;
+RenderThread                        g_renderThreadA;
+RenderThread                        g_renderThreadB;
+UINT64                              g_frameCounterA = 0;
+FrameLatencyTracker                 g_latency;
+DirtyRectCost                       g_dirtyCost;
+DirtyCopyStats                      g_dirtyStatsB;
+DirtyRect                           g_lastQuadBoundsA = {};
+FrameConstants                      g_lastPublishedCBA;
+bool                                g_hasPublishedA = false;
+DirtyRegion                         g_dirtyFullA;
+
+//? Reduced sharing: negotiated once both devices exist
+ProducerSurfaceConfig               g_producerConfigA;
+ConsumerSurfaceRequest              g_consumerRequestB;
+SharedSurfaceDesc                   g_sharedDesc;
+ID3D11ShaderResourceView*           g_pBackBufferSRVA = nullptr;
+ID3D11VertexShader*                 g_pDownsampleVS = nullptr;
+ID3D11PixelShader*                  g_pDownsamplePS = nullptr;
+ID3D11Buffer*                       g_pCBDownsample = nullptr;
+ID3D11RasterizerState*              g_pScissorStateA = nullptr;
+
+//? Frame capture from window A: copies in frame N, mapped in frame N + kReadbackLatency
+static const UINT                   kReadbackLatency = 2;
+bool                                g_captureFrames = false;
+std::unique_ptr<IStagingBackend>    g_readbackBackendA;
+std::unique_ptr<ReadbackRing>       g_readbackA;
+std::vector<uint8_t>                g_capturedFrameA;
+UINT64                              g_capturedFrameIdA = 0;
+
+//? GPU time of each pass on both devices, read back kGpuProfileLatency frames later
+static const UINT                   kGpuProfileLatency = 3;
+static const size_t                 kGpuProfileMaxScopes = 8;
+struct GpuPassScopes
+{
+    size_t  clear = 0;
+    size_t  draw = 0;
+    size_t  copy = 0;
+    size_t  present = 0;
+};
+bool                                g_gpuProfile = false;
+D3D11TimestampBackend               g_timestampsA;
+D3D11TimestampBackend               g_timestampsB;
+std::unique_ptr<GpuProfiler>        g_gpuProfilerA;
+std::unique_ptr<GpuProfiler>        g_gpuProfilerB;
+GpuPassScopes                       g_gpuScopesA;
+GpuPassScopes                       g_gpuScopesB;
+UINT64                              g_frameCounterB = 0;
+
+//? Scene mode: a grid of quads on window A instead of the single one, optionally
+//? recorded on deferred contexts by worker threads
+static const size_t                 kSceneChunkQuads = 256;
+size_t                              g_sceneQuadCountA = 0;      // 0: draw the single quad
+size_t                              g_deferredContextsA = 0;    // 0: record on the immediate context
+std::vector<FrameConstants>         g_sceneQuadsA;
+std::unique_ptr<D3D11CommandRecorder> g_sceneRecorderA;
+std::unique_ptr<WorkerPool>         g_scenePoolA;
+SceneSubmitStats                    g_sceneTotalsA;             // summed over g_sceneFramesA
+UINT64                              g_sceneFramesA = 0;
+
+//? Instanced scene: the same grid batched by texture, one draw per texture array
+static const UINT                   kTextureArraySlices = 16;
+bool                                g_instancedA = false;
+UINT                                g_sceneTextureCountA = 1;   // distinct textures across the grid
+QuadList                            g_quadListA;
+QuadBatcher                         g_batcherA;
+std::unique_ptr<D3D11QuadBatchRenderer> g_batchRendererA;
+double                              g_batchBuildMsA = 0.0;      // summed over the frames that rebuilt
+UINT64                              g_batchBuildsA = 0;
+
+//? Headless: window A alone, offscreen at a fixed size, for a fixed number of frames
+HeadlessOptions                     g_headless;                 // width 0: show the windows
+
+//? Benchmark: a headless run timed per phase, summarized to g_headless.benchmarkPath
+BenchmarkConfig                     g_benchmarkConfig;
+FrameBenchmark*                     g_benchmarkA = nullptr;     // the running benchmark, if any
+size_t                              g_scenePhaseA = 0;
+size_t                              g_submitPhaseA = 0;
+
+//? CPU trace: markers on every thread, written to g_tracePath as Chrome trace JSON
+std::wstring                        g_tracePath;                // empty: not tracing
+
+//? Resizing: WM_SIZE only records the new size while the user drags a border, and the
+//? targets are recreated once when the drag ends; other size changes (maximize, ALT+ENTER)
+//? apply at once. With -threaded the message thread only queues them and render thread A
+//? applies them between frames, so the message thread never waits on a render thread
+//? that may itself be waiting on a message (DXGI sends some while presenting).
+struct PendingResize
+{
+    HWND    hWnd;
+    UINT    width;
+    UINT    height;
+};
+bool                                g_inSizeMove = false;
+std::mutex                          g_resizeMutex;              // guards g_pendingResizes
+std::vector<PendingResize>          g_pendingResizes;
+std::atomic<bool>                   g_resizeRequested( false ); // -threaded: for render thread A
+bool                                g_startFullscreen = false;
+
+//? Frame pacing: each side waits on its swap chains before a frame instead of queueing
+//? as many presents as DXGI allows; A can also be throttled to a target frame rate
+UINT                                g_maxFrameLatency = 1;      // 0: no waits, present as fast as possible
+UINT                                g_swapChainBuffers = 3;
+UINT                                g_syncInterval = 1;
+SteadyPacingClock                   g_pacingClock;
+FramePacingConfig                   g_pacingConfigA;
+std::unique_ptr<FramePacer>         g_pacerA;
+std::unique_ptr<FramePacer>         g_pacerB;
+std::vector<IFrameLatencyWaitable*> g_latencyWaitablesB;     // B's windows that present this frame
+bool                                g_timerPeriodSet = false;
+
+//? Transient depth: B's windows draw one after the other, so device B plans their depth
+//? buffers per frame and they share one instead of each keeping its own
+bool                                g_transientDepthB = true;
+std::vector<D3D11RenderWindow*>     g_drawingB;                 // B's windows that draw this frame
+
+//? Damage tracking: each window draws and presents only when one of its inputs changed
+//? since its last frame. The animation advances only while it runs, so a paused scene
+//? goes idle and the message loop sleeps instead of spinning.
+enum DamageInput : size_t
+{
+    DAMAGE_CONSTANTS,                   // the frame constants
+    DAMAGE_TARGET,                      // the window's resize count
+    DAMAGE_WINDOWS,                     // g_windowChanges
+    DAMAGE_SHARED_SURFACE,              // B only: g_sharedGenerationB
+};
+std::atomic<bool>                   g_animateA( true );
+UINT64                              g_animationStepA = 0;
+ChangeSignal                        g_windowChanges;            // keys, exposed and resized windows
+DamageTracker                       g_damageA;
+std::vector<DamageTracker>          g_damageB;                  // one per window on device B
+UINT64                              g_sharedGenerationB = 0;    // B's copy of the shared image changed
+
+//? Frame graph: the passes of a frame on both devices and the schedule compiled from
+//? them; RenderA and RenderB each run their device's steps
+static const uint32_t               kGraphDeviceA = 0;
+static const uint32_t               kGraphDeviceB = 1;
+static const size_t                 kNoGraphPass = SIZE_MAX;
+struct FrameGraphPasses
+{
+    size_t  drawA = kNoGraphPass;
+    size_t  publishA = kNoGraphPass;
+    size_t  readbackA = kNoGraphPass;       // only when capturing
+    size_t  presentA = kNoGraphPass;
+    size_t  copyB = kNoGraphPass;
+    size_t  windowsB = kNoGraphPass;
+};
+RenderGraph                         g_frameGraph;
+RenderSchedule                      g_frameSchedule;
+FrameGraphPasses                    g_graphPasses;
+
+//? Resource growth: with -leakcheck each render thread compares its device's resources
+//? every kResourceCheckFrames frames and reports whatever piled up in between
+static const UINT64                 kResourceCheckFrames = 600;
+bool                                g_leakCheck = false;
+ResourceSnapshot                    g_resourcesA;               // at the last check; frame 0: none yet
+ResourceSnapshot                    g_resourcesB;
+
+//? Golden images: headless frames checked against, or recorded as, reference images
+std::unique_ptr<GoldenSuite>        g_goldenSuite;              // null: no checks
 
 
 //? --------------------------------------------------------------------------------------
 //? Forward declarations
 //? --------------------------------------------------------------------------------------
+void InitShaders();
 HRESULT InitWindow( HINSTANCE hInstance, int nCmdShow );
-HRESULT InitWndA();
-HRESULT InitWndB();
+HRESULT InitDevices();
+HRESULT InitSharedSurfaces();
+void ReleaseSharedSurfaces();
+HRESULT InitReadbackA();
+HRESULT InitGpuProfilers();
+HRESULT InitSceneA();
+HRESULT BuildFrameGraph();
+void FinishShaderCompiles();
+int RunHeadless();
 void CleanupDevice();
+void StartRenderThreads();
+void StopRenderThreads();
+void QueueResize( HWND hWnd, UINT width, UINT height );
+void RequestResizes();
+bool ApplyPendingResizes();
 LRESULT CALLBACK    WndProc( HWND, UINT, WPARAM, LPARAM );
-void RenderA();
-void RenderB();
+bool DrawFrameA( float t, FrameConstants& cb );
+void RenderA( SharedSlot& slot );
+void RenderB( SharedSlot& slot );
+void CheckResourceGrowth( D3D11RenderDevice& device, UINT64 frame, ResourceSnapshot& last, const char* name );
+bool UpdateDamageA();
+bool ProduceFrameA();
+bool ConsumeFrameB();
 
 
 //? --------------------------------------------------------------------------------------
@@ -134,46 +325,186 @@ void RenderB();
 int WINAPI wWinMain( _In_ HINSTANCE hInstance, _In_opt_ HINSTANCE hPrevInstance, _In_ LPWSTR lpCmdLine, _In_ int nCmdShow )
 {
     UNREFERENCED_PARAMETER( hPrevInstance );
-    UNREFERENCED_PARAMETER( lpCmdLine );
+
+    // -threaded: drive each device from its own render thread
+    g_threadedRender = lpCmdLine && wcsstr( lpCmdLine, L"-threaded" ) != nullptr;
+
+    // -sharedscale=N: share a 1/2^N resolution surface, -compact: share it as RGB565
+    if( lpCmdLine )
+    {
+        const wchar_t* scale = wcsstr( lpCmdLine, L"-sharedscale=" );
+        if( scale )
+            g_producerConfigA.scaleShift = (UINT)_wtoi( scale + wcslen( L"-sharedscale=" ) );
+        g_producerConfigA.preferCompact = wcsstr( lpCmdLine, L"-compact" ) != nullptr;
+
+        // -capture: read window A's frames back to the CPU
+        g_captureFrames = wcsstr( lpCmdLine, L"-capture" ) != nullptr;
+
+        // -gpuprofile: time the clear, draw, copy and present passes on the GPU
+        g_gpuProfile = wcsstr( lpCmdLine, L"-gpuprofile" ) != nullptr;
+
+        // -fullscreen: start window A fullscreen; ALT+ENTER toggles any window
+        g_startFullscreen = wcsstr( lpCmdLine, L"-fullscreen" ) != nullptr;
+
+        // -leakcheck: report resources and references that pile up between frames
+        g_leakCheck = wcsstr( lpCmdLine, L"-leakcheck" ) != nullptr;
+
+        // -paused: start with the animation stopped; SPACE toggles it
+        if( wcsstr( lpCmdLine, L"-paused" ) )
+            g_animateA = false;
+
+        // -latency=N: let each swap chain queue at most N frames and wait on it before a
+        // frame (0: never wait), -buffers=N: swap chain buffers, -vsync=N: present every
+        // N vblanks (0: immediately), -fps=N: throttle window A to N frames per second
+        const wchar_t* latency = wcsstr( lpCmdLine, L"-latency=" );
+        if( latency )
+            g_maxFrameLatency = (UINT)_wtoi( latency + wcslen( L"-latency=" ) );
+        const wchar_t* buffers = wcsstr( lpCmdLine, L"-buffers=" );
+        if( buffers && _wtoi( buffers + wcslen( L"-buffers=" ) ) > 0 )
+            g_swapChainBuffers = (UINT)_wtoi( buffers + wcslen( L"-buffers=" ) );
+        const wchar_t* vsync = wcsstr( lpCmdLine, L"-vsync=" );
+        if( vsync )
+            g_syncInterval = (UINT)_wtoi( vsync + wcslen( L"-vsync=" ) );
+        const wchar_t* fps = wcsstr( lpCmdLine, L"-fps=" );
+        if( fps && _wtof( fps + wcslen( L"-fps=" ) ) > 0.0 )
+            g_pacingConfigA.targetFps = _wtof( fps + wcslen( L"-fps=" ) );
+
+        // -owndepth: give every window on device B a depth buffer of its own
+        g_transientDepthB = wcsstr( lpCmdLine, L"-owndepth" ) == nullptr;
+
+        // -deferred=N: record the -quads=N grid on N deferred contexts
+        const wchar_t* deferred = wcsstr( lpCmdLine, L"-deferred=" );
+        if( deferred && _wtoi( deferred + wcslen( L"-deferred=" ) ) > 0 )
+            g_deferredContextsA = (size_t)_wtoi( deferred + wcslen( L"-deferred=" ) );
+
+        // -instanced: draw the -quads=N grid in one instanced draw per texture array
+        g_instancedA = wcsstr( lpCmdLine, L"-instanced" ) != nullptr;
+
+        // -headless=WxH, -software, -frames=N, -benchmark=<file>, -golden=<dir>,
+        // -goldenupdate and the scene size -quads=N, -textures=N and -windows=N: see
+        // HeadlessDriver.h, which reads them from the command line in the ANSI code page
+        std::string commandLine( WideCharToMultiByte( CP_ACP, 0, lpCmdLine, -1, nullptr, 0, nullptr, nullptr ), '\0' );
+        WideCharToMultiByte( CP_ACP, 0, lpCmdLine, -1, &commandLine[0], (int)commandLine.size(), nullptr, nullptr );
+        ParseHeadlessOptions( commandLine.c_str(), g_headless );
+        g_sceneQuadCountA = g_headless.quads;
+        g_sceneTextureCountA = g_headless.textures;
+        g_windowCountB = g_headless.windows;
+        if( !g_headless.goldenDirectory.empty() && !g_headless.software )
+            g_goldenSuite.reset( new GoldenSuite( g_headless.goldenDirectory, g_headless.goldenUpdate ) );
+    }
+
+    // -trace=<file>: record CPU markers from the start and write them to <file> on exit,
+    // for chrome://tracing or ui.perfetto.dev
+    const wchar_t* trace = lpCmdLine ? wcsstr( lpCmdLine, L"-trace=" ) : nullptr;
+    if( trace )
+    {
+        const wchar_t* path = trace + wcslen( L"-trace=" );
+        g_tracePath.assign( path, wcscspn( path, L" \t" ) );
+        CpuTrace::Enable( true );
+        CpuTrace::SetThreadName( "Main" );
+    }
+
+    // The CPU rasterizer runs its own versions of the shaders, on any platform
+    if( g_headless.software )
+    {
+        const int result = RunPortableHeadless( g_headless, []( const char* text ) { OutputDebugStringA( text ); } );
+        CleanupDevice();
+        return result;
+    }
+
+    // Shader compiles run on worker threads while the windows and devices are created
+    InitShaders();
+
+    if( g_headless.width )
+        return RunHeadless();
 
     if( FAILED( InitWindow( hInstance, nCmdShow ) ) )
         return 0;
 
-    /*/
-    if (FAILED(InitDevice()))
+    if (FAILED(InitDevices()))
     {
         CleanupDevice();
         return 0;
     }
-    //*/
 
-    if (FAILED(InitWndA()))
+    if (FAILED(InitSharedSurfaces()))
     {
         CleanupDevice();
         return 0;
     }
 
-    //*/
-    if (FAILED(InitWndB()))
+    if (g_captureFrames && FAILED(InitReadbackA()))
+    {
+        CleanupDevice();
+        return 0;
+    }
+
+    if (g_gpuProfile && FAILED(InitGpuProfilers()))
+    {
+        CleanupDevice();
+        return 0;
+    }
+
+    if (g_sceneQuadCountA && FAILED(InitSceneA()))
+    {
+        CleanupDevice();
+        return 0;
+    }
+
+    if (FAILED(BuildFrameGraph()))
     {
         CleanupDevice();
         return 0;
     }
+
+    // Throttled waits sleep in 1 ms steps, which the default timer resolution rounds up
+    // to a scheduler tick
+    if (g_pacingConfigA.targetFps > 0.0)
+        g_timerPeriodSet = timeBeginPeriod(1) == TIMERR_NOERROR;
+
+    FinishShaderCompiles();
     //*/
 
+    // The switch arrives as a WM_SIZE, which resizes window A
+    if( g_startFullscreen )
+        g_windowA->SwapChain()->SetFullscreenState( TRUE, nullptr );
+
     // Main message loop
     MSG msg = {0};
-    while( WM_QUIT != msg.message )
+    if( g_threadedRender )
     {
-        if( PeekMessage( &msg, nullptr, 0, 0, PM_REMOVE ) )
+        // The render threads hand frames to each other through the slot ring, so this
+        // thread only has to pump messages
+        StartRenderThreads();
+
+        while( GetMessage( &msg, nullptr, 0, 0 ) > 0 )
         {
             TranslateMessage( &msg );
             DispatchMessage( &msg );
         }
-        else
+
+        StopRenderThreads();
+    }
+    else
+    {
+        while( WM_QUIT != msg.message )
         {
-            RenderA();
-            RenderB();
+            if( PeekMessage( &msg, nullptr, 0, 0, PM_REMOVE ) )
+            {
+                TranslateMessage( &msg );
+                DispatchMessage( &msg );
+            }
+            else if( UpdateDamageA() )
+            {
+                ProduceFrameA();
+                ConsumeFrameB();
+            }
+            else
+            {
+                // Nothing changed: sleep until the next message instead of spinning
+                g_damageA.MarkSkipped();
+                MsgWaitForMultipleObjectsEx( 0, nullptr, INFINITE, QS_ALLINPUT, MWMO_INPUTAVAILABLE );
+            }
         }
     }
 
@@ -282,6 +613,73 @@ const auto m_shaderB = R"SHADERB(
     }
     )SHADERB";
 
+//? Box-filter downsample of window A's back buffer into a reduced shared surface.
+//? Matches DownsampleBoxScalar() in SharedDownsample.cpp.
+const auto m_shaderDownsample = R"SHADERDS(
+    Texture2D txSource : register(t0);
+
+    cbuffer cbDownsample : register( b0 )
+    {
+        uint Scale;
+        uint3 Pad;
+    };
+
+    float4 VS(uint id : SV_VertexID) : SV_POSITION
+    {
+        // Fullscreen triangle
+        float2 uv = float2((id << 1) & 2, id & 2);
+        return float4(uv * float2(2.0f, -2.0f) + float2(-1.0f, 1.0f), 0.0f, 1.0f);
+    }
+
+    float4 PS(float4 pos : SV_POSITION) : SV_Target
+    {
+        int2 base = int2(pos.xy) * (int)Scale;
+        float4 sum = 0;
+        for (uint y = 0; y < Scale; ++y)
+        {
+            for (uint x = 0; x < Scale; ++x)
+                sum += txSource.Load(int3(base + int2(x, y), 0));
+        }
+        return sum / (float)(Scale * Scale);
+    }
+    )SHADERDS";
+
+//? Instanced quads: the placement and texture-array slice come per instance (QuadInstance)
+const auto m_shaderBatch = R"SHADERBATCH(
+    Texture2DArray txArray : register(t0);
+    SamplerState samLinear : register(s0);
+
+    struct VS_INPUT
+    {
+        float4 Pos : POSITION;
+        float2 Tex : TEXCOORD0;
+        float3 Row0 : TEXCOORD1;
+        float3 Row1 : TEXCOORD2;
+        uint Slice : TEXCOORD3;
+    };
+
+    struct PS_INPUT
+    {
+        float4 Pos : SV_POSITION;
+        float3 Tex : TEXCOORD0;
+    };
+
+    PS_INPUT VS(VS_INPUT input)
+    {
+        PS_INPUT output = (PS_INPUT)0;
+        float3 pos = float3(input.Pos.xy, 1.0f);
+        output.Pos = float4(dot(input.Row0, pos), dot(input.Row1, pos), 0.0f, 1.0f);
+        output.Tex = float3(input.Tex, (float)input.Slice);
+
+        return output;
+    }
+
+    float4 PS(PS_INPUT input) : SV_Target
+    {
+        return txArray.Sample(samLinear, input.Tex);
+    }
+    )SHADERBATCH";
+
 //? --------------------------------------------------------------------------------------
 //? Register class and create window
 //? --------------------------------------------------------------------------------------
@@ -309,22 +707,27 @@ HRESULT InitWindow( HINSTANCE hInstance, int nCmdShow )
     g_hInst = hInstance;
     RECT rc = { 0, 0, 800, 600 };
     AdjustWindowRect( &rc, WS_OVERLAPPEDWINDOW, FALSE );
-    g_hWnd = CreateWindow( L"WindowClass", L"Window A",
-                           WS_OVERLAPPED | WS_CAPTION | WS_SYSMENU | WS_MINIMIZEBOX,
+    g_hWnd = CreateWindow( L"WindowClass", L"Window A", WS_OVERLAPPEDWINDOW,
                            CW_USEDEFAULT, CW_USEDEFAULT, rc.right - rc.left, rc.bottom - rc.top, nullptr, nullptr, hInstance,
                            nullptr );
     if( !g_hWnd )
         return E_FAIL;
 
-    g_hWndB = CreateWindow(L"WindowClass", L"Window B",
-                           WS_OVERLAPPED | WS_CAPTION | WS_SYSMENU | WS_MINIMIZEBOX,
-                           CW_USEDEFAULT, CW_USEDEFAULT, rc.right - rc.left, rc.bottom - rc.top, nullptr, nullptr, hInstance,
-                           nullptr);
-    if (!g_hWndB)
-        return E_FAIL;
+    for (UINT i = 0; i < g_windowCountB; ++i)
+    {
+        wchar_t title[32];
+        swprintf_s(title, i == 0 ? L"Window B" : L"Window B%u", i + 1);
+        HWND hWnd = CreateWindow(L"WindowClass", title, WS_OVERLAPPEDWINDOW,
+                                 CW_USEDEFAULT, CW_USEDEFAULT, rc.right - rc.left, rc.bottom - rc.top, nullptr, nullptr, hInstance,
+                                 nullptr);
+        if (!hWnd)
+            return E_FAIL;
+        g_hWndB.push_back(hWnd);
+    }
 
     ShowWindow( g_hWnd, nCmdShow );
-    ShowWindow( g_hWndB, nCmdShow );
+    for (HWND hWnd : g_hWndB)
+        ShowWindow( hWnd, nCmdShow );
 
     return S_OK;
 }
@@ -332,9 +735,11 @@ HRESULT InitWindow( HINSTANCE hInstance, int nCmdShow )
 //? shader from string method
 HRESULT CompileShaderFromString(const char* shaderName, LPCSTR szEntryPoint, LPCSTR szShaderModel, ID3DBlob** ppBlobOut)
 {
+    CPU_TRACE_SCOPE("CompileShaderFromString");
+
     HRESULT hr = S_OK;
 
-    DWORD dwShaderFlags = D3DCOMPILE_ENABLE_STRICTNESS;
+    DWORD dwShaderFlags = kShaderCompileFlags;
 
     ID3DBlob* pErrorBlob = nullptr;
     hr = D3DCompile(
@@ -365,747 +770,882 @@ HRESULT CompileShaderFromString(const char* shaderName, LPCSTR szEntryPoint, LPC
     return S_OK;
 }
 
+//? ShaderCompileFn for the render devices. D3DCompile only runs on a shader cache miss.
+bool CompileShaderBytecode(const char* source, const char* entryPoint, const char* target, std::vector<uint8_t>& bytecode)
+{
+    return g_shaderCache.GetOrCompile(source, entryPoint, target, kShaderCompileFlags,
+        [](const char* src, const char* entry, const char* profile, std::vector<uint8_t>& out)
+        {
+            ID3DBlob* pBlob = nullptr;
+            if (FAILED(CompileShaderFromString(src, entry, profile, &pBlob)))
+                return false;
+
+            const uint8_t* code = static_cast<const uint8_t*>(pBlob->GetBufferPointer());
+            out.assign(code, code + pBlob->GetBufferSize());
+            pBlob->Release();
+            return true;
+        }, bytecode);
+}
+
 //! --------------------------------------------------------------------------------------
 //!
-//! WINDOW A
+//! DEVICES AND WINDOWS
 //!
 //! --------------------------------------------------------------------------------------
-HRESULT InitWndA()
+
+//? --------------------------------------------------------------------------------------
+//? Device A renders the textured quad into window A; device B shows what A shares in
+//? each of its windows.
+//? --------------------------------------------------------------------------------------
+//? --------------------------------------------------------------------------------------
+//? Registers the shader programs and starts compiling all of them on a worker pool. The
+//? devices join each compile right before they create the shader from it.
+//? --------------------------------------------------------------------------------------
+void InitShaders()
 {
-    HRESULT hr = S_OK;
+    g_programA = g_assets.AddProgram("A", m_shader);
+    g_programB = g_assets.AddProgram("B", m_shaderB);
 
-    RECT rc;
-    GetClientRect(g_hWnd, &rc);
-    UINT width = rc.right - rc.left;
-    UINT height = rc.bottom - rc.top;
+    g_shaderCache.Open(kShaderCachePath);
 
-    UINT createDeviceFlags = 0;
-#ifdef _DEBUG
-    createDeviceFlags |= D3D11_CREATE_DEVICE_DEBUG;
-#endif
+    const UINT hardwareThreads = std::thread::hardware_concurrency();
+    const size_t workers = hardwareThreads > 2 ? (hardwareThreads - 1 < 4 ? hardwareThreads - 1 : 4) : 1;
+    g_compilePool.reset(new WorkerPool(workers));
+    g_assets.PrefetchAll(CompileShaderBytecode, *g_compilePool);
 
-    D3D_DRIVER_TYPE driverTypes[] =
+    //? The downsample pass is only needed if A ends up sharing a reduced surface
+    g_programDownsample = g_assets.AddProgram("Downsample", m_shaderDownsample);
+    if (g_producerConfigA.scaleShift > 0 || g_producerConfigA.preferCompact)
     {
-        D3D_DRIVER_TYPE_WARP,
-        D3D_DRIVER_TYPE_HARDWARE,
-        D3D_DRIVER_TYPE_REFERENCE,
-    };
-    UINT numDriverTypes = ARRAYSIZE(driverTypes);
+        g_assets.Request(g_programDownsample, SHADER_STAGE_VERTEX, CompileShaderBytecode, g_compilePool.get());
+        g_assets.Request(g_programDownsample, SHADER_STAGE_PIXEL, CompileShaderBytecode, g_compilePool.get());
+    }
 
-    D3D_FEATURE_LEVEL featureLevels[] =
+    g_programBatch = g_assets.AddProgram("Batch", m_shaderBatch, VERTEX_LAYOUT_QUAD_INSTANCED);
+    if (g_sceneQuadCountA && g_instancedA)
     {
-        D3D_FEATURE_LEVEL_11_1,
-        D3D_FEATURE_LEVEL_11_0,
-        D3D_FEATURE_LEVEL_10_1,
-        D3D_FEATURE_LEVEL_10_0,
-    };
-    UINT numFeatureLevels = ARRAYSIZE(featureLevels);
+        g_assets.Request(g_programBatch, SHADER_STAGE_VERTEX, CompileShaderBytecode, g_compilePool.get());
+        g_assets.Request(g_programBatch, SHADER_STAGE_PIXEL, CompileShaderBytecode, g_compilePool.get());
+    }
+}
 
-    for (UINT driverTypeIndex = 0; driverTypeIndex < numDriverTypes; driverTypeIndex++)
+HRESULT InitDevices()
+{
+    g_deviceA.reset(new D3D11RenderDevice(g_assets, CompileShaderBytecode));
+    if (!g_deviceA->Create())
+        return g_deviceA->LastError();
+
+    RenderWindowDesc descA;
+    descA.name = "A";
+    descA.nativeWindow = g_hWnd;
+    descA.program = g_programA;
+    descA.textureFile = L"test.dds";
+    memcpy(descA.clearColor, Colors::MidnightBlue.f, sizeof(descA.clearColor));
+    descA.shaderReadableBackBuffer = true;     // read by the downsample pass
+    descA.bufferCount = g_swapChainBuffers;
+    descA.maxFrameLatency = g_maxFrameLatency;
+    descA.syncInterval = g_syncInterval;
+    g_windowA = g_deviceA->CreateRenderWindow(descA);
+    if (!g_windowA)
+        return g_deviceA->LastError();
+
+    g_deviceB.reset(new D3D11RenderDevice(g_assets, CompileShaderBytecode));
+    if (!g_deviceB->Create())
+        return g_deviceB->LastError();
+
+    //? The windows sample g_pTextureRV1, which InitSharedSurfaces creates once the shared
+    //? surface size is known
+    for (size_t i = 0; i < g_hWndB.size(); ++i)
     {
-        g_driverType = driverTypes[driverTypeIndex];
-        hr = D3D11CreateDevice(nullptr, g_driverType, nullptr, createDeviceFlags, featureLevels, numFeatureLevels,
-            D3D11_SDK_VERSION, &g_pd3dDeviceA, &g_featureLevel, &g_pImmediateContextA);
-
-        if (hr == E_INVALIDARG)
-        {
-            // DirectX 11.0 platforms will not recognize D3D_FEATURE_LEVEL_11_1 so we need to retry without it
-            hr = D3D11CreateDevice(nullptr, g_driverType, nullptr, createDeviceFlags, &featureLevels[1], numFeatureLevels - 1,
-                D3D11_SDK_VERSION, &g_pd3dDeviceA, &g_featureLevel, &g_pImmediateContextA);
-        }
-
-        if (SUCCEEDED(hr))
-            break;
+        RenderWindowDesc descB;
+        descB.name = i == 0 ? "B" : "B" + std::to_string(i + 1);
+        descB.nativeWindow = g_hWndB[i];
+        descB.program = g_programB;
+        memcpy(descB.clearColor, Colors::CadetBlue.f, sizeof(descB.clearColor));
+        descB.bufferCount = g_swapChainBuffers;
+        descB.maxFrameLatency = g_maxFrameLatency;
+        descB.syncInterval = g_syncInterval;
+        descB.transientDepth = g_transientDepthB;
+        if (!g_deviceB->CreateRenderWindow(descB))
+            return g_deviceB->LastError();
     }
-    if (FAILED(hr))
-        return hr;
 
-    //! Obtain DXGI factory from device (since we used nullptr for pAdapter above)
-    /*IDXGIFactory1* dxgiFactory = nullptr;*/
+    g_damageA.AddInput("constants");
+    g_damageA.AddInput("target");
+    g_damageA.AddInput("windows");
+    g_damageB.resize(g_deviceB->WindowCount());
+    for (DamageTracker& damage : g_damageB)
     {
-        IDXGIDevice* dxgiDevice = nullptr;
-        hr = g_pd3dDeviceA->QueryInterface(__uuidof(IDXGIDevice), reinterpret_cast<void**>(&dxgiDevice));
-        if (SUCCEEDED(hr))
-        {
-            IDXGIAdapter* adapter = nullptr;
-            hr = dxgiDevice->GetAdapter(&adapter);
-            if (SUCCEEDED(hr))
-            {
-                hr = adapter->GetParent(__uuidof(IDXGIFactory1), reinterpret_cast<void**>(&dxgiFactory));
-                adapter->Release();
-            }
-            dxgiDevice->Release();
-        }
+        damage.AddInput("constants");
+        damage.AddInput("target");
+        damage.AddInput("windows");
+        damage.AddInput("shared surface");
     }
 
-    //? Create swap chain
-    hr = dxgiFactory->QueryInterface( __uuidof(IDXGIFactory2), reinterpret_cast<void**>(&dxgiFactory2) );
+    //? B follows A's frames through the slot ring, so only A is throttled
+    g_pacerA.reset(new FramePacer(g_pacingClock, g_pacingConfigA));
+    g_pacerB.reset(new FramePacer(g_pacingClock, FramePacingConfig()));
 
-        // DirectX 11.1 or later
-        hr = g_pd3dDeviceA->QueryInterface( __uuidof(ID3D11Device1), reinterpret_cast<void**>(&g_pd3dDevice1A) );
-        if (SUCCEEDED(hr))
-        {
-            (void) g_pImmediateContextA->QueryInterface( __uuidof(ID3D11DeviceContext1), reinterpret_cast<void**>(&g_pImmediateContext1A) );
-        }
+    OutputDebugStringA(FormatRenderDeviceStats(*g_deviceA).c_str());
+    OutputDebugStringA(FormatRenderDeviceStats(*g_deviceB).c_str());
 
-        DXGI_SWAP_CHAIN_DESC1 sd = {};
-        sd.Width = width;
-        sd.Height = height;
-        sd.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
-        sd.SampleDesc.Count = 1;
-        sd.SampleDesc.Quality = 0;
-        sd.BufferUsage = DXGI_USAGE_RENDER_TARGET_OUTPUT;
-        sd.BufferCount = DXGI_MAX_SWAP_CHAIN_BUFFERS;
-        sd.SwapEffect = DXGI_SWAP_EFFECT_FLIP_SEQUENTIAL;
-
-        hr = dxgiFactory2->CreateSwapChainForHwnd( g_pd3dDeviceA, g_hWnd, &sd, nullptr, nullptr, &g_pSwapChain1A );
-        if (SUCCEEDED(hr))
-        {
-            hr = g_pSwapChain1A->QueryInterface( __uuidof(IDXGISwapChain), reinterpret_cast<void**>(&g_pSwapChainA) );
-        }
+    return S_OK;
+}
 
+//! --------------------------------------------------------------------------------------
+//!
+//! SHARED SURFACES
+//!
+//! --------------------------------------------------------------------------------------
 
-    //! Note this tutorial doesn't handle full-screen swapchains so we block the ALT+ENTER shortcut
-    dxgiFactory->MakeWindowAssociation( g_hWnd, DXGI_MWA_NO_ALT_ENTER );
+DXGI_FORMAT SharedDxgiFormat(SharedPixelFormat format)
+{
+    return format == SHARED_FORMAT_RGB565 ? DXGI_FORMAT_B5G6R5_UNORM : DXGI_FORMAT_R8G8B8A8_UNORM;
+}
 
+//? Resources for the GPU downsample pass on device A
+HRESULT InitDownsampleA()
+{
+    HRESULT hr = g_deviceA->Device()->CreateShaderResourceView(g_windowA->BackBuffer(), nullptr, &g_pBackBufferSRVA);
     if (FAILED(hr))
         return hr;
 
-    //! Create a render target view
-    ID3D11Texture2D* pBackBuffer = nullptr;
-    hr = g_pSwapChainA->GetBuffer( 0, __uuidof( ID3D11Texture2D ), reinterpret_cast<void**>( &pBackBuffer ) );
-    if( FAILED( hr ) )
+    //? Joins the compiles InitShaders started
+    const std::vector<uint8_t>* vs = g_assets.Bytecode(g_programDownsample, SHADER_STAGE_VERTEX, CompileShaderBytecode);
+    if (!vs)
+        return E_FAIL;
+    hr = g_deviceA->Device()->CreateVertexShader(vs->data(), vs->size(), nullptr, &g_pDownsampleVS);
+    if (FAILED(hr))
         return hr;
 
-    hr = g_pd3dDeviceA->CreateRenderTargetView( pBackBuffer, nullptr, &g_pRenderTargetViewA );
-    if( FAILED( hr ) )
+    const std::vector<uint8_t>* ps = g_assets.Bytecode(g_programDownsample, SHADER_STAGE_PIXEL, CompileShaderBytecode);
+    if (!ps)
+        return E_FAIL;
+    hr = g_deviceA->Device()->CreatePixelShader(ps->data(), ps->size(), nullptr, &g_pDownsamplePS);
+    if (FAILED(hr))
         return hr;
 
-    //? Create depth stencil texture
-    D3D11_TEXTURE2D_DESC descDepth = {};
-    descDepth.Width = width;
-    descDepth.Height = height;
-    descDepth.MipLevels = 1;
-    descDepth.ArraySize = 1;
-    descDepth.Format = DXGI_FORMAT_D24_UNORM_S8_UINT;
-    descDepth.SampleDesc.Count = 1;
-    descDepth.SampleDesc.Quality = 0;
-    descDepth.Usage = D3D11_USAGE_DEFAULT;
-    descDepth.BindFlags = D3D11_BIND_DEPTH_STENCIL;
-    descDepth.CPUAccessFlags = 0;
-    descDepth.MiscFlags = 0;
-
-    hr = g_pd3dDeviceA->CreateTexture2D( &descDepth, nullptr, &g_pDepthStencilA );
-    if( FAILED( hr ) )
-        return hr;
+    CBDownsample cb = {};
+    cb.Scale = 1u << g_sharedDesc.scaleShift;
 
-    //? Create the depth stencil view
-    D3D11_DEPTH_STENCIL_VIEW_DESC descDSV = {};
-    descDSV.Format = descDepth.Format;
-    descDSV.ViewDimension = D3D11_DSV_DIMENSION_TEXTURE2D;
-    descDSV.Texture2D.MipSlice = 0;
-    hr = g_pd3dDeviceA->CreateDepthStencilView( g_pDepthStencilA, &descDSV, &g_pDepthStencilViewA );
-    if( FAILED( hr ) )
+    D3D11_BUFFER_DESC bd = {};
+    bd.Usage = D3D11_USAGE_IMMUTABLE;
+    bd.ByteWidth = sizeof(CBDownsample);
+    bd.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
+    D3D11_SUBRESOURCE_DATA InitData = {};
+    InitData.pSysMem = &cb;
+    hr = g_deviceA->Device()->CreateBuffer(&bd, &InitData, &g_pCBDownsample);
+    if (FAILED(hr))
         return hr;
+    g_deviceA->Resources().Track(g_pCBDownsample, "downsample");
+
+    //? Only the dirty rectangles are downsampled, one scissored draw each
+    D3D11_RASTERIZER_DESC rd = {};
+    rd.FillMode = D3D11_FILL_SOLID;
+    rd.CullMode = D3D11_CULL_NONE;
+    rd.DepthClipEnable = TRUE;
+    rd.ScissorEnable = TRUE;
+    return g_deviceA->Device()->CreateRasterizerState(&rd, &g_pScissorStateA);
+}
 
-    g_pImmediateContextA->OMSetRenderTargets( 1, &g_pRenderTargetViewA, g_pDepthStencilViewA );
-
-    //? Setup the viewport
-    D3D11_VIEWPORT vp;
-    vp.Width = (FLOAT)width;
-    vp.Height = (FLOAT)height;
-    vp.MinDepth = 0.0f;
-    vp.MaxDepth = 1.0f;
-    vp.TopLeftX = 0;
-    vp.TopLeftY = 0;
-    g_pImmediateContextA->RSSetViewports( 1, &vp );
-
-    //? Compile the vertex shader
-    ID3DBlob* pVSBlob = nullptr;
-    hr = CompileShaderFromString( m_shader, "VS", "vs_4_0", &pVSBlob );
-    if( FAILED( hr ) )
-    {
-        MessageBox( nullptr,
-                    L"Vertex shader compilation failed.", L"Error", MB_OK );
-        return hr;
-    }
+//? --------------------------------------------------------------------------------------
+//? Negotiates what A shares with B, then creates the shared ring surfaces on A, opens them
+//? on B and creates B's local copy of the shared image.
+//? --------------------------------------------------------------------------------------
+HRESULT InitSharedSurfaces()
+{
+    HRESULT hr = S_OK;
 
-    //? Create the vertex shader
-    hr = g_pd3dDeviceA->CreateVertexShader( pVSBlob->GetBufferPointer(), pVSBlob->GetBufferSize(), nullptr, &g_pVertexShader );
-    if( FAILED( hr ) )
-    {
-        pVSBlob->Release();
-        return hr;
-    }
+    g_producerConfigA.width = g_windowA->Width();
+    g_producerConfigA.height = g_windowA->Height();
 
-    //? Define the input layout
-    D3D11_INPUT_ELEMENT_DESC layout[] =
-    {
-        { "POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 0, D3D11_INPUT_PER_VERTEX_DATA, 0 },
-        { "TEXCOORD", 0, DXGI_FORMAT_R32G32_FLOAT, 0, 12, D3D11_INPUT_PER_VERTEX_DATA, 0 },
-    };
-    UINT numElements = ARRAYSIZE( layout );
+    //? RGB565 needs to be renderable on A and sampleable on B
+    UINT support = 0;
+    g_producerConfigA.canRenderCompact = SUCCEEDED(g_deviceA->Device()->CheckFormatSupport(DXGI_FORMAT_B5G6R5_UNORM, &support))
+        && (support & D3D11_FORMAT_SUPPORT_RENDER_TARGET);
+    support = 0;
+    g_consumerRequestB.acceptsCompact = SUCCEEDED(g_deviceB->Device()->CheckFormatSupport(DXGI_FORMAT_B5G6R5_UNORM, &support))
+        && (support & D3D11_FORMAT_SUPPORT_SHADER_SAMPLE);
 
-    //? Create the input layout
-    hr = g_pd3dDeviceA->CreateInputLayout( layout, numElements, pVSBlob->GetBufferPointer(),
-                                          pVSBlob->GetBufferSize(), &g_pVertexLayout );
-    pVSBlob->Release();
-    if( FAILED( hr ) )
-        return hr;
+    g_sharedDesc = NegotiateSharedSurface(g_producerConfigA, g_consumerRequestB);
+    const DXGI_FORMAT format = SharedDxgiFormat(g_sharedDesc.format);
 
-    //? Set the input layout
-    g_pImmediateContextA->IASetInputLayout( g_pVertexLayout );
+    D3D11_TEXTURE2D_DESC td = {};
+    td.Width = g_sharedDesc.width;
+    td.Height = g_sharedDesc.height;
+    td.MipLevels = 1;
+    td.ArraySize = 1;
+    td.SampleDesc.Count = 1;
+    td.SampleDesc.Quality = 0;
+    td.Format = format;
+    td.BindFlags = D3D11_BIND_SHADER_RESOURCE | (g_sharedDesc.IsReduced() ? D3D11_BIND_RENDER_TARGET : 0);
+    td.CPUAccessFlags = 0;
+    td.MiscFlags = D3D11_RESOURCE_MISC_SHARED_KEYEDMUTEX;
 
-    //? Compile the pixel shader
-    ID3DBlob* pPSBlob = nullptr;
-    hr = CompileShaderFromString( m_shader, "PS", "ps_4_0", &pPSBlob );
-    if( FAILED( hr ) )
+    //? One shared surface per ring slot so A can render ahead while B still copies
+    for (SharedSlot& slot : g_sharedSlots)
     {
-        MessageBox( nullptr,
-                    L"Pixel shader compilation failed.", L"Error", MB_OK );
-        return hr;
-    }
+        hr = g_deviceA->Device()->CreateTexture2D(&td, nullptr, &slot.texA);
+        if (FAILED(hr))
+            return hr;
+        g_deviceA->Resources().Track(slot.texA, "shared surfaces");
 
-    //? Create the pixel shader
-    hr = g_pd3dDeviceA->CreatePixelShader( pPSBlob->GetBufferPointer(), pPSBlob->GetBufferSize(), nullptr, &g_pPixelShader );
-    pPSBlob->Release();
-    if( FAILED( hr ) )
-        return hr;
+        if (g_sharedDesc.IsReduced())
+        {
+            hr = g_deviceA->Device()->CreateRenderTargetView(slot.texA, nullptr, &slot.rtvA);
+            if (FAILED(hr))
+                return hr;
+        }
 
-    //? Create vertex buffer
-    SimpleVertex vertices[] =
-    {
-        { XMFLOAT3( -1.0f, -1.0f, 0.0f ), XMFLOAT2( 1.0f, 1.0f ) }, // vertex XYZ and texture map reference
-        { XMFLOAT3( 1.0f, -1.0f, 0.0f ), XMFLOAT2( 0.0f, 1.0f ) },
-        { XMFLOAT3( 1.0f, 1.0f, 0.0f ), XMFLOAT2( 0.0f, 0.0f ) },
-        { XMFLOAT3( -1.0f, 1.0f, 0.0f ), XMFLOAT2( 1.0f, 0.0f ) }
-    };
+        hr = slot.texA->QueryInterface(__uuidof(IDXGIKeyedMutex), reinterpret_cast<void**>(&slot.mutexA));
+        if (FAILED(hr))
+            return hr;
 
-    D3D11_BUFFER_DESC bd = {};
-    bd.Usage = D3D11_USAGE_DEFAULT;
-    bd.ByteWidth = sizeof( SimpleVertex ) * 4;
-    bd.BindFlags = D3D11_BIND_VERTEX_BUFFER;
-    bd.CPUAccessFlags = 0;
+        IDXGIResource* tempResource = nullptr;
+        hr = slot.texA->QueryInterface(__uuidof(IDXGIResource), reinterpret_cast<void**>(&tempResource));
+        if (FAILED(hr))
+            return hr;
 
-    D3D11_SUBRESOURCE_DATA InitData = {};
-    InitData.pSysMem = vertices;
-    hr = g_pd3dDeviceA->CreateBuffer( &bd, &InitData, &g_pVertexBuffer );
-    if( FAILED( hr ) )
-        return hr;
+        hr = tempResource->GetSharedHandle(&slot.handle);
+        tempResource->Release();
+        if (FAILED(hr))
+            return hr;
 
-    //? Set vertex buffer
-    UINT stride = sizeof( SimpleVertex );
-    UINT offset = 0;
-    g_pImmediateContextA->IASetVertexBuffers( 0, 1, &g_pVertexBuffer, &stride, &offset );
+        hr = g_deviceB->Device()->OpenSharedResource(slot.handle, __uuidof(ID3D11Texture2D), (void**)&slot.texB);
+        if (FAILED(hr))
+            return hr;
+        g_deviceB->Resources().Track(slot.texB, "shared surfaces");
 
-    //? Create index buffer
-    //? Create vertex buffer
-    WORD indices[] =
-    {
-        3,1,0,
-        2,1,3
-    };
+        hr = slot.texB->QueryInterface(__uuidof(IDXGIKeyedMutex), reinterpret_cast<void**>(&slot.mutexB));
+        if (FAILED(hr))
+            return hr;
 
-    bd.Usage = D3D11_USAGE_DEFAULT;
-    bd.ByteWidth = sizeof( WORD ) * 36;
-    bd.BindFlags = D3D11_BIND_INDEX_BUFFER;
-    bd.CPUAccessFlags = 0;
-    InitData.pSysMem = indices;
-    hr = g_pd3dDeviceA->CreateBuffer( &bd, &InitData, &g_pIndexBuffer );
-    if( FAILED( hr ) )
+        //? Only the dirty parts of the back buffer are copied into the shared surface each frame
+        slot.frame.dirty.Reset(g_sharedDesc.width, g_sharedDesc.height);
+    }
+    g_dirtyFullA.Reset(g_producerConfigA.width, g_producerConfigA.height);
+    g_hasPublishedA = false;
+
+    //? B's local copy of the shared image. It comes from device B's pool at exactly the
+    //? shared size, since the quad samples all of it; resizing A back to an earlier size
+    //? gets the same texture again.
+    RenderTargetKey copyKey;
+    copyKey.width = g_sharedDesc.width;
+    copyKey.height = g_sharedDesc.height;
+    copyKey.format = format;
+    copyKey.bindFlags = D3D11_BIND_SHADER_RESOURCE;
+    g_renderedTexEntryB = g_deviceB->TargetPool().Acquire(copyKey);
+    if (g_renderedTexEntryB == RenderTargetPool::kInvalidEntry)
+        return E_OUTOFMEMORY;
+    g_pRenderedTexB = g_deviceB->PooledTexture(g_renderedTexEntryB);
+
+    hr = g_deviceB->Device()->CreateShaderResourceView(g_pRenderedTexB, nullptr, &g_pTextureRV1);
+    if (FAILED(hr))
         return hr;
 
-    //? Set index buffer
-    g_pImmediateContextA->IASetIndexBuffer( g_pIndexBuffer, DXGI_FORMAT_R16_UINT, 0 );
+    for (size_t i = 0; i < g_deviceB->WindowCount(); ++i)
+        g_deviceB->Window(i)->SetTexture(g_pTextureRV1);
+    ++g_sharedGenerationB;
 
-    //? Set primitive topology
-    g_pImmediateContextA->IASetPrimitiveTopology( D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST );
+    if (g_sharedDesc.IsReduced())
+    {
+        hr = InitDownsampleA();
+        if (FAILED(hr))
+            return hr;
+    }
 
-    //? Create the constant buffers
-    bd.Usage = D3D11_USAGE_DEFAULT;
-    bd.ByteWidth = sizeof(CBNeverChanges);
-    bd.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
-    bd.CPUAccessFlags = 0;
-    hr = g_pd3dDeviceA->CreateBuffer( &bd, nullptr, &g_pCBNeverChanges );
-    if( FAILED( hr ) )
-        return hr;
+    const SharedBandwidthReport bandwidth = ComputeSharedBandwidth(g_producerConfigA, g_sharedDesc);
+    char msg[160];
+    sprintf_s(msg, "Shared surface %ux%u %s: %llu bytes/frame, %.1f%% less than full-resolution RGBA8\n",
+        g_sharedDesc.width, g_sharedDesc.height, g_sharedDesc.format == SHARED_FORMAT_RGB565 ? "RGB565" : "RGBA8",
+        bandwidth.reducedFrameBytes, bandwidth.SavedFraction() * 100.0);
+    OutputDebugStringA(msg);
 
-    bd.ByteWidth = sizeof(CBChangeOnResize);
-    hr = g_pd3dDeviceA->CreateBuffer( &bd, nullptr, &g_pCBChangeOnResize );
-    if( FAILED( hr ) )
-        return hr;
+    return S_OK;
+}
 
-    bd.ByteWidth = sizeof(CBChangesEveryFrame);
-    hr = g_pd3dDeviceA->CreateBuffer( &bd, nullptr, &g_pCBChangesEveryFrame );
-    if( FAILED( hr ) )
-        return hr;
+//? Releases everything InitSharedSurfaces created; B's copy goes back to the pool
+void ReleaseSharedSurfaces()
+{
+    if (g_deviceB)
+    {
+        for (size_t i = 0; i < g_deviceB->WindowCount(); ++i)
+            g_deviceB->Window(i)->SetTexture(nullptr);
+    }
 
-    //! ####################################################################################################
-    //! Load the Texture
+    if (g_pTextureRV1) g_pTextureRV1->Release();
+    if (g_renderedTexEntryB != RenderTargetPool::kInvalidEntry) g_deviceB->TargetPool().Release(g_renderedTexEntryB);
+    if (g_pBackBufferSRVA) g_pBackBufferSRVA->Release();
+    if (g_pDownsampleVS) g_pDownsampleVS->Release();
+    if (g_pDownsamplePS) g_pDownsamplePS->Release();
+    if (g_pCBDownsample) g_pCBDownsample->Release();
+    if (g_pScissorStateA) g_pScissorStateA->Release();
+    g_pTextureRV1 = nullptr;
+    g_pRenderedTexB = nullptr;
+    g_renderedTexEntryB = RenderTargetPool::kInvalidEntry;
+    g_pBackBufferSRVA = nullptr;
+    g_pDownsampleVS = nullptr;
+    g_pDownsamplePS = nullptr;
+    g_pCBDownsample = nullptr;
+    g_pScissorStateA = nullptr;
+
+    for (SharedSlot& slot : g_sharedSlots)
+    {
+        if (slot.mutexB) slot.mutexB->Release();
+        if (slot.texB) slot.texB->Release();
+        if (slot.mutexA) slot.mutexA->Release();
+        if (slot.rtvA) slot.rtvA->Release();
+        if (slot.texA) slot.texA->Release();
+        slot = SharedSlot();
+    }
+}
 
-    hr = CreateDDSTextureFromFile( g_pd3dDeviceA, L"test.dds", nullptr, &g_pTextureRV );
-    if (FAILED(hr))
-        return hr;
+//? --------------------------------------------------------------------------------------
+//? Readback ring for window A's back buffer. The callback keeps the latest frame as a
+//? tightly packed RGBA8 image.
+//? --------------------------------------------------------------------------------------
+HRESULT InitReadbackA()
+{
+    g_readbackBackendA = g_windowA->CreateReadback(kReadbackLatency + 1);
+    if (!g_readbackBackendA)
+        return E_FAIL;
 
-    D3D11_TEXTURE2D_DESC td = {};
-    td.Width = width;
-    td.Height = height;
-    td.MipLevels = 0;
-    td.ArraySize = 1;
-    td.SampleDesc.Count = 1;
-    td.SampleDesc.Quality = 0;
-    td.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
-    td.BindFlags = D3D11_BIND_SHADER_RESOURCE;
-    td.CPUAccessFlags = 0;
-    td.MiscFlags = D3D11_RESOURCE_MISC_SHARED;
+    g_readbackA.reset(new ReadbackRing(*g_readbackBackendA, kReadbackLatency + 1, kReadbackLatency, g_windowA->Width(), g_windowA->Height(), 4));
+    g_readbackA->SetCallback([](const ReadbackFrame& frame)
+    {
+        g_capturedFrameA.assign(frame.data, frame.data + frame.size);
+        g_capturedFrameIdA = frame.frameId;
+    });
 
+    return S_OK;
+}
 
-    IDXGIResource* tempResource = nullptr;
-    hr = g_pd3dDeviceA->CreateTexture2D(&td, nullptr, &g_pRenderedTex);
+//? --------------------------------------------------------------------------------------
+//? Timestamp profilers for both devices, with the same pass names on each
+//? --------------------------------------------------------------------------------------
+HRESULT InitGpuProfilers()
+{
+    const size_t slots = kGpuProfileLatency + 1;
+    HRESULT hr = g_timestampsA.Init(g_deviceA->Device(), g_deviceA->Context(), slots, 2 * (kGpuProfileMaxScopes + 1));
     if (FAILED(hr))
         return hr;
-
-    hr = g_pRenderedTex->QueryInterface(__uuidof(IDXGIResource), reinterpret_cast<void**>(&tempResource));
+    hr = g_timestampsB.Init(g_deviceB->Device(), g_deviceB->Context(), slots, 2 * (kGpuProfileMaxScopes + 1));
     if (FAILED(hr))
         return hr;
 
-    /*tempResource->CreateSharedHandle(NULL,
-        DXGI_SHARED_RESOURCE_READ | DXGI_SHARED_RESOURCE_WRITE,
-        NULL,
-        &texHandle);*/
+    g_gpuProfilerA.reset(new GpuProfiler(g_timestampsA, slots, kGpuProfileMaxScopes, kGpuProfileLatency));
+    g_gpuProfilerB.reset(new GpuProfiler(g_timestampsB, slots, kGpuProfileMaxScopes, kGpuProfileLatency));
+    GpuProfiler* profilers[] = { g_gpuProfilerA.get(), g_gpuProfilerB.get() };
+    GpuPassScopes* scopes[] = { &g_gpuScopesA, &g_gpuScopesB };
+    for (int i = 0; i < 2; ++i)
+    {
+        scopes[i]->clear = profilers[i]->Scope("clear");
+        scopes[i]->draw = profilers[i]->Scope("draw");
+        scopes[i]->copy = profilers[i]->Scope("copy");
+        scopes[i]->present = profilers[i]->Scope("present");
+    }
+    return S_OK;
+}
 
-    tempResource->GetSharedHandle(&texHandle);
+//? --------------------------------------------------------------------------------------
+//? Scene mode for window A: a recorder on deferred contexts (or the immediate context)
+//? and the worker threads that fill them
+//? --------------------------------------------------------------------------------------
+HRESULT InitSceneA()
+{
+    if (g_instancedA)
+    {
+        g_batchRendererA.reset(new D3D11QuadBatchRenderer(*g_deviceA, g_programBatch));
+        HRESULT hr = g_batchRendererA->Init();
+        if (FAILED(hr))
+            return hr;
+
+        // Window A's texture stands in for every distinct texture of the grid
+        if (!g_windowA->Texture())
+            return E_FAIL;
+        ID3D11Resource* resource = nullptr;
+        ID3D11Texture2D* source = nullptr;
+        g_windowA->Texture()->GetResource(&resource);
+        hr = resource->QueryInterface(__uuidof(ID3D11Texture2D), reinterpret_cast<void**>(&source));
+        resource->Release();
+        if (FAILED(hr))
+            return hr;
+
+        std::vector<ID3D11Texture2D*> slices(kTextureArraySlices, source);
+        for (UINT first = 0; first < g_sceneTextureCountA && SUCCEEDED(hr); first += kTextureArraySlices)
+        {
+            const UINT count = g_sceneTextureCountA - first < kTextureArraySlices ? g_sceneTextureCountA - first : kTextureArraySlices;
+            ID3D11ShaderResourceView* textureArray = nullptr;
+            hr = CreateTextureArray(g_deviceA->Device(), g_deviceA->Context(), slices.data(), count, &textureArray);
+            if (SUCCEEDED(hr))
+            {
+                ID3D11Resource* arrayResource = nullptr;
+                textureArray->GetResource(&arrayResource);
+                g_deviceA->Resources().Track(arrayResource, "scene textures");
+                arrayResource->Release();
+                g_batchRendererA->AddMaterial(textureArray);
+                textureArray->Release();
+            }
+        }
+        source->Release();
+        g_quadListA.Reserve(g_sceneQuadCountA);
+        return hr;
+    }
 
-    hr = g_pSwapChainA->GetBuffer(0, __uuidof(ID3D11Texture2D), reinterpret_cast<void**>(&g_pRenderedTex));
+    g_sceneRecorderA.reset(new D3D11CommandRecorder(*g_deviceA, *g_windowA, g_deferredContextsA));
+    HRESULT hr = g_sceneRecorderA->Init();
     if (FAILED(hr))
         return hr;
-    //! ####################################################################################################
-
-    //? Create the sample state
-    D3D11_SAMPLER_DESC sampDesc = {};
-    sampDesc.Filter = D3D11_FILTER_MIN_MAG_MIP_LINEAR;
-    sampDesc.AddressU = D3D11_TEXTURE_ADDRESS_WRAP;
-    sampDesc.AddressV = D3D11_TEXTURE_ADDRESS_WRAP;
-    sampDesc.AddressW = D3D11_TEXTURE_ADDRESS_WRAP;
-    sampDesc.ComparisonFunc = D3D11_COMPARISON_NEVER;
-    sampDesc.MinLOD = 0;
-    sampDesc.MaxLOD = D3D11_FLOAT32_MAX;
-    hr = g_pd3dDeviceA->CreateSamplerState( &sampDesc, &g_pSamplerLinear );
-    if( FAILED( hr ) )
-        return hr;
-
-    //? Initialize the world matrices
-    g_World = XMMatrixIdentity();
-
-    //? Initialize the view matrix
-    XMVECTOR Eye = XMVectorSet(0.0f, 0.0f, -5.0f, 0.0f);    // cam rotation (Y-axis Rot, X-axis Rot, Z-axis?)
-    XMVECTOR At = XMVectorSet(0.0f, 0.0f, 0.0f, 0.0f);
-    XMVECTOR Up = XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f);      // ? but cannot be empty/zero
-    g_View = XMMatrixLookAtLH( Eye, At, Up );
-
-    CBNeverChanges cbNeverChanges;
-    cbNeverChanges.mView = XMMatrixTranspose( g_View );
-    g_pImmediateContextA->UpdateSubresource( g_pCBNeverChanges, 0, nullptr, &cbNeverChanges, 0, 0 );
-
-    //? Initialize the projection matrix
-    g_Projection = XMMatrixPerspectiveFovLH( XM_PIDIV4, width / (FLOAT)height, 0.01f, 100.0f );
 
-    CBChangeOnResize cbChangesOnResize;
-    cbChangesOnResize.mProjection = XMMatrixTranspose( g_Projection );
-    g_pImmediateContextA->UpdateSubresource( g_pCBChangeOnResize, 0, nullptr, &cbChangesOnResize, 0, 0 );
-
-    pBackBuffer->Release();
-    tempResource->Release();
+    if (g_deferredContextsA > 1)
+        g_scenePoolA.reset(new WorkerPool(g_deferredContextsA));
 
+    g_sceneQuadsA.resize(g_sceneQuadCountA);
     return S_OK;
 }
 
-//! --------------------------------------------------------------------------------------
-//!
-//! WINDOW B
-//!
-//! --------------------------------------------------------------------------------------
-
-HRESULT InitWndB()
+//? --------------------------------------------------------------------------------------
+//? Every shader has been requested by now; keep the new bytecode for the next launch
+//? --------------------------------------------------------------------------------------
+void FinishShaderCompiles()
 {
-    HRESULT hr = S_OK;
-
-    RECT rc;
-    GetClientRect(g_hWndB, &rc);
-    UINT width = rc.right - rc.left;
-    UINT height = rc.bottom - rc.top;
-
-    UINT createDeviceFlags = 0;
-#ifdef _DEBUG
-    createDeviceFlags |= D3D11_CREATE_DEVICE_DEBUG;
-#endif
+    g_compilePool->WaitAll();
+    OutputDebugStringA(WorkerPool::FormatReport(g_compilePool->Timings()).c_str());
+    g_compilePool.reset();
+    g_shaderCache.Save();
+    OutputDebugStringA(ShaderCache::Format(g_shaderCache.GetStats()).c_str());
+}
 
-    D3D_DRIVER_TYPE driverTypes[] =
+//? --------------------------------------------------------------------------------------
+//? Headless run: device A with an offscreen window A, driven by FrameLoop instead of the
+//? message pump. Frames come back through the readback ring and the last one is written
+//? to g_headless.imagePath. A benchmark run adds windows that draw the single quad and
+//? writes its timings to g_headless.benchmarkPath.
+//? --------------------------------------------------------------------------------------
+int RunHeadless()
+{
+    g_deviceA.reset(new D3D11RenderDevice(g_assets, CompileShaderBytecode));
+    if (!g_deviceA->Create())
     {
-        D3D_DRIVER_TYPE_WARP,
-        D3D_DRIVER_TYPE_HARDWARE,
-        D3D_DRIVER_TYPE_REFERENCE,
-    };
-    UINT numDriverTypes = ARRAYSIZE(driverTypes);
+        CleanupDevice();
+        return 0;
+    }
 
-    D3D_FEATURE_LEVEL featureLevels[] =
+    RenderWindowDesc descA;
+    descA.name = "A";
+    descA.program = g_programA;
+    descA.textureFile = L"test.dds";
+    memcpy(descA.clearColor, Colors::MidnightBlue.f, sizeof(descA.clearColor));
+    descA.width = g_headless.width;
+    descA.height = g_headless.height;
+    descA.offscreen = true;
+    g_windowA = g_deviceA->CreateRenderWindow(descA);
+    if (!g_windowA || (g_sceneQuadCountA && FAILED(InitSceneA())))
     {
-        D3D_FEATURE_LEVEL_11_1,
-        D3D_FEATURE_LEVEL_11_0,
-        D3D_FEATURE_LEVEL_10_1,
-        D3D_FEATURE_LEVEL_10_0,
-    };
-    UINT numFeatureLevels = ARRAYSIZE(featureLevels);
+        CleanupDevice();
+        return 0;
+    }
 
-    for (UINT driverTypeIndex = 0; driverTypeIndex < numDriverTypes; driverTypeIndex++)
+    const bool benchmarking = !g_headless.benchmarkPath.empty();
+    std::vector<RenderWindow*> extraWindows;
+    for (UINT i = 1; benchmarking && i < g_windowCountB; ++i)
     {
-        g_driverType = driverTypes[driverTypeIndex];
-        hr = D3D11CreateDevice(nullptr, g_driverType, nullptr, createDeviceFlags, featureLevels, numFeatureLevels,
-            D3D11_SDK_VERSION, &g_pd3dDeviceB, &g_featureLevel, &g_pImmediateContextB);
-
-        if (hr == E_INVALIDARG)
+        descA.name = "A" + std::to_string(i + 1);
+        RenderWindow* window = g_deviceA->CreateRenderWindow(descA);
+        if (!window)
         {
-            // DirectX 11.0 platforms will not recognize D3D_FEATURE_LEVEL_11_1 so we need to retry without it
-            hr = D3D11CreateDevice(nullptr, g_driverType, nullptr, createDeviceFlags, &featureLevels[1], numFeatureLevels - 1,
-                D3D11_SDK_VERSION, &g_pd3dDeviceB, &g_featureLevel, &g_pImmediateContextB);
+            CleanupDevice();
+            return 0;
         }
-
-        if (SUCCEEDED(hr))
-            break;
+        extraWindows.push_back(window);
     }
-    if (FAILED(hr))
-        return hr;
-
-    //! Obtain DXGI factory from device (since we used nullptr for pAdapter above)
-    /*IDXGIFactory1* dxgiFactory = nullptr;*/
+    OutputDebugStringA(FormatRenderDeviceStats(*g_deviceA).c_str());
+
+    FinishShaderCompiles();
+
+    FrameLoopDesc loopDesc;
+    loopDesc.frameCount = g_headless.frames;
+    loopDesc.frameSeconds = kAnimationStepSeconds;
+    loopDesc.readbackLatency = kReadbackLatency;
+    FrameLoop loop(*g_windowA, loopDesc);
+    for (RenderWindow* window : extraWindows)
+        loop.AddWindow(*window);
+    loop.SetDraw([](RenderWindow& window, uint64_t, double seconds)
     {
-        IDXGIDevice* dxgiDevice = nullptr;
-        hr = g_pd3dDeviceB->QueryInterface(__uuidof(IDXGIDevice), reinterpret_cast<void**>(&dxgiDevice));
-        if (SUCCEEDED(hr))
+        FrameConstants cb;
+        if (&window == g_windowA)
         {
-            IDXGIAdapter* adapter = nullptr;
-            hr = dxgiDevice->GetAdapter(&adapter);
-            if (SUCCEEDED(hr))
-            {
-                hr = adapter->GetParent(__uuidof(IDXGIFactory1), reinterpret_cast<void**>(&dxgiFactory));
-                adapter->Release();
-            }
-            dxgiDevice->Release();
+            DrawFrameA((float)seconds, cb);
+            return;
         }
+        XMStoreFloat4x4(reinterpret_cast<XMFLOAT4X4*>(cb.world), XMMatrixTranspose(XMMatrixRotationY((float)seconds)));
+        memcpy(cb.meshColor, &g_vMeshColor, sizeof(cb.meshColor));
+        window.UpdateFrameConstants(cb);
+        window.DrawQuad();
+    });
+
+    g_benchmarkConfig = HeadlessBenchmarkConfig(g_headless);
+    g_benchmarkConfig.windows = 1 + (UINT)extraWindows.size();
+    FrameBenchmark benchmark(g_benchmarkConfig.warmupFrames);
+    if (benchmarking)
+    {
+        g_scenePhaseA = benchmark.AddPhase("scene");
+        g_submitPhaseA = benchmark.AddPhase("submit");
+        g_benchmarkA = &benchmark;
+        loop.SetBenchmark(&benchmark);
+    }
+    loop.SetReadbackCallback([](const ReadbackFrame& frame)
+    {
+        g_capturedFrameA.assign(frame.data, frame.data + frame.size);
+        g_capturedFrameIdA = frame.frameId;
+        if (g_goldenSuite)
+            g_goldenSuite->Check("A", frame.frameId - 1, frame);
+    });
+    bool ok = loop.Run();
+    g_benchmarkA = nullptr;
+
+    const FrameLoopStats& stats = loop.Stats();
+    char msg[200];
+    sprintf_s(msg, "Headless %ux%u: %llu frames in %.1f ms, %llu read back, %llu dropped\n",
+        g_headless.width, g_headless.height, stats.frames, stats.wallMs, stats.delivered, stats.dropped);
+    OutputDebugStringA(msg);
+
+    if (ok && !g_capturedFrameA.empty())
+    {
+        ReadbackFrame last;
+        last.frameId = g_capturedFrameIdA;
+        last.width = g_headless.width;
+        last.height = g_headless.height;
+        last.bytesPerPixel = 4;
+        last.data = g_capturedFrameA.data();
+        last.size = g_capturedFrameA.size();
+        WriteFrameBitmap(g_headless.imagePath, last);
     }
 
-    DXGI_SWAP_CHAIN_DESC1 sd = {};
-    sd.Width = width;
-    sd.Height = height;
-    sd.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
-    sd.SampleDesc.Count = 1;
-    sd.SampleDesc.Quality = 0;
-    sd.BufferUsage = DXGI_USAGE_RENDER_TARGET_OUTPUT;
-    sd.BufferCount = DXGI_MAX_SWAP_CHAIN_BUFFERS;
-    sd.SwapEffect = DXGI_SWAP_EFFECT_FLIP_SEQUENTIAL;
+    if (ok && benchmarking)
+        ok = WriteBenchmarkReport(g_headless.benchmarkPath, benchmark, g_benchmarkConfig, g_deviceA->BackendName(),
+            [](const char* text) { OutputDebugStringA(text); });
+    if (ok && g_goldenSuite)
+        ok = stats.dropped == 0 && FinishGoldenSuite(*g_goldenSuite, [](const char* text) { OutputDebugStringA(text); });
+
+    CleanupDevice();
+    return ok ? 0 : 1;
+}
+
+//? --------------------------------------------------------------------------------------
+//? Lays the scene's quads out on a square grid, each spinning like the single quad. The
+//? instanced version builds the same grid as a QuadList, with texture i % textureCount.
+//? --------------------------------------------------------------------------------------
+void BuildSceneA( float t, const FrameConstants& base )
+{
+    const size_t side = (size_t)ceilf(sqrtf((float)g_sceneQuadsA.size()));
+    const float cell = 2.0f / (float)side;
 
-    hr = dxgiFactory2->CreateSwapChainForHwnd(g_pd3dDeviceB, g_hWndB, &sd, nullptr, nullptr, &g_pSwapChain1B);
-    if (SUCCEEDED(hr))
+    for (size_t i = 0; i < g_sceneQuadsA.size(); ++i)
     {
-        hr = g_pSwapChain1B->QueryInterface(__uuidof(IDXGISwapChain), reinterpret_cast<void**>(&g_pSwapChainB));
+        const float x = -1.0f + cell * ((float)(i % side) + 0.5f);
+        const float y = 1.0f - cell * ((float)(i / side) + 0.5f);
+        const XMMATRIX world = XMMatrixScaling(0.45f * cell, 0.45f * cell, 1.0f) *
+                               XMMatrixRotationY(t + 0.01f * (float)i) *
+                               XMMatrixTranslation(x, y, 0.0f);
+
+        FrameConstants& quad = g_sceneQuadsA[i];
+        XMStoreFloat4x4(reinterpret_cast<XMFLOAT4X4*>(quad.world), XMMatrixTranspose(world));
+        memcpy(quad.meshColor, base.meshColor, sizeof(quad.meshColor));
     }
+}
 
-    //! Note this tutorial doesn't handle full-screen swapchains so we block the ALT+ENTER shortcut
-    dxgiFactory->MakeWindowAssociation(g_hWndB, DXGI_MWA_NO_ALT_ENTER);
+void BuildSceneBatchA( float t )
+{
+    const size_t side = (size_t)ceilf(sqrtf((float)g_sceneQuadCountA));
+    const float cell = 2.0f / (float)side;
 
-    if (FAILED(hr))
-        return hr;
+    // Without a projection, spinning around Y only narrows the quad
+    g_quadListA.Clear();
+    for (size_t i = 0; i < g_sceneQuadCountA; ++i)
+    {
+        const UINT texture = (UINT)(i % g_sceneTextureCountA);
+        g_quadListA.Add(-1.0f + cell * ((float)(i % side) + 0.5f), 1.0f - cell * ((float)(i / side) + 0.5f),
+                        0.45f * cell * cosf(t + 0.01f * (float)i), 0.45f * cell, 0.0f,
+                        texture / kTextureArraySlices, texture % kTextureArraySlices);
+    }
 
-    //! Create a render target view
-    ID3D11Texture2D* pBackBuffer1 = nullptr;
-    hr = g_pSwapChainB->GetBuffer(0, __uuidof(ID3D11Texture2D), reinterpret_cast<void**>(&pBackBuffer1));
-    if (FAILED(hr))
-        return hr;
+    const auto start = std::chrono::steady_clock::now();
+    g_batcherA.Build(g_quadListA, g_batchRendererA->MaterialCount());
+    g_batchBuildMsA += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    ++g_batchBuildsA;
+}
 
-    hr = g_pd3dDeviceB->CreateRenderTargetView(pBackBuffer1, nullptr, &g_pRenderTargetViewB);
-    pBackBuffer1->Release();
-    if (FAILED(hr))
-        return hr;
+//? --------------------------------------------------------------------------------------
+//? Clean up the objects we've created
+//? --------------------------------------------------------------------------------------
+void CleanupDevice()
+{
+    g_compilePool.reset();
 
-    //? Create depth stencil texture
-    D3D11_TEXTURE2D_DESC descDepth = {};
-    descDepth.Width = width;
-    descDepth.Height = height;
-    descDepth.MipLevels = 1;
-    descDepth.ArraySize = 1;
-    descDepth.Format = DXGI_FORMAT_D24_UNORM_S8_UINT;
-    descDepth.SampleDesc.Count = 1;
-    descDepth.SampleDesc.Quality = 0;
-    descDepth.Usage = D3D11_USAGE_DEFAULT;
-    descDepth.BindFlags = D3D11_BIND_DEPTH_STENCIL;
-    descDepth.CPUAccessFlags = 0;
-    descDepth.MiscFlags = 0;
-
-    hr = g_pd3dDeviceB->CreateTexture2D(&descDepth, nullptr, &g_pDepthStencilB);
-    if (FAILED(hr))
-        return hr;
+    //? Every thread that recorded markers has stopped by now
+    if( !g_tracePath.empty() )
+    {
+        const std::string json = CpuTrace::ExportChromeJSON();
+        FILE* file = nullptr;
+        if( _wfopen_s( &file, g_tracePath.c_str(), L"wb" ) == 0 && file )
+        {
+            fwrite( json.data(), 1, json.size(), file );
+            fclose( file );
+        }
 
-    //? Create the depth stencil view
-    D3D11_DEPTH_STENCIL_VIEW_DESC descDSV = {};
-    descDSV.Format = descDepth.Format;
-    descDSV.ViewDimension = D3D11_DSV_DIMENSION_TEXTURE2D;
-    descDSV.Texture2D.MipSlice = 0;
-    hr = g_pd3dDeviceB->CreateDepthStencilView(g_pDepthStencilB, &descDSV, &g_pDepthStencilViewB);
-    if (FAILED(hr))
-        return hr;
+        char msg[160];
+        sprintf_s( msg, "CPU trace: %llu events, %llu dropped\n",
+                   static_cast<unsigned long long>( CpuTrace::EventCount() ), static_cast<unsigned long long>( CpuTrace::DroppedCount() ) );
+        OutputDebugStringA( msg );
+    }
 
-    g_pImmediateContextB->OMSetRenderTargets(1, &g_pRenderTargetViewB, g_pDepthStencilViewB);
-
-    //? Setup the viewport
-    D3D11_VIEWPORT vp;
-    vp.Width = (FLOAT)width;
-    vp.Height = (FLOAT)height;
-    vp.MinDepth = 0.0f;
-    vp.MaxDepth = 1.0f;
-    vp.TopLeftX = 0;
-    vp.TopLeftY = 0;
-    g_pImmediateContextB->RSSetViewports(1, &vp);
-
-    //? Compile the vertex shader
-    ID3DBlob* pVSBlob1 = nullptr;
-    hr = CompileShaderFromString(m_shaderB, "VS", "vs_4_0", &pVSBlob1);
-    if (FAILED(hr))
+    if( g_batchBuildsA )
     {
-        MessageBox(nullptr,
-            L"Vertex shader compilation failed.", L"Error", MB_OK);
-        return hr;
+        char msg[200];
+        sprintf_s( msg, "Instanced scene: %zu quads in %u draws, %.3f ms per batch build\n",
+                   g_quadListA.Size(), g_batchRendererA->LastDrawCount(), g_batchBuildMsA / g_batchBuildsA );
+        OutputDebugStringA( msg );
     }
+    g_batchRendererA.reset();
 
-    //? Create the vertex shader
-    hr = g_pd3dDeviceB->CreateVertexShader(pVSBlob1->GetBufferPointer(), pVSBlob1->GetBufferSize(), nullptr, &g_pVertexShaderB);
-    if (FAILED(hr))
+    if( g_sceneFramesA )
     {
-        pVSBlob1->Release();
-        return hr;
+        char msg[200];
+        sprintf_s( msg, "Scene: %zu quads in %zu chunks on %zu %s contexts, %.3f ms recording and %.3f ms executing per frame\n",
+                   g_sceneTotalsA.quads, g_sceneTotalsA.chunks, g_sceneTotalsA.contexts,
+                   g_sceneRecorderA->Deferred() ? "deferred" : "immediate",
+                   g_sceneTotalsA.recordMs / g_sceneFramesA, g_sceneTotalsA.executeMs / g_sceneFramesA );
+        OutputDebugStringA( msg );
     }
+    g_scenePoolA.reset();
+    g_sceneRecorderA.reset();
 
-    //? Define the input layout
-    D3D11_INPUT_ELEMENT_DESC layout[] =
+    // The render threads have stopped, so device A's counters can be read here
+    if( g_deviceA )
     {
-        { "POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 0, D3D11_INPUT_PER_VERTEX_DATA, 0 },
-        { "TEXCOORD", 0, DXGI_FORMAT_R32G32_FLOAT, 0, 12, D3D11_INPUT_PER_VERTEX_DATA, 0 },
-    };
-    UINT numElements = ARRAYSIZE(layout);
-
-    //? Create the input layout
-    hr = g_pd3dDeviceB->CreateInputLayout(layout, numElements, pVSBlob1->GetBufferPointer(),
-        pVSBlob1->GetBufferSize(), &g_pVertexLayoutB);
-    pVSBlob1->Release();
-    if (FAILED(hr))
-        return hr;
-
-    //? Set the input layout
-    g_pImmediateContextB->IASetInputLayout(g_pVertexLayoutB);
-
-    //? Compile the pixel shader
-    ID3DBlob* pPSBlob1 = nullptr;
-    hr = CompileShaderFromString(m_shaderB, "PS", "ps_4_0", &pPSBlob1);
-    if (FAILED(hr))
+        g_deviceA->Context()->Flush();
+        OutputDebugStringA( ( "Device A " + StateFilter::Format( g_deviceA->StateCache().GetCounters() ) ).c_str() );
+    }
+    if( g_deviceB )
     {
-        MessageBox(nullptr,
-            L"Pixel shader compilation failed.", L"Error", MB_OK);
-        return hr;
+        g_deviceB->Context()->ClearState();
+        g_deviceB->StateCache().InvalidateAll();
     }
 
-    //? Create the pixel shader
-    hr = g_pd3dDeviceB->CreatePixelShader(pPSBlob1->GetBufferPointer(), pPSBlob1->GetBufferSize(), nullptr, &g_pPixelShaderB);
-    pPSBlob1->Release();
-    if (FAILED(hr))
-        return hr;
-
-    //? Create vertex buffer
-    SimpleVertex vertices[] =
+    g_readbackA.reset();
+    g_readbackBackendA.reset();
+
+    // Device A's profiler belongs to its render thread, which has stopped
+    if( g_gpuProfilerA )
+        OutputDebugStringA( ( "Device A " + g_gpuProfilerA->Format() ).c_str() );
+    if( g_gpuProfilerB )
+        OutputDebugStringA( ( "Device B " + g_gpuProfilerB->Format() ).c_str() );
+    g_gpuProfilerA.reset();
+    g_gpuProfilerB.reset();
+    g_timestampsA.Release();
+    g_timestampsB.Release();
+
+    ReleaseSharedSurfaces();
+
+    if( g_pacerA && g_pacerA->GetStats().frames )
+        OutputDebugStringA( ( "Window A " + g_pacerA->Format() ).c_str() );
+    if( g_pacerB && g_pacerB->GetStats().frames )
+        OutputDebugStringA( ( "Device B " + g_pacerB->Format() ).c_str() );
+    if( g_damageA.GetStats().rendered )
+        OutputDebugStringA( ( "Window A " + g_damageA.Format() ).c_str() );
+    for( size_t i = 0; i < g_damageB.size(); ++i )
     {
-        { XMFLOAT3(-1.0f, -1.0f, 0.0f), XMFLOAT2(1.0f, 1.0f) }, // vertex XYZ and texture map reference
-        { XMFLOAT3(1.0f, -1.0f, 0.0f), XMFLOAT2(0.0f, 1.0f) },
-        { XMFLOAT3(1.0f, 1.0f, 0.0f), XMFLOAT2(0.0f, 0.0f) },
-        { XMFLOAT3(-1.0f, 1.0f, 0.0f), XMFLOAT2(1.0f, 0.0f) }
-    };
-
-    D3D11_BUFFER_DESC bd = {};
-    bd.Usage = D3D11_USAGE_DEFAULT;
-    bd.ByteWidth = sizeof(SimpleVertex) * 4;
-    bd.BindFlags = D3D11_BIND_VERTEX_BUFFER;
-    bd.CPUAccessFlags = 0;
-
-    D3D11_SUBRESOURCE_DATA InitData = {};
-    InitData.pSysMem = vertices;
-    hr = g_pd3dDeviceB->CreateBuffer(&bd, &InitData, &g_pVertexBufferB);
-    if (FAILED(hr))
-        return hr;
-
-    //? Set vertex buffer
-    UINT stride = sizeof(SimpleVertex);
-    UINT offset = 0;
-    g_pImmediateContextB->IASetVertexBuffers(0, 1, &g_pVertexBufferB, &stride, &offset);
-
-    //? Create index buffer
-    //? Create vertex buffer
-    WORD indices[] =
+        char prefix[32];
+        sprintf_s( prefix, "Window B%zu ", i + 1 );
+        OutputDebugStringA( ( prefix + g_damageB[i].Format() ).c_str() );
+    }
+    g_damageB.clear();
+    g_pacerA.reset();
+    g_pacerB.reset();
+    g_latencyWaitablesB.clear();
+    g_drawingB.clear();
+    if( g_timerPeriodSet )
     {
-        3,1,0,
-        2,1,3
-    };
-
-    bd.Usage = D3D11_USAGE_DEFAULT;
-    bd.ByteWidth = sizeof(WORD) * 36;
-    bd.BindFlags = D3D11_BIND_INDEX_BUFFER;
-    bd.CPUAccessFlags = 0;
-    InitData.pSysMem = indices;
-    hr = g_pd3dDeviceB->CreateBuffer(&bd, &InitData, &g_pIndexBufferB);
-    if (FAILED(hr))
-        return hr;
-
-    //? Set index buffer
-    g_pImmediateContextB->IASetIndexBuffer(g_pIndexBufferB, DXGI_FORMAT_R16_UINT, 0);
-
-    //? Set primitive topology
-    g_pImmediateContextB->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
-
-    //? Create the constant buffers
-    bd.Usage = D3D11_USAGE_DEFAULT;
-    bd.ByteWidth = sizeof(CBNeverChanges);
-    bd.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
-    bd.CPUAccessFlags = 0;
-    hr = g_pd3dDeviceB->CreateBuffer(&bd, nullptr, &g_pCBNeverChangesB);
-    if (FAILED(hr))
-        return hr;
-
-    bd.ByteWidth = sizeof(CBChangeOnResize);
-    hr = g_pd3dDeviceB->CreateBuffer(&bd, nullptr, &g_pCBChangeOnResizeB);
-    if (FAILED(hr))
-        return hr;
-
-    bd.ByteWidth = sizeof(CBChangesEveryFrame);
-    hr = g_pd3dDeviceB->CreateBuffer(&bd, nullptr, &g_pCBChangesEveryFrameB);
-    if (FAILED(hr))
-        return hr;
-
-    //! ####################################################################################################
+        timeEndPeriod( 1 );
+        g_timerPeriodSet = false;
+    }
 
-    /*hr = CreateDDSTextureFromFile(g_pd3dDeviceB, L"test2.dds", nullptr, &g_pTextureRV1);
-    if (FAILED(hr))
-        return hr;*/
+    //? Sizes and memory after any resizes, and how well the pools served them
+    if( g_deviceA && g_deviceB )
+    {
+        OutputDebugStringA( FormatRenderDeviceStats( *g_deviceA ).c_str() );
+        OutputDebugStringA( FormatRenderDeviceStats( *g_deviceB ).c_str() );
+        OutputDebugStringA( ( "Device A " + g_deviceA->TargetPool().Format() ).c_str() );
+        OutputDebugStringA( ( "Device B " + g_deviceB->TargetPool().Format() ).c_str() );
+        if( g_deviceB->TransientTargets()->GetStats().plans )
+            OutputDebugStringA( ( "Device B " + g_deviceB->TransientTargets()->Format() ).c_str() );
+        OutputDebugStringA( ( "Device A " + g_deviceA->Resources().Tracker().FormatLive() ).c_str() );
+        OutputDebugStringA( ( "Device B " + g_deviceB->Resources().Tracker().FormatLive() ).c_str() );
+    }
 
-    D3D11_TEXTURE2D_DESC td = {};
-    td.Width = width;
-    td.Height = height;
-    td.MipLevels = 0;
-    td.ArraySize = 1;
-    td.SampleDesc.Count = 1;
-    td.SampleDesc.Quality = 0;
-    td.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
-    td.BindFlags = D3D11_BIND_SHADER_RESOURCE;
-    td.CPUAccessFlags = 0;
-    td.MiscFlags = D3D11_RESOURCE_MISC_SHARED;
+    //? The records outlive the devices, so anything still on them once both are gone
+    //? was never released
+    std::shared_ptr<ResourceTracker> resourcesA = g_deviceA ? g_deviceA->Resources().SharedTracker() : nullptr;
+    std::shared_ptr<ResourceTracker> resourcesB = g_deviceB ? g_deviceB->Resources().SharedTracker() : nullptr;
+    g_resourcesA = ResourceSnapshot();
+    g_resourcesB = ResourceSnapshot();
+
+    //? Windows go with their device
+    g_windowA = nullptr;
+    g_deviceB.reset();
+    g_deviceA.reset();
+
+    if( resourcesA && resourcesA->GetStats().liveCount )
+        OutputDebugStringA( ( "Leaked on device A: " + resourcesA->FormatLive() ).c_str() );
+    if( resourcesB && resourcesB->GetStats().liveCount )
+        OutputDebugStringA( ( "Leaked on device B: " + resourcesB->FormatLive() ).c_str() );
+}
 
-    hr = g_pd3dDeviceB->CreateTexture2D(&td, nullptr, &g_pRenderedTexB);
-    if (FAILED(hr))
-        return hr;
+//? --------------------------------------------------------------------------------------
+//? Render threads for -threaded. Stopping closes the slot ring so neither side stays
+//? blocked on the other; frames still in the ring are dropped.
+//? --------------------------------------------------------------------------------------
+void StartRenderThreads()
+{
+    g_windowChanges.Reopen();
+    g_renderThreadA.Start( [] { CpuTrace::SetThreadName( "Render A" ); return ProduceFrameA(); } );
+    g_renderThreadB.Start( [] { CpuTrace::SetThreadName( "Render B" ); return ConsumeFrameB(); } );
+}
 
-    hr = g_pd3dDeviceB->OpenSharedResource(texHandle, __uuidof(ID3D11Texture2D), (void**)&g_pRenderedTex);
+void StopRenderThreads()
+{
+    g_renderThreadA.RequestStop();
+    g_renderThreadB.RequestStop();
+    g_frameRing.Close();
+    g_windowChanges.Close();
+    g_renderThreadA.Join();
+    g_renderThreadB.Join();
+}
 
-    D3D11_SHADER_RESOURCE_VIEW_DESC rd = {};
-    rd.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
-    rd.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE2D;
-    rd.Texture2D.MostDetailedMip = 0;
-    rd.Texture2D.MipLevels = 1;
 
-    //CreateDDSTextureFromMemory(g_pd3dDeviceB, nullptr, nullptr, &g_pRenderedTex, &g_pTextureRV1);
+//! --------------------------------------------------------------------------------------
+//!
+//! RESIZING
+//!
+//! --------------------------------------------------------------------------------------
 
-    hr = g_pd3dDeviceB->CreateShaderResourceView(g_pRenderedTexB, nullptr, &g_pTextureRV1);
-    if (FAILED(hr))
-        return hr;
-    //! ####################################################################################################
-
-    //? Create the sample state
-    D3D11_SAMPLER_DESC sampDesc = {};
-    sampDesc.Filter = D3D11_FILTER_MIN_MAG_MIP_LINEAR;
-    sampDesc.AddressU = D3D11_TEXTURE_ADDRESS_WRAP;
-    sampDesc.AddressV = D3D11_TEXTURE_ADDRESS_WRAP;
-    sampDesc.AddressW = D3D11_TEXTURE_ADDRESS_WRAP;
-    sampDesc.ComparisonFunc = D3D11_COMPARISON_NEVER;
-    sampDesc.MinLOD = 0;
-    sampDesc.MaxLOD = D3D11_FLOAT32_MAX;
-    hr = g_pd3dDeviceB->CreateSamplerState(&sampDesc, &g_pSamplerLinear1);
-    if (FAILED(hr))
-        return hr;
+//? Keeps only the latest size per window
+void QueueResize( HWND hWnd, UINT width, UINT height )
+{
+    std::lock_guard<std::mutex> lock( g_resizeMutex );
+    for( PendingResize& pending : g_pendingResizes )
+    {
+        if( pending.hWnd == hWnd )
+        {
+            pending.width = width;
+            pending.height = height;
+            return;
+        }
+    }
+    g_pendingResizes.push_back( { hWnd, width, height } );
+}
 
-    //? Initialize the world matrices
-    g_World = XMMatrixIdentity();
+//? --------------------------------------------------------------------------------------
+//? Message thread: the queued sizes are final. Without render threads they apply right
+//? away; with them render thread A picks them up before its next frame.
+//? --------------------------------------------------------------------------------------
+void RequestResizes()
+{
+    if( !g_windowA || !g_deviceB )
+    {
+        // Messages sent while the windows are created; the devices take the client size
+        std::lock_guard<std::mutex> lock( g_resizeMutex );
+        g_pendingResizes.clear();
+        return;
+    }
 
-    //? Initialize the view matrix
-    XMVECTOR Eye = XMVectorSet(0.0f, 0.0f, -5.0f, 0.0f);    // cam rotation (Y-axis Rot, X-axis Rot, Z-axis?)
-    XMVECTOR At = XMVectorSet(0.0f, 0.0f, 0.0f, 0.0f);
-    XMVECTOR Up = XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f);      // ? but cannot be empty/zero
-    g_View = XMMatrixLookAtLH(Eye, At, Up);
+    if( g_renderThreadA.Running() )
+    {
+        g_resizeRequested = true;
+        g_windowChanges.Notify();       // wakes A if it is idle
+        return;
+    }
+    ApplyPendingResizes();
+}
 
-    CBNeverChanges cbNeverChanges;
-    cbNeverChanges.mView = XMMatrixTranspose(g_View);
-    g_pImmediateContextB->UpdateSubresource(g_pCBNeverChangesB, 0, nullptr, &cbNeverChanges, 0, 0);
+//? --------------------------------------------------------------------------------------
+//? Window A's size is the shared surfaces' size, so they, B's copy of them and the
+//? readback staging slots are recreated along with A's targets
+//? --------------------------------------------------------------------------------------
+HRESULT ResizeWindowA( UINT width, UINT height )
+{
+    if( width == g_windowA->Width() && height == g_windowA->Height() )
+        return S_OK;
 
-    //? Initialize the projection matrix
-    g_Projection = XMMatrixPerspectiveFovLH(XM_PIDIV4, width / (FLOAT)height, 0.01f, 100.0f);
+    // Both hold the old back buffer
+    g_readbackA.reset();
+    g_readbackBackendA.reset();
+    ReleaseSharedSurfaces();
 
-    CBChangeOnResize cbChangesOnResize;
-    cbChangesOnResize.mProjection = XMMatrixTranspose(g_Projection);
-    g_pImmediateContextB->UpdateSubresource(g_pCBChangeOnResizeB, 0, nullptr, &cbChangesOnResize, 0, 0);
+    if( !g_windowA->Resize( width, height ) )
+        return g_windowA->LastError();
 
-    return S_OK;
+    HRESULT hr = InitSharedSurfaces();
+    if( SUCCEEDED( hr ) && g_captureFrames )
+        hr = InitReadbackA();
+    return hr;
 }
 
 //? --------------------------------------------------------------------------------------
-//? Clean up the objects we've created
+//? Applies the queued sizes between frames, on the thread rendering window A. The shared
+//? surfaces both sides use are replaced, so with -threaded the ring has to be drained
+//? first: B then waits for A's next frame and touches neither its device nor its windows.
+//? False, with the application closing, if a resize failed.
 //? --------------------------------------------------------------------------------------
-void CleanupDevice()
+bool ApplyPendingResizes()
 {
-    if( g_pImmediateContextA ) g_pImmediateContextA->Flush();
-    if (g_pImmediateContextB) g_pImmediateContextB->ClearState();
-
-    if( g_pSamplerLinear ) g_pSamplerLinear->Release();
-    if( g_pTextureRV ) g_pTextureRV->Release();
-    if( g_pCBNeverChanges ) g_pCBNeverChanges->Release();
-    if( g_pCBChangeOnResize ) g_pCBChangeOnResize->Release();
-    if( g_pCBChangesEveryFrame ) g_pCBChangesEveryFrame->Release();
-    if( g_pSamplerLinear1 ) g_pSamplerLinear1->Release();
-    if( g_pTextureRV1 ) g_pTextureRV1->Release();
-    if( g_pCBNeverChangesB ) g_pCBNeverChangesB->Release();
-    if( g_pCBChangeOnResizeB ) g_pCBChangeOnResizeB->Release();
-    if( g_pCBChangesEveryFrameB ) g_pCBChangesEveryFrameB->Release();
-    if( g_pVertexBuffer ) g_pVertexBuffer->Release();
-    if( g_pIndexBuffer ) g_pIndexBuffer->Release();
-    if( g_pVertexLayout ) g_pVertexLayout->Release();
-    if( g_pVertexShader ) g_pVertexShader->Release();
-    if( g_pPixelShader ) g_pPixelShader->Release();
-    if( g_pVertexBufferB ) g_pVertexBufferB->Release();
-    if( g_pIndexBufferB ) g_pIndexBufferB->Release();
-    if( g_pVertexLayoutB ) g_pVertexLayoutB->Release();
-    if( g_pVertexShaderB ) g_pVertexShaderB->Release();
-    if( g_pPixelShaderB ) g_pPixelShaderB->Release();
-    if( g_pDepthStencilA ) g_pDepthStencilA->Release();
-    if( g_pDepthStencilViewA ) g_pDepthStencilViewA->Release();
-    if( g_pRenderTargetViewA ) g_pRenderTargetViewA->Release();
-    if( g_pSwapChain1A ) g_pSwapChain1A->Release();
-    if( g_pSwapChainA ) g_pSwapChainA->Release();
-    if( g_pImmediateContext1A ) g_pImmediateContext1A->Release();
-    if( g_pImmediateContextA ) g_pImmediateContextA->Release();
-    if (g_pImmediateContext1B) g_pImmediateContext1B->Release();
-    if (g_pImmediateContextB) g_pImmediateContextB->Release();
-    if( g_pDepthStencilB ) g_pDepthStencilB->Release();
-    if( g_pDepthStencilViewB ) g_pDepthStencilViewB->Release();
-    if( g_pRenderTargetViewB ) g_pRenderTargetViewB->Release();
-    if( g_pSwapChain1B ) g_pSwapChain1B->Release();
-    if( g_pSwapChainB ) g_pSwapChainB->Release();
-    if( g_pd3dDevice1A ) g_pd3dDevice1A->Release();
-    if( g_pd3dDeviceA ) g_pd3dDeviceA->Release();
-    if (g_pd3dDevice1B) g_pd3dDevice1B->Release();
-    if (g_pd3dDeviceB) g_pd3dDeviceB->Release();
-    if (g_pRenderedTex) g_pRenderedTex->Release();
+    std::vector<PendingResize> resizes;
+    {
+        std::lock_guard<std::mutex> lock( g_resizeMutex );
+        resizes.swap( g_pendingResizes );
+    }
+    if( resizes.empty() )
+        return true;
+
+    CPU_TRACE_SCOPE( "Resize" );
+
+    HRESULT hr = S_OK;
+    for( const PendingResize& pending : resizes )
+    {
+        if( pending.hWnd == g_hWnd )
+        {
+            hr = ResizeWindowA( pending.width, pending.height );
+        }
+        else
+        {
+            for( size_t i = 0; i < g_deviceB->WindowCount(); ++i )
+            {
+                D3D11RenderWindow* window = g_deviceB->Window( i );
+                if( window->Hwnd() == pending.hWnd && !window->Resize( pending.width, pending.height ) )
+                    hr = window->LastError();
+            }
+        }
+        if( FAILED( hr ) )
+            break;
+    }
+
+    if( FAILED( hr ) )
+    {
+        char msg[96];
+        sprintf_s( msg, "Resize failed (0x%08lx), exiting\n", static_cast<unsigned long>( hr ) );
+        OutputDebugStringA( msg );
+        // Posted, since this may run on a render thread
+        PostMessage( g_hWnd, WM_CLOSE, 0, 0 );
+        return false;
+    }
+
+    // Both sides redraw at least once at the new sizes; the targets they replaced are
+    // no growth
+    g_windowChanges.Notify();
+    g_resourcesA = ResourceSnapshot();
+    g_resourcesB = ResourceSnapshot();
+    return true;
 }
 
 
@@ -1122,14 +1662,40 @@ LRESULT CALLBACK WndProc( HWND hWnd, UINT message, WPARAM wParam, LPARAM lParam
     case WM_PAINT:
         hdc = BeginPaint( hWnd, &ps );
         EndPaint( hWnd, &ps );
+        g_windowChanges.Notify();
+        break;
+
+    case WM_KEYDOWN:
+        // SPACE pauses and resumes the animation; while paused nothing is rendered
+        if( wParam == VK_SPACE )
+        {
+            g_animateA = !g_animateA;
+            g_windowChanges.Notify();
+        }
         break;
 
     case WM_DESTROY:
         PostQuitMessage( 0 );
         break;
 
-        // Note that this tutorial does not handle resizing (WM_SIZE) requests,
-        // so we created the window without the resize border.
+    case WM_ENTERSIZEMOVE:
+        g_inSizeMove = true;
+        break;
+
+    case WM_EXITSIZEMOVE:
+        g_inSizeMove = false;
+        RequestResizes();
+        break;
+
+    case WM_SIZE:
+        // Minimized windows keep their targets; they are restored at the old size anyway
+        if( wParam != SIZE_MINIMIZED )
+        {
+            QueueResize( hWnd, LOWORD( lParam ), HIWORD( lParam ) );
+            if( !g_inSizeMove )
+                RequestResizes();
+        }
+        break;
 
     default:
         return DefWindowProc( hWnd, message, wParam, lParam );
@@ -1140,117 +1706,618 @@ LRESULT CALLBACK WndProc( HWND hWnd, UINT message, WPARAM wParam, LPARAM lParam
 
 
 //? --------------------------------------------------------------------------------------
-//? Render a frame
+//? Screen-space bounds of the unit quad after transforming it to clip space
 //? --------------------------------------------------------------------------------------
-void RenderA()
+DirtyRect QuadScreenBounds( const XMMATRIX& toClip, UINT width, UINT height )
 {
-    // Update our time
-    static float t = 0.0f;
+    const XMVECTOR corners[] =
+    {
+        XMVectorSet( -1.0f, -1.0f, 0.0f, 1.0f ),
+        XMVectorSet(  1.0f, -1.0f, 0.0f, 1.0f ),
+        XMVectorSet(  1.0f,  1.0f, 0.0f, 1.0f ),
+        XMVectorSet( -1.0f,  1.0f, 0.0f, 1.0f ),
+    };
 
-    // Set Output Merger Render Target
-    g_pImmediateContextA->OMSetRenderTargets(1, &g_pRenderTargetViewA, g_pDepthStencilViewA);
+    float minX = FLT_MAX, minY = FLT_MAX, maxX = -FLT_MAX, maxY = -FLT_MAX;
+    for( const XMVECTOR& corner : corners )
+    {
+        XMFLOAT4 p;
+        XMStoreFloat4( &p, XMVector4Transform( corner, toClip ) );
+        if( p.w <= 0.0f )
+            return DirtyRect{ 0, 0, width, height };    // crosses the eye plane, be conservative
+
+        const float x = ( p.x / p.w * 0.5f + 0.5f ) * width;
+        const float y = ( 0.5f - p.y / p.w * 0.5f ) * height;
+        minX = fminf( minX, x ); maxX = fmaxf( maxX, x );
+        minY = fminf( minY, y ); maxY = fmaxf( maxY, y );
+    }
 
-    //DirectX::CaptureTexture(g_pd3dDeviceA,)
+    // One pixel of slack for filtering and rasterization rules
+    DirtyRect rc;
+    rc.left   = UINT( fmaxf( 0.0f, floorf( minX ) - 1.0f ) );
+    rc.top    = UINT( fmaxf( 0.0f, floorf( minY ) - 1.0f ) );
+    rc.right  = UINT( fmaxf( 0.0f, fminf( float( width ), ceilf( maxX ) + 1.0f ) ) );
+    rc.bottom = UINT( fmaxf( 0.0f, fminf( float( height ), ceilf( maxY ) + 1.0f ) ) );
+    return rc;
+}
 
-    // Rotate cube around the origin
-    g_World = XMMatrixRotationY( t );
+//? --------------------------------------------------------------------------------------
+//? Renders the dirty part of a reduced shared surface from window A's back buffer
+//? --------------------------------------------------------------------------------------
+void DownsampleDirtyRectsA( SharedSlot& slot )
+{
+    D3D11StateCache& state = g_deviceA->StateCache();
+
+    D3D11_VIEWPORT vp = { 0.0f, 0.0f, (FLOAT)g_sharedDesc.width, (FLOAT)g_sharedDesc.height, 0.0f, 1.0f };
+    state.OMSetRenderTargets( 1, &slot.rtvA, nullptr );
+    state.RSSetViewports( 1, &vp );
+    state.RSSetState( g_pScissorStateA );
+    state.IASetInputLayout( nullptr );
+    state.VSSetShader( g_pDownsampleVS );
+    state.PSSetShader( g_pDownsamplePS );
+    state.PSSetConstantBuffers( 0, 1, &g_pCBDownsample );
+    state.PSSetShaderResources( 0, 1, &g_pBackBufferSRVA );
+
+    for( const DirtyRect& rc : slot.frame.dirty.Rects() )
+    {
+        D3D11_RECT scissor = { (LONG)rc.left, (LONG)rc.top, (LONG)rc.right, (LONG)rc.bottom };
+        state.RSSetScissorRects( 1, &scissor );
+        g_deviceA->Context()->Draw( 3, 0 );
+    }
 
-    //
-    // Clear the back buffer
-    //
-    g_pImmediateContextA->ClearRenderTargetView( g_pRenderTargetViewA, Colors::MidnightBlue );
+    // Let go of the back buffer before window A binds it as a render target again
+    ID3D11ShaderResourceView* nullSRV = nullptr;
+    state.PSSetShaderResources( 0, 1, &nullSRV );
+}
 
-    //
-    // Clear the depth buffer to 1.0 (max depth)
-    //
-    g_pImmediateContextA->ClearDepthStencilView( g_pDepthStencilViewA, D3D11_CLEAR_DEPTH, 1.0f, 0 );
+//? --------------------------------------------------------------------------------------
+//? Window A works out the regions that changed since its last frame: where the quad was
+//? and where it is now. False while the frame inputs stay the same; nothing is published
+//? then.
+//? --------------------------------------------------------------------------------------
+bool PrepareDirtyRectsA( SharedSlot& slot, const FrameConstants& cb, bool wholeFrame, DirtyRect& bounds )
+{
+    DirtyRegion& dirty = slot.frame.dirty;
+    dirty.Clear();
+
+    if( g_hasPublishedA && memcmp( &cb, &g_lastPublishedCBA, sizeof( cb ) ) == 0 )
+        return false;
+
+    // Window A's vertex shader only applies World, so the quad is already in clip space
+    const XMMATRIX world = XMLoadFloat4x4( reinterpret_cast<const XMFLOAT4X4*>( cb.world ) );
+    bounds = QuadScreenBounds( XMMatrixTranspose( world ), g_dirtyFullA.Width(), g_dirtyFullA.Height() );
+
+    g_dirtyFullA.Clear();
+    if( g_hasPublishedA && !wholeFrame )
+    {
+        g_dirtyFullA.Add( g_lastQuadBoundsA );
+        g_dirtyFullA.Add( bounds );
+    }
+    else
+    {
+        // First frame, or a scene that covers the window: everything goes across
+        g_dirtyFullA.AddAll();
+    }
+    g_dirtyFullA.Coalesce( g_dirtyCost );
+
+    // The slot's region is in shared-surface pixels, which may be reduced
+    for( const DirtyRect& rc : g_dirtyFullA.Rects() )
+        dirty.Add( ScaleDirtyRectDown( rc, g_sharedDesc.scaleShift ) );
+    return true;
+}
+
+//? --------------------------------------------------------------------------------------
+//? Copies the prepared regions into the slot's shared surface, which window A holds by
+//? now, downsampling them on the way for a reduced surface
+//? --------------------------------------------------------------------------------------
+void PublishDirtyRectsA( SharedSlot& slot, const FrameConstants& cb, const DirtyRect& bounds )
+{
+    const DirtyRegion& dirty = slot.frame.dirty;
+    if( g_sharedDesc.IsReduced() )
+    {
+        DownsampleDirtyRectsA( slot );
+    }
+    else
+    {
+        for( const DirtyRect& rc : dirty.Rects() )
+        {
+            D3D11_BOX box = { rc.left, rc.top, 0, rc.right, rc.bottom, 1 };
+            g_deviceA->Context()->CopySubresourceRegion( slot.texA, 0, rc.left, rc.top, 0, g_windowA->BackBuffer(), 0, &box );
+        }
+    }
+
+    g_lastQuadBoundsA = bounds;
+    g_lastPublishedCBA = cb;
+    g_hasPublishedA = true;
+}
+
+//? --------------------------------------------------------------------------------------
+//? Window A's content at time t: the spinning quad, or the scene. Returns whether it drew
+//? the scene; cb is the frame's constants either way.
+//? --------------------------------------------------------------------------------------
+bool DrawFrameA( float t, FrameConstants& cb )
+{
+    // Rotate cube around the origin
+    XMMATRIX world = XMMatrixRotationY( t );
 
     //
     // Update variables that change once per frame
     //
-    CBChangesEveryFrame cb;
-    cb.mWorld = XMMatrixTranspose( g_World );
-    cb.vMeshColor = g_vMeshColor;
-    g_pImmediateContextA->UpdateSubresource( g_pCBChangesEveryFrame, 0, nullptr, &cb, 0, 0 );
+    XMStoreFloat4x4( reinterpret_cast<XMFLOAT4X4*>( cb.world ), XMMatrixTranspose( world ) );
+    memcpy( cb.meshColor, &g_vMeshColor, sizeof( cb.meshColor ) );
 
     //
-    // Render the cube
+    // Render the cube, or the scene; the scene only changes when cb does
     //
-    g_pImmediateContextA->VSSetShader( g_pVertexShader, nullptr, 0 );
-    g_pImmediateContextA->VSSetConstantBuffers( 0, 1, &g_pCBNeverChanges );
-    g_pImmediateContextA->VSSetConstantBuffers( 1, 1, &g_pCBChangeOnResize );
-    g_pImmediateContextA->VSSetConstantBuffers( 2, 1, &g_pCBChangesEveryFrame );
-    g_pImmediateContextA->PSSetShader( g_pPixelShader, nullptr, 0 );
-    g_pImmediateContextA->PSSetConstantBuffers( 2, 1, &g_pCBChangesEveryFrame );
-    g_pImmediateContextA->PSSetShaderResources( 0, 1, &g_pTextureRV );
-    g_pImmediateContextA->PSSetSamplers( 0, 1, &g_pSamplerLinear );
-    g_pImmediateContextA->DrawIndexed( 6, 0, 0 );
+    const bool scene = g_sceneQuadCountA > 0;
+    const bool rebuild = !g_hasPublishedA || memcmp( &cb, &g_lastPublishedCBA, sizeof( cb ) ) != 0;
+    if( scene && rebuild )
+    {
+        FrameBenchmark::ScopedPhase buildTiming( g_benchmarkA, g_scenePhaseA );
+        if( g_batchRendererA )
+            BuildSceneBatchA( t );
+        else
+            BuildSceneA( t, cb );
+    }
 
-    //
-    // Present our back buffer to our front buffer
-    //
-    g_pSwapChainA->Present( 0, 0 );
+    FrameBenchmark::ScopedPhase submitTiming( g_benchmarkA, g_submitPhaseA );
+    if( scene && g_batchRendererA )
+    {
+        g_batchRendererA->Draw( g_batcherA );
+    }
+    else if( scene )
+    {
+        const SceneSubmitStats stats = SubmitScene( *g_sceneRecorderA, g_sceneQuadsA, kSceneChunkQuads, g_scenePoolA.get() );
+        g_sceneTotalsA.quads = stats.quads;
+        g_sceneTotalsA.chunks = stats.chunks;
+        g_sceneTotalsA.contexts = stats.contexts;
+        g_sceneTotalsA.recordMs += stats.recordMs;
+        g_sceneTotalsA.executeMs += stats.executeMs;
+        ++g_sceneFramesA;
+    }
+    else
+    {
+        g_windowA->UpdateFrameConstants( cb );
+        g_windowA->DrawQuad();
+    }
+    return scene;
+}
 
-    g_pSwapChainA->GetBuffer(0, __uuidof(ID3D11Texture2D), reinterpret_cast<void**>(&g_pRenderedTex));
+//? --------------------------------------------------------------------------------------
+//? B's windows: every one shows the same shared image, and the ones none of whose inputs
+//? changed keep showing their last frame. The quad turns in step with the frame from
+//? window A.
+//? --------------------------------------------------------------------------------------
+void DrawWindowsB(const FrameConstants& cb, GpuProfiler* profiler)
+{
+    g_latencyWaitablesB.clear();
+    g_drawingB.clear();
+    for (size_t i = 0; i < g_deviceB->WindowCount(); ++i)
+    {
+        D3D11RenderWindow* window = g_deviceB->Window(i);
+        DamageTracker& damage = g_damageB[i];
+        damage.UpdateBytes(DAMAGE_CONSTANTS, &cb, sizeof(cb));
+        damage.UpdateGeneration(DAMAGE_TARGET, window->Stats().resizes);
+        damage.UpdateGeneration(DAMAGE_WINDOWS, g_windowChanges.Generation());
+        damage.UpdateGeneration(DAMAGE_SHARED_SURFACE, g_sharedGenerationB);
+        if (damage.Dirty())
+        {
+            g_drawingB.push_back(window);
+            if (window->LatencyWaitable())
+                g_latencyWaitablesB.push_back(window->LatencyWaitable());
+        }
+    }
+    if (!g_drawingB.empty())
+    {
+        CPU_TRACE_SCOPE("PaceB");
+        g_pacerB->BeginFrame(g_latencyWaitablesB.data(), g_latencyWaitablesB.size());
+    }
+
+    //? Only the windows that draw need a depth buffer this frame
+    if (g_transientDepthB && !g_drawingB.empty())
+        g_deviceB->PlanTransientDepth(g_drawingB.data(), g_drawingB.size());
 
-    g_pImmediateContextA->Flush();
+    for (size_t i = 0; i < g_deviceB->WindowCount(); ++i)
+    {
+        D3D11RenderWindow* window = g_deviceB->Window(i);
+        DamageTracker& damage = g_damageB[i];
+        if (!damage.Dirty())
+        {
+            damage.MarkSkipped();
+            continue;
+        }
+        {
+            GpuProfileScope scope(profiler, g_gpuScopesB.clear);
+            window->BeginFrame();
+        }
+        {
+            GpuProfileScope scope(profiler, g_gpuScopesB.draw);
+            window->UpdateFrameConstants(cb);
+            window->DrawQuad();
+        }
+        {
+            GpuProfileScope scope(profiler, g_gpuScopesB.present);
+            window->Present();
+        }
+        damage.MarkRendered();
+    }
 }
 
-void RenderB()
+//? --------------------------------------------------------------------------------------
+//? Device A's side of a frame graph run. Waiting on the shared surface takes the slot's
+//? keyed mutex, and only when the frame has something to publish.
+//? --------------------------------------------------------------------------------------
+class FrameGraphRunA : public IRenderGraphBackend
 {
-    // Update our time
-    static float t = 0.0f;
+public:
+    FrameGraphRunA( SharedSlot& slot, GpuProfiler* profiler, float t ) : m_slot( slot ), m_profiler( profiler ), m_t( t ) {}
 
+    void RunPass( size_t pass ) override
+    {
+        if( pass == g_graphPasses.drawA )
+            DrawPass();
+        else if( pass == g_graphPasses.publishA )
+            PublishPass();
+        else if( pass == g_graphPasses.readbackA && g_readbackA )
+            g_readbackA->Capture( m_slot.frame.stamp.frameId );
+        else if( pass == g_graphPasses.presentA )
+            PresentPass();
+    }
 
-    // Set Output Merger Render Target
-    ID3D11Resource* tempRes;
-    ID3D11Texture2D* tempTex;
-    g_pImmediateContextB->OMSetRenderTargets(1, &g_pRenderTargetViewB, g_pDepthStencilViewB);
+    void Wait( size_t ) override
+    {
+        // B releases the slot's key only after its copies, so this never blocks for long
+        m_acquired = m_publish && SUCCEEDED( m_slot.mutexA->AcquireSync( kKeyProducer, INFINITE ) );
+        m_slot.frame.published = m_acquired;
+    }
 
-    g_pd3dDeviceB->OpenSharedResource(texHandle, __uuidof(ID3D11Texture2D), (void**)&tempTex);
-    g_pRenderedTexB->QueryInterface(__uuidof(ID3D11Resource), reinterpret_cast<void**>(&tempRes));
-    g_pImmediateContextB->CopySubresourceRegion(tempRes, 0, 0, 0, 0, tempTex, 0, nullptr);
-    tempRes->Release();
-    tempTex->Release();
+    void Signal( size_t ) override
+    {
+        if( m_acquired )
+            m_slot.mutexA->ReleaseSync( kKeyConsumer );
+        m_acquired = false;
+    }
 
-    //g_pImmediateContextB->CopyResource(g_pRenderedTexB, g_pRenderedTex);
+    void Flush() override
+    {
+        g_deviceA->Context()->Flush();
+    }
 
-    // Rotate cube around the origin
-    g_World = XMMatrixRotationY(t);
+private:
+    void DrawPass()
+    {
+        //
+        // Set the render target and clear it and the depth buffer
+        //
+        {
+            GpuProfileScope scope( m_profiler, g_gpuScopesA.clear );
+            g_windowA->BeginFrame();
+        }
 
-    //
-    // Clear the back buffer
-    //
-    g_pImmediateContextB->ClearRenderTargetView(g_pRenderTargetViewB, Colors::CadetBlue);
+        bool scene;
+        {
+            GpuProfileScope scope( m_profiler, g_gpuScopesA.draw );
+            scene = DrawFrameA( m_t, m_cb );
+        }
+        m_slot.frame.constants = m_cb;
+
+        // The regions to publish are known now, so the wait on the shared surface can
+        // skip the keyed mutex when there are none
+        m_publish = PrepareDirtyRectsA( m_slot, m_cb, scene, m_bounds );
+    }
+
+    void PublishPass()
+    {
+        if( !m_publish )
+            return;
+        if( !m_acquired )
+        {
+            m_slot.frame.dirty.Clear();
+            return;
+        }
+        GpuProfileScope scope( m_profiler, g_gpuScopesA.copy );
+        PublishDirtyRectsA( m_slot, m_cb, m_bounds );
+    }
+
+    void PresentPass()
+    {
+        //
+        // Present our back buffer to our front buffer
+        //
+        GpuProfileScope scope( m_profiler, g_gpuScopesA.present );
+        g_windowA->Present();
+    }
+
+    SharedSlot&     m_slot;
+    GpuProfiler*    m_profiler;
+    float           m_t;
+    FrameConstants  m_cb = {};
+    DirtyRect       m_bounds = {};
+    bool            m_publish = false;      // the frame changed; its regions go to the shared surface
+    bool            m_acquired = false;     // holds the slot's keyed mutex
+};
+
+//? --------------------------------------------------------------------------------------
+//? Device B's side: the wait only takes the keyed mutex when A's wait took it, as
+//? recorded in the slot; the dirty region alone can be empty after A released the key
+//? --------------------------------------------------------------------------------------
+class FrameGraphRunB : public IRenderGraphBackend
+{
+public:
+    FrameGraphRunB( SharedSlot& slot, GpuProfiler* profiler ) : m_slot( slot ), m_profiler( profiler ) {}
+
+    void RunPass( size_t pass ) override
+    {
+        if( pass == g_graphPasses.copyB )
+            CopyPass();
+        else if( pass == g_graphPasses.windowsB )
+            DrawWindowsB( m_slot.frame.constants, m_profiler );
+    }
+
+    void Wait( size_t ) override
+    {
+        m_acquired = m_slot.frame.published && SUCCEEDED( m_slot.mutexB->AcquireSync( kKeyConsumer, INFINITE ) );
+    }
+
+    void Signal( size_t ) override
+    {
+        if( m_acquired )
+            m_slot.mutexB->ReleaseSync( kKeyProducer );
+        m_acquired = false;
+    }
+
+    void Flush() override
+    {
+        g_deviceB->Context()->Flush();
+    }
+
+private:
+    //? Pulls only the regions window A published as dirty
+    void CopyPass()
+    {
+        const DirtyRegion& dirty = m_slot.frame.dirty;
+        if( m_acquired )
+        {
+            GpuProfileScope scope( m_profiler, g_gpuScopesB.copy );
+            for( const DirtyRect& rc : dirty.Rects() )
+            {
+                D3D11_BOX box = { rc.left, rc.top, 0, rc.right, rc.bottom, 1 };
+                g_deviceB->Context()->CopySubresourceRegion( g_pRenderedTexB, 0, rc.left, rc.top, 0, m_slot.texB, 0, &box );
+            }
+            ++g_sharedGenerationB;
+        }
+        g_dirtyStatsB.Record( dirty, SharedFormatBytesPerPixel( g_sharedDesc.format ) );
+    }
+
+    SharedSlot&     m_slot;
+    GpuProfiler*    m_profiler;
+    bool            m_acquired = false;
+};
+
+//? --------------------------------------------------------------------------------------
+//? The frame as a render graph: A draws, publishes the changed regions to the shared
+//? surface, reads back and presents; B copies what was published and redraws its
+//? windows. Only the pass bodies depend on the sizes, so resizes keep the schedule.
+//? --------------------------------------------------------------------------------------
+HRESULT BuildFrameGraph()
+{
+    RenderGraph& graph = g_frameGraph;
+    graph.Clear();
+    const size_t backBufferA = graph.AddResource( "A back buffer" );
+    const size_t shared = graph.AddResource( "shared surface", GRAPH_RESOURCE_SHARED );
+    const size_t copyB = graph.AddResource( "B copy" );
+    const size_t backBuffersB = graph.AddResource( "B back buffers" );
+
+    g_graphPasses = FrameGraphPasses();
+    g_graphPasses.drawA = graph.AddPass( "draw A", kGraphDeviceA );
+    graph.Write( g_graphPasses.drawA, backBufferA );
+
+    g_graphPasses.publishA = graph.AddPass( "publish A", kGraphDeviceA );
+    graph.Read( g_graphPasses.publishA, backBufferA );
+    graph.Write( g_graphPasses.publishA, shared );
+
+    if( g_captureFrames )
+    {
+        const size_t readback = graph.AddResource( "A readback", GRAPH_RESOURCE_OUTPUT );
+        g_graphPasses.readbackA = graph.AddPass( "readback A", kGraphDeviceA );
+        graph.Read( g_graphPasses.readbackA, backBufferA );
+        graph.Write( g_graphPasses.readbackA, readback );
+    }
+
+    g_graphPasses.presentA = graph.AddPass( "present A", kGraphDeviceA, true );
+    graph.Read( g_graphPasses.presentA, backBufferA );
+
+    g_graphPasses.copyB = graph.AddPass( "copy B", kGraphDeviceB );
+    graph.Read( g_graphPasses.copyB, shared );
+    graph.Write( g_graphPasses.copyB, copyB );
+
+    g_graphPasses.windowsB = graph.AddPass( "windows B", kGraphDeviceB, true );
+    graph.Read( g_graphPasses.windowsB, copyB );
+    graph.Write( g_graphPasses.windowsB, backBuffersB );
+
+    //? Releasing a keyed mutex submits the device's work, so handing the shared surface
+    //? over needs no flush; presenting submits the rest
+    RenderGraphOptions options;
+    options.signalFlushes = true;
+    const bool compiled = CompileRenderGraph( graph, g_frameSchedule, options );
+    OutputDebugStringA( g_frameSchedule.Format( graph ).c_str() );
+    OutputDebugStringA( g_frameSchedule.FormatStats().c_str() );
+    return compiled ? S_OK : E_FAIL;
+}
+
+//? --------------------------------------------------------------------------------------
+//? Render a frame
+//? --------------------------------------------------------------------------------------
+void RenderA( SharedSlot& slot )
+{
+    CPU_TRACE_SCOPE( "RenderA" );
+
+    slot.frame.stamp = FrameStamp();
+    slot.frame.stamp.frameId = ++g_frameCounterA;
+    slot.frame.published = false;
+    slot.frame.stamp.renderStart = LatencyNow();
+
+    // Update our time; it stands still while the animation is paused
+    const float t = (float)( g_animationStepA * kAnimationStepSeconds );
+
+    GpuProfiler* profiler = g_gpuProfilerA.get();
+    if( profiler )
+        profiler->BeginFrame( slot.frame.stamp.frameId );
 
     //
-    // Clear the depth buffer to 1.0 (max depth)
+    // Draw, publish the changed parts of the frame to the shared surface, queue the frame
+    // for CPU readback (picked up kReadbackLatency frames later) and present, in the
+    // order the frame graph runs them
     //
-    g_pImmediateContextB->ClearDepthStencilView( g_pDepthStencilViewB, D3D11_CLEAR_DEPTH, 1.0f, 0 );
+    FrameGraphRunA run( slot, profiler, t );
+    ExecuteRenderSchedule( g_frameSchedule, kGraphDeviceA, run );
+
+    if( g_readbackA )
+        g_readbackA->Poll( slot.frame.stamp.frameId );
+
+    if( profiler )
+    {
+        profiler->EndFrame();
+        profiler->Resolve( slot.frame.stamp.frameId );
+    }
+
+    if( g_animateA )
+        ++g_animationStepA;
+
+    CheckResourceGrowth( *g_deviceA, slot.frame.stamp.frameId, g_resourcesA, "Device A" );
+
+    slot.frame.stamp.submit = LatencyNow();
+}
+
+void RenderB( SharedSlot& slot )
+{
+    CPU_TRACE_SCOPE( "RenderB" );
+
+    FrameStamp stamp = slot.frame.stamp;
+    stamp.acquire = LatencyNow();
+
+    GpuProfiler* profiler = g_gpuProfilerB.get();
+    const UINT64 frameB = ++g_frameCounterB;
+    if (profiler)
+        profiler->BeginFrame(frameB);
 
     //
-    // Update variables that change once per frame
+    // Pull what window A published into B's copy and redraw the windows showing it, in
+    // the order the frame graph runs them
     //
-    CBChangesEveryFrame cb;
-    cb.mWorld = XMMatrixTranspose(g_World);
-    cb.vMeshColor = g_vMeshColor;
-    g_pImmediateContextB->UpdateSubresource( g_pCBChangesEveryFrameB, 0, nullptr, &cb, 0, 0 );
+    FrameGraphRunB run(slot, profiler);
+    ExecuteRenderSchedule(g_frameSchedule, kGraphDeviceB, run);
+
+    if (profiler)
+    {
+        profiler->EndFrame();
+        profiler->Resolve(frameB);
+    }
+
+    CheckResourceGrowth(*g_deviceB, frameB, g_resourcesB, "Device B");
+
+    stamp.present = LatencyNow();
+    g_latency.RecordPresented(stamp);
 
     //
-    // Render the cube
+    // Periodic dump of the handoff statistics
     //
-    g_pImmediateContextB->VSSetShader( g_pVertexShaderB, nullptr, 0 );
-    g_pImmediateContextB->VSSetConstantBuffers( 0, 1, &g_pCBNeverChangesB );
-    g_pImmediateContextB->VSSetConstantBuffers( 1, 1, &g_pCBChangeOnResizeB );
-    g_pImmediateContextB->VSSetConstantBuffers( 2, 1, &g_pCBChangesEveryFrameB );
-    g_pImmediateContextB->PSSetShader( g_pPixelShaderB, nullptr, 0 );
-    g_pImmediateContextB->PSSetConstantBuffers( 2, 1, &g_pCBChangesEveryFrameB );
-    g_pImmediateContextB->PSSetShaderResources( 0, 1, &g_pTextureRV1 );
-    g_pImmediateContextB->PSSetSamplers( 0, 1, &g_pSamplerLinear1 );
-    g_pImmediateContextB->DrawIndexed( 6, 0, 0 );
+    std::string report;
+    if (g_latency.DumpIfDue(stamp.present, report))
+    {
+        char msg[160];
+        sprintf_s(msg, "Shared surface: %.0f bytes copied/frame (%.1f%% of full copies), %llu rects last frame\n",
+            g_dirtyStatsB.BytesPerFrame(), g_dirtyStatsB.CopyRatio() * 100.0, g_dirtyStatsB.lastFrameRects);
+        OutputDebugStringA(report.c_str());
+        OutputDebugStringA(msg);
+        OutputDebugStringA(("Device B " + StateFilter::Format(g_deviceB->StateCache().GetCounters())).c_str());
+        if (profiler)
+            OutputDebugStringA(("Device B " + profiler->Format()).c_str());
+    }
+}
 
-    //
-    // Present our back buffer to our front buffer
-    //#
-    g_pSwapChainB->Present(0, 0);
+//? --------------------------------------------------------------------------------------
+//? Stamps a device's new resources with the frame and, with -leakcheck, compares its
+//? live resources with the last check every kResourceCheckFrames frames. Runs between
+//? frames on the thread rendering with the device, the only one releasing its resources,
+//? as ResourceTracker::Snapshot() requires.
+//? --------------------------------------------------------------------------------------
+void CheckResourceGrowth( D3D11RenderDevice& device, UINT64 frame, ResourceSnapshot& last, const char* name )
+{
+    ResourceTracker& tracker = device.Resources().Tracker();
+    tracker.SetFrame( frame );
+    if( !g_leakCheck || frame % kResourceCheckFrames )
+        return;
+
+    ResourceSnapshot snapshot = tracker.Snapshot();
+    if( last.frame )
+    {
+        const ResourceDiff diff = DiffResourceSnapshots( last, snapshot );
+        if( diff.Grew() )
+            OutputDebugStringA( ( std::string( name ) + " " + diff.Format() ).c_str() );
+    }
+    last = std::move( snapshot );
+}
+
+//? --------------------------------------------------------------------------------------
+//? Feeds window A's inputs for its next frame to its tracker. False when that frame
+//? would be the same as the last one.
+//? --------------------------------------------------------------------------------------
+bool UpdateDamageA()
+{
+    const FrameConstants cb = SpinningQuadConstants( (float)( g_animationStepA * kAnimationStepSeconds ), &g_vMeshColor.x );
+    g_damageA.UpdateBytes( DAMAGE_CONSTANTS, &cb, sizeof( cb ) );
+    g_damageA.UpdateGeneration( DAMAGE_TARGET, g_windowA->Stats().resizes );
+    g_damageA.UpdateGeneration( DAMAGE_WINDOWS, g_windowChanges.Generation() );
+    return g_damageA.Dirty();
+}
+
+//? --------------------------------------------------------------------------------------
+//? One step of each side of the handoff. In threaded mode each runs in a loop on its own
+//? render thread; otherwise the message loop calls them back to back, and only once
+//? UpdateDamageA() found something to draw. B waits in the ring while A has nothing.
+//? --------------------------------------------------------------------------------------
+bool ProduceFrameA()
+{
+    // Only on a render thread: sizes the message thread queued
+    if( g_resizeRequested.exchange( false ) )
+    {
+        CPU_TRACE_SCOPE( "DrainForResize" );
+        if( !g_frameRing.WaitDrained() || !ApplyPendingResizes() )
+            return false;
+    }
+
+    const uint64_t changes = g_windowChanges.Generation();
+    if( !UpdateDamageA() )
+    {
+        // Only on a render thread: sleep until the message thread reports a change
+        g_damageA.MarkSkipped();
+        return g_windowChanges.WaitForChange( changes );
+    }
+
+    {
+        CPU_TRACE_SCOPE( "PaceA" );
+        IFrameLatencyWaitable* waitable = g_windowA->LatencyWaitable();
+        g_pacerA->BeginFrame( &waitable, waitable ? 1 : 0 );
+    }
+
+    size_t slot = 0;
+    if( !g_frameRing.AcquireForWrite( slot ) )
+        return false;
+
+    RenderA( g_sharedSlots[slot] );
+    g_frameRing.Publish( slot );
+    g_damageA.MarkRendered();
+    return true;
+}
+
+bool ConsumeFrameB()
+{
+    size_t slot = 0;
+    if( !g_frameRing.AcquireForRead( slot ) )
+        return false;
+
+    RenderB( g_sharedSlots[slot] );
+    g_frameRing.Release( slot );
+    return true;
 }
@@ -0,0 +1,195 @@
+//--------------------------------------------------------------------------------------
+// File: DamageTrackerTests.cpp
+//
+// DamageTracker's change detection and ChangeSignal's waits
+//--------------------------------------------------------------------------------------
+
+#include "TestHarness.h"
+#include "DamageTracker.h"
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+
+namespace
+{
+    struct Constants
+    {
+        float   world[16];
+        float   color[4];
+    };
+
+    //? Polls 'done' for up to a second
+    template <typename Fn>
+    bool WaitFor( Fn done )
+    {
+        for( int i = 0; i < 1000 && !done(); ++i )
+            std::this_thread::sleep_for( std::chrono::milliseconds( 1 ) );
+        return done();
+    }
+}
+
+TEST_CASE( DamageTrackerStartsDirty )
+{
+    DamageTracker tracker;
+    CHECK( !tracker.Dirty() );
+    const size_t constants = tracker.AddInput( "constants" );
+    CHECK( tracker.Dirty() && tracker.Changed( constants ) );
+
+    // The first value seen is stored but is not a change on top of the initial one
+    const uint64_t generation = tracker.Generation( constants );
+    const Constants value = {};
+    CHECK( tracker.UpdateBytes( constants, &value, sizeof( value ) ) );
+    CHECK( tracker.Generation( constants ) == generation );
+    tracker.MarkRendered();
+    CHECK( !tracker.Dirty() );
+    CHECK( !tracker.UpdateBytes( constants, &value, sizeof( value ) ) );
+    CHECK( tracker.Generation( constants ) == generation );
+}
+
+TEST_CASE( DamageTrackerComparesBytes )
+{
+    DamageTracker tracker;
+    const size_t constants = tracker.AddInput( "constants" );
+    const size_t target = tracker.AddInput( "target" );
+    Constants value = {};
+    tracker.UpdateBytes( constants, &value, sizeof( value ) );
+    tracker.UpdateGeneration( target, 0 );
+    tracker.MarkRendered();
+
+    value.color[3] = 1.0f;
+    CHECK( tracker.UpdateBytes( constants, &value, sizeof( value ) ) );
+    CHECK( tracker.Dirty() && tracker.Changed( constants ) && !tracker.Changed( target ) );
+    tracker.MarkRendered();
+
+    // Changing back is a change too, and so is a different size
+    value.color[3] = 0.0f;
+    CHECK( tracker.UpdateBytes( constants, &value, sizeof( value ) ) );
+    tracker.MarkRendered();
+    CHECK( tracker.UpdateBytes( constants, &value, sizeof( value.world ) ) );
+    tracker.MarkRendered();
+    CHECK( !tracker.Dirty() );
+}
+
+TEST_CASE( DamageTrackerFollowsGenerations )
+{
+    DamageTracker tracker;
+    const size_t target = tracker.AddInput( "target" );
+    const size_t windows = tracker.AddInput( "windows" );
+    tracker.UpdateGeneration( target, 7 );
+    tracker.UpdateGeneration( windows, 0 );
+    tracker.MarkRendered();
+
+    CHECK( !tracker.UpdateGeneration( target, 7 ) );
+    CHECK( tracker.UpdateGeneration( target, 8 ) );
+    CHECK( tracker.Changed( target ) && !tracker.Changed( windows ) );
+    tracker.MarkRendered();
+
+    tracker.Invalidate( windows );
+    CHECK( tracker.Changed( windows ) && !tracker.Changed( target ) );
+    tracker.MarkRendered();
+    tracker.InvalidateAll();
+    CHECK( tracker.Changed( windows ) && tracker.Changed( target ) );
+}
+
+TEST_CASE( DamageTrackerCountsFrames )
+{
+    DamageTracker tracker;
+    const size_t constants = tracker.AddInput( "constants" );
+    tracker.AddInput( "target" );
+    tracker.MarkRendered();
+    tracker.MarkSkipped();
+    tracker.MarkSkipped();
+    tracker.MarkSkipped();
+    tracker.Invalidate( constants );
+    tracker.MarkRendered();
+
+    CHECK( tracker.GetStats().rendered == 2 );
+    CHECK( tracker.GetStats().skipped == 3 );
+    CHECK( tracker.Format() == "Damage: 2 frames rendered, 3 skipped (60.0%); constants changed 1 times, target changed 0 times\n" );
+}
+
+TEST_CASE( ChangeSignalWakesWaiters )
+{
+    ChangeSignal signal;
+    const uint64_t seen = signal.Generation();
+    std::atomic<int> woken( 0 );
+    std::thread waiters[3];
+    for( std::thread& waiter : waiters )
+        waiter = std::thread( [&] { woken += signal.WaitForChange( seen ) ? 1 : 0; } );
+
+    signal.Notify();
+    for( std::thread& waiter : waiters )
+        waiter.join();
+    CHECK( woken == 3 );
+    CHECK( signal.Generation() == seen + 1 );
+
+    // A change made before the wait does not block it
+    CHECK( signal.WaitForChange( seen ) );
+}
+
+TEST_CASE( ChangeSignalCloseReleasesWaiters )
+{
+    ChangeSignal signal;
+    std::atomic<int> result( -1 );
+    std::thread waiter( [&] { result = signal.WaitForChange( signal.Generation() ) ? 1 : 0; } );
+    signal.Close();
+    waiter.join();
+    CHECK( result == 0 );
+    CHECK( !signal.WaitForChange( signal.Generation() ) );
+
+    signal.Reopen();
+    signal.Notify();
+    CHECK( signal.WaitForChange( 0 ) );
+}
+
+TEST_CASE( DamageDrivenLoopSleepsWhileClean )
+{
+    //? The render thread's loop: render when an input changed, otherwise sleep on the
+    //? signal. The main thread stands in for input handling.
+    ChangeSignal signal;
+    std::atomic<uint32_t> color( 0 );
+    std::atomic<uint64_t> rendered( 0 );
+    std::atomic<uint64_t> skipped( 0 );
+    std::thread renderThread( [&]
+    {
+        DamageTracker tracker;
+        const size_t constants = tracker.AddInput( "constants" );
+        const size_t events = tracker.AddInput( "events" );
+        for( ;; )
+        {
+            const uint64_t seen = signal.Generation();
+            const uint32_t value = color;
+            tracker.UpdateBytes( constants, &value, sizeof( value ) );
+            tracker.UpdateGeneration( events, seen );
+            if( tracker.Dirty() )
+            {
+                tracker.MarkRendered();
+                ++rendered;
+                continue;
+            }
+            tracker.MarkSkipped();
+            ++skipped;
+            if( !signal.WaitForChange( seen ) )
+                break;
+        }
+    } );
+
+    CHECK( WaitFor( [&] { return rendered == 1 && skipped == 1; } ) );
+    std::this_thread::sleep_for( std::chrono::milliseconds( 20 ) );
+    CHECK( rendered == 1 && skipped == 1 );
+
+    // An event that changes an input renders one frame; one that changes nothing the
+    // loop reads still renders once, as the events input moved
+    color = 0xff00ff00;
+    signal.Notify();
+    CHECK( WaitFor( [&] { return rendered == 2 && skipped == 2; } ) );
+    signal.Notify();
+    CHECK( WaitFor( [&] { return rendered == 3 && skipped == 3; } ) );
+    std::this_thread::sleep_for( std::chrono::milliseconds( 20 ) );
+    CHECK( rendered == 3 && skipped == 3 );
+
+    signal.Close();
+    renderThread.join();
+}
@@ -0,0 +1,188 @@
+//--------------------------------------------------------------------------------------
+// File: FrameLatencyTests.cpp
+//
+// SpscRing and the percentiles and counters of FrameLatencyTracker
+//--------------------------------------------------------------------------------------
+
+#include "TestHarness.h"
+#include "FrameLatency.h"
+
+#include <thread>
+
+
+namespace
+{
+    const uint64_t kMs = 1000000;
+
+    //? A frame whose end-to-end latency is 'ms', split 1:2:1 over the segments
+    FrameStamp StampOf( uint64_t frameId, uint64_t ms )
+    {
+        FrameStamp stamp;
+        stamp.frameId = frameId;
+        stamp.renderStart = frameId * 1000 * kMs;
+        stamp.submit = stamp.renderStart + ms * kMs / 4;
+        stamp.acquire = stamp.renderStart + ms * kMs * 3 / 4;
+        stamp.present = stamp.renderStart + ms * kMs;
+        return stamp;
+    }
+}
+
+TEST_CASE( SpscRingKeepsOrderAcrossTheWrap )
+{
+    static SpscRing<int, 4> ring;   // zeroed storage: GCC cannot see that TryPop() only reads pushed items
+    int value = 0;
+    CHECK( !ring.TryPop( value ) );
+
+    for( int round = 0; round < 3; ++round )
+    {
+        for( int i = 0; i < 4; ++i )
+            CHECK( ring.TryPush( round * 4 + i ) );
+        CHECK( !ring.TryPush( 99 ) );
+
+        for( int i = 0; i < 4; ++i )
+        {
+            CHECK( ring.TryPop( value ) );
+            CHECK( value == round * 4 + i );
+        }
+        CHECK( !ring.TryPop( value ) );
+    }
+}
+
+TEST_CASE( SpscRingHandsOverBetweenThreads )
+{
+    const int count = 200000;
+    SpscRing<int, 64> ring;
+
+    std::thread writer( [&ring]()
+    {
+        for( int i = 0; i < count; )
+        {
+            if( ring.TryPush( i ) )
+                ++i;
+            else
+                std::this_thread::yield();
+        }
+    } );
+
+    int expected = 0;
+    bool inOrder = true;
+    while( expected < count )
+    {
+        int value = 0;
+        if( !ring.TryPop( value ) )
+        {
+            std::this_thread::yield();
+            continue;
+        }
+        inOrder = inOrder && value == expected;
+        ++expected;
+    }
+    writer.join();
+    CHECK( inOrder );
+}
+
+TEST_CASE( LatencyPercentilesPickTheNearestRank )
+{
+    FrameLatencyTracker tracker;
+    for( uint64_t i = 1; i <= 100; ++i )
+        tracker.RecordPresented( StampOf( i, 101 - i ) );
+
+    const LatencyReport report = tracker.Report();
+    CHECK( report.samples == 100 );
+    CHECK( report.framesPresented == 100 );
+    CHECK( report.framesDropped == 0 );
+    CHECK( report.samplesLost == 0 );
+
+    // 1..100 ms: rank q * 99 rounded, of the sorted values
+    CHECK_NEAR( report.endToEnd.p50, 51.0, 1e-9 );
+    CHECK_NEAR( report.endToEnd.p95, 95.0, 1e-9 );
+    CHECK_NEAR( report.endToEnd.p99, 99.0, 1e-9 );
+    CHECK_NEAR( report.endToEnd.max, 100.0, 1e-9 );
+    CHECK_NEAR( report.producer.p50, 12.75, 1e-9 );
+    CHECK_NEAR( report.handoff.p50, 25.5, 1e-9 );
+    CHECK_NEAR( report.consumer.p50, 12.75, 1e-9 );
+}
+
+TEST_CASE( LatencyPercentilesOfNoSamplesAreZero )
+{
+    FrameLatencyTracker tracker;
+    const LatencyReport report = tracker.Report();
+    CHECK( report.samples == 0 );
+    CHECK( report.endToEnd.p50 == 0.0 );
+    CHECK( report.endToEnd.max == 0.0 );
+}
+
+TEST_CASE( LatencyCountsGapsAndIgnoresRepeats )
+{
+    FrameLatencyTracker tracker;
+    tracker.RecordPresented( StampOf( 1, 10 ) );
+    tracker.RecordPresented( StampOf( 2, 10 ) );
+    tracker.RecordPresented( StampOf( 2, 10 ) );    // re-presented stale frame
+    tracker.RecordPresented( StampOf( 5, 10 ) );    // 3 and 4 never shown
+    tracker.RecordPresented( StampOf( 4, 10 ) );    // older than the last one
+
+    const LatencyReport report = tracker.Report();
+    CHECK( report.framesPresented == 3 );
+    CHECK( report.framesDropped == 2 );
+    CHECK( report.samples == 3 );
+}
+
+TEST_CASE( LatencyLosesSamplesOnlyWhenTheRingIsFull )
+{
+    FrameLatencyTracker tracker;
+    const uint64_t frames = FrameLatencyTracker::kRingSize + 44;
+    for( uint64_t i = 1; i <= frames; ++i )
+        tracker.RecordPresented( StampOf( i, 5 ) );
+
+    LatencyReport report = tracker.Report();
+    CHECK( report.framesPresented == frames );
+    CHECK( report.samplesLost == 44 );
+    CHECK( report.samples == FrameLatencyTracker::kRingSize );
+
+    // Drained by Report(), so the ring takes the next ones again
+    tracker.RecordPresented( StampOf( frames + 1, 5 ) );
+    report = tracker.Report();
+    CHECK( report.samplesLost == 44 );
+    CHECK( report.samples == FrameLatencyTracker::kRingSize + 1 );
+}
+
+TEST_CASE( LatencyWindowKeepsTheNewestSamples )
+{
+    FrameLatencyTracker tracker;
+    uint64_t id = 0;
+
+    // A full window of 1 ms frames, then half a window of 3 ms ones
+    while( id < FrameLatencyTracker::kWindowSize )
+    {
+        tracker.RecordPresented( StampOf( ++id, 1 ) );
+        if( id % 128 == 0 )
+            tracker.Report();
+    }
+    for( size_t i = 0; i < FrameLatencyTracker::kWindowSize / 2 + 1; ++i )
+    {
+        tracker.RecordPresented( StampOf( ++id, 3 ) );
+        if( id % 128 == 0 )
+            tracker.Report();
+    }
+
+    const LatencyReport report = tracker.Report();
+    CHECK( report.samples == FrameLatencyTracker::kWindowSize );
+    CHECK( report.samplesLost == 0 );
+    CHECK_NEAR( report.endToEnd.p50, 3.0, 1e-9 );
+    CHECK_NEAR( report.endToEnd.max, 3.0, 1e-9 );
+}
+
+TEST_CASE( LatencyDumpsOncePerInterval )
+{
+    FrameLatencyTracker tracker;
+    tracker.SetDumpInterval( 100 );
+    tracker.RecordPresented( StampOf( 1, 4 ) );
+
+    std::string text;
+    CHECK( !tracker.DumpIfDue( 1000 * kMs, text ) );     // starts the interval
+    CHECK( !tracker.DumpIfDue( 1099 * kMs, text ) );
+    CHECK( tracker.DumpIfDue( 1100 * kMs, text ) );
+    CHECK( text.find( "1 samples" ) != std::string::npos );
+    CHECK( !tracker.DumpIfDue( 1150 * kMs, text ) );
+    CHECK( tracker.DumpIfDue( 1200 * kMs, text ) );
+}
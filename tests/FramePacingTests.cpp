@@ -0,0 +1,276 @@
+//--------------------------------------------------------------------------------------
+// File: FramePacingTests.cpp
+//
+// FramePacer against a simulated clock and display: time only moves when the pacer
+// sleeps or spins, or when a test says the frame's work took some
+//--------------------------------------------------------------------------------------
+
+#include "TestHarness.h"
+#include "FramePacing.h"
+
+#include <vector>
+
+
+namespace
+{
+    const uint64_t kMs = 1000000;
+    const uint64_t kVsync = 16666667;       // 60 Hz
+
+    //? Sleeps end on the next timer tick (if set) and then 'jitter' later; a pause takes 0.5 us
+    class FakeClock : public IPacingClock
+    {
+    public:
+        uint64_t    now = 1000 * kMs;
+        uint64_t    tick = 0;
+        uint64_t    jitter = 0;
+        uint64_t    sleeps = 0;
+        uint64_t    pauses = 0;
+
+        uint64_t Now() override { return now; }
+
+        void Sleep( uint64_t ns ) override
+        {
+            ++sleeps;
+            uint64_t wake = now + ns;
+            if( tick )
+                wake = ( wake + tick - 1 ) / tick * tick;
+            now = wake + ( jitter ? sleeps * 7919 % jitter : 0 );
+        }
+
+        void Pause() override
+        {
+            ++pauses;
+            now += 500;
+        }
+    };
+
+    //? A swap chain with room for maxLatency queued frames; one leaves the queue at every
+    //? vsync. Wait() jumps the clock to the vsync that frees a frame.
+    class FakeDisplay : public IFrameLatencyWaitable
+    {
+    public:
+        FakeDisplay( FakeClock& clock, uint64_t period, uint32_t maxLatency ) :
+            m_clock( clock ), m_period( period ), m_maxLatency( maxLatency ), m_lastVsync( clock.now / period * period ) {}
+
+        bool Wait( uint64_t timeoutNs ) override
+        {
+            Scanout();
+            const uint64_t start = m_clock.now;
+            while( queued >= m_maxLatency )
+            {
+                const uint64_t next = m_lastVsync + m_period;
+                if( next - start > timeoutNs )
+                {
+                    m_clock.now = start + timeoutNs;
+                    return false;
+                }
+                m_clock.now = next;
+                Scanout();
+            }
+            return true;
+        }
+
+        void Present()
+        {
+            Scanout();
+            ++queued;
+            maxQueued = queued > maxQueued ? queued : maxQueued;
+        }
+
+        uint32_t    queued = 0;
+        uint32_t    maxQueued = 0;
+        uint64_t    shown = 0;
+
+    private:
+        void Scanout()
+        {
+            while( m_lastVsync + m_period <= m_clock.now )
+            {
+                m_lastVsync += m_period;
+                if( queued )
+                {
+                    --queued;
+                    ++shown;
+                }
+            }
+        }
+
+        FakeClock&      m_clock;
+        const uint64_t  m_period;
+        const uint32_t  m_maxLatency;
+        uint64_t        m_lastVsync;
+    };
+
+    //? Runs 'frames' frames of 'workNs' each; returns the intervals between BeginFrame()
+    //? returns, in ns
+    std::vector<uint64_t> RunFrames( FramePacer& pacer, FakeClock& clock, int frames, uint64_t workNs,
+                                     FakeDisplay* display = nullptr )
+    {
+        IFrameLatencyWaitable* waitables[1] = { display };
+        std::vector<uint64_t> intervals;
+        uint64_t last = 0;
+        for( int frame = 0; frame < frames; ++frame )
+        {
+            pacer.BeginFrame( display ? waitables : nullptr, display ? 1 : 0 );
+            if( frame )
+                intervals.push_back( clock.now - last );
+            last = clock.now;
+            clock.now += workNs;
+            if( display )
+                display->Present();
+        }
+        return intervals;
+    }
+}
+
+TEST_CASE( FramePacerHoldsTheTargetRate )
+{
+    FakeClock clock;
+    clock.jitter = 300000;
+    FramePacingConfig config;
+    config.targetFps = 144;
+    FramePacer pacer( clock, config );
+
+    const std::vector<uint64_t> intervals = RunFrames( pacer, clock, 1000, 1500000 );
+    const uint64_t period = uint64_t( 1e9 / 144 + 0.5 );
+    bool onTime = true;
+    for( size_t i = 0; i < intervals.size(); ++i )
+        onTime = onTime && intervals[i] >= period - 500 && intervals[i] <= period + 500;
+    CHECK( onTime );
+
+    // Mostly asleep: spinning only covers what a sleep might overshoot
+    const FramePacer::Stats& stats = pacer.GetStats();
+    CHECK( stats.frames == 1000 );
+    CHECK( stats.lateFrames == 0 );
+    CHECK( stats.sleepMs > 3.0 * stats.spinMs );
+    CHECK( stats.maxOvershootMs < 0.001 );
+    CHECK_NEAR( pacer.FrameIntervals().MeanMs(), 1000.0 / 144, 0.001 );
+}
+
+TEST_CASE( FramePacerLearnsACoarseTimer )
+{
+    FakeClock clock;
+    clock.tick = 15625000;                  // the default Windows timer resolution
+    FramePacingConfig config;
+    config.targetFps = 60;
+    FramePacer pacer( clock, config );
+    CHECK( pacer.SleepEstimateNs() == config.initialSleepNs );
+
+    const std::vector<uint64_t> intervals = RunFrames( pacer, clock, 300, 2 * kMs );
+
+    // A 1 ms sleep takes up to a whole tick, and the estimate covers that
+    CHECK( pacer.SleepEstimateNs() > 10 * kMs );
+    CHECK( pacer.SleepEstimateNs() < 20 * kMs );
+
+    // The estimate is a mean plus a deviation, not a worst case: a sleep still runs past
+    // a deadline now and then, but most frames start on time and the rate holds
+    size_t onTime = 0;
+    uint64_t total = 0;
+    for( size_t i = 100; i < intervals.size(); ++i )
+    {
+        onTime += intervals[i] >= kVsync - 1000 && intervals[i] <= kVsync + 1000;
+        total += intervals[i];
+    }
+    CHECK( onTime * 10 >= ( intervals.size() - 100 ) * 8 );
+    CHECK_NEAR( double( total ) / double( intervals.size() - 100 ), double( kVsync ), 0.1 * kMs );
+    CHECK( pacer.GetStats().lateFrames == 0 );
+
+    // A finer timer brings the estimate back down
+    clock.tick = 0;
+    RunFrames( pacer, clock, 600, 2 * kMs );
+    CHECK( pacer.SleepEstimateNs() < 2 * kMs );
+}
+
+TEST_CASE( FramePacerRestartsAfterALateFrame )
+{
+    FakeClock clock;
+    FramePacingConfig config;
+    config.targetFps = 60;
+    FramePacer pacer( clock, config );
+
+    RunFrames( pacer, clock, 50, kMs );
+    pacer.BeginFrame();
+    clock.now += 100 * kMs;                 // a hitch of six frames
+    const std::vector<uint64_t> after = RunFrames( pacer, clock, 20, kMs );
+
+    // No burst of frames to catch up: the schedule starts over at the late frame
+    CHECK( pacer.GetStats().lateFrames == 1 );
+    bool paced = true;
+    for( uint64_t interval : after )
+        paced = paced && interval >= kVsync - 1000;
+    CHECK( paced );
+}
+
+TEST_CASE( FramePacerWaitsForTheSwapChain )
+{
+    FakeClock clock;
+    FakeDisplay display( clock, kVsync, 1 );
+    FramePacer pacer( clock, FramePacingConfig() );
+
+    // Without a target rate the waitable alone paces at the refresh rate, one frame queued
+    const std::vector<uint64_t> intervals = RunFrames( pacer, clock, 600, 3 * kMs, &display );
+    bool atVsync = true;
+    for( size_t i = 2; i < intervals.size(); ++i )
+        atVsync = atVsync && intervals[i] >= kVsync - 1 && intervals[i] <= kVsync + 1;
+    CHECK( atVsync );
+    CHECK( display.maxQueued == 1 );
+    CHECK( pacer.GetStats().latencyTimeouts == 0 );
+    CHECK( clock.sleeps == 0 && clock.pauses == 0 );
+    CHECK( pacer.GetStats().latencyWaitMs > 500 * 13.0 );
+}
+
+TEST_CASE( FramePacerCombinesVsyncAndTargetRate )
+{
+    FakeClock clock;
+    clock.jitter = 200000;
+    FakeDisplay display( clock, kVsync, 2 );
+    FramePacingConfig config;
+    config.targetFps = 40;                  // slower than the display
+    FramePacer pacer( clock, config );
+
+    const std::vector<uint64_t> intervals = RunFrames( pacer, clock, 400, 2 * kMs, &display );
+    uint64_t total = 0;
+    for( size_t i = 5; i < intervals.size(); ++i )
+        total += intervals[i];
+    CHECK_NEAR( double( total ) / double( intervals.size() - 5 ), 25.0 * kMs, 0.05 * kMs );
+    CHECK( display.maxQueued <= 2 );
+}
+
+TEST_CASE( FramePacerTimesOutOnAStuckSwapChain )
+{
+    FakeClock clock;
+    FakeDisplay stuck( clock, 1000000 * kMs, 1 );   // an occluded window never scans out
+    stuck.Present();
+    FramePacingConfig config;
+    FramePacer pacer( clock, config );
+
+    IFrameLatencyWaitable* waitables[2] = { &stuck, nullptr };
+    const uint64_t start = clock.now;
+    pacer.BeginFrame( waitables, 2 );
+    CHECK( pacer.GetStats().latencyTimeouts == 1 );
+    CHECK( clock.now - start == config.latencyTimeoutNs );
+    pacer.BeginFrame( waitables, 2 );
+    CHECK( pacer.GetStats().latencyTimeouts == 2 );
+    CHECK( pacer.Format().find( "2 latency timeouts" ) != std::string::npos );
+}
+
+TEST_CASE( FramePacerStopsThrottlingAtZeroFps )
+{
+    FakeClock clock;
+    FramePacingConfig config;
+    config.targetFps = 30;
+    FramePacer pacer( clock, config );
+    RunFrames( pacer, clock, 10, kMs );
+
+    pacer.SetTargetFps( 0.0 );
+    CHECK( pacer.TargetFps() == 0.0 );
+    const uint64_t sleeps = clock.sleeps;
+    const std::vector<uint64_t> intervals = RunFrames( pacer, clock, 10, kMs );
+    CHECK( clock.sleeps == sleeps );
+    CHECK( intervals.back() == kMs );
+
+    // A new rate starts a new schedule instead of counting the unthrottled frames late
+    pacer.SetTargetFps( 100.0 );
+    RunFrames( pacer, clock, 10, kMs );
+    CHECK( pacer.GetStats().lateFrames == 0 );
+}
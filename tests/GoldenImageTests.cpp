@@ -0,0 +1,165 @@
+//--------------------------------------------------------------------------------------
+// File: GoldenImageTests.cpp
+//
+// DiffImages against a per-pixel reference, the DDS files goldens are kept in, and a
+// GoldenSuite recording frames and then catching one that changed
+//--------------------------------------------------------------------------------------
+
+#include "TestHarness.h"
+#include "GoldenImage.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+
+
+namespace
+{
+    ReadbackFrame Frame( const std::vector<uint8_t>& pixels, uint32_t width, uint32_t height, uint64_t frameId = 1 )
+    {
+        ReadbackFrame frame;
+        frame.frameId = frameId;
+        frame.width = width;
+        frame.height = height;
+        frame.bytesPerPixel = 4;
+        frame.data = pixels.data();
+        frame.size = pixels.size();
+        return frame;
+    }
+
+    //? What DiffImages has to report, one channel at a time
+    ImageDiffResult ReferenceDiff( const std::vector<uint8_t>& image, const std::vector<uint8_t>& reference, const ImageDiffOptions& options )
+    {
+        const size_t pixels = image.size() / 4;
+        const int channels = options.compareAlpha ? 4 : 3;
+        uint64_t squared = 0;
+        ImageDiffResult result;
+        result.sizeMatches = true;
+        result.pixels = pixels;
+        for( size_t p = 0; p < pixels; ++p )
+        {
+            bool differs = false;
+            for( int c = 0; c < channels; ++c )
+            {
+                const uint32_t error = uint32_t( std::abs( int( image[p * 4 + c] ) - int( reference[p * 4 + c] ) ) );
+                squared += error * error;
+                result.maxError = std::max( result.maxError, error );
+                differs |= error > options.tolerance;
+            }
+            result.differing += differs ? 1 : 0;
+        }
+        result.mse = double( squared ) / ( double( pixels ) * channels );
+        return result;
+    }
+}
+
+TEST_CASE( GoldenImageDiffMatchesAPerPixelReference )
+{
+    //? Sizes that end in a partial 16-byte group, and edits from none to every byte
+    std::mt19937 random( 5 );
+    const uint32_t kSizes[][2] = { { 1, 1 }, { 3, 1 }, { 7, 3 }, { 64, 64 }, { 333, 77 } };
+    bool matches = true;
+    for( const uint32_t* size : kSizes )
+    {
+        const size_t bytes = size_t( size[0] ) * size[1] * 4;
+        for( int edit = 0; edit < 4; ++edit )
+        {
+            std::vector<uint8_t> image( bytes ), reference( bytes );
+            for( uint8_t& byte : reference )
+                byte = uint8_t( random() );
+            image = reference;
+            for( uint8_t& byte : image )
+            {
+                if( edit == 1 )
+                    byte = uint8_t( random() );
+                else if( edit == 2 && random() % 7 == 0 )
+                    byte = uint8_t( byte + int( random() % 5 ) - 2 );
+                else if( edit == 3 && random() % 50 == 0 )
+                    byte ^= 0x80;
+            }
+
+            for( bool alpha : { true, false } )
+            {
+                for( uint32_t tolerance : { 0u, 1u, 3u, 300u } )
+                {
+                    ImageDiffOptions options;
+                    options.compareAlpha = alpha;
+                    options.tolerance = tolerance;
+                    const ImageDiffResult actual = DiffImages( Frame( image, size[0], size[1] ), Frame( reference, size[0], size[1] ), options );
+                    const ImageDiffResult expected = ReferenceDiff( image, reference, options );
+                    matches &= actual.sizeMatches && actual.pixels == expected.pixels;
+                    matches &= actual.differing == expected.differing && actual.maxError == expected.maxError;
+                    matches &= std::fabs( actual.mse - expected.mse ) < 1e-9;
+                    matches &= expected.mse > 0.0 || std::isinf( actual.psnr );
+                }
+            }
+        }
+    }
+    CHECK( matches );
+}
+
+TEST_CASE( GoldenImageDiffReportsTheWorstCase )
+{
+    const std::vector<uint8_t> white( 64 * 64 * 4, 255 ), black( 64 * 64 * 4, 0 );
+    const ImageDiffResult result = DiffImages( Frame( white, 64, 64 ), Frame( black, 64, 64 ) );
+    CHECK( result.differing == 64 * 64 );
+    CHECK( result.maxError == 255 );
+    CHECK( result.mse == 255.0 * 255.0 );
+    CHECK_NEAR( result.psnr, 0.0, 1e-9 );
+
+    //? Same bytes, other shape
+    CHECK( !DiffImages( Frame( white, 32, 128 ), Frame( white, 64, 64 ) ).sizeMatches );
+}
+
+TEST_CASE( GoldenImageDDSRoundTrips )
+{
+    std::mt19937 random( 9 );
+    std::vector<uint8_t> first( 5 * 3 * 4 ), second( 5 * 3 * 4 );
+    for( uint8_t& byte : first )
+        byte = uint8_t( random() );
+    for( uint8_t& byte : second )
+        byte = uint8_t( random() );
+
+    const std::string path = TestOutputPath( "GoldenRoundTrip.dds" );
+    CHECK( WriteFramesDDS( path.c_str(), { Frame( first, 5, 3 ), Frame( second, 5, 3 ) } ) );
+
+    std::vector<uint8_t> pixels;
+    uint32_t width = 0, height = 0, count = 0;
+    CHECK( ReadFramesDDS( path.c_str(), pixels, &width, &height, &count ) );
+    CHECK( width == 5 && height == 3 && count == 2 );
+    CHECK( pixels.size() == first.size() * 2 && memcmp( pixels.data(), first.data(), first.size() ) == 0 &&
+           memcmp( pixels.data() + first.size(), second.data(), second.size() ) == 0 );
+
+    //? Slices of an array all have one size
+    CHECK( !WriteFramesDDS( TestOutputPath( "GoldenMixedSizes.dds" ).c_str(), { Frame( first, 5, 3 ), Frame( second, 3, 5 ) } ) );
+    CHECK( !ReadFramesDDS( TestOutputPath( "GoldenMissing.dds" ).c_str(), pixels, &width, &height, &count ) );
+}
+
+TEST_CASE( GoldenSuiteRecordsThenCatchesAChangedFrame )
+{
+    const std::string directory = TestOutputPath( "" );
+    std::vector<uint8_t> frames[3];
+    for( int i = 0; i < 3; ++i )
+        frames[i].assign( 16 * 8 * 4, uint8_t( 40 * i ) );
+
+    GoldenSuite record( directory, true );
+    for( uint64_t i = 0; i < 3; ++i )
+        CHECK( record.Check( "GoldenSuiteCase", i, Frame( frames[i], 16, 8, i + 1 ) ) );
+    CHECK( record.Finish() );
+
+    //? One pixel off by more than the thresholds allow, in frame 1 only
+    GoldenSuite check( directory, false );
+    std::vector<uint8_t> changed = frames[1];
+    changed[100] = uint8_t( changed[100] + 20 );
+    CHECK( check.Check( "GoldenSuiteCase", 0, Frame( frames[0], 16, 8, 1 ) ) );
+    CHECK( !check.Check( "GoldenSuiteCase", 1, Frame( changed, 16, 8, 2 ) ) );
+    CHECK( check.Check( "GoldenSuiteCase", 2, Frame( frames[2], 16, 8, 3 ) ) );
+    CHECK( !check.Finish() );
+
+    const GoldenSuite::CaseResult& result = check.Cases().at( "GoldenSuiteCase" );
+    CHECK( result.frames == 3 && result.failed == 1 && result.firstFailed == 1 );
+    CHECK( result.maxError == 20 );
+    CHECK( !result.missing );
+}
@@ -0,0 +1,241 @@
+//--------------------------------------------------------------------------------------
+// File: GpuProfilerTests.cpp
+//
+// GpuProfiler's query ring and statistics, on a backend with synthetic timestamps
+//--------------------------------------------------------------------------------------
+
+#include "TestHarness.h"
+#include "GpuProfiler.h"
+
+#include <map>
+#include <utility>
+
+
+namespace
+{
+    //? A GPU whose clock the test advances. Queries written in frame N complete once the
+    //? test has declared N done; 1 tick is 1 microsecond.
+    class SyntheticGpu : public ITimestampBackend
+    {
+    public:
+        uint64_t    clock = 0;
+        uint64_t    frame = 0;          // the frame queries are being written in
+        uint64_t    completed = 0;      // the last frame the GPU has finished
+        bool        nextDisjoint = false;
+        bool        failTimestamps = false;
+        size_t      written = 0;        // timestamps written so far
+
+        void BeginDisjoint( size_t slot ) override
+        {
+            m_disjoint[slot] = Query{ UINT64_MAX, nextDisjoint ? 1u : 0u };
+        }
+        void EndDisjoint( size_t slot ) override { m_disjoint[slot].frame = frame; }
+        void WriteTimestamp( size_t slot, size_t query ) override
+        {
+            m_timestamps[std::make_pair( slot, query )] = Query{ frame, clock };
+            ++written;
+        }
+
+        QueryResult GetDisjoint( size_t slot, uint64_t* frequency, bool* disjoint ) override
+        {
+            const Query& query = m_disjoint[slot];
+            if( query.frame > completed )
+                return QUERY_BUSY;
+            *frequency = 1000000;
+            *disjoint = query.value != 0;
+            return QUERY_OK;
+        }
+        QueryResult GetTimestamp( size_t slot, size_t index, uint64_t* ticks ) override
+        {
+            if( failTimestamps )
+                return QUERY_FAILED;
+            const Query& query = m_timestamps[std::make_pair( slot, index )];
+            if( query.frame > completed )
+                return QUERY_BUSY;
+            *ticks = query.value;
+            return QUERY_OK;
+        }
+
+    private:
+        struct Query
+        {
+            uint64_t    frame;
+            uint64_t    value;
+        };
+
+        std::map<size_t, Query>                         m_disjoint;
+        std::map<std::pair<size_t, size_t>, Query>      m_timestamps;
+    };
+
+    //? One frame: 100 us of clear, 500 + 250 us of draw in two scopes, 50 us of the rest
+    void ProfileFrame( GpuProfiler& profiler, SyntheticGpu& gpu, uint64_t frameId, size_t clear, size_t draw )
+    {
+        gpu.frame = frameId;
+        profiler.BeginFrame( frameId );
+        profiler.BeginScope( clear );
+        gpu.clock += 100;
+        profiler.EndScope( clear );
+        {
+            GpuProfileScope scope( &profiler, draw );
+            gpu.clock += 500;
+        }
+        profiler.BeginScope( draw );
+        gpu.clock += 250;
+        profiler.EndScope( draw );
+        gpu.clock += 50;
+        profiler.EndFrame();
+        gpu.clock += 1000;      // idle between frames
+    }
+}
+
+TEST_CASE( GpuProfilerSumsScopesPerFrame )
+{
+    SyntheticGpu gpu;
+    GpuProfiler profiler( gpu, 3, 4, 2, 8 );
+    const size_t clear = profiler.Scope( "clear" );
+    const size_t draw = profiler.Scope( "draw" );
+    CHECK( clear == 1 && draw == 2 );
+    CHECK( profiler.Scope( "clear" ) == clear );
+    CHECK( profiler.ScopeName( GpuProfiler::kFrameScope ) == "frame" );
+
+    for( uint64_t frame = 1; frame <= 20; ++frame )
+    {
+        gpu.completed = frame - 1;      // the GPU runs one frame behind
+        ProfileFrame( profiler, gpu, frame, clear, draw );
+        profiler.Resolve( frame );
+    }
+
+    const GpuProfiler::Stats& stats = profiler.GetStats();
+    CHECK( stats.droppedNoSlot == 0 && stats.droppedDisjoint == 0 && stats.droppedFailed == 0 );
+    CHECK( stats.framesResolved == 18 );    // frames 19 and 20 are not 2 frames old yet
+    CHECK( profiler.InFlight() == 2 );
+    CHECK_NEAR( profiler.ScopeTimer( clear ).MeanMs(), 0.1, 1e-9 );
+    CHECK_NEAR( profiler.ScopeTimer( draw ).MeanMs(), 0.75, 1e-9 );
+    CHECK_NEAR( profiler.ScopeTimer( GpuProfiler::kFrameScope ).MeanMs(), 0.9, 1e-9 );
+    CHECK( profiler.ScopeTimer( clear ).Count() == 18 );
+
+    const std::string text = profiler.Format();
+    CHECK( text.find( "GPU time: 18 frames resolved" ) == 0 );
+    CHECK( text.find( "draw" ) != std::string::npos );
+}
+
+TEST_CASE( GpuProfilerWaitsForBusyQueries )
+{
+    SyntheticGpu gpu;
+    GpuProfiler profiler( gpu, 4, 2, 1 );
+    const size_t draw = profiler.Scope( "draw" );
+    ProfileFrame( profiler, gpu, 1, draw, draw );
+
+    CHECK( profiler.Resolve( 1 ) == 0 );    // less than one frame old
+    CHECK( profiler.GetStats().queryBusy == 0 );
+    CHECK( profiler.Resolve( 2 ) == 0 );    // old enough, but the GPU is still busy
+    CHECK( profiler.GetStats().queryBusy == 1 );
+    CHECK( profiler.InFlight() == 1 );
+
+    gpu.completed = 1;
+    CHECK( profiler.Resolve( 3 ) == 1 );
+    CHECK( profiler.InFlight() == 0 );
+}
+
+TEST_CASE( GpuProfilerDropsDisjointAndFailedFrames )
+{
+    SyntheticGpu gpu;
+    GpuProfiler profiler( gpu, 2, 2, 0 );
+    const size_t draw = profiler.Scope( "draw" );
+    gpu.completed = 100;
+
+    gpu.nextDisjoint = true;
+    ProfileFrame( profiler, gpu, 1, draw, draw );
+    gpu.nextDisjoint = false;
+    profiler.Resolve( 1 );
+    CHECK( profiler.GetStats().droppedDisjoint == 1 );
+
+    gpu.failTimestamps = true;
+    ProfileFrame( profiler, gpu, 2, draw, draw );
+    profiler.Resolve( 2 );
+    CHECK( profiler.GetStats().droppedFailed == 1 );
+    gpu.failTimestamps = false;
+
+    // Both slots came back
+    CHECK( profiler.InFlight() == 0 );
+    CHECK( profiler.ScopeTimer( draw ).Count() == 0 );
+    ProfileFrame( profiler, gpu, 3, draw, draw );
+    ProfileFrame( profiler, gpu, 4, draw, draw );
+    CHECK( profiler.GetStats().droppedNoSlot == 0 );
+    CHECK( profiler.Resolve( 4 ) == 2 );
+}
+
+TEST_CASE( GpuProfilerSkipsFramesWhileTheRingIsFull )
+{
+    SyntheticGpu gpu;
+    GpuProfiler profiler( gpu, 3, 2, 1 );
+    const size_t draw = profiler.Scope( "draw" );
+
+    // The GPU stalls: three frames fill the ring, the fourth is not profiled
+    for( uint64_t frame = 1; frame <= 4; ++frame )
+    {
+        gpu.frame = frame;
+        CHECK( profiler.BeginFrame( frame ) == ( frame <= 3 ) );
+        const size_t written = gpu.written;
+        profiler.BeginScope( draw );
+        profiler.EndScope( draw );
+        CHECK( ( gpu.written == written ) == ( frame == 4 ) );
+        profiler.EndFrame();
+        profiler.Resolve( frame );
+    }
+    CHECK( profiler.GetStats().droppedNoSlot == 1 );
+    CHECK( profiler.InFlight() == 3 );
+
+    gpu.completed = 3;
+    CHECK( profiler.Resolve( 5 ) == 3 );
+    CHECK( profiler.BeginFrame( 5 ) );
+}
+
+TEST_CASE( GpuProfilerKeepsRoomToCloseNestedScopes )
+{
+    SyntheticGpu gpu;
+    GpuProfiler profiler( gpu, 2, 4, 0 );   // 10 timestamps per frame
+    const size_t draw = profiler.Scope( "draw" );
+    gpu.completed = 100;
+
+    // Sequential scopes: 4 pairs fit after the frame's begin, the 5th and 6th overflow
+    profiler.BeginFrame( 1 );
+    for( int i = 0; i < 6; ++i )
+    {
+        profiler.BeginScope( draw );
+        gpu.clock += 10;
+        profiler.EndScope( draw );
+    }
+    profiler.EndFrame();
+    CHECK( profiler.GetStats().scopesOverflowed == 2 );
+    CHECK( gpu.written == 10 );
+
+    // Nested scopes: the opens stop while there is still room for every close
+    gpu.written = 0;
+    profiler.BeginFrame( 2 );
+    for( int i = 0; i < 6; ++i )
+        profiler.BeginScope( draw );
+    gpu.clock += 10;
+    for( int i = 0; i < 6; ++i )
+        profiler.EndScope( draw );
+    profiler.EndFrame();
+    CHECK( profiler.GetStats().scopesOverflowed == 2 + 2 );
+    CHECK( gpu.written == 10 );
+
+    CHECK( profiler.Resolve( 2 ) == 2 );
+    CHECK_NEAR( profiler.ScopeTimer( draw ).LastMs(), 4 * 0.01, 1e-9 );
+}
+
+TEST_CASE( RollingTimerKeepsTheLastWindow )
+{
+    RollingTimer timer( 3 );
+    CHECK( timer.MeanMs() == 0.0 && timer.MinMs() == 0.0 && timer.MaxMs() == 0.0 );
+    timer.Add( 1.0 );
+    timer.Add( 2.0 );
+    timer.Add( 3.0 );
+    timer.Add( 10.0 );
+    CHECK( timer.Count() == 4 );
+    CHECK( timer.MinMs() == 2.0 && timer.MaxMs() == 10.0 );
+    CHECK_NEAR( timer.MeanMs(), 5.0, 1e-12 );
+    CHECK( timer.LastMs() == 10.0 );
+}
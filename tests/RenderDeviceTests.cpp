@@ -0,0 +1,177 @@
+//--------------------------------------------------------------------------------------
+// File: RenderDeviceTests.cpp
+//
+// Device and window lifecycle and the shared assets, on the null backend
+//--------------------------------------------------------------------------------------
+
+#include "TestHarness.h"
+#include "RenderDevice.h"
+#include "RenderThreads.h"
+
+#include <atomic>
+#include <cstring>
+
+
+namespace
+{
+    //? Compiles every entry point into 'size' bytes and counts the calls
+    ShaderCompileFn CountingCompiler( std::atomic<int>& calls, size_t size, bool ok = true )
+    {
+        return [&calls, size, ok]( const char*, const char*, const char*, std::vector<uint8_t>& bytecode )
+        {
+            ++calls;
+            bytecode.assign( size, 0xcc );
+            return ok;
+        };
+    }
+
+    RenderWindowDesc WindowDesc( const char* name, size_t program, uint32_t width, uint32_t height )
+    {
+        RenderWindowDesc desc;
+        desc.name = name;
+        desc.program = program;
+        desc.width = width;
+        desc.height = height;
+        desc.offscreen = true;
+        return desc;
+    }
+}
+
+TEST_CASE( NullDeviceOwnsItsWindows )
+{
+    SharedRenderAssets assets;
+    const size_t program = assets.AddProgram( "A", "" );
+    std::unique_ptr<RenderDevice> device = CreateNullRenderDevice( assets );
+    CHECK( device->Create() );
+    CHECK( strcmp( device->BackendName(), "Null" ) == 0 );
+    CHECK( &device->Assets() == &assets );
+
+    RenderWindow* first = device->CreateRenderWindow( WindowDesc( "first", program, 64, 32 ) );
+    RenderWindow* second = device->CreateRenderWindow( WindowDesc( "second", program, 16, 16 ) );
+    CHECK( first && second );
+    CHECK( device->WindowCount() == 2 );
+    CHECK( device->CreateRenderWindow( WindowDesc( "unknown", program + 1, 8, 8 ) ) == nullptr );
+    CHECK( device->WindowCount() == 2 );
+
+    device->DestroyRenderWindow( first );
+    CHECK( device->WindowCount() == 1 );
+    CHECK( device->Window( 0 ) == second );
+    CHECK( second->Desc().name == "second" );
+
+    device->DestroyAllWindows();
+    CHECK( device->WindowCount() == 0 );
+}
+
+TEST_CASE( NullWindowClearsAndReadsBack )
+{
+    SharedRenderAssets assets;
+    std::unique_ptr<RenderDevice> device = CreateNullRenderDevice( assets );
+    device->Create();
+
+    RenderWindowDesc desc = WindowDesc( "A", assets.AddProgram( "A", "" ), 4, 2 );
+    const float clear[4] = { 1.0f, 0.0f, 0.5f, 2.0f };     // alpha clamps to 1
+    memcpy( desc.clearColor, clear, sizeof( clear ) );
+    RenderWindow* window = device->CreateRenderWindow( desc );
+    CHECK( window->Offscreen() );
+    CHECK( window->Width() == 4 && window->Height() == 2 );
+    CHECK( window->Stats().gpuBytes == 2 * 4 * 2 * sizeof( uint32_t ) + sizeof( FrameConstants ) );
+
+    std::unique_ptr<IStagingBackend> readback = window->CreateReadback( 2 );
+    window->BeginFrame();
+    window->UpdateFrameConstants( FrameConstants() );
+    window->DrawQuad();
+    window->Present();
+    CHECK( window->FramesPresented() == 1 );
+
+    CHECK( readback->IssueCopy( 1 ) );
+    const uint8_t* data = nullptr;
+    size_t rowPitch = 0;
+    CHECK( readback->TryMap( 1, &data, &rowPitch ) == IStagingBackend::MAP_OK );
+    CHECK( rowPitch == 4 * 4 );
+    const uint8_t expected[4] = { 255, 0, 128, 255 };
+    CHECK( memcmp( data, expected, 4 ) == 0 );
+    CHECK( memcmp( data + rowPitch * 2 - 4, expected, 4 ) == 0 );
+    readback->Unmap( 1 );
+}
+
+TEST_CASE( NullWindowResizeCountsProjectionUpdates )
+{
+    SharedRenderAssets assets;
+    std::unique_ptr<RenderDevice> device = CreateNullRenderDevice( assets );
+    device->Create();
+    RenderWindow* window = device->CreateRenderWindow( WindowDesc( "A", assets.AddProgram( "A", "" ), 64, 32 ) );
+
+    CHECK( window->Resize( 0, 0 ) );            // minimized: keeps its targets
+    CHECK( window->Resize( 64, 32 ) );          // same size
+    CHECK( window->Stats().resizes == 0 );
+    CHECK( window->Width() == 64 );
+
+    CHECK( window->Resize( 128, 64 ) );         // same aspect
+    CHECK( window->Stats().resizes == 1 );
+    CHECK( window->Stats().projectionUpdates == 0 );
+
+    CHECK( window->Resize( 100, 100 ) );
+    CHECK( window->Stats().resizes == 2 );
+    CHECK( window->Stats().projectionUpdates == 1 );
+    CHECK( window->Width() == 100 && window->Height() == 100 );
+    CHECK( window->Stats().gpuBytes == 2 * 100 * 100 * sizeof( uint32_t ) + sizeof( FrameConstants ) );
+
+    const std::string text = FormatRenderDeviceStats( *device );
+    CHECK( text.find( "Null device" ) == 0 );
+    CHECK( text.find( "window 'A' 100x100" ) != std::string::npos );
+    CHECK( text.find( "resized 2 times (1 projection updates)" ) != std::string::npos );
+}
+
+TEST_CASE( SharedAssetsCompileEachStageOnce )
+{
+    SharedRenderAssets assets;
+    const size_t program = assets.AddProgram( "A", "source" );
+    CHECK( assets.ProgramCount() == 1 );
+    CHECK( assets.Vertices().size() == 4 && assets.Indices().size() == 6 );
+    const uint64_t geometryBytes = assets.Bytes();
+    CHECK( geometryBytes == 4 * sizeof( QuadVertex ) + 6 * sizeof( uint16_t ) );
+
+    std::atomic<int> calls( 0 );
+    const ShaderCompileFn compile = CountingCompiler( calls, 100 );
+    const std::vector<uint8_t>* vertex = assets.Bytecode( program, SHADER_STAGE_VERTEX, compile );
+    CHECK( vertex && vertex->size() == 100 );
+    CHECK( assets.Bytecode( program, SHADER_STAGE_VERTEX, compile ) == vertex );
+    CHECK( calls == 1 );
+    CHECK( assets.Bytes() == geometryBytes + 100 );
+
+    assets.Bytecode( program, SHADER_STAGE_PIXEL, compile );
+    CHECK( calls == 2 );
+    CHECK( assets.Bytes() == geometryBytes + 200 );
+}
+
+TEST_CASE( SharedAssetsReportFailedCompiles )
+{
+    SharedRenderAssets assets;
+    const size_t program = assets.AddProgram( "A", "source" );
+
+    std::atomic<int> calls( 0 );
+    CHECK( assets.Bytecode( program, SHADER_STAGE_PIXEL, CountingCompiler( calls, 10, false ) ) == nullptr );
+    CHECK( assets.Bytecode( program, SHADER_STAGE_PIXEL, CountingCompiler( calls, 10 ) ) == nullptr );   // not retried
+    CHECK( calls == 1 );
+    CHECK( assets.Bytecode( program + 1, SHADER_STAGE_PIXEL, CountingCompiler( calls, 10 ) ) == nullptr );
+    CHECK( calls == 1 );
+}
+
+TEST_CASE( SharedAssetsPrefetchOnThePool )
+{
+    SharedRenderAssets assets;
+    assets.AddProgram( "A", "a" );
+    assets.AddProgram( "B", "b" );
+    assets.AddProgram( "C", "c" );
+
+    std::atomic<int> calls( 0 );
+    const ShaderCompileFn compile = CountingCompiler( calls, 8 );
+    {
+        WorkerPool pool( 2 );
+        assets.PrefetchAll( compile, pool );
+        assets.PrefetchAll( compile, pool );    // already requested
+        for( size_t i = 0; i < assets.ProgramCount(); ++i )
+            CHECK( assets.Bytecode( i, SHADER_STAGE_PIXEL, compile ) != nullptr );
+    }
+    CHECK( calls == 6 );
+}
@@ -0,0 +1,216 @@
+//--------------------------------------------------------------------------------------
+// File: RenderTargetPoolTests.cpp
+//
+// RenderTargetPool reuse, bucketing and eviction, with an allocator that only keeps
+// track of which entries hold a target
+//--------------------------------------------------------------------------------------
+
+#include "TestHarness.h"
+#include "RenderTargetPool.h"
+
+#include <random>
+#include <set>
+
+
+namespace
+{
+    //? 4 bytes per pixel; flags creating an entry that is already live
+    class TrackingAllocator : public IRenderTargetAllocator
+    {
+    public:
+        std::set<size_t>    live;
+        uint64_t            creates = 0;
+        uint64_t            misuse = 0;     // creates of live entries, destroys of dead ones
+        bool                fail = false;
+
+        bool CreateTarget( size_t entry, const RenderTargetKey& key, uint64_t* bytes ) override
+        {
+            if( fail )
+                return false;
+            misuse += !live.insert( entry ).second;
+            *bytes = uint64_t( key.width ) * key.height * 4;
+            ++creates;
+            return true;
+        }
+
+        void DestroyTarget( size_t entry ) override
+        {
+            misuse += live.erase( entry ) == 0;
+        }
+    };
+
+    RenderTargetKey Key( uint32_t width, uint32_t height, uint32_t format = 28, uint32_t bindFlags = 32 )
+    {
+        RenderTargetKey key;
+        key.width = width;
+        key.height = height;
+        key.format = format;
+        key.bindFlags = bindFlags;
+        return key;
+    }
+
+    const uint64_t kMB = 1024 * 1024;
+}
+
+TEST_CASE( BucketTargetSizeRoundsUpByAnEighth )
+{
+    CHECK( BucketTargetSize( 0 ) == 0 );
+    CHECK( BucketTargetSize( 1 ) == 32 );
+    CHECK( BucketTargetSize( 32 ) == 32 );
+    CHECK( BucketTargetSize( 33 ) == 64 );
+    CHECK( BucketTargetSize( 600 ) == 640 );
+    CHECK( BucketTargetSize( 801 ) == 832 );
+    CHECK( BucketTargetSize( 1080 ) == 1152 );
+    CHECK( BucketTargetSize( 1920 ) == 1920 );
+    CHECK( BucketTargetSize( UINT32_MAX ) == UINT32_MAX );
+
+    bool covers = true, tight = true, stable = true;
+    for( uint32_t size = 1; size < 100000; ++size )
+    {
+        const uint32_t bucket = BucketTargetSize( size );
+        covers = covers && bucket >= size;
+        tight = tight && ( size < 256 || bucket - size <= size / 8 + 1 );
+        stable = stable && BucketTargetSize( bucket ) == bucket;
+    }
+    CHECK( covers );
+    CHECK( tight );
+    CHECK( stable );
+}
+
+TEST_CASE( RenderTargetPoolReusesAcrossADragResize )
+{
+    TrackingAllocator allocator;
+    RenderTargetPool pool( allocator, 16 * kMB );
+
+    size_t entry = pool.Acquire( Key( 800, 600 ), true );
+    CHECK( pool.Key( entry ).width == 832 && pool.Key( entry ).height == 640 );
+    for( uint32_t width = 801; width < 830; ++width )
+    {
+        pool.Release( entry );
+        entry = pool.Acquire( Key( width, 600 + ( width - 800 ) / 2 ), true );
+    }
+    CHECK( allocator.creates == 1 );
+    CHECK( pool.GetStats().reused == 29 );
+    CHECK( pool.LiveCount() == 1 && pool.FreeCount() == 0 );
+}
+
+TEST_CASE( RenderTargetPoolMatchesTheWholeKey )
+{
+    TrackingAllocator allocator;
+    RenderTargetPool pool( allocator, 64 * kMB );
+
+    const size_t color = pool.Acquire( Key( 800, 600 ) );
+    pool.Release( color );
+    CHECK( pool.Acquire( Key( 800, 600, 29 ) ) != color );         // other format
+    CHECK( pool.Acquire( Key( 800, 600, 28, 8 ) ) != color );      // other bind flags
+    CHECK( pool.Acquire( Key( 800, 600 ), true ) != color );        // bucketed: 832x640
+    CHECK( pool.Acquire( Key( 800, 600 ) ) == color );
+    CHECK( allocator.creates == 4 );
+}
+
+TEST_CASE( RenderTargetPoolTogglesBetweenTwoSizes )
+{
+    TrackingAllocator allocator;
+    RenderTargetPool pool( allocator, 16 * kMB );
+
+    // Windowed and fullscreen, back and forth: two targets, ever
+    size_t entry = pool.Acquire( Key( 800, 600 ) );
+    for( int i = 0; i < 10; ++i )
+    {
+        pool.Release( entry );
+        entry = pool.Acquire( i % 2 ? Key( 800, 600 ) : Key( 1920, 1080 ) );
+    }
+    CHECK( allocator.creates == 2 );
+    CHECK( pool.GetStats().liveBytes == 800 * 600 * 4 );
+    CHECK( pool.GetStats().freeBytes == 1920 * 1080 * 4 );
+    CHECK( pool.GetStats().peakBytes == 800 * 600 * 4 + 1920 * 1080 * 4 );
+}
+
+TEST_CASE( RenderTargetPoolEvictsTheLeastRecentlyReleased )
+{
+    TrackingAllocator allocator;
+    RenderTargetPool pool( allocator, 10 * kMB );      // two and a half 1000x1000 targets
+
+    std::vector<size_t> entries;
+    for( uint32_t i = 0; i < 5; ++i )
+        entries.push_back( pool.Acquire( Key( 1000 + i, 1000 ) ) );
+    for( size_t entry : entries )
+        pool.Release( entry );
+
+    CHECK( pool.GetStats().freeBytes <= 10 * kMB );
+    CHECK( pool.GetStats().evicted == 3 );
+    CHECK( pool.FreeCount() == 2 );
+
+    const uint64_t creates = allocator.creates;
+    pool.Release( pool.Acquire( Key( 1004, 1000 ) ) );     // released last: kept
+    CHECK( allocator.creates == creates );
+    pool.Release( pool.Acquire( Key( 1000, 1000 ) ) );     // released first: evicted
+    CHECK( allocator.creates == creates + 1 );
+
+    pool.Trim( 0 );
+    CHECK( pool.FreeCount() == 0 && pool.GetStats().freeBytes == 0 );
+    CHECK( allocator.live.empty() );
+    CHECK( allocator.misuse == 0 );
+}
+
+TEST_CASE( RenderTargetPoolSurvivesAllocatorFailures )
+{
+    TrackingAllocator allocator;
+    {
+        RenderTargetPool pool( allocator, 16 * kMB );
+        allocator.fail = true;
+        CHECK( pool.Acquire( Key( 64, 64 ) ) == RenderTargetPool::kInvalidEntry );
+        CHECK( pool.GetStats().failed == 1 );
+        allocator.fail = false;
+
+        const size_t entry = pool.Acquire( Key( 64, 64 ) );
+        CHECK( entry != RenderTargetPool::kInvalidEntry );
+        pool.Release( 12345 );      // unknown and double releases are ignored
+        pool.Release( entry );
+        pool.Release( entry );
+        CHECK( pool.FreeCount() == 1 );
+        CHECK( pool.GetStats().freeBytes == 64 * 64 * 4 );
+        CHECK( pool.Format().find( "Target pool: 2 acquires, 0 reused, 1 created" ) == 0 );
+    }
+    CHECK( allocator.live.empty() );    // the pool destroys what it still holds
+    CHECK( allocator.misuse == 0 );
+}
+
+TEST_CASE( RenderTargetPoolStaysConsistentUnderChurn )
+{
+    TrackingAllocator allocator;
+    std::mt19937 random( 3 );
+    bool consistent = true;
+    {
+        RenderTargetPool pool( allocator, 5 * kMB );
+        std::vector<size_t> held;
+        for( int i = 0; i < 20000 && consistent; ++i )
+        {
+            if( held.empty() || random() % 2 )
+            {
+                const RenderTargetKey key = Key( 100 + random() % 900, 100 + random() % 700, random() % 2 );
+                const size_t entry = pool.Acquire( key, random() % 2 != 0 );
+                for( size_t other : held )
+                    consistent = consistent && other != entry;
+                held.push_back( entry );
+                if( held.size() > 6 )
+                {
+                    pool.Release( held.front() );
+                    held.erase( held.begin() );
+                }
+            }
+            else
+            {
+                const size_t index = random() % held.size();
+                pool.Release( held[index] );
+                held.erase( held.begin() + ptrdiff_t( index ) );
+            }
+
+            consistent = consistent && pool.GetStats().freeBytes <= 5 * kMB && pool.LiveCount() == held.size() &&
+                         allocator.live.size() == pool.LiveCount() + pool.FreeCount();
+        }
+    }
+    CHECK( consistent );
+    CHECK( allocator.live.empty() );
+    CHECK( allocator.misuse == 0 );
+}
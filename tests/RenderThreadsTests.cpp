@@ -0,0 +1,181 @@
+//--------------------------------------------------------------------------------------
+// File: RenderThreadsTests.cpp
+//
+// BoundedQueue, RenderThread and the slot ring render threads A and B hand frames
+// through
+//--------------------------------------------------------------------------------------
+
+#include "TestHarness.h"
+#include "RenderThreads.h"
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+
+TEST_CASE( BoundedQueueBlocksWhenFull )
+{
+    BoundedQueue<int> queue( 2 );
+    bool waited = true;
+    CHECK( queue.Push( 1, &waited ) && !waited );
+    CHECK( queue.Push( 2 ) );
+    CHECK( queue.Size() == 2 );
+
+    // A third push waits for a pop
+    std::atomic<bool> pushed( false );
+    std::thread producer( [&]() { pushed = queue.Push( 3, &waited ); } );
+    std::this_thread::sleep_for( std::chrono::milliseconds( 10 ) );
+    CHECK( !pushed );
+    int value = 0;
+    CHECK( queue.Pop( value ) && value == 1 );
+    producer.join();
+    CHECK( pushed && waited );
+    CHECK( queue.Pop( value ) && value == 2 );
+    CHECK( queue.TryPop( value ) && value == 3 );
+    CHECK( !queue.TryPop( value ) );
+
+    // Close fails both sides and drops what is queued; Reopen starts empty
+    queue.Push( 4 );
+    queue.Close();
+    CHECK( !queue.Pop( value ) && !queue.Push( 5 ) );
+    queue.Reopen();
+    CHECK( queue.Size() == 0 && queue.Push( 6 ) );
+}
+
+TEST_CASE( FrameSlotRingHandsEveryFrameOverInOrder )
+{
+    //? A and B on render threads of their own, as in threaded mode. Each slot carries
+    //? the number of the frame written into it.
+    const int kFrames = 20000;
+    FrameSlotRing ring( 3 );
+    std::vector<int> frameIn( ring.SlotCount(), 0 );
+    std::atomic<int> lastRead( 0 );
+    int written = 0;
+    bool bounded = true;
+    bool ordered = true;
+
+    RenderThread producer;
+    RenderThread consumer;
+    producer.Start( [&]()
+    {
+        size_t slot = 0;
+        if( !ring.AcquireForWrite( slot ) )
+            return false;
+        bounded = bounded && written - lastRead < int( ring.SlotCount() );
+        frameIn[slot] = ++written;
+        ring.Publish( slot );
+        return written < kFrames;
+    } );
+    consumer.Start( [&]()
+    {
+        size_t slot = 0;
+        if( !ring.AcquireForRead( slot ) )
+            return false;
+        ordered = ordered && frameIn[slot] == lastRead + 1;
+        lastRead = frameIn[slot];
+        ring.Release( slot );
+        return lastRead < kFrames;
+    } );
+    producer.Join();
+    consumer.Join();
+
+    CHECK( ordered && bounded );
+    CHECK( lastRead == kFrames );
+    CHECK( producer.Frames() == uint64_t( kFrames - 1 ) );
+    const FrameSlotRing::Stats stats = ring.GetStats();
+    CHECK( stats.published == uint64_t( kFrames ) && stats.consumed == uint64_t( kFrames ) );
+}
+
+TEST_CASE( RenderThreadStopsOnRequest )
+{
+    FrameSlotRing ring( 2 );
+    RenderThread consumer;
+    CHECK( !consumer.Running() );
+
+    // Blocked in the ring: stopping takes RequestStop() and Close()
+    consumer.Start( [&]()
+    {
+        size_t slot = 0;
+        if( !ring.AcquireForRead( slot ) )
+            return false;
+        ring.Release( slot );
+        return true;
+    } );
+    CHECK( consumer.Running() );
+    size_t slot = 0;
+    CHECK( ring.AcquireForWrite( slot ) );
+    ring.Publish( slot );
+    for( int i = 0; i < 1000 && consumer.Frames() < 1; ++i )
+        std::this_thread::sleep_for( std::chrono::milliseconds( 1 ) );
+    CHECK( consumer.Frames() == 1 );
+
+    consumer.RequestStop();
+    ring.Close();
+    consumer.Join();
+    CHECK( !consumer.Running() );
+    CHECK( consumer.Frames() <= 2 );
+}
+
+TEST_CASE( FrameSlotRingDrainsForAResize )
+{
+    FrameSlotRing ring( 3 );
+    std::atomic<int> consumed( 0 );
+    std::atomic<bool> consumerDone( false );
+
+    // B takes its time with every frame, like a consumer presenting with vsync
+    std::thread consumer( [&]()
+    {
+        size_t slot = 0;
+        while( ring.AcquireForRead( slot ) )
+        {
+            std::this_thread::sleep_for( std::chrono::milliseconds( 5 ) );
+            ring.Release( slot );
+            ++consumed;
+        }
+        consumerDone = true;
+    } );
+
+    for( int frame = 0; frame < 3; ++frame )
+    {
+        size_t slot = 0;
+        CHECK( ring.AcquireForWrite( slot ) );
+        ring.Publish( slot );
+    }
+
+    // A drains between frames: every slot given back, and B now waits for a publish
+    CHECK( ring.WaitDrained() );
+    CHECK( ring.GetStats().consumed == 3 );
+    std::this_thread::sleep_for( std::chrono::milliseconds( 10 ) );
+    CHECK( consumed == 3 && !consumerDone );
+
+    // With the surfaces recreated, the handoff goes on
+    size_t slot = 0;
+    CHECK( ring.AcquireForWrite( slot ) );
+    ring.Publish( slot );
+    CHECK( ring.WaitDrained() );
+    CHECK( ring.GetStats().consumed == 4 );
+
+    ring.Close();
+    consumer.join();
+    CHECK( consumerDone );
+}
+
+TEST_CASE( FrameSlotRingCloseEndsAWaitForDrain )
+{
+    FrameSlotRing ring( 2 );
+    size_t slot = 0;
+    CHECK( ring.WaitDrained() );        // nothing held
+    CHECK( ring.AcquireForWrite( slot ) );
+    ring.Publish( slot );               // never released: B is gone
+
+    std::atomic<bool> drained( true );
+    std::thread producer( [&]() { drained = ring.WaitDrained(); } );
+    std::this_thread::sleep_for( std::chrono::milliseconds( 10 ) );
+    ring.Close();
+    producer.join();
+    CHECK( !drained );
+
+    ring.Reset();
+    CHECK( ring.WaitDrained() );
+}
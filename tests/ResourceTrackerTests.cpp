@@ -0,0 +1,222 @@
+//--------------------------------------------------------------------------------------
+// File: ResourceTrackerTests.cpp
+//
+// ResourceTracker and DiffResourceSnapshots behind a mock device whose objects are
+// reference counted the way COM objects are
+//--------------------------------------------------------------------------------------
+
+#include "TestHarness.h"
+#include "ResourceTracker.h"
+
+#include <memory>
+#include <thread>
+#include <vector>
+
+
+namespace
+{
+    class MockDevice;
+
+    //? The last Release() destroys the object, which removes its record, as a D3D11
+    //? resource's private data does
+    class MockResource
+    {
+    public:
+        MockResource( MockDevice& device ) : m_device( device ) {}
+
+        uint32_t AddRef() { return ++m_refs; }
+        uint32_t Release();
+
+    private:
+        MockDevice& m_device;
+        uint32_t    m_refs = 1;
+    };
+
+    class MockDevice : public IResourceRefCounts
+    {
+    public:
+        MockDevice() : tracker( std::make_shared<ResourceTracker>( this ) ) {}
+        ~MockDevice() override { tracker->SetRefCounts( nullptr ); }
+
+        MockResource* Create( const char* owner, uint64_t bytes, ResourceKind kind = RESOURCE_TEXTURE )
+        {
+            MockResource* resource = new MockResource( *this );
+            tracker->Add( resource, kind, owner, bytes );
+            return resource;
+        }
+
+        //? What the D3D11 tracker does: a reference taken and dropped again
+        uint32_t RefCount( const void* object ) override
+        {
+            MockResource* resource = const_cast<MockResource*>( static_cast<const MockResource*>( object ) );
+            resource->AddRef();
+            return resource->Release();
+        }
+
+        std::shared_ptr<ResourceTracker> tracker;
+    };
+
+    uint32_t MockResource::Release()
+    {
+        const uint32_t refs = --m_refs;
+        if( !refs )
+        {
+            m_device.tracker->Remove( this );
+            delete this;
+        }
+        return refs;
+    }
+
+    const uint64_t kBackBufferBytes = 800 * 600 * 4;
+}
+
+TEST_CASE( ResourceTrackerRecordsLiveResources )
+{
+    MockDevice device;
+    MockResource* backBuffer = device.Create( "A back buffer", kBackBufferBytes );
+    MockResource* constants = device.Create( "A constants", 256, RESOURCE_BUFFER );
+
+    // The first record stands
+    CHECK( !device.tracker->Add( backBuffer, RESOURCE_BUFFER, "someone else", 1 ) );
+    CHECK( device.tracker->Contains( backBuffer ) );
+    ResourceTracker::Stats stats = device.tracker->GetStats();
+    CHECK( stats.recorded == 2 && stats.liveCount == 2 && stats.liveBytes == kBackBufferBytes + 256 );
+
+    device.tracker->SetFrame( 10 );
+    const ResourceSnapshot snapshot = device.tracker->Snapshot();
+    CHECK( snapshot.frame == 10 && snapshot.bytes == kBackBufferBytes + 256 );
+    CHECK( snapshot.resources.size() == 2 );
+    CHECK( snapshot.resources[0].object == backBuffer && snapshot.resources[0].owner == "A back buffer" );
+    CHECK( snapshot.resources[0].refCount == 1 && snapshot.resources[0].frame == 0 );
+    CHECK( snapshot.resources[1].kind == RESOURCE_BUFFER && snapshot.resources[1].id > snapshot.resources[0].id );
+
+    // Largest owner first
+    CHECK( device.tracker->FormatLive() ==
+           "Resources: 2 owners, 1.83 MB live\n"
+           "  A back buffer               1 resources,       1.83 MB\n"
+           "  A constants                 1 resources,       0.00 MB\n" );
+
+    constants->Release();
+    backBuffer->Release();
+    stats = device.tracker->GetStats();
+    CHECK( stats.removed == 2 && stats.liveCount == 0 && stats.liveBytes == 0 );
+    CHECK( stats.peakBytes == kBackBufferBytes + 256 );
+    CHECK( device.tracker->FormatLive().empty() );
+    CHECK( !device.tracker->Remove( backBuffer ) );
+}
+
+TEST_CASE( ResourceDiffIgnoresSteadyChurn )
+{
+    MockDevice device;
+    MockResource* backBuffer = device.Create( "A back buffer", kBackBufferBytes );
+    device.tracker->SetFrame( 10 );
+    const ResourceSnapshot before = device.tracker->Snapshot();
+
+    // A scratch texture created and released every frame
+    for( uint64_t frame = 11; frame <= 20; ++frame )
+    {
+        device.tracker->SetFrame( frame );
+        device.Create( "A scratch", 1024 )->Release();
+    }
+    const ResourceDiff diff = DiffResourceSnapshots( before, device.tracker->Snapshot() );
+    CHECK( !diff.Grew() );
+    CHECK( diff.frames == 10 && diff.bytes == 0 );
+    CHECK( diff.created.empty() && diff.destroyed.empty() && diff.refGrowth.empty() && diff.owners.empty() );
+
+    backBuffer->Release();
+}
+
+TEST_CASE( ResourceDiffFindsLeakedReferences )
+{
+    MockDevice device;
+    MockResource* backBuffer = device.Create( "A back buffer", kBackBufferBytes );
+    device.tracker->SetFrame( 20 );
+    const ResourceSnapshot before = device.tracker->Snapshot();
+
+    // A GetBuffer() every frame without its Release()
+    for( uint64_t frame = 21; frame <= 30; ++frame )
+        backBuffer->AddRef();
+    device.tracker->SetFrame( 30 );
+    const ResourceDiff diff = DiffResourceSnapshots( before, device.tracker->Snapshot() );
+    CHECK( diff.Grew() && diff.bytes == 0 );
+    CHECK( diff.refGrowth.size() == 1 );
+    CHECK( diff.refGrowth[0].refsBefore == 1 && diff.refGrowth[0].resource.refCount == 11 );
+    CHECK( diff.Format() ==
+           "Resource changes over 10 frames: 0 created, 0 destroyed, +0.00 MB, 1 gained references\n"
+           "  A back buffer            texture #1: 1 -> 11 references\n" );
+
+    for( int i = 0; i < 11; ++i )
+        backBuffer->Release();
+    CHECK( device.tracker->GetStats().liveCount == 0 );
+}
+
+TEST_CASE( ResourceDiffFindsLeakedResources )
+{
+    MockDevice device;
+    MockResource* backBuffer = device.Create( "A back buffer", kBackBufferBytes );
+    device.tracker->SetFrame( 30 );
+    const ResourceSnapshot before = device.tracker->Snapshot();
+
+    // A copy target created every frame and never released
+    std::vector<MockResource*> leaked;
+    for( uint64_t frame = 31; frame <= 40; ++frame )
+    {
+        device.tracker->SetFrame( frame );
+        leaked.push_back( device.Create( "B copy", 4096 ) );
+    }
+    const ResourceDiff diff = DiffResourceSnapshots( before, device.tracker->Snapshot() );
+    CHECK( diff.Grew() && diff.bytes == 40960 );
+    CHECK( diff.created.size() == 10 && diff.destroyed.empty() );
+    CHECK( diff.created[0].frame == 31 && diff.created[9].frame == 40 );
+    CHECK( diff.owners.size() == 1 && diff.owners[0].owner == "B copy" );
+    CHECK( diff.owners[0].count == 10 && diff.owners[0].bytes == 40960 );
+    CHECK( diff.Format() ==
+           "Resource changes over 10 frames: 10 created, 0 destroyed, +0.04 MB, 0 gained references\n"
+           "  B copy                    +10 resources,      +0.04 MB\n" );
+
+    // Another thread may release them while no snapshot is being taken
+    std::thread releaser( [&] { for( MockResource* resource : leaked ) resource->Release(); } );
+    releaser.join();
+    CHECK( device.tracker->GetStats().liveCount == 1 );
+    backBuffer->Release();
+}
+
+TEST_CASE( ResourceDiffMatchesById )
+{
+    MockDevice device;
+    MockResource* constants = device.Create( "A constants", 256, RESOURCE_BUFFER );
+    const ResourceSnapshot before = device.tracker->Snapshot();
+
+    // Replaced by one of the same size: a creation and a destruction, but no growth
+    constants->Release();
+    constants = device.Create( "A constants", 256, RESOURCE_BUFFER );
+    const ResourceDiff diff = DiffResourceSnapshots( before, device.tracker->Snapshot() );
+    CHECK( !diff.Grew() );
+    CHECK( diff.created.size() == 1 && diff.destroyed.size() == 1 );
+    CHECK( diff.created[0].id != diff.destroyed[0].id );
+    CHECK( diff.owners.empty() );
+
+    constants->Release();
+}
+
+TEST_CASE( ResourceTrackerOutlivesItsDevice )
+{
+    //? The leak report after shutdown: the records stay, the counts can no longer be read
+    std::shared_ptr<ResourceTracker> tracker;
+    MockResource* leaked = nullptr;
+    {
+        MockDevice device;
+        tracker = device.tracker;
+        device.Create( "A back buffer", kBackBufferBytes )->Release();
+        leaked = device.Create( "B shared", 4096 );
+    }
+    const ResourceSnapshot snapshot = tracker->Snapshot();
+    CHECK( snapshot.resources.size() == 1 && snapshot.resources[0].refCount == 0 );
+    CHECK( tracker->FormatLive() ==
+           "Resources: 1 owners, 0.00 MB live\n"
+           "  B shared                    1 resources,       0.00 MB\n" );
+
+    //? Its device is gone, so Release() cannot be used; drop the record by hand
+    CHECK( tracker->Remove( leaked ) );
+    delete leaked;
+}
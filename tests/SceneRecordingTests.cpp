@@ -0,0 +1,132 @@
+//--------------------------------------------------------------------------------------
+// File: SceneRecordingTests.cpp
+//
+// Scene splitting and parallel recording, checked on SoftwareCommandRecorder
+//--------------------------------------------------------------------------------------
+
+#include "TestHarness.h"
+#include "SceneRecording.h"
+#include "RenderThreads.h"
+
+
+namespace
+{
+    //? Quad i is told apart by its mesh color
+    std::vector<FrameConstants> NumberedQuads( size_t count )
+    {
+        std::vector<FrameConstants> quads( count );
+        for( size_t i = 0; i < count; ++i )
+            quads[i].meshColor[0] = float( i );
+        return quads;
+    }
+
+    //? Whether the executed commands are the quads in order, chunk c recorded on c % contexts
+    bool ExecutedInOrder( const SoftwareCommandRecorder& recorder, size_t quadCount, size_t chunkQuads, size_t contexts )
+    {
+        const std::vector<SoftwareCommandRecorder::Command>& executed = recorder.Executed();
+        if( executed.size() != quadCount )
+            return false;
+        for( size_t i = 0; i < quadCount; ++i )
+        {
+            const size_t chunk = i / chunkQuads;
+            if( executed[i].constants.meshColor[0] != float( i ) || executed[i].chunk != chunk ||
+                executed[i].context != chunk % contexts )
+                return false;
+        }
+        return true;
+    }
+
+    class FailingRecorder : public SoftwareCommandRecorder
+    {
+    public:
+        FailingRecorder( size_t contexts, size_t failingChunk, bool failBegin = false ) :
+            SoftwareCommandRecorder( contexts ), m_failingChunk( failingChunk ), m_failBegin( failBegin ) {}
+
+        bool BeginSubmission( size_t chunkCount ) override
+        {
+            return !m_failBegin && SoftwareCommandRecorder::BeginSubmission( chunkCount );
+        }
+
+        bool RecordChunk( size_t context, size_t chunk, const FrameConstants* quads, size_t count ) override
+        {
+            return chunk != m_failingChunk && SoftwareCommandRecorder::RecordChunk( context, chunk, quads, count );
+        }
+
+    private:
+        const size_t    m_failingChunk;
+        const bool      m_failBegin;
+    };
+}
+
+TEST_CASE( SplitSceneCoversEveryQuadOnce )
+{
+    const std::vector<SceneChunk> chunks = SplitScene( 1000, 256 );
+    CHECK( chunks.size() == 4 );
+    CHECK( chunks[0].first == 0 && chunks[0].count == 256 );
+    CHECK( chunks[3].first == 768 && chunks[3].count == 232 );
+
+    CHECK( SplitScene( 512, 256 ).size() == 2 );
+    CHECK( SplitScene( 0, 256 ).empty() );
+    CHECK( SplitScene( 10, 0 ).size() == 1 );          // 0: one chunk for everything
+    CHECK( SplitScene( 10, 0 )[0].count == 10 );
+}
+
+TEST_CASE( SubmitSceneOnAPoolMatchesOneThread )
+{
+    const std::vector<FrameConstants> quads = NumberedQuads( 5000 );
+    WorkerPool pool( 4 );
+    for( int submission = 0; submission < 10; ++submission )
+    {
+        SoftwareCommandRecorder recorder( 3 );
+        const SceneSubmitStats stats = SubmitScene( recorder, quads, 128, &pool );
+        CHECK( stats.ok );
+        CHECK( stats.quads == 5000 && stats.chunks == 40 && stats.contexts == 3 );
+        CHECK( ExecutedInOrder( recorder, quads.size(), 128, 3 ) );
+    }
+    CHECK( pool.Timings().empty() );
+}
+
+TEST_CASE( SubmitSceneRecordsInlineWithoutAPool )
+{
+    const std::vector<FrameConstants> quads = NumberedQuads( 300 );
+    SoftwareCommandRecorder recorder( 4 );
+    const SceneSubmitStats stats = SubmitScene( recorder, quads, 64, nullptr );
+    CHECK( stats.ok && stats.chunks == 5 && stats.contexts == 4 );
+    CHECK( ExecutedInOrder( recorder, quads.size(), 64, 4 ) );
+
+    // Executing appends; a second submission follows the first
+    SubmitScene( recorder, quads, 64, nullptr );
+    CHECK( recorder.Executed().size() == 600 );
+    recorder.ClearExecuted();
+    CHECK( recorder.Executed().empty() );
+}
+
+TEST_CASE( SubmitSceneUsesNoMoreContextsThanChunks )
+{
+    const std::vector<FrameConstants> quads = NumberedQuads( 100 );
+    WorkerPool pool( 2 );
+    SoftwareCommandRecorder recorder( 8 );
+    const SceneSubmitStats stats = SubmitScene( recorder, quads, 40, &pool );
+    CHECK( stats.chunks == 3 && stats.contexts == 3 );
+    CHECK( ExecutedInOrder( recorder, quads.size(), 40, 3 ) );
+
+    SoftwareCommandRecorder empty( 8 );
+    const SceneSubmitStats none = SubmitScene( empty, std::vector<FrameConstants>(), 40, &pool );
+    CHECK( none.ok && none.chunks == 0 && none.contexts == 0 );
+    CHECK( empty.Executed().empty() );
+}
+
+TEST_CASE( SubmitSceneReportsRecordingFailures )
+{
+    const std::vector<FrameConstants> quads = NumberedQuads( 256 );
+    WorkerPool pool( 2 );
+
+    FailingRecorder failsChunk( 2, 1 );
+    const SceneSubmitStats stats = SubmitScene( failsChunk, quads, 64, &pool );
+    CHECK( !stats.ok );
+    CHECK( failsChunk.Executed().size() == 256 - 64 );  // the other chunks still ran
+
+    FailingRecorder failsBegin( 2, 99, true );
+    CHECK( !SubmitScene( failsBegin, quads, 64, &pool ).ok );
+    CHECK( failsBegin.Executed().empty() );
+}
@@ -0,0 +1,200 @@
+//--------------------------------------------------------------------------------------
+// File: ShaderCacheTests.cpp
+//
+// ShaderCache keys, hits and misses, and the pack file, with a stub compiler
+//--------------------------------------------------------------------------------------
+
+#include "TestHarness.h"
+#include "ShaderCache.h"
+
+#include <atomic>
+#include <cstdio>
+#include <thread>
+
+
+namespace
+{
+    //? "Bytecode" is the inputs spelled out, so a wrong hit shows in the result
+    struct StubCompiler
+    {
+        std::atomic<int>    calls{ 0 };
+        bool                ok = true;
+
+        ShaderCache::CompileFn Fn()
+        {
+            return [this]( const char* source, const char* entryPoint, const char* target, std::vector<uint8_t>& bytecode )
+            {
+                ++calls;
+                const std::string text = std::string( source ) + "|" + entryPoint + "|" + target;
+                bytecode.assign( text.begin(), text.end() );
+                return ok;
+            };
+        }
+    };
+
+    std::string Text( const std::vector<uint8_t>& bytecode )
+    {
+        return std::string( bytecode.begin(), bytecode.end() );
+    }
+
+    //? A pack of its own for each test, removed up front
+    std::string FreshPack( const char* name )
+    {
+        const std::string path = TestOutputPath( name );
+        remove( path.c_str() );
+        return path;
+    }
+}
+
+TEST_CASE( ShaderCacheKeyCoversEveryInput )
+{
+    const uint64_t key = ShaderCacheKey( "source", "VS", "vs_4_0", 0 );
+    CHECK( key == ShaderCacheKey( "source", "VS", "vs_4_0", 0 ) );
+    CHECK( key != ShaderCacheKey( "source2", "VS", "vs_4_0", 0 ) );
+    CHECK( key != ShaderCacheKey( "source", "PS", "vs_4_0", 0 ) );
+    CHECK( key != ShaderCacheKey( "source", "VS", "vs_5_0", 0 ) );
+    CHECK( key != ShaderCacheKey( "source", "VS", "vs_4_0", 1 ) );
+
+    // Moving characters from one string to the next changes the key
+    CHECK( ShaderCacheKey( "ab", "c", "t", 0 ) != ShaderCacheKey( "a", "bc", "t", 0 ) );
+    CHECK( ShaderCacheKey( nullptr, "VS", "t", 0 ) == ShaderCacheKey( "", "VS", "t", 0 ) );
+}
+
+TEST_CASE( ShaderCacheCompilesEachKeyOnce )
+{
+    ShaderCache cache;
+    StubCompiler compiler;
+    std::vector<uint8_t> bytecode;
+
+    CHECK( cache.GetOrCompile( "src", "VS", "vs_4_0", 0, compiler.Fn(), bytecode ) );
+    CHECK( cache.GetOrCompile( "src", "VS", "vs_4_0", 0, compiler.Fn(), bytecode ) );
+    CHECK( Text( bytecode ) == "src|VS|vs_4_0" );
+    CHECK( compiler.calls == 1 );
+
+    CHECK( cache.GetOrCompile( "src", "VS", "vs_4_0", 1, compiler.Fn(), bytecode ) );    // other flags
+    CHECK( cache.GetOrCompile( "src", "PS", "ps_4_0", 0, compiler.Fn(), bytecode ) );
+    CHECK( Text( bytecode ) == "src|PS|ps_4_0" );
+    CHECK( compiler.calls == 3 );
+
+    const ShaderCache::Stats stats = cache.GetStats();
+    CHECK( stats.hits == 1 && stats.misses == 3 && stats.failures == 0 );
+    CHECK( cache.EntryCount() == 3 );
+    CHECK( cache.Dirty() );
+
+    CHECK( cache.Lookup( ShaderCacheKey( "src", "PS", "ps_4_0", 0 ), bytecode ) );
+    CHECK( !cache.Lookup( ShaderCacheKey( "src", "PS", "ps_4_0", 1 ), bytecode ) );
+}
+
+TEST_CASE( ShaderCacheDoesNotKeepFailures )
+{
+    ShaderCache cache;
+    StubCompiler compiler;
+    compiler.ok = false;
+    std::vector<uint8_t> bytecode;
+
+    CHECK( !cache.GetOrCompile( "broken", "PS", "ps_4_0", 0, compiler.Fn(), bytecode ) );
+    CHECK( !cache.GetOrCompile( "broken", "PS", "ps_4_0", 0, compiler.Fn(), bytecode ) );
+    CHECK( compiler.calls == 2 );
+    CHECK( cache.GetStats().failures == 2 );
+    CHECK( cache.EntryCount() == 0 );
+    CHECK( !cache.GetOrCompile( "broken", "PS", "ps_4_0", 0, nullptr, bytecode ) );
+}
+
+TEST_CASE( ShaderCachePackSurvivesAReopen )
+{
+    const std::string path = FreshPack( "shadercache_reopen.pack" );
+    StubCompiler compiler;
+    std::vector<uint8_t> bytecode;
+    {
+        ShaderCache cache( 7 );
+        CHECK( !cache.Open( path ) );       // no pack yet, still usable
+        CHECK( cache.Save() );              // nothing to write
+        cache.GetOrCompile( "a", "VS", "vs_4_0", 0, compiler.Fn(), bytecode );
+        cache.GetOrCompile( "b", "VS", "vs_4_0", 0, compiler.Fn(), bytecode );
+        CHECK( cache.Save() );
+        CHECK( !cache.Dirty() );
+        CHECK( cache.EntryCount() == 2 );
+
+        // Served from the new mapping now
+        CHECK( cache.GetOrCompile( "a", "VS", "vs_4_0", 0, compiler.Fn(), bytecode ) );
+        CHECK( Text( bytecode ) == "a|VS|vs_4_0" );
+    }
+    {
+        ShaderCache cache( 7 );
+        CHECK( cache.Open( path ) );
+        CHECK( cache.EntryCount() == 2 );
+        CHECK( cache.GetOrCompile( "b", "VS", "vs_4_0", 0, compiler.Fn(), bytecode ) );
+        CHECK( Text( bytecode ) == "b|VS|vs_4_0" );
+        CHECK( compiler.calls == 2 );
+
+        // Merged with the mapped entries on the next save
+        cache.GetOrCompile( "c", "VS", "vs_4_0", 0, compiler.Fn(), bytecode );
+        CHECK( cache.Save() );
+        CHECK( cache.EntryCount() == 3 );
+    }
+    {
+        ShaderCache cache( 8 );             // another compiler's pack
+        CHECK( !cache.Open( path ) );
+        CHECK( cache.EntryCount() == 0 );
+    }
+    remove( path.c_str() );
+}
+
+TEST_CASE( ShaderCacheIgnoresACorruptPack )
+{
+    const std::string path = FreshPack( "shadercache_corrupt.pack" );
+    {
+        ShaderCache cache;
+        cache.Open( path );
+        StubCompiler compiler;
+        std::vector<uint8_t> bytecode;
+        cache.GetOrCompile( "a", "VS", "vs_4_0", 0, compiler.Fn(), bytecode );
+        CHECK( cache.Save() );
+    }
+
+    // Cut into the blob of the only entry
+    FILE* file = fopen( path.c_str(), "rb" );
+    std::vector<uint8_t> pack( 4096 );
+    pack.resize( fread( pack.data(), 1, pack.size(), file ) );
+    fclose( file );
+    file = fopen( path.c_str(), "wb" );
+    fwrite( pack.data(), 1, pack.size() - 2, file );
+    fclose( file );
+
+    ShaderCache cache;
+    CHECK( !cache.Open( path ) );
+    CHECK( cache.EntryCount() == 0 );
+    remove( path.c_str() );
+}
+
+TEST_CASE( ShaderCacheCompilesFromManyThreads )
+{
+    ShaderCache cache;
+    StubCompiler compiler;
+    const char* sources[4] = { "a", "b", "c", "d" };
+    std::atomic<int> wrong( 0 );
+
+    std::vector<std::thread> threads;
+    for( int t = 0; t < 4; ++t )
+    {
+        threads.emplace_back( [&]()
+        {
+            std::vector<uint8_t> bytecode;
+            for( int i = 0; i < 200; ++i )
+            {
+                const char* source = sources[i % 4];
+                if( !cache.GetOrCompile( source, "PS", "ps_4_0", 0, compiler.Fn(), bytecode ) ||
+                    Text( bytecode ) != std::string( source ) + "|PS|ps_4_0" )
+                    ++wrong;
+            }
+        } );
+    }
+    for( std::thread& thread : threads )
+        thread.join();
+
+    CHECK( wrong == 0 );
+    CHECK( cache.EntryCount() == 4 );
+    const ShaderCache::Stats stats = cache.GetStats();
+    CHECK( stats.hits + stats.misses == 800 );
+    CHECK( compiler.calls == int( stats.misses ) );
+}
@@ -0,0 +1,64 @@
+//--------------------------------------------------------------------------------------
+// File: SharedDownsampleTests.cpp
+//
+// The box-filter downsample: its rounding, and the SIMD path giving the same bytes as
+// the scalar definition for every box size, width and pitch
+//--------------------------------------------------------------------------------------
+
+#include "TestHarness.h"
+#include "SharedDownsample.h"
+
+#include <cstring>
+#include <random>
+#include <vector>
+
+
+TEST_CASE( SharedDownsampleRoundsHalvesUp )
+{
+    //? Four 2x2 boxes of gray texels, averaging 0.5, 1.5, 1.25 and 254.75
+    const uint8_t gray[2][8] = {
+        { 0, 1,   1, 2,   1, 1,   255, 255 },
+        { 1, 0,   2, 1,   1, 2,   255, 254 },
+    };
+    uint8_t src[2][8 * 4];
+    for( int y = 0; y < 2; ++y )
+        for( int x = 0; x < 8; ++x )
+            memset( &src[y][x * 4], gray[y][x], 4 );
+
+    uint8_t dst[4 * 4] = {};
+    DownsampleBoxScalar( &src[0][0], sizeof( src[0] ), 8, 2, dst, sizeof( dst ), 1 );
+    const uint8_t expected[4] = { 1, 2, 1, 255 };
+    bool rounded = true;
+    for( int pixel = 0; pixel < 4; ++pixel )
+        for( int c = 0; c < 4; ++c )
+            rounded &= dst[pixel * 4 + c] == expected[pixel];
+    CHECK( rounded );
+}
+
+TEST_CASE( SharedDownsampleSimdMatchesScalar )
+{
+    //? Widths around the 16-byte groups, an odd height, and a padded source pitch as a
+    //? mapped texture has. The byte after each destination image has to stay untouched.
+    std::mt19937 random( 1 );
+    const uint32_t height = 13;
+    bool same = true;
+    for( uint32_t shift = 0; shift <= kMaxSharedScaleShift; ++shift )
+    {
+        for( uint32_t width : { 1u, 7u, 16u, 37u, 803u } )
+        {
+            const size_t srcPitch = size_t( width ) * 4 + 12;
+            std::vector<uint8_t> src( srcPitch * height );
+            for( uint8_t& byte : src )
+                byte = uint8_t( random() );
+
+            const uint32_t dstWidth = width >> shift;
+            const uint32_t dstHeight = height >> shift;
+            const size_t dstPitch = size_t( dstWidth ) * 4;
+            std::vector<uint8_t> scalar( dstPitch * dstHeight + 1, 0xcd ), simd( dstPitch * dstHeight + 1, 0xcd );
+            DownsampleBoxScalar( src.data(), srcPitch, width, height, scalar.data(), dstPitch, shift );
+            DownsampleBox( src.data(), srcPitch, width, height, simd.data(), dstPitch, shift );
+            same &= scalar == simd && simd.back() == 0xcd;
+        }
+    }
+    CHECK( same );
+}
@@ -0,0 +1,174 @@
+//--------------------------------------------------------------------------------------
+// File: SoftwareRasterTests.cpp
+//
+// TileRasterizer coverage and depth rules, and a threaded flush drawing the same image
+// as a serial one
+//--------------------------------------------------------------------------------------
+
+#include "TestHarness.h"
+#include "SoftwareRaster.h"
+#include "RenderThreads.h"
+
+#include <cstring>
+#include <random>
+#include <vector>
+
+
+namespace
+{
+    const uint32_t kWidth = 16;
+    const uint32_t kHeight = 16;
+    const float kBlack[4] = { 0.0f, 0.0f, 0.0f, 1.0f };
+
+    //? A vertex at screen position (x, y) in pixels, w = 1
+    RasterVertex ScreenVertex( float x, float y, float z, uint32_t width = kWidth, uint32_t height = kHeight )
+    {
+        RasterVertex v = {};
+        v.clip[0] = x / float( width ) * 2.0f - 1.0f;
+        v.clip[1] = 1.0f - y / float( height ) * 2.0f;
+        v.clip[2] = z;
+        v.clip[3] = 1.0f;
+        return v;
+    }
+
+    //? Untextured draws shade the mesh color
+    RasterDrawState FlatColor( float r, float g, float b )
+    {
+        RasterDrawState state;
+        state.shader = RASTER_PS_MESH_COLOR_MINUS_TEXTURE;
+        state.meshColor[0] = r;
+        state.meshColor[1] = g;
+        state.meshColor[2] = b;
+        return state;
+    }
+
+    void DrawTriangle( TileRasterizer& raster, const RasterVertex& a, const RasterVertex& b, const RasterVertex& c, const RasterDrawState& state )
+    {
+        const RasterVertex vertices[3] = { a, b, c };
+        const uint16_t indices[3] = { 0, 1, 2 };
+        raster.DrawTriangles( vertices, indices, 3, state );
+    }
+
+    //? Pixels a triangle drawn alone covers, as a kWidth x kHeight mask
+    std::vector<bool> Coverage( const RasterVertex& a, const RasterVertex& b, const RasterVertex& c )
+    {
+        TileRasterizer raster( kWidth, kHeight );
+        raster.Clear( kBlack );
+        DrawTriangle( raster, a, b, c, FlatColor( 1.0f, 1.0f, 1.0f ) );
+        raster.Flush();
+        std::vector<bool> covered( kWidth * kHeight );
+        for( uint32_t i = 0; i < kWidth * kHeight; ++i )
+            covered[i] = raster.Depth()[i] < 1.0f;
+        return covered;
+    }
+}
+
+TEST_CASE( SoftwareRasterFollowsTheTopLeftRule )
+{
+    //? A square whose corners and diagonal lie on pixel centers, split into two triangles
+    //? along the diagonal: every center on a shared or outer edge belongs to exactly one
+    //? triangle, and only the top and left outer edges are inside
+    const RasterVertex topLeft = ScreenVertex( 2.5f, 3.5f, 0.5f );
+    const RasterVertex topRight = ScreenVertex( 10.5f, 3.5f, 0.5f );
+    const RasterVertex bottomRight = ScreenVertex( 10.5f, 11.5f, 0.5f );
+    const RasterVertex bottomLeft = ScreenVertex( 2.5f, 11.5f, 0.5f );
+    const std::vector<bool> upper = Coverage( topLeft, topRight, bottomRight );
+    const std::vector<bool> lower = Coverage( topLeft, bottomRight, bottomLeft );
+
+    bool once = true;
+    for( uint32_t y = 0; y < kHeight; ++y )
+    {
+        for( uint32_t x = 0; x < kWidth; ++x )
+        {
+            const bool inside = x >= 2 && x < 10 && y >= 3 && y < 11;
+            const uint32_t count = ( upper[y * kWidth + x] ? 1 : 0 ) + ( lower[y * kWidth + x] ? 1 : 0 );
+            once &= count == ( inside ? 1u : 0u );
+        }
+    }
+    CHECK( once );
+
+    //? The diagonal's pixel centers go to the triangle it is a left edge of, the upper one
+    CHECK( upper[5 * kWidth + 4] && !lower[5 * kWidth + 4] );
+}
+
+TEST_CASE( SoftwareRasterTestsAndWritesDepth )
+{
+    const float nearZ = 0.25f, farZ = 0.75f;
+    const RasterDrawState red = FlatColor( 1.0f, 0.0f, 0.0f );
+    const RasterDrawState green = FlatColor( 0.0f, 1.0f, 0.0f );
+    const float redColor[4] = { 1.0f, 0.0f, 0.0f, 1.0f };
+    const float greenColor[4] = { 0.0f, 1.0f, 0.0f, 1.0f };
+    const uint32_t redPixel = PackRasterColor( redColor );
+    const uint32_t greenPixel = PackRasterColor( greenColor );
+
+    //? Near drawn first and far second, then the same depth drawn twice: LESS keeps the
+    //? first draw in both cases. The red triangle covers x + y < 16, the green one y < x.
+    for( float second : { farZ, nearZ } )
+    {
+        TileRasterizer raster( kWidth, kHeight );
+        raster.Clear( kBlack );
+        DrawTriangle( raster, ScreenVertex( 0.0f, 0.0f, nearZ ), ScreenVertex( 16.0f, 0.0f, nearZ ), ScreenVertex( 0.0f, 16.0f, nearZ ), red );
+        DrawTriangle( raster, ScreenVertex( 0.0f, 0.0f, second ), ScreenVertex( 16.0f, 0.0f, second ), ScreenVertex( 16.0f, 16.0f, second ), green );
+        raster.Flush();
+
+        CHECK( raster.Color()[1 * kWidth + 8] == redPixel );          // both triangles
+        CHECK_NEAR( raster.Depth()[1 * kWidth + 8], nearZ, 1e-6f );
+        CHECK( raster.Color()[8 * kWidth + 14] == greenPixel );       // the second only
+        CHECK_NEAR( raster.Depth()[8 * kWidth + 14], second, 1e-6f );
+        CHECK( raster.Depth()[14 * kWidth + 6] == 1.0f );             // neither
+    }
+
+    //? Far first, near second: the near triangle replaces color and depth
+    TileRasterizer raster( kWidth, kHeight );
+    raster.Clear( kBlack );
+    DrawTriangle( raster, ScreenVertex( 0.0f, 0.0f, farZ ), ScreenVertex( 16.0f, 0.0f, farZ ), ScreenVertex( 0.0f, 16.0f, farZ ), red );
+    DrawTriangle( raster, ScreenVertex( 0.0f, 0.0f, nearZ ), ScreenVertex( 16.0f, 0.0f, nearZ ), ScreenVertex( 16.0f, 16.0f, nearZ ), green );
+    raster.Flush();
+    CHECK( raster.Color()[1 * kWidth + 8] == greenPixel );
+    CHECK_NEAR( raster.Depth()[1 * kWidth + 8], nearZ, 1e-6f );
+    CHECK( raster.Color()[8 * kWidth + 2] == redPixel );
+    CHECK_NEAR( raster.Depth()[8 * kWidth + 2], farZ, 1e-6f );
+}
+
+TEST_CASE( SoftwareRasterThreadedMatchesSerial )
+{
+    //? Overlapping textured triangles at random depths over many tiles, some reaching past
+    //? the guard band so the clipper runs
+    const uint32_t width = 333, height = 211;
+    std::vector<uint32_t> texels( 64 * 64 );
+    std::mt19937 random( 3 );
+    for( uint32_t& texel : texels )
+        texel = uint32_t( random() );
+    SoftwareTexture texture;
+    AppendTextureLevel( texture, 64, 64, texels.data() );
+    GenerateTextureMips( texture );
+
+    std::uniform_real_distribution<float> x( -2.0f * width, 3.0f * width ), y( -2.0f * height, 3.0f * height ), z( 0.0f, 1.0f );
+    std::vector<RasterVertex> vertices;
+    for( int i = 0; i < 3 * 200; ++i )
+    {
+        RasterVertex v = ScreenVertex( x( random ), y( random ), z( random ), width, height );
+        v.tex[0] = float( i % 7 ) * 0.37f;
+        v.tex[1] = float( i % 5 ) * 0.61f;
+        vertices.push_back( v );
+    }
+    std::vector<uint16_t> indices( vertices.size() );
+    for( size_t i = 0; i < indices.size(); ++i )
+        indices[i] = uint16_t( i );
+
+    RasterDrawState state;
+    state.texture = &texture;
+    TileRasterizer serial( width, height ), threaded( width, height );
+    WorkerPool pool( 3 );
+    for( TileRasterizer* raster : { &serial, &threaded } )
+    {
+        raster->Clear( kBlack );
+        raster->DrawTriangles( vertices.data(), indices.data(), indices.size(), state );
+        raster->Flush( raster == &threaded ? &pool : nullptr );
+    }
+
+    const size_t pixels = size_t( width ) * height;
+    CHECK( serial.GetStats().clipped > 0 );
+    CHECK( memcmp( serial.Color(), threaded.Color(), pixels * sizeof( uint32_t ) ) == 0 );
+    CHECK( memcmp( serial.Depth(), threaded.Depth(), pixels * sizeof( float ) ) == 0 );
+}
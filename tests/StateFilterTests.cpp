@@ -0,0 +1,174 @@
+//--------------------------------------------------------------------------------------
+// File: StateFilterTests.cpp
+//
+// StateFilter in front of a mock context that records the calls reaching it, used the
+// way D3D11StateCache uses it
+//--------------------------------------------------------------------------------------
+
+#include "TestHarness.h"
+#include "StateFilter.h"
+
+#include <string>
+#include <vector>
+
+
+namespace
+{
+    struct Viewport
+    {
+        float   x, y, width, height;
+    };
+
+    //? Records the calls that get through, as "Name start count"
+    class RecordingContext
+    {
+    public:
+        void VSSetShader( const void* ) { m_calls.push_back( "VSSetShader" ); }
+        void PSSetShaderResources( uint32_t start, uint32_t count, const void* const* )
+        {
+            m_calls.push_back( "PSSetShaderResources " + std::to_string( start ) + " " + std::to_string( count ) );
+        }
+        void RSSetViewports( uint32_t count, const Viewport* )
+        {
+            m_calls.push_back( "RSSetViewports " + std::to_string( count ) );
+        }
+
+        const std::vector<std::string>& Calls() const noexcept { return m_calls; }
+        void Clear() { m_calls.clear(); }
+
+    private:
+        std::vector<std::string>    m_calls;
+    };
+
+    //? The filtering D3D11StateCache does, for the calls the tests need
+    class FilteredContext
+    {
+    public:
+        void VSSetShader( const void* shader )
+        {
+            if( m_filter.Update( STATE_VS_SHADER, 0, 1, &shader, sizeof( shader ) ) )
+                m_context.VSSetShader( shader );
+        }
+        void PSSetShaderResources( uint32_t start, uint32_t count, const void* const* views )
+        {
+            uint32_t first = 0, issued = 0;
+            if( m_filter.Update( STATE_PS_SHADER_RESOURCES, start, count, views, sizeof( *views ), &first, &issued ) )
+                m_context.PSSetShaderResources( first, issued, views + ( first - start ) );
+        }
+        void RSSetViewports( uint32_t count, const Viewport* viewports )
+        {
+            if( m_filter.Update( STATE_RS_VIEWPORTS, 0, 1, viewports, count * sizeof( Viewport ) ) )
+                m_context.RSSetViewports( count, viewports );
+        }
+
+        StateFilter         m_filter;
+        RecordingContext    m_context;
+    };
+
+    int a, b, c, d;     // stand-ins for the objects being bound
+}
+
+TEST_CASE( StateFilterDropsRepeatedCalls )
+{
+    FilteredContext context;
+    context.VSSetShader( &a );
+    context.VSSetShader( &a );
+    context.VSSetShader( &b );
+    context.VSSetShader( &b );
+
+    const std::vector<std::string> expected = { "VSSetShader", "VSSetShader" };
+    CHECK( context.m_context.Calls() == expected );
+    CHECK( context.m_filter.GetCounters().issued[STATE_VS_SHADER] == 2 );
+    CHECK( context.m_filter.GetCounters().filtered[STATE_VS_SHADER] == 2 );
+
+    const void* const* last = static_cast<const void* const*>( context.m_filter.Last( STATE_VS_SHADER, 0, sizeof( void* ) ) );
+    CHECK( last && *last == &b );
+    CHECK( context.m_filter.Last( STATE_VS_SHADER, 1, sizeof( void* ) ) == nullptr );
+    CHECK( context.m_filter.Last( STATE_VS_SHADER, 0, 4 ) == nullptr );
+}
+
+TEST_CASE( StateFilterTrimsToTheChangedSlots )
+{
+    FilteredContext context;
+    const void* views[4] = { &a, &b, &c, &d };
+    context.PSSetShaderResources( 0, 4, views );
+
+    const void* middle[4] = { &a, &c, &b, &d };
+    context.PSSetShaderResources( 0, 4, middle );
+    const void* tail[2] = { &b, &a };
+    context.PSSetShaderResources( 2, 2, tail );         // slot 2 unchanged
+    context.PSSetShaderResources( 5, 1, views );        // past every slot set so far
+
+    const std::vector<std::string> expected =
+    {
+        "PSSetShaderResources 0 4",
+        "PSSetShaderResources 1 2",
+        "PSSetShaderResources 3 1",
+        "PSSetShaderResources 5 1",
+    };
+    CHECK( context.m_context.Calls() == expected );
+
+    // The trimmed call passed on the changed views, not the first ones
+    const void* const* slot3 = static_cast<const void* const*>( context.m_filter.Last( STATE_PS_SHADER_RESOURCES, 3, sizeof( void* ) ) );
+    CHECK( slot3 && *slot3 == &a );
+    CHECK( context.m_filter.Last( STATE_PS_SHADER_RESOURCES, 4, sizeof( void* ) ) == nullptr );
+}
+
+TEST_CASE( StateFilterReissuesAfterInvalidate )
+{
+    FilteredContext context;
+    const void* views[2] = { &a, &b };
+    context.VSSetShader( &a );
+    context.PSSetShaderResources( 0, 2, views );
+    context.m_context.Clear();
+
+    // Only the invalidated call goes through again
+    context.m_filter.Invalidate( STATE_PS_SHADER_RESOURCES );
+    context.VSSetShader( &a );
+    context.PSSetShaderResources( 0, 2, views );
+    std::vector<std::string> expected = { "PSSetShaderResources 0 2" };
+    CHECK( context.m_context.Calls() == expected );
+
+    // As after ClearState() or executing a command list
+    context.m_filter.InvalidateAll();
+    context.VSSetShader( &a );
+    context.PSSetShaderResources( 0, 2, views );
+    expected.push_back( "VSSetShader" );
+    expected.push_back( "PSSetShaderResources 0 2" );
+    CHECK( context.m_context.Calls() == expected );
+}
+
+TEST_CASE( StateFilterComparesWholeArrays )
+{
+    FilteredContext context;
+    const Viewport viewports[2] = { { 0, 0, 640, 480 }, { 640, 0, 640, 480 } };
+    context.RSSetViewports( 2, viewports );
+    context.RSSetViewports( 2, viewports );
+    context.RSSetViewports( 1, viewports );             // same first viewport, fewer of them
+
+    Viewport moved[2] = { viewports[0], viewports[1] };
+    moved[1].height = 479;
+    context.RSSetViewports( 2, moved );
+
+    const std::vector<std::string> expected = { "RSSetViewports 2", "RSSetViewports 1", "RSSetViewports 2" };
+    CHECK( context.m_context.Calls() == expected );
+}
+
+TEST_CASE( StateFilterFormatsItsCounters )
+{
+    FilteredContext context;
+    for( int i = 0; i < 4; ++i )
+        context.VSSetShader( &a );
+    const Viewport viewport = { 0, 0, 64, 64 };
+    context.RSSetViewports( 1, &viewport );
+
+    const std::string text = StateFilter::Format( context.m_filter.GetCounters() );
+    CHECK( text.find( "State changes: 2 issued, 3 filtered (60.0%)" ) == 0 );
+    CHECK( text.find( "VSSetShader" ) != std::string::npos );
+    CHECK( text.find( "RSSetViewports" ) != std::string::npos );
+    CHECK( text.find( "PSSetShaderResources" ) == std::string::npos );
+
+    context.m_filter.ResetCounters();
+    CHECK( context.m_filter.GetCounters().filtered[STATE_VS_SHADER] == 0 );
+    CHECK( StateFilter::Format( context.m_filter.GetCounters() ).find( "(0.0%)" ) != std::string::npos );
+}
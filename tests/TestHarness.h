@@ -0,0 +1,40 @@
+//--------------------------------------------------------------------------------------
+// File: TestHarness.h
+//
+// A small test harness for the host build, without any dependency. TEST_CASE defines a
+// test and registers it; CHECK and CHECK_NEAR record a failure with its file and line
+// and let the test go on. TestMain.cpp runs every registered test, or only those whose
+// name contains the first argument, and fails if any check did. Tests run in the source
+// directory, so they find test.dds, and write their files to the build directory.
+//
+// Each module's tests live in tests/<Module>Tests.cpp.
+//--------------------------------------------------------------------------------------
+
+#pragma once
+
+#include <cmath>
+#include <string>
+
+
+using TestFn = void (*)();
+
+// Adds a test to the ones TestMain.cpp runs; returns true so it can initialize a static
+bool RegisterTest( const char* name, TestFn test );
+
+// A path for files a test writes, in the build directory
+std::string TestOutputPath( const char* name );
+
+// Counts a failed check of the test that is running and prints where it failed
+void ReportFailure( const char* file, int line, const char* expression );
+
+#define TEST_CASE( name ) \
+    static void name(); \
+    static const bool name##Registered = RegisterTest( #name, name ); \
+    static void name()
+
+#define CHECK( expression ) \
+    do { if( !( expression ) ) ReportFailure( __FILE__, __LINE__, #expression ); } while( 0 )
+
+#define CHECK_NEAR( value, expected, tolerance ) \
+    do { if( !( std::fabs( double( value ) - double( expected ) ) <= double( tolerance ) ) ) \
+             ReportFailure( __FILE__, __LINE__, #value " == " #expected " +- " #tolerance ); } while( 0 )
@@ -0,0 +1,71 @@
+//--------------------------------------------------------------------------------------
+// File: TestMain.cpp
+//
+// Runs the tests registered by TEST_CASE: rendertex_tests [filter]
+//--------------------------------------------------------------------------------------
+
+#include "TestHarness.h"
+
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+
+namespace
+{
+    struct RegisteredTest
+    {
+        const char* name;
+        TestFn      test;
+    };
+
+    //? Function-local, so tests registered by other files' statics find it constructed
+    std::vector<RegisteredTest>& Tests()
+    {
+        static std::vector<RegisteredTest> tests;
+        return tests;
+    }
+
+    const char* g_running = nullptr;
+    int         g_failedChecks = 0;
+}
+
+bool RegisterTest( const char* name, TestFn test )
+{
+    Tests().push_back( { name, test } );
+    return true;
+}
+
+std::string TestOutputPath( const char* name )
+{
+    return std::string( RENDERTEX_TEST_OUTPUT_DIR ) + "/" + name;
+}
+
+void ReportFailure( const char* file, int line, const char* expression )
+{
+    ++g_failedChecks;
+    printf( "%s:%d: %s: CHECK( %s ) failed\n", file, line, g_running, expression );
+}
+
+int main( int argc, char** argv )
+{
+    const char* filter = argc > 1 ? argv[1] : nullptr;
+
+    int run = 0;
+    int failed = 0;
+    for( const RegisteredTest& test : Tests() )
+    {
+        if( filter && !strstr( test.name, filter ) )
+            continue;
+
+        g_running = test.name;
+        const int failedBefore = g_failedChecks;
+        test.test();
+        ++run;
+        if( g_failedChecks != failedBefore )
+            ++failed;
+    }
+
+    printf( "%d tests, %d failed\n", run, failed );
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,154 @@
+//--------------------------------------------------------------------------------------
+// File: TextureSamplerTests.cpp
+//
+// The trilinear sampler: every path and texel layout gives the same bits, and the level
+// of detail picks the mip level the D3D11 rules ask for
+//--------------------------------------------------------------------------------------
+
+#include "TestHarness.h"
+#include "TextureSampler.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <random>
+#include <vector>
+
+
+namespace
+{
+    SoftwareTexture RandomTexture( uint32_t width, uint32_t height, TexelLayout layout )
+    {
+        std::mt19937 random( width * 7 + height );
+        std::vector<uint32_t> texels( size_t( width ) * height );
+        for( uint32_t& texel : texels )
+            texel = uint32_t( random() );
+        SoftwareTexture texture;
+        AppendTextureLevel( texture, width, height, texels.data() );
+        GenerateTextureMips( texture );
+        SetTextureLayout( texture, layout );
+        return texture;
+    }
+
+    //? A texture whose every level is one flat color, level i having red = 10 * i
+    SoftwareTexture FlatLevels( uint32_t width, uint32_t height )
+    {
+        SoftwareTexture texture;
+        for( uint32_t level = 0; ; ++level )
+        {
+            const uint32_t w = std::max( width >> level, 1u );
+            const uint32_t h = std::max( height >> level, 1u );
+            const std::vector<uint32_t> texels( size_t( w ) * h, 0xff000000u | ( level * 10 ) );
+            AppendTextureLevel( texture, w, h, texels.data() );
+            if( w == 1 && h == 1 )
+                return texture;
+        }
+    }
+
+    float SampleRed( const SoftwareTexture& texture, float u, float v, float lod )
+    {
+        float rgba[4];
+        SampleTextureLinear( texture, &u, &v, &lod, 1, rgba );
+        return rgba[0] * 255.0f;
+    }
+}
+
+TEST_CASE( TextureSamplerPathsAndLayoutsGiveTheSameBits )
+{
+    const size_t kPoints = 10007;
+    std::mt19937 random( 1 );
+    std::uniform_real_distribution<float> coordinate( -4.0f, 4.0f ), lod( -2.0f, 12.0f );
+    std::vector<float> u( kPoints ), v( kPoints ), lods( kPoints );
+    for( size_t i = 0; i < kPoints; ++i )
+    {
+        u[i] = coordinate( random );
+        v[i] = coordinate( random );
+        lods[i] = lod( random );
+    }
+
+    //? Coordinates and levels the gathers have to clamp or zero the same way
+    const float nan = std::numeric_limits<float>::quiet_NaN();
+    const float inf = std::numeric_limits<float>::infinity();
+    u[0] = nan; v[1] = inf; lods[2] = nan; lods[3] = -inf; lods[4] = inf; u[5] = 3e9f; v[6] = -3e9f;
+
+    const uint32_t kSizes[][2] = { { 256, 256 }, { 37, 53 }, { 1, 9 } };
+    for( const uint32_t* size : kSizes )
+    {
+        const SoftwareTexture linear = RandomTexture( size[0], size[1], TEXEL_LAYOUT_LINEAR );
+        const SoftwareTexture morton = RandomTexture( size[0], size[1], TEXEL_LAYOUT_MORTON );
+        std::vector<float> expected( kPoints * 4 ), actual( kPoints * 4 );
+        SampleTextureLinear( linear, u.data(), v.data(), lods.data(), kPoints, expected.data(), SAMPLER_PATH_SCALAR );
+
+        //? Counts that leave a partial batch on each path, and the full run
+        bool same = true;
+        for( uint32_t path = SAMPLER_PATH_SCALAR; path <= SAMPLER_PATH_AVX2; ++path )
+        {
+            for( const SoftwareTexture* texture : { &linear, &morton } )
+            {
+                for( size_t count : { size_t( 1 ), size_t( 3 ), size_t( 8 ), size_t( 13 ), kPoints } )
+                {
+                    std::fill( actual.begin(), actual.end(), -1.0f );
+                    SampleTextureLinear( *texture, u.data(), v.data(), lods.data(), count, actual.data(), SamplerPath( path ) );
+                    same &= memcmp( actual.data(), expected.data(), count * 4 * sizeof( float ) ) == 0;
+                    same &= count == kPoints || actual[count * 4] == -1.0f;
+                }
+            }
+        }
+        CHECK( same );
+
+        bool inRange = true;
+        for( float channel : expected )
+            inRange &= channel >= 0.0f && channel <= 1.0f;
+        CHECK( inRange );
+    }
+}
+
+TEST_CASE( TextureSamplerReturnsTexelsAtTheirCenters )
+{
+    const SoftwareTexture texture = RandomTexture( 16, 8, TEXEL_LAYOUT_MORTON );
+    bool exact = true;
+    for( uint32_t y = 0; y < 8; ++y )
+    {
+        for( uint32_t x = 0; x < 16; ++x )
+        {
+            const float u = ( float( x ) + 0.5f ) / 16.0f, v = ( float( y ) + 0.5f ) / 8.0f, lod = 0.0f;
+            float rgba[4];
+            SampleTextureLinear( texture, &u, &v, &lod, 1, rgba );
+            const uint32_t texel = texture.Fetch( 0, x, y );
+            for( int c = 0; c < 4; ++c )
+                exact &= fabsf( rgba[c] - float( ( texel >> ( c * 8 ) ) & 0xff ) / 255.0f ) < 1e-6f;
+        }
+    }
+    CHECK( exact );
+
+    //? u = 0 sits between the last texel of the row and the first, half of each
+    const uint32_t last = texture.Fetch( 0, 15, 0 ), first = texture.Fetch( 0, 0, 0 );
+    CHECK_NEAR( SampleRed( texture, 0.0f, 0.5f / 8.0f, 0.0f ), ( float( last & 0xff ) + float( first & 0xff ) ) / 2.0f, 1e-3f );
+}
+
+TEST_CASE( TextureSamplerComputesTheLevelOfDetail )
+{
+    const SoftwareTexture texture = RandomTexture( 256, 128, TEXEL_LAYOUT_LINEAR );
+    CHECK( texture.levels.size() == 9 );
+    CHECK( texture.levels[8].width == 1 && texture.levels[8].height == 1 );
+
+    //? One texel per pixel is level 0; the longer axis of the footprint decides
+    CHECK_NEAR( ComputeTextureLod( texture, 1.0f / 256.0f, 0.0f, 0.0f, 1.0f / 128.0f ), 0.0f, 1e-5f );
+    CHECK_NEAR( ComputeTextureLod( texture, 4.0f / 256.0f, 0.0f, 0.0f, 1.0f / 128.0f ), 2.0f, 1e-5f );
+    CHECK_NEAR( ComputeTextureLod( texture, 0.0f, 0.0f, 3.0f / 256.0f, 4.0f / 128.0f ), log2f( 5.0f ), 1e-5f );
+    CHECK( ComputeTextureLod( texture, 0.0f, 0.0f, 0.0f, 0.0f ) < 0.0f );
+}
+
+TEST_CASE( TextureSamplerBlendsTheSelectedLevels )
+{
+    const SoftwareTexture texture = FlatLevels( 64, 32 );
+    CHECK( texture.levels.size() == 7 );
+
+    //? Whole levels, halfway between two, and clamped at both ends of the chain
+    CHECK_NEAR( SampleRed( texture, 0.3f, 0.7f, 0.0f ), 0.0f, 1e-3f );
+    CHECK_NEAR( SampleRed( texture, 0.3f, 0.7f, 2.0f ), 20.0f, 1e-3f );
+    CHECK_NEAR( SampleRed( texture, 0.3f, 0.7f, 2.5f ), 25.0f, 1e-3f );
+    CHECK_NEAR( SampleRed( texture, 0.3f, 0.7f, -3.0f ), 0.0f, 1e-3f );
+    CHECK_NEAR( SampleRed( texture, 0.3f, 0.7f, 40.0f ), 60.0f, 1e-3f );
+}
@@ -0,0 +1,282 @@
+//--------------------------------------------------------------------------------------
+// File: TransientTargetsTests.cpp
+//
+// Transient lifetimes, the aliasing plan, and TransientTargetSet keeping its targets in
+// a RenderTargetPool across frames
+//--------------------------------------------------------------------------------------
+
+#include "TestHarness.h"
+#include "TransientTargets.h"
+
+#include <set>
+
+
+namespace
+{
+    //? 4 bytes per pixel, like the pool's tests
+    class TrackingAllocator : public IRenderTargetAllocator
+    {
+    public:
+        std::set<size_t>    live;
+        uint64_t            creates = 0;
+        bool                fail = false;
+
+        bool CreateTarget( size_t entry, const RenderTargetKey& key, uint64_t* bytes ) override
+        {
+            if( fail )
+                return false;
+            live.insert( entry );
+            *bytes = uint64_t( key.width ) * key.height * 4;
+            ++creates;
+            return true;
+        }
+
+        void DestroyTarget( size_t entry ) override { live.erase( entry ); }
+    };
+
+    const uint32_t kDepthFormat = 45;
+    const uint32_t kColorFormat = 28;
+    const uint32_t kDepthBind = 64;
+    const uint32_t kColorBind = 32;
+    const uint64_t kMB = 1024 * 1024;
+
+    TransientTextureDesc Texture( uint32_t width, uint32_t height, bool mayBeLarger = false,
+                                  uint32_t format = kDepthFormat, uint32_t bindFlags = kDepthBind )
+    {
+        TransientTextureDesc desc;
+        desc.name = "texture";
+        desc.key.width = width;
+        desc.key.height = height;
+        desc.key.format = format;
+        desc.key.bindFlags = bindFlags;
+        desc.mayBeLarger = mayBeLarger;
+        return desc;
+    }
+
+    //? Each texture written by a pass of its own, one after the other
+    void DeclareSequence( TransientFrame& frame, const TransientTextureDesc* textures, size_t count )
+    {
+        frame.Clear();
+        for( size_t i = 0; i < count; ++i )
+        {
+            const size_t texture = frame.AddTexture( textures[i] );
+            frame.Write( frame.AddPass( "window" ), texture );
+        }
+    }
+}
+
+TEST_CASE( TransientTexturesInSequenceShareATarget )
+{
+    //? Three windows drawn one after the other, each with its own depth buffer
+    const TransientTextureDesc depth[3] = { Texture( 800, 600, true ), Texture( 800, 600, true ), Texture( 800, 600, true ) };
+    TransientFrame frame;
+    TransientPlan plan;
+    DeclareSequence( frame, depth, 3 );
+    PlanTransientAliasing( frame, plan );
+
+    CHECK( plan.targets.size() == 1 );
+    CHECK( plan.targetOf[0] == 0 && plan.targetOf[1] == 0 && plan.targetOf[2] == 0 );
+    CHECK( plan.targets[0].textures == 3 && plan.targets[0].lastPass == 2 );
+    CHECK( plan.requestedBytes == 3 * 800 * 600 * 4 && plan.plannedBytes == 800 * 600 * 4 );
+    CHECK( plan.lifetimes[1].first == 1 && plan.lifetimes[1].last == 1 && plan.lifetimes[1].firstWrite == 1 );
+    CHECK( plan.Format() == "Transient targets: 3 textures in 1 targets, 1.83 MB instead of 5.49 MB, 0 read before written\n" );
+}
+
+TEST_CASE( TransientTexturesAliveTogetherDoNotShare )
+{
+    TransientFrame frame;
+    const size_t a = frame.AddTexture( Texture( 100, 100, false, kColorFormat, kColorBind ) );
+    const size_t b = frame.AddTexture( Texture( 100, 100, false, kColorFormat, kColorBind ) );
+    const size_t c = frame.AddTexture( Texture( 100, 100, false, kColorFormat, kColorBind ) );
+    const size_t pass0 = frame.AddPass( "a" );
+    const size_t pass1 = frame.AddPass( "b" );
+    const size_t pass2 = frame.AddPass( "c" );
+    frame.Write( pass0, a );
+    frame.Read( pass1, a );         // a ends in the pass b starts in
+    frame.Write( pass1, b );
+    frame.Read( pass2, b );
+    frame.Write( pass2, c );
+
+    TransientPlan plan;
+    PlanTransientAliasing( frame, plan );
+    CHECK( plan.lifetimes[a].Overlaps( plan.lifetimes[b] ) && !plan.lifetimes[a].Overlaps( plan.lifetimes[c] ) );
+    CHECK( plan.targets.size() == 2 );
+    CHECK( plan.targetOf[a] != plan.targetOf[b] );
+    CHECK( plan.targetOf[c] == plan.targetOf[a] );
+}
+
+TEST_CASE( TransientTargetsGrowOnlyWhenThatIsCheaper )
+{
+    TransientFrame frame;
+    TransientPlan plan;
+
+    // 800x600 and then 640x700: one 800x700 target is smaller than the two apart
+    const TransientTextureDesc grow[2] = { Texture( 800, 600, true ), Texture( 640, 700, true ) };
+    DeclareSequence( frame, grow, 2 );
+    PlanTransientAliasing( frame, plan );
+    CHECK( plan.targets.size() == 1 );
+    CHECK( plan.targets[0].key.width == 800 && plan.targets[0].key.height == 700 );
+    CHECK( plan.plannedBytes == 800 * 700 * 4 );
+
+    // 1000x100 and then 100x1000: a 1000x1000 target is larger than the two apart
+    const TransientTextureDesc apart[2] = { Texture( 1000, 100, true ), Texture( 100, 1000, true ) };
+    DeclareSequence( frame, apart, 2 );
+    PlanTransientAliasing( frame, plan );
+    CHECK( plan.targets.size() == 2 );
+    CHECK( plan.plannedBytes == plan.requestedBytes );
+
+    // A smaller texture fits into a larger target as it is
+    const TransientTextureDesc fits[2] = { Texture( 800, 600, true ), Texture( 640, 480, true ) };
+    DeclareSequence( frame, fits, 2 );
+    PlanTransientAliasing( frame, plan );
+    CHECK( plan.targets.size() == 1 && plan.targets[0].key.width == 800 && plan.targets[0].key.height == 600 );
+
+    // ...but only if it may be larger than drawn into, and only exact targets never grow
+    const TransientTextureDesc exact[2] = { Texture( 800, 600, true ), Texture( 640, 480 ) };
+    DeclareSequence( frame, exact, 2 );
+    PlanTransientAliasing( frame, plan );
+    CHECK( plan.targets.size() == 2 );
+    const TransientTextureDesc exactFirst[2] = { Texture( 640, 480 ), Texture( 800, 600, true ) };
+    DeclareSequence( frame, exactFirst, 2 );
+    PlanTransientAliasing( frame, plan );
+    CHECK( plan.targets.size() == 2 );
+}
+
+TEST_CASE( TransientTargetsPickTheSmallestThatFits )
+{
+    //? Two targets alive together, then a texture either could hold
+    TransientFrame frame;
+    const size_t large = frame.AddTexture( Texture( 1024, 1024, true ) );
+    const size_t small = frame.AddTexture( Texture( 512, 512, true ) );
+    const size_t later = frame.AddTexture( Texture( 400, 400, true ) );
+    const size_t pass0 = frame.AddPass( "both" );
+    const size_t pass1 = frame.AddPass( "later" );
+    frame.Write( pass0, large );
+    frame.Write( pass0, small );
+    frame.Write( pass1, later );
+
+    TransientPlan plan;
+    PlanTransientAliasing( frame, plan );
+    CHECK( plan.targets.size() == 2 );
+    CHECK( plan.targetOf[later] == plan.targetOf[small] );
+}
+
+TEST_CASE( TransientTargetsMatchFormatAndUsage )
+{
+    TransientFrame frame;
+    TransientPlan plan;
+
+    const TransientTextureDesc formats[2] = { Texture( 256, 256, true ), Texture( 256, 256, true, kColorFormat, kDepthBind ) };
+    DeclareSequence( frame, formats, 2 );
+    PlanTransientAliasing( frame, plan );
+    CHECK( plan.targets.size() == 2 );
+
+    const TransientTextureDesc usage[2] = { Texture( 256, 256, true ), Texture( 256, 256, true, kDepthFormat, kColorBind ) };
+    DeclareSequence( frame, usage, 2 );
+    PlanTransientAliasing( frame, plan );
+    CHECK( plan.targets.size() == 2 );
+
+    const TransientTextureDesc same[2] = { Texture( 256, 256, true ), Texture( 256, 256, true ) };
+    DeclareSequence( frame, same, 2 );
+    PlanTransientAliasing( frame, plan );
+    CHECK( plan.targets.size() == 1 );
+}
+
+TEST_CASE( TransientLifetimesFlagReadsBeforeWrites )
+{
+    TransientFrame frame;
+    const size_t history = frame.AddTexture( Texture( 64, 64 ) );   // read, never written
+    const size_t blend = frame.AddTexture( Texture( 64, 64 ) );     // read and written by one pass
+    const size_t color = frame.AddTexture( Texture( 64, 64 ) );     // written, then read
+    const size_t unused = frame.AddTexture( Texture( 64, 64 ) );
+    const size_t pass0 = frame.AddPass( "draw" );
+    const size_t pass1 = frame.AddPass( "post" );
+    frame.Read( pass0, history );
+    frame.Write( pass0, blend );
+    frame.Read( pass0, blend );
+    frame.Write( pass0, color );
+    frame.Read( pass1, color );
+
+    TransientPlan plan;
+    PlanTransientAliasing( frame, plan );
+    CHECK( plan.lifetimes[history].readBeforeWrite && plan.lifetimes[history].firstWrite == kNoTransient );
+    CHECK( plan.lifetimes[blend].readBeforeWrite );
+    CHECK( !plan.lifetimes[color].readBeforeWrite );
+    CHECK( !plan.lifetimes[unused].Used() && plan.targetOf[unused] == kNoTransient );
+    CHECK( plan.undefinedReads == 2 );
+    CHECK( plan.Format() == "Transient targets: 3 textures in 3 targets, 0.05 MB instead of 0.05 MB, 2 read before written\n" );
+}
+
+TEST_CASE( TransientTargetSetKeepsTargetsAcrossPlans )
+{
+    TrackingAllocator allocator;
+    RenderTargetPool pool( allocator, 64 * kMB );
+    {
+        TransientTargetSet set( pool );
+        TransientFrame frame;
+        TransientPlan plan;
+        const TransientTextureDesc depth[3] = { Texture( 800, 600, true ), Texture( 800, 600, true ), Texture( 800, 600, true ) };
+
+        // The same frame declared and planned again every frame
+        DeclareSequence( frame, depth, 3 );
+        PlanTransientAliasing( frame, plan );
+        CHECK( set.Realize( plan ) );
+        const size_t entry = set.TextureEntry( plan, 2 );
+        CHECK( entry != RenderTargetPool::kInvalidEntry && entry == set.TargetEntry( 0 ) );
+        bool same = true;
+        for( int i = 0; i < 10; ++i )
+        {
+            DeclareSequence( frame, depth, 3 );
+            PlanTransientAliasing( frame, plan );
+            same = same && set.Realize( plan ) && set.TextureEntry( plan, 0 ) == entry;
+        }
+        CHECK( same );
+        CHECK( set.GetStats().plans == 11 && set.GetStats().acquired == 1 && set.GetStats().kept == 10 );
+        CHECK( allocator.creates == 1 && pool.LiveCount() == 1 );
+
+        // A resize asks for another target; the old one goes back to the pool
+        const TransientTextureDesc resized[3] = { Texture( 1024, 768, true ), Texture( 1024, 768, true ), Texture( 1024, 768, true ) };
+        DeclareSequence( frame, resized, 3 );
+        PlanTransientAliasing( frame, plan );
+        CHECK( set.Realize( plan ) );
+        CHECK( set.GetStats().acquired == 2 && pool.LiveCount() == 1 && pool.FreeCount() == 1 );
+
+        CHECK( set.GetStats().peakRequestedBytes == 3 * 1024 * 768 * 4 );
+        CHECK( set.GetStats().peakPlannedBytes == 1024 * 768 * 4 );
+        CHECK( set.Format() == "Transient targets: 12 plans, 10 targets kept, 2 acquired, 0 failed; peak 3.00 MB instead of 9.00 MB\n" );
+
+        // Nothing planned: nothing held
+        frame.Clear();
+        PlanTransientAliasing( frame, plan );
+        CHECK( set.Realize( plan ) );
+        CHECK( pool.LiveCount() == 0 && set.TargetEntry( 0 ) == RenderTargetPool::kInvalidEntry );
+
+        DeclareSequence( frame, depth, 3 );
+        PlanTransientAliasing( frame, plan );
+        set.Realize( plan );
+        CHECK( pool.LiveCount() == 1 );
+    }
+    CHECK( pool.LiveCount() == 0 );
+}
+
+TEST_CASE( TransientTargetSetReportsFailedTargets )
+{
+    TrackingAllocator allocator;
+    allocator.fail = true;
+    RenderTargetPool pool( allocator, 64 * kMB );
+    TransientTargetSet set( pool );
+    TransientFrame frame;
+    TransientPlan plan;
+    const TransientTextureDesc depth[1] = { Texture( 800, 600, true ) };
+    DeclareSequence( frame, depth, 1 );
+    PlanTransientAliasing( frame, plan );
+
+    CHECK( !set.Realize( plan ) );
+    CHECK( set.TextureEntry( plan, 0 ) == RenderTargetPool::kInvalidEntry );
+    CHECK( set.GetStats().failed == 1 );
+
+    // The next plan tries again
+    allocator.fail = false;
+    CHECK( set.Realize( plan ) );
+    CHECK( set.TextureEntry( plan, 0 ) != RenderTargetPool::kInvalidEntry );
+}
@@ -0,0 +1,189 @@
+//--------------------------------------------------------------------------------------
+// File: UploadRingTests.cpp
+//
+// UploadRing offsets under both wrap policies
+//--------------------------------------------------------------------------------------
+
+#include "TestHarness.h"
+#include "UploadRing.h"
+
+
+TEST_CASE( UploadRingAlignsAndRejectsBadSizes )
+{
+    UploadRing ring( 1024, 256, UploadRing::WRAP_DISCARD );
+    const UploadRing::Allocation first = ring.Allocate( 80 );
+    CHECK( first.valid && first.offset == 0 && first.size == 256 );
+    CHECK( first.discard );                 // the first map always discards
+    const UploadRing::Allocation second = ring.Allocate( 257 );
+    CHECK( second.valid && second.offset == 256 && second.size == 512 && !second.discard );
+
+    CHECK( !ring.Allocate( 0 ).valid );
+    CHECK( !ring.Allocate( 1025 ).valid );
+    CHECK( ring.GetStats().failed == 2 );
+    CHECK( ring.GetStats().allocations == 2 );
+    CHECK( ring.GetStats().bytesAllocated == 768 );
+}
+
+TEST_CASE( UploadRingDiscardsOnWrap )
+{
+    UploadRing ring( 1024, 256, UploadRing::WRAP_DISCARD );
+    ring.Allocate( 256 );
+    ring.EndFrame( 1 );
+    ring.Allocate( 512 );
+    ring.EndFrame( 2 );
+    CHECK( ring.FramesInFlight() == 2 );
+
+    // Nothing retired, and still no wait: the driver renames the buffer
+    const UploadRing::Allocation wrapped = ring.Allocate( 512 );
+    CHECK( wrapped.valid && wrapped.offset == 0 && wrapped.discard );
+    CHECK( ring.FramesInFlight() == 0 );
+    CHECK( ring.BytesInUse() == 512 );
+
+    const UploadRing::Stats& stats = ring.GetStats();
+    CHECK( stats.wraps == 1 );
+    CHECK( stats.discards == 2 );
+    CHECK( stats.bytesSkipped == 256 );
+}
+
+TEST_CASE( UploadRingFencedWrapWaitsForRetiredFrames )
+{
+    UploadRing ring( 1024, 256, UploadRing::WRAP_FENCED );
+    ring.Allocate( 512 );
+    ring.EndFrame( 1 );
+    ring.Allocate( 256 );
+    ring.EndFrame( 2 );
+
+    // 256 bytes left at the end; 512 only fit at the front, which frame 1 still uses
+    CHECK( !ring.Allocate( 512 ).valid );
+    CHECK( ring.GetStats().failed == 1 );
+    CHECK( ring.GetStats().wraps == 0 );
+
+    ring.Retire( 0 );                       // older than any fence
+    CHECK( !ring.Allocate( 512 ).valid );
+
+    ring.Retire( 1 );
+    CHECK( ring.Tail() == 512 );
+    const UploadRing::Allocation wrapped = ring.Allocate( 512 );
+    CHECK( wrapped.valid && wrapped.offset == 0 && !wrapped.discard );
+    CHECK( ring.GetStats().wraps == 1 );
+    CHECK( ring.GetStats().bytesSkipped == 256 );
+}
+
+TEST_CASE( UploadRingReusesRetiredSpace )
+{
+    UploadRing ring( 1024, 256, UploadRing::WRAP_FENCED );
+    for( uint64_t frame = 1; frame <= 4; ++frame )
+    {
+        ring.Allocate( 256 );
+        ring.EndFrame( frame );
+    }
+    CHECK( ring.BytesInUse() == 1024 );
+    CHECK( !ring.Allocate( 256 ).valid );
+
+    ring.Retire( 2 );
+    CHECK( ring.BytesInUse() == 512 );
+    CHECK( ring.FramesInFlight() == 2 );
+    const UploadRing::Allocation a = ring.Allocate( 256 );
+    const UploadRing::Allocation b = ring.Allocate( 256 );
+    CHECK( a.valid && a.offset == 0 );
+    CHECK( b.valid && b.offset == 256 );
+    ring.EndFrame( 5 );
+
+    // Retiring everything lets the next allocation start at the front again
+    ring.Retire( 5 );
+    CHECK( ring.BytesInUse() == 0 );
+    const UploadRing::Allocation whole = ring.Allocate( 1024 );
+    CHECK( whole.valid && whole.offset == 0 );
+}
+
+TEST_CASE( UploadRingFitsExactlyAtTheTail )
+{
+    UploadRing ring( 1000, 100, UploadRing::WRAP_FENCED );
+    ring.Allocate( 700 );
+    ring.EndFrame( 1 );
+
+    // Exactly the space left at the end: no wrap, nothing skipped
+    const UploadRing::Allocation last = ring.Allocate( 300 );
+    CHECK( last.valid && last.offset == 700 );
+    CHECK( ring.Head() == 1000 );
+    CHECK( ring.GetStats().wraps == 0 );
+    ring.EndFrame( 2 );
+
+    // And exactly the retired space at the front
+    ring.Retire( 1 );
+    const UploadRing::Allocation front = ring.Allocate( 700 );
+    CHECK( front.valid && front.offset == 0 );
+    CHECK( ring.GetStats().bytesSkipped == 0 );
+    CHECK( ring.Head() == ring.Tail() );
+}
+
+TEST_CASE( UploadRingTellsFullFromEmptyWhenHeadMeetsTail )
+{
+    UploadRing ring( 1024, 256, UploadRing::WRAP_FENCED );
+    ring.Allocate( 512 );
+    ring.EndFrame( 1 );
+    ring.Allocate( 512 );
+    ring.EndFrame( 2 );
+    ring.Retire( 1 );
+    ring.Allocate( 512 );                   // wraps to the front and ends at the tail
+    ring.EndFrame( 3 );
+
+    // head == tail with bytes in use: full
+    CHECK( ring.Head() == 512 && ring.Tail() == 512 );
+    CHECK( ring.BytesInUse() == 1024 );
+    CHECK( !ring.Allocate( 256 ).valid );
+
+    // head == tail with nothing in use: empty, and allocation starts over at 0
+    ring.Retire( 3 );
+    CHECK( ring.BytesInUse() == 0 );
+    CHECK( ring.Head() == ring.Tail() );
+    const UploadRing::Allocation next = ring.Allocate( 1024 );
+    CHECK( next.valid && next.offset == 0 );
+}
+
+TEST_CASE( UploadRingSkipsFencesForEmptyFrames )
+{
+    UploadRing ring( 1024, 256, UploadRing::WRAP_FENCED );
+    ring.EndFrame( 1 );
+    CHECK( ring.FramesInFlight() == 0 );
+    ring.Allocate( 256 );
+    ring.EndFrame( 2 );
+    ring.EndFrame( 3 );
+    CHECK( ring.FramesInFlight() == 1 );
+
+    CHECK( ring.BytesInUse() == 256 );
+}
+
+TEST_CASE( UploadRingGivesSkippedSpaceBackWithTheNextFrame )
+{
+    UploadRing ring( 1024, 256, UploadRing::WRAP_FENCED );
+    ring.Allocate( 512 );
+    ring.EndFrame( 1 );
+    ring.Allocate( 256 );
+    ring.EndFrame( 2 );
+    ring.Retire( 1 );
+
+    // Wraps past the last 256 bytes, which stay in use until the wrapping frame retires
+    CHECK( ring.Allocate( 512 ).offset == 0 );
+    ring.EndFrame( 3 );
+    CHECK( ring.BytesInUse() == 256 + 256 + 512 );
+    ring.Retire( 2 );
+    CHECK( ring.BytesInUse() == 256 + 512 );
+    ring.Retire( 3 );
+    CHECK( ring.BytesInUse() == 0 );
+}
+
+TEST_CASE( UploadRingResetDiscardsAtTheFront )
+{
+    UploadRing ring( 1024, 256, UploadRing::WRAP_FENCED );
+    ring.Allocate( 256 );
+    ring.Allocate( 256 );
+    ring.EndFrame( 1 );
+
+    ring.Reset();
+    CHECK( ring.FramesInFlight() == 0 );
+    CHECK( ring.BytesInUse() == 0 );
+    const UploadRing::Allocation first = ring.Allocate( 256 );
+    CHECK( first.valid && first.offset == 0 && first.discard );
+    CHECK( !ring.Allocate( 256 ).discard );
+}
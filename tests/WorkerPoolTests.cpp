@@ -0,0 +1,128 @@
+//--------------------------------------------------------------------------------------
+// File: WorkerPoolTests.cpp
+//
+// WorkerPool job graphs, and shader prefetching with a compiler that only takes time
+//--------------------------------------------------------------------------------------
+
+#include "TestHarness.h"
+#include "RenderDevice.h"
+#include "RenderThreads.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <thread>
+
+
+namespace
+{
+    const auto kFakeCompileTime = std::chrono::milliseconds( 15 );
+
+    //? Sleeps like a D3DCompile call and returns the source as bytecode
+    bool FakeCompile( const char* source, const char* entryPoint, const char*, std::vector<uint8_t>& bytecode )
+    {
+        std::this_thread::sleep_for( kFakeCompileTime );
+        bytecode.assign( source, source + strlen( source ) );
+        bytecode.push_back( uint8_t( entryPoint[0] ) );
+        return true;
+    }
+}
+
+TEST_CASE( WorkerPoolRunsADiamondInOrder )
+{
+    WorkerPool pool( 3 );
+    std::atomic<int> step( 0 );
+    int top = -1, left = -1, right = -1, bottom = -1;
+
+    const WorkerPool::JobId a = pool.Submit( "top", [&]()
+    {
+        std::this_thread::sleep_for( std::chrono::milliseconds( 5 ) );
+        top = step++;
+    } );
+    const WorkerPool::JobId b = pool.Submit( "left", [&]() { left = step++; }, { a } );
+    const WorkerPool::JobId c = pool.Submit( "right", [&]() { right = step++; }, { a } );
+    const WorkerPool::JobId d = pool.Submit( "bottom", [&]() { bottom = step++; }, { b, c } );
+    pool.Wait( d );
+
+    CHECK( top == 0 );
+    CHECK( ( left == 1 && right == 2 ) || ( left == 2 && right == 1 ) );
+    CHECK( bottom == 3 );
+
+    const std::vector<WorkerPool::JobTiming> timings = pool.Timings();
+    CHECK( timings.size() == 4 );
+    CHECK( timings[d].dependencies.size() == 2 );
+    CHECK( timings[d].startMs >= timings[b].endMs && timings[d].startMs >= timings[c].endMs );
+    CHECK( timings[b].startMs >= timings[a].endMs );
+
+    const std::string report = WorkerPool::FormatReport( timings );
+    CHECK( report.find( "Worker pool: 4 jobs" ) == 0 );
+    CHECK( report.find( "'bottom'" ) != std::string::npos );
+    CHECK( report.find( "after 1,2" ) != std::string::npos );
+}
+
+TEST_CASE( WorkerPoolDoesNotWaitForFinishedDependencies )
+{
+    WorkerPool pool( 1 );
+    const WorkerPool::JobId first = pool.Submit( "first", []() {} );
+    pool.Wait( first );
+
+    bool ran = false;
+    pool.Wait( pool.Submit( "second", [&ran]() { ran = true; }, { first } ) );
+    CHECK( ran );
+    pool.Wait( 1000 );      // unknown ids return at once
+}
+
+TEST_CASE( WorkerPoolClearsItsHistory )
+{
+    WorkerPool pool( 0 );   // still one worker
+    CHECK( pool.ThreadCount() == 1 );
+
+    std::atomic<int> done( 0 );
+    for( int i = 0; i < 8; ++i )
+        pool.Submit( "job", [&done]() { ++done; } );
+    pool.ClearHistory();
+    CHECK( done == 8 );
+    CHECK( pool.Timings().empty() );
+    CHECK( pool.Submit( "again", []() {} ) == 0 );
+}
+
+TEST_CASE( WorkerPoolFinishesJobsBeforeItIsDestroyed )
+{
+    std::atomic<int> done( 0 );
+    {
+        WorkerPool pool( 2 );
+        for( int i = 0; i < 16; ++i )
+            pool.Submit( "job", [&done]() { std::this_thread::sleep_for( std::chrono::milliseconds( 1 ) ); ++done; } );
+    }
+    CHECK( done == 16 );
+}
+
+TEST_CASE( ShaderPrefetchOverlapsCompiles )
+{
+    SharedRenderAssets assets;
+    const char* sources[4] = { "a", "bb", "ccc", "dddd" };
+    for( const char* source : sources )
+        assets.AddProgram( source, source );
+
+    WorkerPool pool( 4 );
+    assets.PrefetchAll( FakeCompile, pool );
+
+    // Joining a prefetched stage returns its bytecode without compiling again
+    const std::vector<uint8_t>* bytecode = assets.Bytecode( 3, SHADER_STAGE_PIXEL, FakeCompile );
+    CHECK( bytecode && bytecode->size() == 5 && bytecode->back() == 'P' );
+    pool.WaitAll();
+
+    const std::vector<WorkerPool::JobTiming> timings = pool.Timings();
+    CHECK( timings.size() == 8 );
+    double first = timings[0].submitMs, last = 0.0, serial = 0.0;
+    for( const WorkerPool::JobTiming& timing : timings )
+    {
+        first = timing.submitMs < first ? timing.submitMs : first;
+        last = timing.endMs > last ? timing.endMs : last;
+        serial += timing.endMs - timing.startMs;
+    }
+
+    // Eight 15 ms compiles on four workers take about two compiles, not eight
+    CHECK( serial >= 8 * 15.0 );
+    CHECK( last - first < serial / 2.0 );
+}